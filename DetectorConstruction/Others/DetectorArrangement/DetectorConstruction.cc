@@ -0,0 +1,83 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Detectors in air around the origin, whose arrangement is read from a text file at runtime
+(see DetectorArrangement.hh). Intended for the evaluation of different detector arrangements
+without recompiling utr. By default, the file Detectors.txt in this directory is used, which
+contains the gamma^3 setup of runs 271 - 279 (compare Detectors_G3_271_279.cc of Campaign_2018_2019).
+Use another file with
+
+/utr/setArrangementFile Detectors FILENAME
+
+before /run/initialize.
+*/
+
+#include "DetectorConstruction.hh"
+
+// Materials
+#include "G4NistManager.hh"
+
+// Geometry
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4VisAttributes.hh"
+#include "globals.hh"
+
+static const G4String this_directory = G4String(__FILE__).substr(0, G4String(__FILE__).find_last_of('/') + 1);
+
+DetectorConstruction::DetectorConstruction() : Max_Sensitive_Detector_ID(0), detectors(nullptr) {}
+
+DetectorConstruction::~DetectorConstruction() { delete detectors; }
+
+G4VPhysicalVolume *DetectorConstruction::Construct() {
+
+  G4NistManager *nist = G4NistManager::Instance();
+  G4Material *air = nist->FindOrBuildMaterial("G4_AIR");
+
+  /***************** WORLD *****************/
+
+  G4double World_x = 2000. * mm;
+  G4double World_y = 2000. * mm;
+  G4double World_z = 2000. * mm;
+
+  G4Box *World_dim = new G4Box("World_Solid", World_x * 0.5, World_y * 0.5, World_z * 0.5);
+
+  G4LogicalVolume *World_Logical = new G4LogicalVolume(World_dim, air, "World_Logical", 0, 0, 0);
+
+  World_Logical->SetVisAttributes(G4VisAttributes::GetInvisible());
+
+  G4VPhysicalVolume *World_Physical = new G4PVPlacement(0, G4ThreeVector(), World_Logical, "World", 0, false, 0);
+
+  /***************** DETECTORS *****************/
+
+  delete detectors;
+  detectors = new DetectorArrangement(World_Logical, "Detectors", this_directory + "Detectors.txt");
+  detectors->Construct(G4ThreeVector());
+
+  Max_Sensitive_Detector_ID = detectors->Get_Max_Sensitive_Detector_ID() < 0 ? 0 : detectors->Get_Max_Sensitive_Detector_ID();
+
+  return World_Physical;
+}
+
+void DetectorConstruction::ConstructSDandField() {
+  detectors->ConstructSDs();
+}
@@ -59,6 +59,9 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
  * EVENT_POSZ
  * EVENT_PARTICLE
  * EVENT_VOLUME
+ *
+ * Alternatively, the depth-resolved photon spectrum can be scored without any ntuple output by the
+ * track-length estimator '/utr/flux/cylinder target 10 50 1 100 0 0 0 mm' (see FluxScoring).
  */
 
 const size_t n_target_layers = 100; // Determines the number of layers of the target.
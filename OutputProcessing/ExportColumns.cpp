@@ -0,0 +1,423 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// exportColumns converts the n-tuples of ROOT output files to text, raw binary or NumPy files.
+// It is a fast replacement for RootToTxt, and produces the same text format by default.
+//
+// - The branches are read basket by basket with the bulk I/O of ROOT where possible, instead of
+//   entry by entry.
+// - Numbers are formatted with std::to_chars into a large buffer, which is written at once.
+// - Several files are converted in parallel.
+//
+// Output formats (the output files have the name of the input file without the '.root' suffix):
+// - txt: One row per entry with the values in the format '%.6e' separated by tabs, like RootToTxt.
+// - bin: One row per entry with the values as little-endian 64-bit floats, without any header.
+//        The names of the branches are written to a text file with the suffix '.columns'.
+// - npy: One NumPy file '<name>_<branch>.npy' per branch with a one-dimensional array of
+//        little-endian 64-bit floats, which can be read with numpy.load() or NPZ.jl without
+//        reading the other columns.
+
+#include <argp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+#include <RVersion.h>
+#include <TBranch.h>
+#include <TBufferFile.h>
+#include <TFile.h>
+#include <TKey.h>
+#include <TLeaf.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Size of the output buffer of each thread
+static const size_t buffer_size = 16 * 1024 * 1024;
+// Number of entries which are read at once from branches that do not support bulk reading
+static const Long64_t block_size = 4096;
+
+static char doc[] = "Convert the n-tuples of ROOT files to text, raw binary or NumPy files";
+static char args_doc[] = "FILE...";
+
+static struct argp_option options[] = {
+    {"tree", 't', "TREENAME", 0, "Name of the tree (default: the first tree in each file)", 0},
+    {"format", 'f', "FORMAT", 0, "Output format 'txt', 'bin' or 'npy' (default: txt)", 0},
+    {"outputdir", 'o', "OUTPUTDIR", 0, "Directory in which the output files will be written (default: same as the input file)", 0},
+    {"precision", 'p', "DIGITS", 0, "Number of digits after the decimal point in the text format (default: 6)", 0},
+    {"threads", 'j', "NTHREADS", 0, "Number of files which are converted in parallel (default: number of cores)", 0},
+    {"silent", 's', 0, 0, "Silent mode", 0},
+    {0, 0, 0, 0, 0, 0}};
+
+struct arguments {
+  string tree = "";
+  string format = "txt";
+  string outputDir = "";
+  int precision = 6;
+  unsigned int nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+  bool verbose = true;
+  vector<string> files;
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  struct arguments *arguments = (struct arguments *)state->input;
+  switch (key) {
+    case 't':
+      arguments->tree = arg;
+      break;
+    case 'f':
+      arguments->format = arg;
+      break;
+    case 'o':
+      arguments->outputDir = arg;
+      break;
+    case 'p':
+      arguments->precision = atoi(arg);
+      break;
+    case 'j':
+      arguments->nthreads = (unsigned int)std::max(atoi(arg), 1);
+      break;
+    case 's':
+      arguments->verbose = false;
+      break;
+    case ARGP_KEY_ARG:
+      arguments->files.push_back(arg);
+      break;
+    case ARGP_KEY_END:
+      if (arguments->files.size() == 0) {
+        argp_usage(state);
+      }
+      break;
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
+
+static std::mutex outputMutex;
+
+// Buffered output file
+class OutputFile {
+  public:
+  OutputFile(const string &filename) : file(fopen(filename.c_str(), "wb")) {
+    buffer.reserve(buffer_size);
+  }
+  ~OutputFile() {
+    Flush();
+    if (file) {
+      fclose(file);
+    }
+  }
+
+  bool IsOpen() const { return file != nullptr; }
+
+  void Write(const char *data, size_t size) {
+    if (buffer.size() + size > buffer_size) {
+      Flush();
+    }
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  // Values in little-endian byte order
+  void WriteDoubles(const double *values, size_t n) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    Write(reinterpret_cast<const char *>(values), n * sizeof(double));
+#else
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t bits;
+      memcpy(&bits, &values[i], sizeof(bits));
+      bits = __builtin_bswap64(bits);
+      Write(reinterpret_cast<const char *>(&bits), sizeof(bits));
+    }
+#endif
+  }
+
+  // Same format as std::scientific, followed by a tab
+  void WriteText(double value, int precision) {
+    char text[64];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text) - 1, value, std::chars_format::scientific, precision);
+    *result.ptr = '\t';
+    Write(text, (size_t)(result.ptr - text) + 1);
+#else
+    const int length = snprintf(text, sizeof(text), "%.*e\t", precision, value);
+    Write(text, (size_t)length);
+#endif
+  }
+
+  void Flush() {
+    if (file && buffer.size() > 0) {
+      fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+    buffer.clear();
+  }
+
+  private:
+  FILE *file;
+  vector<char> buffer;
+};
+
+// Reads the values of a branch basket by basket. Only branches with a single Double_t leaf are
+// read in bulk, all others entry by entry.
+class BranchReader {
+  public:
+  BranchReader(TBranch *br) : branch(br), leaf((TLeaf *)br->GetListOfLeaves()->At(0)), next_entry(0), bulk(false), bulk_buffer(TBuffer::kWrite, 32 * 1024) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 14, 0)
+    bulk = branch->GetListOfLeaves()->GetEntries() == 1 && string(leaf->GetTypeName()) == "Double_t" && branch->SupportsBulkRead();
+#endif
+  }
+
+  // Appends the values of the next basket (or block of entries) to values. Returns false after the last entry.
+  bool ReadNext(vector<double> &values) {
+    if (next_entry >= branch->GetEntries()) {
+      return false;
+    }
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 14, 0)
+    if (bulk) {
+      const Int_t n = branch->GetBulkRead().GetBulkEntries(next_entry, bulk_buffer);
+      if (n > 0) {
+        const double *data = reinterpret_cast<const double *>(bulk_buffer.GetCurrent());
+        values.insert(values.end(), data, data + n);
+        next_entry += n;
+        return true;
+      }
+      // Fall back to reading entry by entry
+      bulk = false;
+    }
+#endif
+    const Long64_t last_entry = std::min(next_entry + block_size, branch->GetEntries());
+    for (; next_entry < last_entry; ++next_entry) {
+      branch->GetEntry(next_entry);
+      values.push_back(leaf->GetValue());
+    }
+    return true;
+  }
+
+  bool IsBulk() const { return bulk; }
+
+  private:
+  TBranch *branch;
+  TLeaf *leaf;
+  Long64_t next_entry;
+  bool bulk;
+  TBufferFile bulk_buffer;
+};
+
+static string OutputBasename(const string &filename, const string &outputDir) {
+  string basename = filename;
+  if (basename.size() >= 5 && basename.compare(basename.size() - 5, 5, ".root") == 0) {
+    basename = basename.substr(0, basename.size() - 5);
+  }
+  if (outputDir != "") {
+    basename = outputDir + "/" + basename.substr(basename.find_last_of('/') + 1);
+  }
+  return basename;
+}
+
+// Header of a NumPy file (format version 1.0) with a one-dimensional array of little-endian doubles
+static string NumpyHeader(Long64_t n_entries) {
+  string header = "{'descr': '<f8', 'fortran_order': False, 'shape': (" + std::to_string(n_entries) + ",), }";
+  // The magic string, the version, the header length and the header are padded to a multiple of 64 bytes
+  const size_t total_size = ((10 + header.size() + 1 + 63) / 64) * 64;
+  header.append(total_size - 10 - header.size() - 1, ' ');
+  header += '\n';
+  const uint16_t header_length = (uint16_t)header.size();
+  string preamble = "\x93NUMPY";
+  preamble += '\x01';
+  preamble += '\x00';
+  preamble += (char)(header_length & 0xff);
+  preamble += (char)(header_length >> 8);
+  return preamble + header;
+}
+
+static bool ConvertFile(const string &filename, const struct arguments &arguments) {
+  const auto start = std::chrono::steady_clock::now();
+
+  TFile file(filename.c_str());
+  if (file.IsZombie()) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    cerr << "> ERROR: Could not open '" << filename << "'" << endl;
+    return false;
+  }
+
+  TTree *tree = nullptr;
+  if (arguments.tree != "") {
+    tree = dynamic_cast<TTree *>(file.Get(arguments.tree.c_str()));
+  } else {
+    for (auto key : *file.GetListOfKeys()) {
+      tree = dynamic_cast<TTree *>(((TKey *)key)->ReadObj());
+      if (tree) {
+        break;
+      }
+    }
+  }
+  if (!tree) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    cerr << "> ERROR: '" << filename << "' does not contain a tree" << (arguments.tree != "" ? " named '" + arguments.tree + "'" : "") << endl;
+    return false;
+  }
+
+  const Long64_t n_entries = tree->GetEntries();
+  vector<std::unique_ptr<BranchReader>> readers;
+  vector<string> names;
+  for (auto branch : *tree->GetListOfBranches()) {
+    readers.push_back(std::unique_ptr<BranchReader>(new BranchReader((TBranch *)branch)));
+    names.push_back(branch->GetName());
+  }
+  const size_t n_branches = readers.size();
+
+  const string basename = OutputBasename(filename, arguments.outputDir);
+  vector<std::unique_ptr<OutputFile>> outputFiles;
+  if (arguments.format == "npy") {
+    for (auto &name : names) {
+      outputFiles.push_back(std::unique_ptr<OutputFile>(new OutputFile(basename + "_" + name + ".npy")));
+      const string header = NumpyHeader(n_entries);
+      outputFiles.back()->Write(header.data(), header.size());
+    }
+  } else {
+    outputFiles.push_back(std::unique_ptr<OutputFile>(new OutputFile(basename + "." + arguments.format)));
+    if (arguments.format == "bin") {
+      OutputFile columnsFile(basename + ".columns");
+      for (auto &name : names) {
+        columnsFile.Write(name.data(), name.size());
+        columnsFile.Write("\n", 1);
+      }
+    }
+  }
+  for (auto &outputFile : outputFiles) {
+    if (!outputFile->IsOpen()) {
+      std::lock_guard<std::mutex> lock(outputMutex);
+      cerr << "> ERROR: Could not open the output file for '" << filename << "'" << endl;
+      return false;
+    }
+  }
+
+  // The baskets of the branches have different sizes, so the values are collected per branch
+  // until the rows which are complete in all branches can be written.
+  vector<vector<double>> columns(n_branches);
+  vector<size_t> positions(n_branches, 0); // First value of each column which has not been written yet
+  vector<double> row(n_branches);
+  for (Long64_t n_written = 0; n_written < n_entries;) {
+    size_t n_rows = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < n_branches; ++i) {
+      if (positions[i] == columns[i].size()) {
+        columns[i].clear();
+        positions[i] = 0;
+      }
+      if (columns[i].size() == 0 && !readers[i]->ReadNext(columns[i])) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        cerr << "> ERROR: Branch '" << names[i] << "' of '" << filename << "' has fewer entries than the tree" << endl;
+        return false;
+      }
+      n_rows = std::min(n_rows, columns[i].size() - positions[i]);
+    }
+
+    if (arguments.format == "npy") {
+      for (size_t i = 0; i < n_branches; ++i) {
+        outputFiles[i]->WriteDoubles(columns[i].data() + positions[i], n_rows);
+      }
+    } else {
+      for (size_t r = 0; r < n_rows; ++r) {
+        if (arguments.format == "bin") {
+          for (size_t i = 0; i < n_branches; ++i) {
+            row[i] = columns[i][positions[i] + r];
+          }
+          outputFiles[0]->WriteDoubles(row.data(), n_branches);
+        } else {
+          for (size_t i = 0; i < n_branches; ++i) {
+            outputFiles[0]->WriteText(columns[i][positions[i] + r], arguments.precision);
+          }
+          outputFiles[0]->Write("\n", 1);
+        }
+      }
+    }
+
+    for (size_t i = 0; i < n_branches; ++i) {
+      positions[i] += n_rows;
+    }
+    n_written += (Long64_t)n_rows;
+  }
+  outputFiles.clear();
+
+  if (arguments.verbose) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t n_bulk = 0;
+    for (auto &reader : readers) {
+      if (reader->IsBulk()) {
+        ++n_bulk;
+      }
+    }
+    std::lock_guard<std::mutex> lock(outputMutex);
+    cout << "> " << filename << ": " << n_entries << " entries, " << n_branches << " branches (" << n_bulk << " read in bulk) in " << seconds << " s" << endl;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  struct arguments arguments;
+  argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+  if (arguments.format != "txt" && arguments.format != "bin" && arguments.format != "npy") {
+    cerr << "> ERROR: Unknown FORMAT '" << arguments.format << "', expected 'txt', 'bin' or 'npy'. Aborting..." << endl;
+    return 1;
+  }
+
+  ROOT::EnableThreadSafety();
+
+  // Each thread converts one file at a time
+  std::atomic<size_t> next_file(0);
+  std::atomic<bool> success(true);
+  vector<std::thread> threads;
+  for (unsigned int i = 0; i < std::min((size_t)arguments.nthreads, arguments.files.size()); ++i) {
+    threads.push_back(std::thread([&]() {
+      for (size_t f = next_file++; f < arguments.files.size(); f = next_file++) {
+        if (!ConvertFile(arguments.files[f], arguments)) {
+          success = false;
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  return success ? 0 : 1;
+}
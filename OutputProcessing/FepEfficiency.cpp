@@ -0,0 +1,375 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// fepEfficiency extracts the full-energy peak (FEP), single-escape (SE) and double-escape (DE)
+// efficiencies from the histogram files of an efficiency sweep, i.e. from the output of getHistogram
+// for a series of simulations with monoenergetic photons.
+//
+// The energy of the photons is taken from the name of each file, for example 'Efficiency_1000_keV_hist.root'
+// (see run_simulations.sh). The content of each peak is determined in a window around the peak energy,
+// optionally with a linear background from two side bands of the same width, or by a fit of a
+// Gaussian on a linear background. The files are processed in parallel, and all results are written
+// to a single table.
+
+#include <argp.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Math/MinimizerOptions.h>
+#include <TF1.h>
+#include <TFile.h>
+#include <TFitResult.h>
+#include <TH1.h>
+#include <TROOT.h>
+#include <TSystemDirectory.h>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::map;
+using std::string;
+using std::vector;
+
+static const double electron_mass = 0.51099895; // In MeV
+
+static char doc[] = "Extract full-energy peak and escape peak efficiencies from the histogram files of an efficiency sweep";
+static char args_doc[] = "";
+
+static struct argp_option options[] = {
+    {"inputdir", 'd', "INPUTDIR", 0, "Directory to search for histogram files (default: current working directory '.')", 0},
+    {"pattern1", 'p', "PATTERN1", 0, "First string files must contain to be processed (default: '')", 0},
+    {"pattern2", 'q', "PATTERN2", 0, "Second string files must contain to be processed (default: _hist.root)", 0},
+    {"nsim", 'n', "NSIM", 0, "Number of simulated primary particles per file (required)", 0},
+    {"window", 'w', "WIDTH", 0, "Half width of the peak window in keV (default: 2 keV)", 0},
+    {"background", 'b', "MODE", 0, "Background under the peaks: 'none', 'sideband' (linear background from two side bands with the width of the peak window) or 'fit' (Gaussian on a linear background in three times the peak window) (default: sideband)", 0},
+    {"group", 'g', "NAME=ID,ID,...", 0, "Sum the histograms of several detectors, e.g. 'clover1=8,9,10,11'. Can be given several times.", 0},
+    {"maxid", 'm', "MAXID", 0, "Highest detector ID of the individual detectors (default: all histograms 'hist<ID>' in the files)", 0},
+    {"filename", 'o', "OUTPUTFILENAME", 0, "Output file name (default: INPUTDIR/fep_efficiency.txt)", 0},
+    {"threads", 'j', "NTHREADS", 0, "Number of files which are processed in parallel (default: number of cores)", 0},
+    {0, 0, 0, 0, 0, 0}};
+
+struct arguments {
+  string inputDir = ".";
+  string p1 = "";
+  string p2 = "_hist.root";
+  double nsim = 0.;
+  double window = 2. / 1000.;
+  string background = "sideband";
+  vector<string> groups;
+  int maxid = -1;
+  string outputFilename = "";
+  unsigned int nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  struct arguments *arguments = (struct arguments *)state->input;
+  switch (key) {
+    case 'd':
+      arguments->inputDir = arg;
+      break;
+    case 'p':
+      arguments->p1 = arg;
+      break;
+    case 'q':
+      arguments->p2 = arg;
+      break;
+    case 'n':
+      arguments->nsim = atof(arg);
+      break;
+    case 'w':
+      arguments->window = atof(arg) / 1000.;
+      break;
+    case 'b':
+      arguments->background = arg;
+      break;
+    case 'g':
+      arguments->groups.push_back(arg);
+      break;
+    case 'm':
+      arguments->maxid = atoi(arg);
+      break;
+    case 'o':
+      arguments->outputFilename = arg;
+      break;
+    case 'j':
+      arguments->nthreads = (unsigned int)std::max(atoi(arg), 1);
+      break;
+    case ARGP_KEY_ARG:
+      cerr << "> Error: fepEfficiency takes only options and no arguments!" << endl;
+      argp_usage(state);
+      break;
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
+
+struct Detector {
+  string name;
+  vector<int> ids;
+};
+
+struct PeakContent {
+  double counts = 0.;
+  double uncertainty = 0.;
+  bool valid = false; // False if the peak is outside of the histogram or the fit failed
+};
+
+struct Result {
+  double energy = 0.; // In MeV
+  map<string, vector<PeakContent>> peaks; // Detector name -> FEP, SE, DE
+};
+
+// Energy in MeV from a file name like 'Efficiency_1000_keV_hist.root' or 'utr_1.5MeV_hist.root', or a negative value
+static double EnergyFromFilename(const string &filename) {
+  static const std::regex energy_regex("([0-9]+(\\.[0-9]*)?)_?(keV|MeV)");
+  std::smatch match;
+  if (!std::regex_search(filename, match, energy_regex)) {
+    return -1.;
+  }
+  return std::stod(match[1].str()) * (match[3].str() == "keV" ? 1e-3 : 1.);
+}
+
+static double SumBins(const TH1 &histogram, int first_bin, int last_bin) {
+  double sum = 0.;
+  for (int bin = first_bin; bin <= last_bin; ++bin) {
+    sum += histogram.GetBinContent(bin);
+  }
+  return sum;
+}
+
+static PeakContent GetPeakContent(const TH1 &histogram, double energy, const struct arguments &arguments) {
+  PeakContent peak;
+  const TAxis *axis = histogram.GetXaxis();
+  const int first_bin = axis->FindFixBin(energy - arguments.window);
+  const int last_bin = axis->FindFixBin(energy + arguments.window);
+  const int n_window_bins = last_bin - first_bin + 1;
+  if (first_bin - n_window_bins < 1 || last_bin + n_window_bins > histogram.GetNbinsX()) {
+    return peak;
+  }
+
+  const double window_counts = SumBins(histogram, first_bin, last_bin);
+  if (arguments.background == "none") {
+    peak.counts = window_counts;
+    peak.uncertainty = sqrt(window_counts);
+    peak.valid = true;
+  } else if (arguments.background == "sideband") {
+    // The mean of the two side bands is the integral of a linear background in the peak window
+    const double background = 0.5 * (SumBins(histogram, first_bin - n_window_bins, first_bin - 1) + SumBins(histogram, last_bin + 1, last_bin + n_window_bins));
+    peak.counts = window_counts - background;
+    peak.uncertainty = sqrt(window_counts + 0.5 * background);
+    peak.valid = true;
+  } else {
+    const double bin_width = axis->GetBinWidth(first_bin);
+    const double low = axis->GetBinLowEdge(first_bin - n_window_bins);
+    const double high = axis->GetBinUpEdge(last_bin + n_window_bins);
+    TF1 function("peak", "[0]*exp(-0.5*((x-[1])/[2])^2)+[3]+[4]*(x-[1])", low, high);
+    double maximum = 0.;
+    for (int bin = first_bin; bin <= last_bin; ++bin) {
+      maximum = std::max(maximum, histogram.GetBinContent(bin));
+    }
+    function.SetParameters(maximum, energy, std::max(0.5 * arguments.window, bin_width), 0., 0.);
+    function.SetParLimits(2, 0.1 * bin_width, 3. * arguments.window);
+    TH1 *copy = (TH1 *)histogram.Clone();
+    copy->SetDirectory(nullptr);
+    TFitResultPtr fit = copy->Fit(&function, "QNRSL");
+    if (fit.Get() && fit->IsValid() && maximum > 0.) {
+      // Integral of the Gaussian in units of counts
+      const double factor = sqrt(2. * M_PI) / bin_width;
+      peak.counts = factor * fit->Parameter(0) * fit->Parameter(2);
+      peak.uncertainty = factor * sqrt(pow(fit->Parameter(2) * fit->ParError(0), 2) + pow(fit->Parameter(0) * fit->ParError(2), 2) + 2. * fit->Parameter(0) * fit->Parameter(2) * fit->CovMatrix(0, 2));
+      peak.valid = true;
+    }
+    delete copy;
+  }
+  return peak;
+}
+
+static bool ProcessFile(const string &filename, const vector<Detector> &detectors, const struct arguments &arguments, Result &result) {
+  TFile file(filename.c_str());
+  if (file.IsZombie()) {
+    return false;
+  }
+
+  for (auto &detector : detectors) {
+    TH1 *sum = nullptr;
+    for (auto id : detector.ids) {
+      TH1 *histogram = dynamic_cast<TH1 *>(file.Get(Form("hist%d", id)));
+      if (!histogram) {
+        continue;
+      }
+      if (!sum) {
+        sum = (TH1 *)histogram->Clone();
+        sum->SetDirectory(nullptr);
+      } else {
+        sum->Add(histogram);
+      }
+    }
+    if (!sum) {
+      continue;
+    }
+
+    vector<PeakContent> &peaks = result.peaks[detector.name];
+    for (int escaped = 0; escaped < 3; ++escaped) {
+      const double peak_energy = result.energy - escaped * electron_mass;
+      if (escaped > 0 && result.energy <= 2. * electron_mass) {
+        peaks.push_back(PeakContent());
+      } else {
+        peaks.push_back(GetPeakContent(*sum, peak_energy, arguments));
+      }
+    }
+    delete sum;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  struct arguments arguments;
+  argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+  if (arguments.nsim <= 0.) {
+    cerr << "> ERROR: The number of simulated primary particles NSIM is required. Aborting..." << endl;
+    exit(1);
+  }
+  if (arguments.background != "none" && arguments.background != "sideband" && arguments.background != "fit") {
+    cerr << "> ERROR: Unknown background MODE '" << arguments.background << "', expected 'none', 'sideband' or 'fit'. Aborting..." << endl;
+    exit(1);
+  }
+  if (arguments.outputFilename == "") {
+    arguments.outputFilename = arguments.inputDir + "/fep_efficiency.txt";
+  }
+
+  // Find all files in the input directory that contain pattern1 and pattern2
+  vector<string> filenames;
+  TSystemDirectory dir(arguments.inputDir.c_str(), arguments.inputDir.c_str());
+  TList *files = dir.GetListOfFiles();
+  if (files) {
+    TSystemFile *file;
+    TIter next(files);
+    while ((file = (TSystemFile *)next())) {
+      const string fname = file->GetName();
+      if (!file->IsDirectory() && fname.find(arguments.p1) != string::npos && fname.find(arguments.p2) != string::npos) {
+        filenames.push_back(fname);
+      }
+    }
+  }
+  if (filenames.size() == 0) {
+    cerr << "> ERROR: No files matching '*" << arguments.p1 << "*" << arguments.p2 << "*' in '" << arguments.inputDir << "'. Aborting..." << endl;
+    exit(1);
+  }
+
+  // Individual detectors: all histograms in the first file, or 0 to MAXID
+  vector<Detector> detectors;
+  if (arguments.maxid < 0) {
+    TFile first_file((arguments.inputDir + "/" + filenames[0]).c_str());
+    for (int id = 0; first_file.Get(Form("hist%d", id)); ++id) {
+      arguments.maxid = id;
+    }
+  }
+  for (int id = 0; id <= arguments.maxid; ++id) {
+    detectors.push_back(Detector{std::to_string(id), {id}});
+  }
+  for (auto &group : arguments.groups) {
+    const size_t equals = group.find('=');
+    if (equals == string::npos) {
+      cerr << "> ERROR: Invalid group '" << group << "', expected 'NAME=ID,ID,...'. Aborting..." << endl;
+      exit(1);
+    }
+    Detector detector{group.substr(0, equals), {}};
+    std::istringstream ids(group.substr(equals + 1));
+    for (string id; std::getline(ids, id, ',');) {
+      detector.ids.push_back(std::stoi(id));
+    }
+    detectors.push_back(detector);
+  }
+
+  vector<Result> results(filenames.size());
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    results[i].energy = EnergyFromFilename(filenames[i]);
+    if (results[i].energy <= 0.) {
+      cerr << "> ERROR: Could not determine the energy from the file name '" << filenames[i] << "', expected e.g. 'Efficiency_1000_keV_hist.root'. Aborting..." << endl;
+      exit(1);
+    }
+  }
+
+  ROOT::EnableThreadSafety();
+  // TMinuit, the default minimizer, is not thread-safe
+  ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+  TH1::AddDirectory(false);
+
+  std::atomic<size_t> next_file(0);
+  std::mutex outputMutex;
+  vector<std::thread> threads;
+  for (unsigned int i = 0; i < std::min((size_t)arguments.nthreads, filenames.size()); ++i) {
+    threads.push_back(std::thread([&]() {
+      for (size_t f = next_file++; f < filenames.size(); f = next_file++) {
+        if (!ProcessFile(arguments.inputDir + "/" + filenames[f], detectors, arguments, results[f])) {
+          std::lock_guard<std::mutex> lock(outputMutex);
+          cerr << "> Warning: Could not open '" << filenames[f] << "'" << endl;
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::sort(results.begin(), results.end(), [](const Result &a, const Result &b) { return a.energy < b.energy; });
+
+  // One row per energy and detector. Invalid peaks (e.g. escape peaks below the pair production threshold) are written as 'nan'.
+  std::ofstream output(arguments.outputFilename);
+  output << "# " << arguments.nsim << " PRIMARY PARTICLES PER FILE, PEAK WINDOW +- " << arguments.window * 1000. << " keV, BACKGROUND: " << arguments.background << endl;
+  output << "# ENERGY [keV]\tDETECTOR\tFEP\tFEP_ERR\tFEP_EFF\tFEP_EFF_ERR\tSE\tSE_ERR\tSE_EFF\tSE_EFF_ERR\tDE\tDE_ERR\tDE_EFF\tDE_EFF_ERR" << endl;
+  output << std::scientific << std::setprecision(6);
+  for (auto &result : results) {
+    for (auto &detector : detectors) {
+      auto peaks = result.peaks.find(detector.name);
+      if (peaks == result.peaks.end()) {
+        continue;
+      }
+      output << result.energy * 1000. << "\t" << detector.name;
+      for (auto &peak : peaks->second) {
+        if (peak.valid) {
+          output << "\t" << peak.counts << "\t" << peak.uncertainty << "\t" << peak.counts / arguments.nsim << "\t" << peak.uncertainty / arguments.nsim;
+        } else {
+          output << "\tnan\tnan\tnan\tnan";
+        }
+      }
+      output << endl;
+    }
+  }
+  output.close();
+
+  cout << "> Processed " << results.size() << " files with " << detectors.size() << " detectors, created file " << arguments.outputFilename << endl;
+  return 0;
+}
@@ -18,21 +18,41 @@ You should have received a copy of the GNU General Public License
 along with utr.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
+// getHistogram-Eventwise sorts the output of utr in EVENT_EVENTWISE mode, i.e. trees which contain the
+// total energy deposition in each detector per event in the columns 'det0', 'det1', ..., into histograms.
+//
+// In a single pass over all input files, it fills the spectra of the individual detectors, the sum
+// spectrum of all detectors, the spectra of addback groups of detectors (e.g. the crystals of a clover),
+// and two-dimensional coincidence matrices of pairs of detectors or addback groups. The matrices are
+// stored as THnSparseD, which only allocate memory for filled bins. The input files are processed by
+// the ROOT thread pool, each thread fills its own copy of the histograms, and the copies are merged
+// at the end.
+
+#include <algorithm>
 #include <argp.h>
+#include <atomic>
+#include <cmath>
 #include <dirent.h>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-#include <TCanvas.h>
-#include <TChain.h>
+#include <ROOT/TThreadedObject.hxx>
+#include <ROOT/TTreeProcessorMT.hxx>
 #include <TFile.h>
 #include <TH1.h>
+#include <THnSparse.h>
 #include <TROOT.h>
 #include <TSystemDirectory.h>
-
+#include <TTree.h>
+#include <TTreeReader.h>
+#include <TTreeReaderValue.h>
 
 using std::cerr;
 using std::cout;
@@ -41,9 +61,8 @@ using std::string;
 using std::stringstream;
 using std::vector;
 
-
 // Program documentation.
-static char doc[] = "Create histograms of energy depositions in detectors from a list of events stored among multiple ROOT files";
+static char doc[] = "Create histograms and coincidence matrices of energy depositions in detectors from the eventwise output (EVENT_EVENTWISE) stored among multiple ROOT files";
 // Description of the accepted/required arguments
 static char args_doc[] = ""; // No arguments, only options!
 
@@ -55,32 +74,36 @@ static struct argp_option options[] = {
     {"inputdir", 'd', "INPUTDIR", 0, "Directory to search for input files matching the patterns (default: current working directory '.' )"},
     {"filename", 'o', "OUTPUTFILENAME", 0, "Output file name, file will be overwritten! (default: {PATTERN1}_hist.root with a trailing '_t' in PATTERN1 dropped)"},
     {"outputdir", 'O', "OUTPUTDIR", 0, "Directory in which the output files will be written (default: same as INPUTDIR)"},
-    //{ "begin",    'b', "START",  0,  "ID of first detector to extract" },
-    //{ "end",      'e', "END",    0,  "ID of last detector to extract" },
     {"binning", 'b', "BINNING", 0, "Size of bins in the histogram in keV (default: 1 keV)"},
     {"maxenergy", 'e', "EMAX", 0, "Maximum energy displayed in histogram in MeV (rounded up to match BINNING) (default: 10 MeV)"},
     {"showbin", 'B', "BIN", 0, "Number of energy bin whose value should be displayed, -1 to disable (default: -1)"},
-    {"maxid", 'n', "MAXID", 0, "Highest detection volume ID (default: 12). 'getHistogram-Eventwise' only processes energy depositions in detectors with integer volume ID numbers from 0 to MAXID (MAXID is included)."},
+    {"maxid", 'n', "MAXID", 0, "Highest detection volume ID. 'getHistogram-Eventwise' only processes the columns 'det0' to 'detMAXID' (MAXID is included). (default: all columns 'det<ID>' of the tree)"},
     {"addback", 'a', "ADDBACKSTARTID", 0, "Add back energy depositions that occurred in 4 leaves of clover detectors. Assumes clover leaves' volume IDs start at ADDBACKSTARTID and volume IDs of all leaves of one clover are consecutive. -1 to disable (default: -1)"},
+    {"group", 'g', "NAME=ID,ID,...", 0, "Add back the energy depositions in several detectors, e.g. 'clover1=8,9,10,11'. Can be given several times."},
+    {"matrix", 'x', "A:B", 0, "Create a coincidence matrix of the energy depositions in A and B, which are detector IDs or names of addback groups, e.g. '0:1' or 'clover1:clover2'. Can be given several times."},
+    {"allmatrices", 'X', 0, 0, "Create coincidence matrices for all pairs of addback groups, or for all pairs of detectors if there are no addback groups (default: Off)"},
+    {"matrixbinning", 'M', "MATRIXBINNING", 0, "Size of bins of the coincidence matrices in keV (default: BINNING)"},
     {"silent", 's', 0, 0, "Silent mode (does not silence -B option) (default: Off"},
     {"threads", 'T', "THREADS", 0, "Number of threads to be used, 0 for number of cpu cores (default: Number of cpu cores)"},
     {0, 0, 0, 0, 0}};
 
 // Used by main to communicate with parse_opt
 struct arguments {
-  string tree = "utr";
+  string tree = "edep";
   string p1 = "utr";
   string p2 = ".root";
   string inputDir = ".";
   string outputFilename = "";
   string outputDir = "";
-  // int firstDetectorID=0;
-  // int lastDetectorID=12;
   double binning = 1. / 1000.;
   double eMax = 10.;
   int binToPrint = -1;
-  unsigned int nhistograms = 12 + 1; // Default value for MAXID of 12 and +1 (histograms 0 to 12)
+  int maxID = -1; // -1: All columns of the tree
   int addback = -1;
+  vector<string> groups;
+  vector<string> matrices;
+  bool allMatrices = false;
+  double matrixBinning = 0.; // 0: Same as binning
   bool verbose = true;
   unsigned int threads = 0;
 };
@@ -119,11 +142,23 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
       arguments->binToPrint = atoi(arg);
       break;
     case 'n':
-      arguments->nhistograms = (unsigned int)atoi(arg) + 1;
-      break; // = MAXID + 1 (histograms 0 to MAXID)
+      arguments->maxID = atoi(arg);
+      break;
     case 'a':
       arguments->addback = atoi(arg);
       break;
+    case 'g':
+      arguments->groups.push_back(arg);
+      break;
+    case 'x':
+      arguments->matrices.push_back(arg);
+      break;
+    case 'X':
+      arguments->allMatrices = true;
+      break;
+    case 'M':
+      arguments->matrixBinning = atof(arg) / 1000.;
+      break;
     case 's':
       arguments->verbose = false;
       break;
@@ -144,6 +179,41 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
 
 static struct argp argp = {options, parse_opt, args_doc, doc};
 
+// A single detector or an addback group of detectors, whose energy depositions in an event are summed
+struct Channel {
+  string name;
+  vector<size_t> detectors;
+};
+
+// Highest N of the columns 'detN' of the tree in the given file, or -1
+static int GetMaxDetectorID(const string &filename, const string &treename) {
+  TFile file(filename.c_str());
+  TTree *tree = dynamic_cast<TTree *>(file.Get(treename.c_str()));
+  if (!tree) {
+    return -1;
+  }
+  int maxID = -1;
+  TIter next(tree->GetListOfBranches());
+  while (TObject *branch = next()) {
+    const string name = branch->GetName();
+    if (name.size() > 3 && name.compare(0, 3, "det") == 0 && name.find_first_not_of("0123456789", 3) == string::npos) {
+      maxID = std::max(maxID, atoi(name.c_str() + 3));
+    }
+  }
+  return maxID;
+}
+
+// Index of the channel given by a detector ID or the name of an addback group, or -1
+static int FindChannel(const vector<Channel> &channels, const string &name) {
+  const string channelName = (!name.empty() && name.find_first_not_of("0123456789") == string::npos) ? "det" + name : name;
+  for (size_t i = 0; i < channels.size(); ++i) {
+    if (channels[i].name == channelName) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
 int main(int argc, char *argv[]) {
 
   struct arguments arguments;
@@ -164,6 +234,10 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (arguments.matrixBinning <= 0.) {
+    arguments.matrixBinning = arguments.binning;
+  }
+
   if (arguments.verbose) {
     cout << "#############################################\n";
     cout << "> getHistogram-Eventwise\n";
@@ -175,12 +249,17 @@ int main(int argc, char *argv[]) {
     cout << "> OUTPUTDIR    : " << arguments.outputDir << "\n";
     cout << "> BINNING      : " << arguments.binning * 1000 << " keV\n";
     cout << "> EMAX         : " << arguments.eMax << " MeV\n";
-    cout << "> MAXID        : " << arguments.nhistograms - 1 << "\n";
+    if (arguments.maxID != -1) {
+      cout << "> MAXID        : " << arguments.maxID << "\n";
+    }
     if (arguments.binToPrint != -1) {
       cout << "> BIN          : " << arguments.binToPrint << "\n";
     }
     if (arguments.addback != -1) {
-      cout << ">       : " << arguments.addback << "\n";
+      cout << "> ADDBACK      : " << arguments.addback << "\n";
+    }
+    if (arguments.matrices.size() || arguments.allMatrices) {
+      cout << "> MATRIXBINNING: " << arguments.matrixBinning * 1000 << " keV\n";
     }
     if (arguments.threads != 0) {
       cout << "> THREADS      : " << arguments.threads << "\n";
@@ -188,7 +267,7 @@ int main(int argc, char *argv[]) {
     cout << "#############################################\n";
   }
 
-  // Find all files in the current directory that contain pattern1 and pattern1 and connect them to a TChain
+  // Find all files in the input directory that contain pattern1 and pattern2
   if (!opendir(arguments.inputDir.c_str())) {
     cerr << "> ERROR: Supplied INPUTDIR is not a valid directory! Aborting...\n";
     exit(1);
@@ -201,21 +280,89 @@ int main(int argc, char *argv[]) {
     cout << "> Joining all files in '" << arguments.inputDir << "' that contain '" << arguments.p1 << "' and '" << arguments.p2 << "':\n";
   }
   TSystemDirectory dir("INPUTDIRECTORY", arguments.inputDir.c_str());
-  TChain fileChain(arguments.tree.c_str());
-  TString fname;
+  vector<string> filenames;
   TIter next(dir.GetListOfFiles());
   TSystemFile *file = (TSystemFile *)next();
-
   while (file) {
-    fname = arguments.inputDir + "/" + file->GetName();
-    if (!file->IsDirectory() && fname.Contains(arguments.p1) && fname.Contains(arguments.p2)) {
+    const string fname = arguments.inputDir + "/" + file->GetName();
+    if (!file->IsDirectory() && fname.find(arguments.p1) != string::npos && fname.find(arguments.p2) != string::npos) {
       if (arguments.verbose) {
         cout << fname << "\n";
       }
-      fileChain.Add(fname);
+      filenames.push_back(fname);
     }
     file = (TSystemFile *)next();
   }
+  if (filenames.empty()) {
+    cerr << "> ERROR: No files in INPUTDIR match the patterns! Aborting...\n";
+    exit(1);
+  }
+
+  // The columns 'det0' to 'detMAXID' are read from the tree
+  const int maxDetectorID = GetMaxDetectorID(filenames[0], arguments.tree);
+  if (maxDetectorID < 0) {
+    cerr << "> ERROR: '" << filenames[0] << "' does not contain a tree '" << arguments.tree << "' with columns 'det<ID>'. Was utr built with EVENT_EVENTWISE? Aborting...\n";
+    exit(1);
+  }
+  if (arguments.maxID == -1) {
+    arguments.maxID = maxDetectorID;
+  } else if (arguments.maxID < 0 || arguments.maxID > maxDetectorID) {
+    cerr << "> ERROR: MAXID " << arguments.maxID << " is not a column of the tree, whose highest detector ID is " << maxDetectorID << ". Aborting...\n";
+    exit(1);
+  }
+  const size_t nDetectors = (size_t)arguments.maxID + 1;
+
+  // Channels: The individual detectors, followed by the addback groups
+  vector<Channel> channels;
+  for (size_t i = 0; i < nDetectors; ++i) {
+    channels.push_back(Channel{"det" + std::to_string(i), {i}});
+  }
+  if (arguments.addback >= 0) {
+    int clover = 1;
+    for (size_t i = (size_t)arguments.addback; i + 3 < nDetectors; i += 4) {
+      channels.push_back(Channel{"addback" + std::to_string(clover), {i, i + 1, i + 2, i + 3}});
+      clover++;
+    }
+  }
+  for (auto &group : arguments.groups) {
+    const size_t equals = group.find('=');
+    if (equals == string::npos || equals == 0) {
+      cerr << "> ERROR: Invalid group '" << group << "', expected 'NAME=ID,ID,...'. Aborting...\n";
+      exit(1);
+    }
+    Channel channel{group.substr(0, equals), {}};
+    std::istringstream ids(group.substr(equals + 1));
+    for (string id; std::getline(ids, id, ',');) {
+      const int detectorID = atoi(id.c_str());
+      if (detectorID < 0 || detectorID > arguments.maxID) {
+        cerr << "> ERROR: Detector ID " << id << " of group '" << channel.name << "' is not between 0 and MAXID. Aborting...\n";
+        exit(1);
+      }
+      channel.detectors.push_back((size_t)detectorID);
+    }
+    channels.push_back(channel);
+  }
+
+  // Coincidence matrices, given by the indices of two channels
+  vector<std::pair<size_t, size_t>> matrices;
+  for (auto &matrix : arguments.matrices) {
+    const size_t colon = matrix.find(':');
+    const int first = colon == string::npos ? -1 : FindChannel(channels, matrix.substr(0, colon));
+    const int second = colon == string::npos ? -1 : FindChannel(channels, matrix.substr(colon + 1));
+    if (first < 0 || second < 0 || first == second) {
+      cerr << "> ERROR: Invalid matrix '" << matrix << "', expected 'A:B' with two different detector IDs or addback groups. Aborting...\n";
+      exit(1);
+    }
+    matrices.push_back({(size_t)first, (size_t)second});
+  }
+  if (arguments.allMatrices) {
+    const size_t firstChannel = channels.size() > nDetectors ? nDetectors : 0;
+    for (size_t i = firstChannel; i < channels.size(); ++i) {
+      for (size_t j = i + 1; j < channels.size(); ++j) {
+        matrices.push_back({i, j});
+      }
+    }
+  }
 
   // Prepare empty histograms
 
@@ -230,113 +377,124 @@ int main(int argc, char *argv[]) {
     cout << "> Rounded up EMAX from " << arguments.eMax << " MeV to " << eMax << " MeV in order to match the requested BINNING of " << arguments.binning << " MeV\n";
   }
 
-  if (arguments.threads == 0) {
-    ROOT::EnableImplicitMT();
-  } else if (arguments.threads != 1) {
-    ROOT::EnableImplicitMT(arguments.threads);
+  // Same for the coincidence matrices
+  const double matrixEmin = 0 - arguments.matrixBinning / 2;
+  const int matrixNbins = (int)ceil((eMax - matrixEmin) / arguments.matrixBinning);
+  const double matrixEmax = matrixEmin + matrixNbins * arguments.matrixBinning;
+
+  // The number of thread-local copies of the histograms is fixed when they are created
+  ROOT::EnableImplicitMT(arguments.threads);
+  TH1::AddDirectory(false);
+
+  // Choice of proper data type in TH1 is VERY important here! A TH1F for example uses Floats as the datatype for the bin contents, limiting their precision to about 7 digits.
+  // With this precision at a bin content of 1.67772e+07 an incrementation by one gets lost in precision, leaving the value effectively unchanged.
+  // Hence a TH1D is used: The Double datatype has a precision of about 14 digits.
+  vector<std::unique_ptr<ROOT::TThreadedObject<TH1D>>> hist;
+  for (size_t i = 0; i < channels.size(); ++i) {
+    const string title = i < nDetectors ? "Energy deposition in Detector " + std::to_string(i) : "Addback energy deposition in " + channels[i].name;
+    hist.push_back(std::make_unique<ROOT::TThreadedObject<TH1D>>(channels[i].name.c_str(), title.c_str(), nbins, emin, eMax));
   }
-
-  //auto df = ROOT::RDataFrame(fileChain); REfilwe commenetd out
-
-
-  //vector<ROOT::RDF::RResultPtr<TH1D>> histPtr(arguments.nhistograms);REfilwe Commented out
-  //stringstream histname, histtitle; REfilwe Commneted out
-
-  vector<TH1 *> hist(arguments.nhistograms + 1); // +1 For sum histogram
-  stringstream histname, histtitle;
-
-  for (unsigned int i = 0; i < arguments.nhistograms; ++i) {
-    histname << "det" << i;
-    histtitle << "Energy deposition in Detector " << i;
-    // Choice of proper data type in TH1 is VERY important here! A TH1F for example uses Floats as the datatype for the bin contents, limiting their precision to about 7 digits.
-    // With this precision at a bin content of 1.67772e+07 an incrementation by one gets lost in precision, leaving the value effectively unchanged.
-    // Hence the fill() method would fail unnoticed for (Float) bins as soon as they reach this content, effectively limiting the bin's content to this value (although the Float
-    // datatype could handle much higher values, just not with the needed precision on integer basis).
-    // Hence a TH1D is used: The Double datatype has a precision of about 14 digits (more digits than an Integer can store), and the incrementation by one gets lost at
-    // a bin content of about 9.0e+15, which should suffice for all (utr) cases (one could also implement throwing an exception if a bin passes some threshold after filling).
-
-   /* histPtr[i] = df
-                     .Filter([](double e) { return e > 0.; }, {"det" + std::to_string(i)})
-                     .Histo1D(TH1D(histname.str().c_str(), histtitle.str().c_str(), nbins, emin, eMax), "det" + std::to_string(i));
-    histname.str("");
-    histtitle.str("");*/ //REfilwe Commented out
-
-     hist[i] = new TH1D(histname.str().c_str(), histtitle.str().c_str(), nbins, emin, eMax);
-    histname.str("");
-    histtitle.str(""); 
-  }
-  hist[arguments.nhistograms] = new TH1D("sum", "Sum spectrum of all detectors", nbins, emin, eMax);
-  vector<unsigned int> multiplicity_counter(arguments.nhistograms, 0);
-
-   // Fill histogram from TBranch in TChain with user-defined conditions
-  // Define variables and automatically update their values from the ROOT tree using the GetEntry method after registering them with the SetBranchAddress method
-  double Event, lastEvent;
-  double Volume; // Needs to be double to correctly work with GetEntry and SetBranchAddress methods
-  unsigned int lastVolume; // Needs to be unsigned int to correctly work with array indices
-  double Edep;
-  vector<double> EdepBuffer(arguments.nhistograms, 0.);
-
-   fileChain.SetBranchAddress("edep", &Edep);
-  fileChain.SetBranchAddress("volume", &Volume);
-  if (arguments.addback) {
-    fileChain.SetBranchAddress("event", &Event);
-  } else {
-    Event = -1; // If addback is disabled, Event will not be relevant in the code below, and the ROOT tree is not required to contain it
+  ROOT::TThreadedObject<TH1D> sum("sum", "Sum spectrum of all detectors", nbins, emin, eMax);
+
+  int matrixBins[2] = {matrixNbins, matrixNbins};
+  double matrixMin[2] = {matrixEmin, matrixEmin};
+  double matrixMax[2] = {matrixEmax, matrixEmax};
+  vector<std::unique_ptr<ROOT::TThreadedObject<THnSparseD>>> matrixHist;
+  for (auto &matrix : matrices) {
+    const string name = "matrix_" + channels[matrix.first].name + "_" + channels[matrix.second].name;
+    const string title = "Coincidences of " + channels[matrix.first].name + " and " + channels[matrix.second].name;
+    matrixHist.push_back(std::make_unique<ROOT::TThreadedObject<THnSparseD>>(name.c_str(), title.c_str(), 2, matrixBins, matrixMin, matrixMax));
   }
 
-  unsigned int addback_counter = 0;
-  unsigned int warningCounter = 0;
+  // Fill all histograms in a single pass. Each task of the thread pool processes a range of entries of one file.
+  vector<std::string_view> filenameViews(filenames.begin(), filenames.end());
+  ROOT::TTreeProcessorMT processor(filenameViews, arguments.tree);
+  std::atomic<long long> nEntries(0);
+  processor.Process([&](TTreeReader &reader) {
+    vector<std::unique_ptr<TTreeReaderValue<double>>> edep;
+    for (size_t i = 0; i < nDetectors; ++i) {
+      edep.push_back(std::make_unique<TTreeReaderValue<double>>(reader, ("det" + std::to_string(i)).c_str()));
+    }
 
+    // Look up the copies of the histograms of this thread only once per task
+    vector<TH1D *> localHist;
+    for (auto &h : hist) {
+      localHist.push_back(h->Get().get());
+    }
+    TH1D *localSum = sum.Get().get();
+    vector<THnSparseD *> localMatrixHist;
+    for (auto &h : matrixHist) {
+      localMatrixHist.push_back(h->Get().get());
+    }
 
-  if (arguments.addback >= 0) {
-    int clover = 1;
-    for (unsigned int i = static_cast<unsigned int>(arguments.addback); i + 3 < arguments.nhistograms; i += 4) {
-      histname << "addback" << clover;
-      histtitle << "Addback energy deposition in clover detector " << clover;
-      histPtr.push_back(
-          df.Define("ADDBACK" + std::to_string(clover),
-                    [](double e1, double e2, double e3, double e4) { return e1 + e2 + e3 + e4; },
-                    {"det" + std::to_string(i), "det" + std::to_string(i + 1), "det" + std::to_string(i + 2), "det" + std::to_string(i + 3)})
-              .Filter([](double e) { return e > 0.; }, {"ADDBACK" + std::to_string(clover)})
-              .Histo1D(TH1D(histname.str().c_str(), histtitle.str().c_str(), nbins, emin, eMax), "ADDBACK" + std::to_string(clover)));
-      histname.str("");
-      histtitle.str("");
-      clover++;
+    vector<double> energy(channels.size(), 0.);
+    double coincidence[2];
+    long long n = 0;
+    while (reader.Next()) {
+      for (size_t i = 0; i < nDetectors; ++i) {
+        energy[i] = **edep[i];
+        if (energy[i] > 0.) {
+          localHist[i]->Fill(energy[i]);
+          localSum->Fill(energy[i]);
+        }
+      }
+      for (size_t i = nDetectors; i < channels.size(); ++i) {
+        energy[i] = 0.;
+        for (auto detector : channels[i].detectors) {
+          energy[i] += energy[detector];
+        }
+        if (energy[i] > 0.) {
+          localHist[i]->Fill(energy[i]);
+        }
+      }
+      for (size_t m = 0; m < matrices.size(); ++m) {
+        coincidence[0] = energy[matrices[m].first];
+        coincidence[1] = energy[matrices[m].second];
+        if (coincidence[0] > 0. && coincidence[1] > 0.) {
+          localMatrixHist[m]->Fill(coincidence);
+        }
+      }
+      ++n;
     }
-  }
+    nEntries += n;
+  });
 
-  vector<TH1D> hist(histPtr.size() + 1); // +1 For sum histogram
-  hist[arguments.nhistograms] = TH1D("sum", "Sum spectrum of all detectors", nbins, emin, eMax);
-  for (unsigned int i = 0; i < arguments.nhistograms; ++i) {
-    hist[i] = histPtr[i].GetValue();
-    hist[arguments.nhistograms].Add(&(hist[i]));
+  // Merge the copies of the threads
+  vector<std::shared_ptr<TH1D>> mergedHist;
+  for (auto &h : hist) {
+    mergedHist.push_back(h->Merge());
   }
-  for (unsigned int i = arguments.nhistograms + 1; i < hist.size(); ++i) {
-    hist[i] = histPtr[i - 1].GetValue();
+  mergedHist.push_back(sum.Merge());
+  vector<std::shared_ptr<THnSparseD>> mergedMatrixHist;
+  for (auto &h : matrixHist) {
+    mergedMatrixHist.push_back(h->Merge());
   }
 
   if (arguments.verbose) {
-    cout << "> Processed " << fileChain.GetEntries() << " entries\n";
+    cout << "> Processed " << nEntries << " entries\n";
   }
 
   // Display counts of a specific bin in each histogram, if requested
   if (arguments.binToPrint != -1) {
-    cout << "Counts in bin " << arguments.binToPrint << " (centered around " << hist[0].GetBinCenter(arguments.binToPrint) << " MeV ) for each histogram : [ ";
-    for (unsigned int i = 0; i <= arguments.nhistograms; ++i) {
+    cout << "Counts in bin " << arguments.binToPrint << " (centered around " << mergedHist[0]->GetBinCenter(arguments.binToPrint) << " MeV ) for each histogram : [ ";
+    for (size_t i = 0; i < mergedHist.size(); ++i) {
       if (i != 0) {
         cout << ", ";
       }
-      cout << hist[i].GetBinContent(arguments.binToPrint);
+      cout << mergedHist[i]->GetBinContent(arguments.binToPrint);
     }
     cout << "]\n";
   }
 
-  // Write histogram to a new TFile
-  TFile *outFile = new TFile((arguments.outputDir + "/" + arguments.outputFilename).c_str(), "RECREATE");
-  for (auto h : hist) {
-    h.Write();
+  // Write histograms to a new TFile
+  TFile outFile((arguments.outputDir + "/" + arguments.outputFilename).c_str(), "RECREATE");
+  for (auto &h : mergedHist) {
+    h->Write();
+  }
+  for (auto &h : mergedMatrixHist) {
+    h->Write();
   }
-  outFile->Close();
+  outFile.Close();
 
   if (arguments.verbose) {
     cout << "> Created output file " << arguments.outputFilename << "\n";
@@ -21,6 +21,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 
 //////Modified by Refilwe-18 July 2024////////////////////
 
+#include <algorithm>
 #include <argp.h>
 #include <dirent.h>
 #include <iostream>
@@ -29,9 +30,13 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <sys/stat.h>
 
 #include <TChain.h>
 #include <TFile.h>
+#include <TKey.h>
+#include <TObjString.h>
 #include <TH1.h>
 #include <TROOT.h>
 #include <TSystemDirectory.h>
@@ -66,6 +71,8 @@ static struct argp_option options[] = {
     {"multiplicity", 'm', "MULTIPLICITY", 0, "Particle multiplicity, sum energy depositions for each detector among MULTIPLICITY events (default: 1)"},
     {"addback", 'a', 0, 0, "Add back energy depositions that occurred in a single event to the detector first listed in the event (usually this is the first one hit) (default: Off)"},
     {"silent", 's', 0, 0, "Silent mode (does not silence -B option) (default: Off"},
+    {"cache", 'c', "CACHEFILE", 0, "Incremental mode: store the histograms of each input file in CACHEFILE, and only process new or modified input files on the next call with the same options (default: Off)"},
+    {"check", 'C', 0, 0, "With --cache, also create the histograms from all input files at once and check that they are identical to the ones of the incremental mode (default: Off)"},
     {0, 0, 0, 0, 0}};
 
 // Used by main to communicate with parse_opt
@@ -83,6 +90,8 @@ struct arguments {
     unsigned int multiplicity = 1;
     bool addback = false;
     bool verbose = true;
+    string cacheFilename = "";
+    bool check = false;
 };
 
 // Function to parse a single option
@@ -129,6 +138,12 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case 's':
             arguments->verbose = false;
             break;
+        case 'c':
+            arguments->cacheFilename = arg;
+            break;
+        case 'C':
+            arguments->check = true;
+            break;
         case ARGP_KEY_ARG:
             cerr << "> Error: getHistogram takes only options and no arguments!" << endl;
             argp_usage(state);
@@ -143,6 +158,211 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
 
 static struct argp argp = {options, parse_opt, args_doc, doc};
 
+// Detector IDs of the crystals of the clover detectors, whose energy depositions are summed for the addback histograms
+static const int nClover = 5;
+static const int clo_id[nClover][4] = {
+    {8, 9, 10, 11},
+    {12, 13, 14, 15},
+    {16, 17, 18, 19},
+    {20, 21, 22, 23},
+    {24, 25, 26, 27}};
+
+struct Histograms {
+    vector<TH1D *> singles;
+    vector<TH1D *> clover;
+    vector<TH1D *> addback;
+};
+
+static Histograms CreateHistograms(const struct arguments &arguments, int nbins, double emin, double eMax) {
+    Histograms histograms;
+    for (unsigned int i = 0; i < arguments.nhistograms; ++i) {
+        histograms.singles.push_back(new TH1D(Form("hist%d", i), Form("Energy histogram for detector ID %d", i), nbins, emin, eMax));
+    }
+    for (int n = 0; n < nClover; ++n) {
+        histograms.clover.push_back(new TH1D(Form("he_s%d_cal", n + 1), Form("S%d: energy_cal", n + 1), nbins, emin, eMax));
+    }
+    if (arguments.addback) {
+        for (int n = 0; n < nClover; ++n) {
+            histograms.addback.push_back(new TH1D(Form("he_c%d_cal", n + 1), Form("C%d: energy_cal", n + 1), nbins, emin, eMax));
+        }
+    }
+    return histograms;
+}
+
+static vector<TH1D *> AllHistograms(const Histograms &histograms) {
+    vector<TH1D *> all = histograms.singles;
+    all.insert(all.end(), histograms.clover.begin(), histograms.clover.end());
+    all.insert(all.end(), histograms.addback.begin(), histograms.addback.end());
+    return all;
+}
+
+// Read energy depositions from the input chain and fill the histograms. Energy depositions are only
+// added back within the same input file, as in the incremental mode, where each file is processed on its own.
+static void FillHistograms(TChain &chain, Histograms &histograms, const struct arguments &arguments) {
+    TTreeReader reader(&chain);
+    TTreeReaderValue<double> id(reader, "volume");
+    TTreeReaderValue<double> edep(reader, "edep");
+    TTreeReaderValue<double> event(reader, "event"); //event number is relevant for addback
+
+    // Map to accumulate total energy depositions per event and group
+    std::map<double, std::map<int, double>> eventGroupEdep;
+    int treeNumber = -1;
+
+    while (reader.Next()) {
+        if (chain.GetTreeNumber() != treeNumber) {
+            treeNumber = chain.GetTreeNumber();
+            eventGroupEdep.clear();
+        }
+        double eventID = *event;
+        double volumeID = *id;
+        double energyDeposition = *edep;
+        /////////////////////Fill singles-Refilwe//////////////////////////////////////////
+        if (*id >= 0 && static_cast<size_t>(*id) < arguments.nhistograms) {
+            histograms.singles[static_cast<std::vector<TH1D *>::size_type>(*id)]->Fill(*edep);
+        }
+        /////////////////Fill the sum for singles-Refilwe/////////////////////////////
+        for (int n = 0; n < nClover; ++n) {
+            for (int m = 0; m < 4; ++m) {
+                if (*id == clo_id[n][m]) {
+                    histograms.clover[static_cast<size_t>(n)]->Fill(*edep);
+                }
+            }
+        }
+        ////////////////////Fill the sum for addback-Refilwe///////////////////////////
+        if (arguments.addback) {
+            if (volumeID >= 8 && volumeID <= 27) {
+                int groupID;
+                if (volumeID >= 8 && volumeID <= 11)
+                    groupID = 0;
+                else if (volumeID >= 12 && volumeID <= 15)
+                    groupID = 1;
+                else if (volumeID >= 16 && volumeID <= 19)
+                    groupID = 2;
+                else if (volumeID >= 20 && volumeID <= 23)
+                    groupID = 3;
+                else
+                    groupID = 4;
+
+                // Accumulate energy deposition for each event and group
+                eventGroupEdep[eventID][groupID] += energyDeposition;
+                histograms.addback[static_cast<size_t>(groupID)]->Fill(eventGroupEdep[eventID][groupID]);
+            }
+        }
+    }
+}
+
+// The partial histograms of an input file are valid as long as the file and the options which affect the histograms are unchanged
+static string CacheKey(const string &path, const struct arguments &arguments) {
+    struct stat fileStatus;
+    if (stat(path.c_str(), &fileStatus) != 0) {
+        return "";
+    }
+    stringstream key;
+    key << path << "|" << fileStatus.st_size << "|" << fileStatus.st_mtime << "|" << arguments.tree << "|" << arguments.binning << "|" << arguments.eMax << "|" << arguments.nhistograms << "|" << arguments.multiplicity << "|" << arguments.addback;
+    return key.str();
+}
+
+// Name of the directory in the cache file which contains the partial histograms of an input file
+static string CacheDirectoryName(const string &path) {
+    stringstream name;
+    name << "file_" << std::hex << std::hash<string>()(path);
+    return name.str();
+}
+
+// Incremental mode: Adds the partial histograms of all input files to the total histograms. The partial
+// histograms are taken from the cache file if the input file is unchanged, otherwise they are created and
+// stored in the cache file. Partial histograms of files which no longer exist are removed from the cache.
+static void FillHistogramsIncremental(const vector<string> &paths, Histograms &totals, const struct arguments &arguments, int nbins, double emin, double eMax) {
+    TFile cache(arguments.cacheFilename.c_str(), "UPDATE");
+    if (cache.IsZombie()) {
+        cerr << "> ERROR: Could not open CACHEFILE '" << arguments.cacheFilename << "'! Aborting..." << endl;
+        exit(1);
+    }
+
+    const vector<TH1D *> totalHistograms = AllHistograms(totals);
+    std::set<string> usedDirectories;
+    unsigned int nCached = 0, nProcessed = 0;
+    for (auto &path : paths) {
+        const string key = CacheKey(path, arguments);
+        const string directoryName = CacheDirectoryName(path);
+        usedDirectories.insert(directoryName);
+
+        TDirectory *directory = cache.GetDirectory(directoryName.c_str());
+        TObjString *cachedKey = directory ? dynamic_cast<TObjString *>(directory->Get("key")) : nullptr;
+        if (cachedKey && cachedKey->GetString() == key.c_str()) {
+            for (auto &total : totalHistograms) {
+                TH1D *partial = dynamic_cast<TH1D *>(directory->Get(total->GetName()));
+                if (partial) {
+                    total->Add(partial);
+                    delete partial;
+                }
+            }
+            delete cachedKey;
+            ++nCached;
+            continue;
+        }
+        delete cachedKey;
+
+        // Files which are still being written by a running simulation can not be read yet, and are not cached
+        TFile input(path.c_str());
+        if (input.IsZombie() || !input.Get(arguments.tree.c_str())) {
+            cerr << "> Warning: Could not read tree '" << arguments.tree << "' from '" << path << "', skipping it." << endl;
+            continue;
+        }
+        input.Close();
+
+        TChain chain(arguments.tree.c_str());
+        chain.Add(path.c_str());
+        Histograms partials = CreateHistograms(arguments, nbins, emin, eMax);
+        FillHistograms(chain, partials, arguments);
+
+        cache.Delete((directoryName + ";*").c_str());
+        directory = cache.mkdir(directoryName.c_str());
+        directory->cd();
+        TObjString(key.c_str()).Write("key");
+        const vector<TH1D *> partialHistograms = AllHistograms(partials);
+        for (size_t i = 0; i < partialHistograms.size(); ++i) {
+            partialHistograms[i]->Write();
+            totalHistograms[i]->Add(partialHistograms[i]);
+            delete partialHistograms[i];
+        }
+        ++nProcessed;
+    }
+
+    vector<string> obsoleteDirectories;
+    TIter nextKey(cache.GetListOfKeys());
+    while (TKey *cacheKey = (TKey *)nextKey()) {
+        if (usedDirectories.find(cacheKey->GetName()) == usedDirectories.end()) {
+            obsoleteDirectories.push_back(cacheKey->GetName());
+        }
+    }
+    for (auto &name : obsoleteDirectories) {
+        cache.Delete((name + ";*").c_str());
+    }
+    cache.Close();
+
+    if (arguments.verbose) {
+        cout << "> Took " << nCached << " files from the cache, processed " << nProcessed << " files" << endl;
+    }
+}
+
+// Returns the number of histograms whose bin contents differ
+static unsigned int CompareHistograms(const Histograms &histograms, const Histograms &references) {
+    const vector<TH1D *> all = AllHistograms(histograms);
+    const vector<TH1D *> allReferences = AllHistograms(references);
+    unsigned int nDifferent = 0;
+    for (size_t i = 0; i < all.size(); ++i) {
+        for (int bin = 0; bin <= all[i]->GetNbinsX() + 1; ++bin) {
+            if (all[i]->GetBinContent(bin) != allReferences[i]->GetBinContent(bin)) {
+                cerr << "> Error: Histogram '" << all[i]->GetName() << "' differs between the incremental and the plain mode, e.g. in bin " << bin << " (" << all[i]->GetBinContent(bin) << " vs. " << allReferences[i]->GetBinContent(bin) << ")" << endl;
+                ++nDifferent;
+                break;
+            }
+        }
+    }
+    return nDifferent;
+}
+
 int main(int argc, char *argv[]) {
     struct arguments arguments;
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
@@ -183,43 +403,15 @@ int main(int argc, char *argv[]) {
         } else {
             cout << "FALSE" << endl;
         }
+        if (arguments.cacheFilename != "") {
+            cout << "> CACHEFILE    : " << arguments.cacheFilename << endl;
+        }
         cout << "#############################################" << endl;
     }
 
 
-    //////////////////Define my clovers for addback//////////////////////
-  int  nClover = 5;
-  int clo_id[5][4];
-  std::vector<double> clov_energy(static_cast<size_t>(nClover), 0.0);
- 
-    clo_id[0][0] = 8;
-	clo_id[0][1] = 9;
-	clo_id[0][2] = 10;
-	clo_id[0][3] = 11;
-	
-	clo_id[1][0] = 12;
-	clo_id[1][1] = 13;
-	clo_id[1][2] = 14;
-	clo_id[1][3] = 15;
-
-	clo_id[2][0] = 16;
-	clo_id[2][1] = 17;
-	clo_id[2][2] = 18;
-	clo_id[2][3] = 19;
-	
-	clo_id[3][0] = 20;
-	clo_id[3][1] = 21;
-	clo_id[3][2] = 22;
-	clo_id[3][3] = 23;
-	
-	clo_id[4][0] = 24;
-	clo_id[4][1] = 25;
-	clo_id[4][2] = 26;
-	clo_id[4][3] = 27;
-
-  ////////////////////////////////////////////////////////////////////
-
-    // Find all files in the input directory that contain pattern1 and pattern2, and connect them to a TChain
+
+    // Find all files in the input directory that contain pattern1 and pattern2
     if (!opendir(arguments.inputDir.c_str())) {
         cerr << "> ERROR: Supplied INPUTDIR is not a valid directory! Aborting..." << endl;
         exit(1);
@@ -229,8 +421,7 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    // Prepare the input chain
-    TChain chain(arguments.tree.c_str());
+    vector<string> paths;
     TSystemDirectory dir(arguments.inputDir.c_str(), arguments.inputDir.c_str());
     TList *files = dir.GetListOfFiles();
     if (files) {
@@ -240,119 +431,64 @@ int main(int argc, char *argv[]) {
         while ((file = (TSystemFile *)next())) {
             fname = file->GetName();
             if (!file->IsDirectory() && fname.Contains(arguments.p1.c_str()) && fname.Contains(arguments.p2.c_str())) {
-                chain.Add(Form("%s/%s", arguments.inputDir.c_str(), fname.Data()));
+                paths.push_back(Form("%s/%s", arguments.inputDir.c_str(), fname.Data()));
             }
         }
     }
- 
-    //preparing bins for histograms
- 
-  const double emin = 0 - arguments.binning / 2; // Minimum energy of histograms in MeV: bin centered around 0
-  const int nbins = (int)ceil((arguments.eMax - emin) / arguments.binning);// Number of bins in the histograms: Chosen so that the end of the last bin using the given binning is greater or equal to the given maximum energy
-  const double eMax = emin + nbins * arguments.binning; // Maximum energy of histograms in MeV: Choosen so that it matches the given binning
-
-  if (arguments.verbose && eMax != arguments.eMax) {
-    cout << "> Rounded up EMAX from " << arguments.eMax << " MeV to " << eMax << " MeV in order to match the requested BINNING of " << arguments.binning << " MeV" << endl;
-  }
-    // Create the histograms
-    vector<TH1D *> histograms;
-    vector<TH1D *> addbackHistograms;
-    vector<TH1D *> cloverHistograms;
-    for (unsigned int i = 0; i < arguments.nhistograms; ++i) {
-        histograms.push_back(new TH1D(Form("hist%d", i), Form("Energy histogram for detector ID %d", i), nbins, emin, eMax));
-    }
+    std::sort(paths.begin(), paths.end());
 
-    cloverHistograms.resize(5); // Resize the vector to hold nClover elements
-    cloverHistograms[0] = new TH1D("he_s1_cal","S1: energy_cal", nbins, emin, eMax);
-    cloverHistograms[1] = new TH1D("he_s2_cal","S2: energy_cal", nbins, emin, eMax);
-    cloverHistograms[2] = new TH1D("he_s3_cal","S3: energy_cal", nbins, emin, eMax);
-    cloverHistograms[3] = new TH1D("he_s4_cal","S4: energy_cal", nbins, emin, eMax);
-    cloverHistograms[4] = new TH1D("he_s5_cal","S5: energy_cal", nbins, emin, eMax);
-
-      if (arguments.addback) {
-    addbackHistograms.resize(5); // Resize the vector to hold nClover elements
-    addbackHistograms[0] = new TH1D("he_c1_cal","C1: energy_cal", nbins, emin, eMax);
-    addbackHistograms[1] = new TH1D("he_c2_cal","C2: energy_cal", nbins, emin, eMax);
-    addbackHistograms[2] = new TH1D("he_c3_cal","C3: energy_cal", nbins, emin, eMax);
-    addbackHistograms[3] = new TH1D("he_c4_cal","C4: energy_cal", nbins, emin, eMax);
-    addbackHistograms[4] = new TH1D("he_c5_cal","C5: energy_cal", nbins, emin, eMax);
-}
-
-
-    // Read energy depositions from the input chain and fill the histograms
-    TTreeReader reader(&chain);
-    TTreeReaderValue<double> id(reader, "volume");
-    TTreeReaderValue<double> edep(reader, "edep");
-    TTreeReaderValue<double> event(reader, "event");//event number is relevant for addback
-  
-    // Map to accumulate total energy depositions per event and group
-    std::map<double, std::map<int, double>> eventGroupEdep;
+    //preparing bins for histograms
+    const double emin = 0 - arguments.binning / 2; // Minimum energy of histograms in MeV: bin centered around 0
+    const int nbins = (int)ceil((arguments.eMax - emin) / arguments.binning); // Number of bins in the histograms: Chosen so that the end of the last bin using the given binning is greater or equal to the given maximum energy
+    const double eMax = emin + nbins * arguments.binning; // Maximum energy of histograms in MeV: Choosen so that it matches the given binning
 
-   
-    while (reader.Next()) {
-        double eventID = *event;
-        double volumeID = *id;
-        double energyDeposition = *edep;
-/////////////////////Fill singles-Refilwe//////////////////////////////////////////
-   if (*id >= 0 && static_cast<size_t>(*id) < arguments.nhistograms) {
-    histograms[static_cast<std::vector<TH1D*>::size_type>(*id)]->Fill(*edep);
+    if (arguments.verbose && eMax != arguments.eMax) {
+        cout << "> Rounded up EMAX from " << arguments.eMax << " MeV to " << eMax << " MeV in order to match the requested BINNING of " << arguments.binning << " MeV" << endl;
     }
-/////////////////Fill the sum for singles-Refilwe/////////////////////////////
-    for (int n=0; n<nClover; ++n){
-         for (int m=0; m<4; ++m){
-            if (*id == clo_id[n][m]){
-          cloverHistograms[static_cast<size_t>(n)]->Fill(*edep);
-          }
-      }}
-////////////////////Fill the sum for addback-Refilwe///////////////////////////
 
-    if (arguments.addback) {
-
-      if(volumeID >= 8 && volumeID <= 27){
-          int groupID;
-            if (volumeID >= 8 && volumeID <= 11) groupID = 0;
-            else if (volumeID >= 12 && volumeID <= 15) groupID = 1;
-            else if (volumeID >= 16 && volumeID <= 19) groupID = 2;
-            else if (volumeID >= 20 && volumeID <= 23) groupID = 3;
-            else if (volumeID >= 24 && volumeID <= 27) groupID = 4;
- // Ensure groupID is valid
-                if (groupID < 0 || groupID > 4) {
-                    std::cerr << "Invalid groupID: " << groupID << "\n";
-                    continue;
-                }
-
-                // Accumulate energy deposition for each event and group
-                eventGroupEdep[eventID][groupID] += energyDeposition;
+    // Create the histograms
+    if (arguments.cacheFilename != "") {
+        TH1::AddDirectory(false);
+    }
+    Histograms histograms = CreateHistograms(arguments, nbins, emin, eMax);
 
-                // Ensure the histogram for this groupID exists
-                if (static_cast<size_t>(groupID) < addbackHistograms.size()) {
-                    addbackHistograms[static_cast<size_t>(groupID)]->Fill(eventGroupEdep[eventID][groupID]);
-                } else {
-                    std::cerr << "Histogram for groupID " << groupID << " does not exist.\n";
+    // Connect all input files to a TChain
+    TChain chain(arguments.tree.c_str());
+    for (auto &path : paths) {
+        chain.Add(path.c_str());
+    }
+    unsigned int nDifferent = 0;
+    if (arguments.cacheFilename != "") {
+        FillHistogramsIncremental(paths, histograms, arguments, nbins, emin, eMax);
+        if (arguments.check) {
+            Histograms references = CreateHistograms(arguments, nbins, emin, eMax);
+            FillHistograms(chain, references, arguments);
+            nDifferent = CompareHistograms(histograms, references);
+            if (arguments.verbose && nDifferent == 0) {
+                cout << "> Check passed: the histograms are identical to the ones obtained without --cache" << endl;
+            }
+            for (auto &reference : AllHistograms(references)) {
+                delete reference;
+            }
+        }
+    } else {
+        if (arguments.check) {
+            cerr << "> Warning: --check only has an effect together with --cache" << endl;
         }
-         }}}
+        FillHistograms(chain, histograms, arguments);
+    }
 
     // Save histograms to output file
     TFile outputFile(Form("%s/%s", arguments.outputDir.c_str(), arguments.outputFilename.c_str()), "RECREATE");
-    for (auto &hist : histograms) {
+    for (auto &hist : AllHistograms(histograms)) {
         hist->Write();
     }
-
-    for (size_t i = 0; i < cloverHistograms.size(); ++i) {
-        cloverHistograms[i]->Write();
-    } 
-
-  if (arguments.addback) {
-    for (size_t i = 0; i < addbackHistograms.size(); ++i) {
-        addbackHistograms[i]->Write();
-    }
-}
     outputFile.Close();
 
     // Display specific bin value if requested
     if (arguments.binToPrint != -1) {
-        cout << "Value of bin " << arguments.binToPrint << " is: " << histograms[0]->GetBinContent(arguments.binToPrint) << endl;
+        cout << "Value of bin " << arguments.binToPrint << " is: " << histograms.singles[0]->GetBinContent(arguments.binToPrint) << endl;
     }
 
-    return 0;
+    return nDifferent == 0 ? 0 : 1;
 }
@@ -1,26 +1,38 @@
+// getHistogramRDF sorts the energy depositions in the output files of utr into one histogram per
+// sensitive volume, using a ROOT::RDataFrame.
+//
+// Each entry is dispatched to the histogram of its volume by a compiled action in a single pass,
+// instead of evaluating one filter expression per volume for every entry. Each processing slot
+// fills its own histograms, which are created as soon as a volume occurs for the first time, so the
+// number of volumes does not have to be known in advance. The histograms of all slots are added up
+// at the end.
+//
+// If the files contain the branch 'weight' (build option EVENT_WEIGHT of utr), each entry is
+// filled with its weight, which is only different from 1 with variance reduction, for example
+// with forced collisions in the target (/utr/physics/forceCollision).
+//
+// The function getHistogramRDF() can also be called as a ROOT macro.
+
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <memory>
 #include <string>
 #include <vector>
 
-
 #include <argp.h>
 #include <dirent.h>
 #include <iostream>
 #include <sstream>
 #include <stdlib.h>
 
-
 #include <ROOT/RDataFrame.hxx>
+#include <RVersion.h>
 #include <TChain.h>
 #include <TFile.h>
 #include <TH1.h>
 #include <TROOT.h>
 #include <TSystemDirectory.h>
-//#include <ROOT/RDF/RLoopManager.hxx>
-#include <ROOT/RDF/RInterface.hxx>
-//#include <ROOT/LoopManager.h>
-
-// #include <ROOT/RFile.hxx>
 
 using std::cerr;
 using std::cout;
@@ -28,92 +40,25 @@ using std::endl;
 using std::string;
 using std::stringstream;
 using std::vector;
-using ROOT::RDF::RResultPtr;
-//using ROOT::RDF::RLoopManager;
-using ROOT::RDF::RDFDescription;
-using ROOT::RDF::RInterface;
 
 using std::chrono::duration;
 using std::chrono::duration_cast;
 using std::chrono::high_resolution_clock;
-//ROOT::EnableImplicitMT();
+
 void getHistogramRDF(
-    //std::string directory = "/home/refilwemolaeng/Geant4/utr/OutputProcessing",
     std::string directory = ".",
-
     std::string outputfilename = "hist.root",
     std::vector<std::string> filename_identifiers = {"utr", ".root"},
-    std::vector<std::string> conditions = {
-        "volume==0",
-        "volume==1",
-        "volume==2",
-        "volume==3",
-        "volume==4",
-        "volume==5",
-        "volume==6",
-        "volume==7",
-        "volume==8",
-        "volume==9",
-        "volume==10",
-        "volume==11",
-        "volume==12",
-        "volume==13",
-        "volume==14",
-        "volume==15",
-        "volume==16",
-        "volume==17",
-        "volume==18",
-        "volume==19",
-        "volume==20",
-        "volume==21",
-        "volume==22",
-        "volume==23",
-        "volume==24",
-        "volume==25",
-        "volume==26",
-        "volume==27",
-    },
-std::vector<std::string> histogramnames = {
-        "det0",
-        "det1",
-        "det2",
-        "det3",
-        "det4",
-        "det5",
-        "det6",
-        "det7",
-        "det8",
-        "det9",
-        "det10",
-        "det11",
-        "det12",
-        "det13",
-        "det14",
-        "det15",
-        "det16",
-        "det17",
-        "det18",
-        "det19",
-        "det20",
-        "det21",
-        "det22",
-        "det23",
-        "det24",
-        "det25",
-        "det26",
-        "det27",
-    },
-    std::string general_condition = "true", double xlow = 0.0005, double xup = 10.0005, unsigned int nbins = 10000, std::string tree = "utr") {
+    std::string general_condition = "true", double xlow = 0.0005, double xup = 10.0005, unsigned int nbins = 10000, std::string tree = "utr",
+    int maxid = -1, // Highest volume ID, -1: highest volume ID in the files
+    unsigned int nthreads = 0) { // 0: Number of cpu cores, 1: No multithreading
 
   high_resolution_clock::time_point t_start = high_resolution_clock::now();
 
-  if (conditions.size() != histogramnames.size()) {
-    cout << "> Error: Number of conditions and histogram names do not match. Aborting ..." <<endl;
-    abort();
+  if (nthreads != 1) {
+    ROOT::EnableImplicitMT(nthreads);
   }
 
-  ROOT::EnableImplicitMT(3);
-
   cout << "> Looking for files whose names contain the strings ";
   for (auto fid : filename_identifiers) {
     cout << "'" << fid << "' ";
@@ -137,14 +82,14 @@ std::vector<std::string> histogramnames = {
       fname = file->GetName();
       if (!file->IsDirectory()) {
         for (auto fid : filename_identifiers) {
-          if (!fname.Contains(fid)) {
+          if (!fname.Contains(fid.c_str())) {
             skip = true;
             break;
           }
         }
         if (!skip) {
           cout << "\tAdding " << directory << "/" << fname << endl;
-          chain.Add(directory + "/" + fname);
+          chain.Add((directory + "/" + fname.Data()).c_str());
         }
       }
       file = (TSystemFile *)next();
@@ -156,35 +101,194 @@ std::vector<std::string> histogramnames = {
     abort();
   }
 
-  vector<ROOT::RDF::RResultPtr<::TH1D>> hist;
   ROOT::RDataFrame df(chain);
-  df.Filter("edep==4.");
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 22, 0)
+  const unsigned int nslots = df.GetNSlots();
+#else
+  const unsigned int nslots = std::max(ROOT::GetImplicitMTPoolSize(), 1u);
+#endif
 
-  stringstream histname, histtitle, volume_condition;
+  // Histograms of each slot, indexed by the volume ID
+  vector<vector<std::unique_ptr<TH1D>>> slot_hist(nslots);
+  vector<unsigned long long> slot_n_ignored(nslots, 0);
+  TH1::AddDirectory(false);
+  auto create_histogram = [&](size_t volume) {
+    return std::make_unique<TH1D>(("det" + std::to_string(volume)).c_str(), ("Energy deposition in volume " + std::to_string(volume)).c_str(), (int)nbins, xlow, xup);
+  };
+  if (maxid >= 0) {
+    for (auto &hist : slot_hist) {
+      for (size_t volume = 0; volume <= (size_t)maxid; ++volume) {
+        hist.push_back(create_histogram(volume));
+      }
+    }
+  }
 
   cout << endl
-       << "> Filling the following histograms:" << endl;
+       << "> Filling one histogram per volume" << endl;
   cout << "\tGENERAL CONDITION : " << general_condition << endl;
-  cout << "\tNAME : CONDITION" << endl;
-  for (unsigned int i = 0; i < conditions.size(); ++i) {
-    cout << "\t" << histogramnames[i] << " : '" << conditions[i] << "'" << endl;
-    hist.push_back(df.Filter(general_condition.c_str()).Filter(conditions[i].c_str()).Histo1D({histogramnames[i].c_str(), conditions[i].c_str(), (int)nbins, xlow, xup}, "edep"));
+  const bool weighted = chain.GetBranch("weight") != nullptr;
+  if (weighted) {
+    cout << "\tEntries are weighted with the branch 'weight'" << endl;
+  }
+  auto fill_weighted = [&](unsigned int slot, double volume, double edep, double weight) {
+    auto &hist = slot_hist[slot];
+    if (volume < 0. || (maxid >= 0 && volume > maxid)) {
+      ++slot_n_ignored[slot];
+      return;
+    }
+    const size_t index = (size_t)volume;
+    while (index >= hist.size()) {
+      hist.push_back(create_histogram(hist.size()));
+    }
+    hist[index]->Fill(edep, weight);
+  };
+  auto fill = [&](unsigned int slot, double volume, double edep) { fill_weighted(slot, volume, edep, 1.); };
+  if (general_condition == "true") {
+    if (weighted) {
+      df.ForeachSlot(fill_weighted, {"volume", "edep", "weight"});
+    } else {
+      df.ForeachSlot(fill, {"volume", "edep"});
+    }
+  } else {
+    if (weighted) {
+      df.Filter(general_condition).ForeachSlot(fill_weighted, {"volume", "edep", "weight"});
+    } else {
+      df.Filter(general_condition).ForeachSlot(fill, {"volume", "edep"});
+    }
+  }
 
-    histname.str("");
-    histtitle.str("");
+  // Add up the histograms of all slots
+  size_t nvolumes = 0;
+  unsigned long long n_ignored = 0;
+  for (unsigned int slot = 0; slot < nslots; ++slot) {
+    nvolumes = std::max(nvolumes, slot_hist[slot].size());
+    n_ignored += slot_n_ignored[slot];
+  }
+  vector<std::unique_ptr<TH1D>> hist;
+  for (size_t volume = 0; volume < nvolumes; ++volume) {
+    hist.push_back(create_histogram(volume));
+    for (auto &s_hist : slot_hist) {
+      if (volume < s_hist.size()) {
+        hist[volume]->Add(s_hist[volume].get());
+      }
+    }
+  }
+  if (n_ignored) {
+    cout << "> Warning: Ignored " << n_ignored << " entries with a volume ID outside of 0 to MAXID" << endl;
   }
 
   cout << endl
        << "> Writing output to '" << outputfilename << "' ..." << endl;
   cout << "\tNAME : ENTRIES" << endl;
   TFile outputfile(outputfilename.c_str(), "RECREATE");
-  for (unsigned int i = 0; i < conditions.size(); ++i) {
-    cout << "\t" << histogramnames[i] << " : " << hist[i]->GetEntries() << endl;
-    hist[i]->Write();
+  for (auto &h : hist) {
+    cout << "\t" << h->GetName() << " : " << h->GetEntries() << endl;
+    h->Write();
   }
   outputfile.Close();
 
   duration<double> delta_t = duration_cast<duration<double>>(high_resolution_clock::now() - t_start);
-  high_resolution_clock::time_point t_stop = high_resolution_clock::now();
   cout << "> Execution took " << delta_t.count() << " seconds." << endl;
 }
+
+#ifndef __CLING__
+// Program documentation.
+static char doc[] = "Create one histogram of energy depositions per volume from a list of events stored among multiple ROOT files, using a single pass of a ROOT::RDataFrame";
+// Description of the accepted/required arguments
+static char args_doc[] = ""; // No arguments, only options!
+
+// The options argp understands
+static struct argp_option options[] = {
+    {"tree", 't', "TREENAME", 0, "Name of tree composing the list of events to process (default: utr)", 0},
+    {"pattern1", 'p', "PATTERN1", 0, "First string files must contain to be processed (default: utr)", 0},
+    {"pattern2", 'q', "PATTERN2", 0, "Second string files must contain to be processed (default: .root)", 0},
+    {"inputdir", 'd', "INPUTDIR", 0, "Directory to search for input files matching the patterns (default: current working directory '.' )", 0},
+    {"filename", 'o', "OUTPUTFILENAME", 0, "Output file name, file will be overwritten! (default: hist.root)", 0},
+    {"binning", 'b', "BINNING", 0, "Size of bins in the histogram in keV (default: 1 keV)", 0},
+    {"maxenergy", 'e', "EMAX", 0, "Maximum energy displayed in histogram in MeV (rounded up to match BINNING) (default: 10 MeV)", 0},
+    {"maxid", 'n', "MAXID", 0, "Highest volume ID. Entries with a higher volume ID are ignored. (default: highest volume ID in the files)", 0},
+    {"condition", 'c', "CONDITION", 0, "Only process entries which fulfil CONDITION, e.g. 'edep > 0.1' (default: all entries)", 0},
+    {"threads", 'T', "THREADS", 0, "Number of threads to be used, 0 for number of cpu cores (default: Number of cpu cores)", 0},
+    {0, 0, 0, 0, 0, 0}};
+
+// Used by main to communicate with parse_opt
+struct arguments {
+  string tree = "utr";
+  string p1 = "utr";
+  string p2 = ".root";
+  string inputDir = ".";
+  string outputFilename = "hist.root";
+  double binning = 1. / 1000.;
+  double eMax = 10.;
+  int maxid = -1;
+  string condition = "true";
+  unsigned int threads = 0;
+};
+
+// Function to parse a single option
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  // Get the input argument from argp_parse, which is a pointer to the arguments structure
+  struct arguments *arguments = (struct arguments *)state->input;
+
+  switch (key) {
+    case 't':
+      arguments->tree = arg;
+      break;
+    case 'p':
+      arguments->p1 = arg;
+      break;
+    case 'q':
+      arguments->p2 = arg;
+      break;
+    case 'd':
+      arguments->inputDir = arg;
+      break;
+    case 'o':
+      arguments->outputFilename = arg;
+      break;
+    case 'b':
+      arguments->binning = atof(arg) / 1000.;
+      break;
+    case 'e':
+      arguments->eMax = atof(arg);
+      break;
+    case 'n':
+      arguments->maxid = atoi(arg);
+      break;
+    case 'c':
+      arguments->condition = arg;
+      break;
+    case 'T':
+      arguments->threads = (unsigned int)atoi(arg);
+      break;
+    case ARGP_KEY_ARG:
+      cerr << "> Error: getHistogramRDF takes only options and no arguments!" << endl;
+      argp_usage(state);
+      break;
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
+
+int main(int argc, char *argv[]) {
+  struct arguments arguments;
+  argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+  if (!opendir(arguments.inputDir.c_str())) {
+    cerr << "> ERROR: Supplied INPUTDIR is not a valid directory! Aborting..." << endl;
+    exit(1);
+  }
+
+  // Bins centered around multiples of BINNING, starting at 0
+  const double emin = 0 - arguments.binning / 2;
+  const unsigned int nbins = (unsigned int)ceil((arguments.eMax - emin) / arguments.binning);
+  const double eMax = emin + nbins * arguments.binning;
+
+  getHistogramRDF(arguments.inputDir, arguments.outputFilename, {arguments.p1, arguments.p2}, arguments.condition, emin, eMax, nbins, arguments.tree, arguments.maxid, arguments.threads);
+
+  return 0;
+}
+#endif
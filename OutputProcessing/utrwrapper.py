@@ -41,6 +41,8 @@ listing all available options with their effect and default values
 #niceness=18                          # Niceness to run utr with (Default: 18)
 #threads=20                           # Number of threads to run utr and make
 #                                     # with (Default: System's CPU count)
+#shards=1                             # Number of processes (shards) which
+#                                     # share the threads of utr (Default: 1)
 #utrPath=/path/to/utr                 # Path of utr's code (Default: Parent
 #                                     # directory of """
     + programName
@@ -74,6 +76,12 @@ listing all available options with their effect and default values
 #cmakeArgs=--debug-output             # Pure string of additional arguments to
 #                                     # cmake on utr, see also [utrBuildOptions]
 #                                     # section (Default: None)
+#buildUtr=True                        # Whether to run cmake and make on utr
+#                                     # before the simulation (Default: True)
+#geometry=Campaign_2014_2015/150Sm    # Geometry to be loaded by utr at runtime,
+#                                     # requires utr to be built with
+#                                     # GEOMETRY_PLUGINS=ON (Default: The
+#                                     # geometry selected by the build options)
 #getHistogramArgs=-s                  # Pure string of additional arguments to
 #                                     # getHistogram, see also [getHistogramArgs]
 #                                     # section (Default: None)
@@ -207,6 +215,7 @@ if (
 logging = config["generalConfig"].getboolean("logging", True)
 niceness = config["generalConfig"].get("niceness", 18)
 threads = config["generalConfig"].get("threads", os.cpu_count())
+shards = config["generalConfig"].getint("shards", 1)
 utrPath = os.path.realpath(os.path.join(os.path.dirname(__file__), ".."))
 if utrPath.endswith("/build"):
     utrPath = utrPath[:-6]
@@ -215,6 +224,8 @@ checkForExistingOutput = config["generalConfig"].getboolean(
     "checkForExistingOutput", True
 )
 processOutput = config["generalConfig"].getboolean("processOutput", True)
+buildUtr = config["generalConfig"].getboolean("buildUtr", True)
+geometry = config["generalConfig"].get("geometry", None)
 getHistogramExe = config["generalConfig"].get("getHistogramExe", "getHistogram")
 outputDir = config["generalConfig"].get("outputDir", "output")
 outputDirRaw = outputDir
@@ -398,7 +409,7 @@ def runProcess(prog, procArgs, announce=True, **kwargs):
 
 
 # Compile the programs
-if not args.skipSimulation:
+if not args.skipSimulation and buildUtr:
     runProcess(
         "cmake on utr", ["cmake", "-S", ".", "-B", "build"] + cmakeArgs, cwd=utrPath
     )
@@ -454,7 +465,9 @@ if not args.skipSimulation:
             "--nthreads=" + str(threads),
             "--outputdir=" + outputDirRaw + "",
             "--macrofile=" + macFile + "",
-        ],
+        ]
+        + (["--geometry=" + geometry] if geometry else [])
+        + (["--shards=" + str(shards)] if shards > 1 else []),
         env=environmentVariables,
     )
 
@@ -0,0 +1,44 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+// Physics constructor which adds the adjoint particles and processes of the reverse Monte Carlo
+// method of Geant4 (see AdjointSimulation) to the forward EM physics list.
+//
+// The adjoint processes are the reverse photoelectric effect, Compton scattering, ionisation
+// and bremsstrahlung, following the physics list of the Geant4 example ReverseMC01.
+// Their cross sections are computed from the corresponding forward processes 'phot', 'compt',
+// 'eIoni' and 'eBrem', which must be provided by the global EM physics list. The forward
+// cross sections of these processes and of 'conv' are used to correct the weights of the adjoint
+// particles. Multiple scattering of adjoint electrons is not included.
+//
+// Only photons are considered as primary particles which enter the detector. Electrons can be
+// added with the Geant4 command '/adjoint/ConsiderAsPrimary e-'.
+
+#include "G4VPhysicsConstructor.hh"
+
+class AdjointEmPhysics : public G4VPhysicsConstructor {
+  public:
+  AdjointEmPhysics();
+  ~AdjointEmPhysics();
+
+  void ConstructParticle() override;
+  void ConstructProcess() override;
+};
@@ -0,0 +1,51 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Primary generator for the forward cross-check of the adjoint simulation (see AdjointSimulation).
+// Starts photons on the external surface of a physical volume with a cosine-law angular
+// distribution into the volume and energies uniformly distributed between emin and emax.
+#pragma once
+
+#include "G4AffineTransform.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "globals.hh"
+
+class G4Event;
+class G4ParticleGun;
+class G4VSolid;
+
+class AdjointForwardSource : public G4VUserPrimaryGeneratorAction {
+  public:
+  AdjointForwardSource(const G4String &physical_volume, G4double emin, G4double emax);
+  ~AdjointForwardSource();
+
+  void GeneratePrimaries(G4Event *anEvent);
+
+  // Area of the external surface of the volume
+  G4double GetArea() const { return area; };
+
+  private:
+  G4ParticleGun *particleGun;
+  G4VSolid *solid;
+  G4AffineTransform transform; // From the coordinate system of the volume to the world
+  G4double area;
+  G4double energy_min;
+  G4double energy_max;
+};
@@ -0,0 +1,127 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Adjoint (reverse Monte Carlo) simulation of the response of the detectors to photons from
+// extended sources like the walls of the experimental hall or the lead shielding.
+//
+// The reverse Monte Carlo method of Geant4 (G4AdjointSimManager) starts adjoint photons on the
+// external surface of a physical volume which contains the sensitive detectors (the adjoint
+// source), and tracks them backwards, gaining energy, until they reach the external surface of a
+// source volume. For each of these, the photon is then tracked forward from the adjoint source
+// into the detectors. The weight of an event is the response to a unit directional differential
+// flux of photons (1/(mm2 sr MeV)) which enter the source volume through its external surface.
+// Note that the source volume has to enclose the adjoint source, and that the response
+// describes the photons which leave the material of the source, not the emission inside it.
+//
+// For each source volume, the response of each EnergyDepositionSD detector is recorded as a
+// function of the photon energy on the source surface, both for any energy deposition ('total')
+// and for the full-energy peak ('peak', i.e. an energy deposition within the peak window of the
+// photon energy). Let R(E_i) be the response in the energy bin i of the width dE_i. Then
+//
+// - R(E_i) * j(E_i) is the number of counts for a source with the directional differential flux
+//   j(E_i) in 1/(mm2 sr MeV), and
+// - R(E_i) * f / dE_i is the number of counts for a gamma-ray line of energy E_i with the
+//   directional fluence f in 1/(mm2 sr).
+//
+// The response functions are written to '<output directory>/<prefix>_adjoint_<source>.txt'.
+// The coefficients R(E_i) / dE_i of the energy bins that contain the selected lines are printed.
+//
+// As a cross-check, the same source surfaces can be simulated forward ('<prefix>_forward_<source>.txt').
+// The photons are started on the external surface with energies uniformly distributed in the
+// energy range and a cosine-law angular distribution into the volume, i.e. an isotropic
+// directional flux. Each event has the weight pi * A * (E_max - E_min) / N, where A is the
+// area of the surface.
+//
+// The reverse Monte Carlo of Geant4 10.x only supports the sequential run manager, which is
+// selected by the '-a' command-line option together with the adjoint physics (see AdjointEmPhysics).
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "globals.hh"
+
+class G4ParticleDefinition;
+class G4UserEventAction;
+class G4UserRunAction;
+
+struct AdjointSimulation_Response {
+  std::vector<G4double> total; // Sum of the weights per energy bin
+  std::vector<G4double> total_squared; // Sum of the squared weights of the events per energy bin
+  std::vector<G4double> peak;
+  std::vector<G4double> peak_squared;
+};
+
+class AdjointSimulation {
+  public:
+  static void SetEnabled(G4bool enable) { enabled = enable; };
+  static G4bool IsEnabled() { return enabled; };
+  // Registers the user actions, which are replaced by the G4AdjointSimManager during adjoint runs
+  static void SetUserActions(G4UserEventAction *event_action, G4UserRunAction *run_action);
+
+  static void SetDetectorVolume(const G4String &physical_volume) { detector_volume = physical_volume; };
+  static G4String GetDetectorVolume() { return detector_volume; };
+  static void AddSourceVolume(const G4String &physical_volume) { source_volumes.push_back(physical_volume); };
+  static void ClearSourceVolumes() { source_volumes.clear(); };
+  static void SetEnergyRange(G4double emin, G4double emax);
+  static void SetNumberOfBins(G4int nbins) { n_bins = nbins > 0 ? nbins : 1; };
+  static G4int GetNumberOfBins() { return n_bins; };
+  static void AddLine(G4double energy) { lines.push_back(energy); };
+  static void SetPeakWindow(G4double window) { peak_window = window; };
+  static G4double GetPeakWindow() { return peak_window; };
+
+  // Adjoint simulation with n_events events per source volume
+  static void Run(G4int n_events);
+  // Forward simulation with n_events events per source volume
+  static void RunForward(G4int n_events);
+
+  static G4bool IsAdjointParticle(const G4ParticleDefinition *particle);
+  // Called by the sensitive detectors for each detector with an energy deposition in the current event
+  static void AddEnergyDeposition(G4int detID, G4double energy);
+  // Called at the end of each event
+  static void EndOfEvent();
+  // Called by the forward source for each primary photon
+  static void SetForwardPrimary(G4double energy, G4double weight);
+
+  static void PrintInfo();
+
+  private:
+  static G4bool CheckSettings();
+  static G4int GetBin(G4double energy);
+  static void Score(G4double energy, G4double weight);
+  static void ResetResponses();
+  static void WriteResponses(const G4String &mode, const G4String &source, G4double normalization);
+
+  static G4bool enabled;
+  static G4String detector_volume;
+  static std::vector<G4String> source_volumes;
+  static G4double energy_min;
+  static G4double energy_max;
+  static G4int n_bins;
+  static std::vector<G4double> lines;
+  static G4double peak_window;
+
+  // State of the current run
+  static G4String mode; // 'adjoint', 'forward' or '' outside of the runs of AdjointSimulation
+  static std::map<G4int, G4double> event_energies;
+  static G4double forward_energy;
+  static G4double forward_weight;
+  static std::map<G4int, AdjointSimulation_Response> responses;
+};
@@ -0,0 +1,116 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Arrangement of detectors around a point, read from a text file at runtime.
+// This is an alternative to classes like Detectors_G3_271_279, which need to be
+// compiled for every change of the arrangement. All detectors are built by the
+// existing Detector subclasses, the file only contains their parameters.
+//
+// Each non-empty line of the file describes one detector ('#' starts a comment):
+//
+// NAME TYPE PROPERTIES THETA PHI DISTANCE ROTATION SD_ID [OPTIONS ...]
+//
+// NAME: Name of the detector. The sensitive volume gets the same name (clover crystals: NAME_1 to NAME_4).
+// TYPE: HPGe_Coaxial, HPGe_Clover, LaBr_3x3, CeBr3_2x2 or LaBr_Galatea
+// PROPERTIES: Name of the properties in HPGe_Collection for HPGe detectors, '-' for all others
+// THETA, PHI, ROTATION: Polar, azimuthal and intrinsic rotation angle in degrees
+// DISTANCE: Distance of the detector from the center in mm
+// SD_ID: ID of the EnergyDepositionSD or '-' if the detector is passive. Clover detectors use SD_ID to SD_ID+3.
+// OPTIONS:
+//   filter:MATERIAL:THICKNESS:RADIUS  Add a filter (thickness and radius in mm)
+//   wrap:MATERIAL:THICKNESS           Add a wrap (thickness in mm)
+//   offset:X:Y:Z                      Shift the detector with respect to the center (in mm)
+//   filter_case, filter_case_ring     HPGe_Coaxial and LaBr_3x3
+//   dewar                             HPGe_Coaxial and HPGe_Clover
+//   housing                           LaBr_3x3
+//   no_connectors                     CeBr3_2x2
+//   old_configuration                 LaBr_Galatea
+//
+// Single parameters of a detector can be overridden with Set_Parameter() (macro commands in
+// /utr/arrangement/) to scan them between runs without restarting utr. Construct() aborts if a
+// parameter was set for a detector which is not in the arrangement, or if its name is not valid.
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "G4LogicalVolume.hh"
+#include "G4ThreeVector.hh"
+
+using std::map;
+using std::vector;
+
+struct DetectorArrangement_Entry {
+  G4String name;
+  G4String type;
+  G4String properties;
+  G4double theta;
+  G4double phi;
+  G4double dist_from_center;
+  G4double intrinsic_rotation_angle;
+  G4ThreeVector offset;
+  G4int sensitive_detector_id;
+
+  vector<G4String> filter_materials;
+  vector<G4double> filter_thicknesses;
+  vector<G4double> filter_radii;
+
+  vector<G4String> wrap_materials;
+  vector<G4double> wrap_thicknesses;
+
+  vector<G4String> flags;
+};
+
+class DetectorArrangement {
+  public:
+  // The file can be replaced by another one for the arrangement with the given name
+  // via Set_Filename() (macro command /utr/setArrangementFile).
+  DetectorArrangement(G4LogicalVolume *World_Log, G4String arrangement_name, G4String default_filename);
+  ~DetectorArrangement(){};
+
+  void Construct(G4ThreeVector global_coordinates);
+  // Has to be called in DetectorConstruction::ConstructSDandField()
+  void ConstructSDs() const;
+
+  G4String Get_Filename() const;
+  G4int Get_Max_Sensitive_Detector_ID() const;
+  const vector<DetectorArrangement_Entry> &Get_Entries() const { return entries; };
+
+  static void Set_Filename(const G4String &arrangement_name, const G4String &filename);
+
+  // Override a parameter of the detector with the given name. Valid parameters are theta, phi,
+  // rotation (angles), distance, offset_x, offset_y, offset_z, filter_thickness_N and
+  // wrap_thickness_N (lengths), where N is the number of the filter or wrap, starting at 1.
+  static void Set_Parameter(const G4String &detector_name, const G4String &parameter, const G4double value);
+  static void Clear_Parameters() { parameters.clear(); };
+  static void Print_Parameters();
+
+  private:
+  void Read_File(const G4String &filename);
+  void Apply_Parameters(DetectorArrangement_Entry &entry) const;
+  void Construct_Entry(const DetectorArrangement_Entry &entry, G4ThreeVector global_coordinates) const;
+
+  G4LogicalVolume *World_Logical;
+  G4String name;
+  G4String default_filename;
+  vector<DetectorArrangement_Entry> entries;
+
+  static map<G4String, G4String> filenames;
+  static map<G4String, map<G4String, G4double>> parameters;
+};
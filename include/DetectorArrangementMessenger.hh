@@ -0,0 +1,49 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "G4UIcommand.hh"
+#include "G4UIdirectory.hh"
+#include "G4UImessenger.hh"
+#include "globals.hh"
+
+class DetectorArrangementMessenger : public G4UImessenger {
+  public:
+  DetectorArrangementMessenger();
+  ~DetectorArrangementMessenger();
+
+  void SetNewValue(G4UIcommand *command, G4String newValues);
+
+  private:
+  G4UIcommand *CreateParameterCommand(const G4String &command_name, const G4String &guidance, const G4String &default_unit, const G4bool indexed);
+  void GeometryModified();
+
+  G4UIdirectory *arrangementDirectory;
+
+  G4UIcommand *distanceCmd;
+  G4UIcommand *thetaCmd;
+  G4UIcommand *phiCmd;
+  G4UIcommand *rotationCmd;
+  G4UIcommand *offsetCmd;
+  G4UIcommand *filterThicknessCmd;
+  G4UIcommand *wrapThicknessCmd;
+  G4UIcommand *resetCmd;
+  G4UIcommand *printCmd;
+};
@@ -0,0 +1,80 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Cache for the solids and materials of detector models.
+//
+// Many setups contain several detectors of the same model, for example four HPGe detectors with
+// identical properties from the HPGe_Collection. Instead of building the solids of each detector
+// from scratch, the Detector classes look them up here by the name of the model and of the part:
+//
+//   G4VSolid *dewar_solid = DetectorCache::Find_Solid(model, "dewar");
+//   if (!dewar_solid) {
+//     dewar_solid = DetectorCache::Add_Solid(model, "dewar", new G4Tubs(...));
+//   }
+//
+// The name of the model has to contain all properties the solids depend on (see Model_Key()).
+// The logical volumes are still created for each detector with its own name, so that volumes can
+// be looked up by name (e.g. /utr/physics/forceCollision) and made sensitive per detector. Only
+// the names of the shared solids are those of the first detector they were built for.
+//
+// Since Geant4 deletes all solids and logical volumes when the geometry is rebuilt, the cache is
+// cleared before each construction of the geometry.
+#pragma once
+
+#include <map>
+#include <sstream>
+
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4VSolid.hh"
+#include "globals.hh"
+
+class DetectorCache {
+  public:
+  // Return the cached solid of a model, or nullptr if it has not been built yet
+  static G4VSolid *Find_Solid(const G4String &model, const G4String &part);
+  // Add a solid to the cache and return it
+  static G4VSolid *Add_Solid(const G4String &model, const G4String &part, G4VSolid *solid);
+
+  // Scintillator material of the LaBr detectors
+  static G4Material *Find_Or_Build_LaBr3Ce();
+
+  static void Clear();
+
+  // Join the properties of a model into a unique name. Floating point numbers are written with
+  // full precision.
+  template <typename... Properties>
+  static G4String Model_Key(const G4String &type, const Properties &... properties) {
+    std::ostringstream key;
+    key.precision(17);
+    key << type;
+    Append_To_Key(key, properties...);
+    return key.str();
+  }
+
+  private:
+  static void Append_To_Key(std::ostringstream &){};
+  template <typename Property, typename... Properties>
+  static void Append_To_Key(std::ostringstream &key, const Property &property, const Properties &... properties) {
+    key << "|" << property;
+    Append_To_Key(key, properties...);
+  }
+
+  static std::map<G4String, G4VSolid *> solids;
+};
@@ -0,0 +1,50 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+// Interface between utr and a DetectorConstruction.
+//
+// With the GEOMETRY_PLUGINS build option, each DetectorConstruction/<campaign>/<setup> directory
+// is compiled into a shared library which exports the functions below (see
+// src/plugin/DetectorConstructionPlugin.cc). The library is loaded at runtime by the GeometryLoader.
+// Without GEOMETRY_PLUGINS, the same functions are compiled into the utr executable for the
+// DetectorConstruction that was selected by the CAMPAIGN and DETECTOR_CONSTRUCTION build options.
+
+#include "G4VUserDetectorConstruction.hh"
+#include "globals.hh"
+
+// Increase this number whenever the interface changes, to prevent utr from loading incompatible libraries.
+#define UTR_DETECTOR_CONSTRUCTION_PLUGIN_VERSION 1
+
+extern "C" {
+// Version of the interface the library was built with
+G4int utrDetectorConstructionPluginVersion();
+
+// Create a new instance of the DetectorConstruction
+G4VUserDetectorConstruction *utrCreateDetectorConstruction();
+
+// Value of DetectorConstruction::Max_Sensitive_Detector_ID after the geometry has been constructed,
+// or -1 if the DetectorConstruction does not define it (needed for EVENT_EVENTWISE output)
+G4int utrGetMaxSensitiveDetectorID(const G4VUserDetectorConstruction *detectorConstruction);
+}
+
+typedef G4int (*utrDetectorConstructionPluginVersion_t)();
+typedef G4VUserDetectorConstruction *(*utrCreateDetectorConstruction_t)();
+typedef G4int (*utrGetMaxSensitiveDetectorID_t)(const G4VUserDetectorConstruction *);
@@ -0,0 +1,82 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Online digitization of the energy deposited in a sensitive detector.
+// Applies a detector-specific resolution (Gaussian broadening with an
+// energy-dependent FWHM), an energy threshold and an optional rejection of
+// energy depositions in a dead layer at the surface of the crystal.
+// The settings are shared by all threads and should only be modified between
+// runs, e.g. via the /utr/digitizer/ macro commands (see DigitizerMessenger).
+#pragma once
+
+#include <map>
+
+#include "G4Types.hh"
+
+class G4Step;
+
+struct Digitizer_Channel {
+  // Resolution function, taken to be of the same form as the MCNP 'GEB' card:
+  //
+  // FWHM(E) = a + b * sqrt(E + c * E^2)
+  //
+  // with E and FWHM in units of MeV, a in MeV, b in sqrt(MeV) and c in 1/MeV.
+  G4double resolution_a = 0.;
+  G4double resolution_b = 0.;
+  G4double resolution_c = 0.;
+  G4double threshold = 0.; // Events with a (broadened) energy below the threshold are discarded
+  G4double dead_layer_thickness = 0.; // Energy depositions closer to any surface of the sensitive volume than this are ignored
+  G4int histogram_id = -1; // ID of the online histogram, -1 if none was booked
+};
+
+class Digitizer {
+  public:
+  static void SetActive(G4bool act) { active = act; };
+  static G4bool IsActive() { return active; };
+
+  static void SetResolution(G4int detID, G4double a, G4double b, G4double c);
+  static void SetThreshold(G4int detID, G4double thr);
+  static void SetDeadLayer(G4int detID, G4double thickness);
+  static void SetHistogramBinning(G4int nbins, G4double emax);
+
+  // Returns the FWHM of the resolution function of a detector at energy e
+  static G4double GetFWHM(G4int detID, G4double e);
+  // Returns true if an energy deposition in this step has to be ignored because
+  // it happened in the dead layer of the detector
+  static G4bool IsInDeadLayer(G4int detID, const G4Step *step);
+  // Returns the digitized energy for a given total energy deposition in a
+  // detector, or 0 if the result is below the detector threshold
+  static G4double Digitize(G4int detID, G4double edep);
+
+  // Book one histogram of the digitized energy per configured detector.
+  // Must be called on every thread in the same order, since the histogram
+  // IDs are only assigned by the master.
+  static void CreateHistograms(G4bool isMaster);
+  // The weight is only different from 1 with variance reduction (see ForcedCollisionPhysics)
+  static void FillHistogram(G4int detID, G4double energy, G4double weight = 1.);
+
+  static void PrintInfo();
+
+  private:
+  static G4bool active;
+  static std::map<G4int, Digitizer_Channel> channels;
+  static G4int histogram_nbins;
+  static G4double histogram_emax;
+};
@@ -29,6 +29,7 @@ class EventAction : public G4UserEventAction {
   EventAction();
   virtual ~EventAction();
 
+  virtual void BeginOfEventAction(const G4Event *);
   virtual void EndOfEventAction(const G4Event *);
 
   void setNThreads(const int nt) { n_threads = (G4double)nt; };
@@ -0,0 +1,119 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Scoring of the particle fluence with track-length estimators.
+//
+// A scorer divides a region into cells and estimates the fluence in each cell as the sum of the
+// lengths of all track segments inside the cell, multiplied by the track weight and divided by the
+// volume of the cell. Unlike counting the particles which cross a surface, every step contributes,
+// which gives a much smaller variance for thin cells. The following types of scorers exist:
+//
+// - box:      Cartesian mesh of NX x NY x NZ cells, cell index = ix + NX * (iy + NY * iz).
+// - cylinder: Mesh of NR rings times NZ slices around the z axis, cell index = ir + NR * iz.
+// - volume:   One cell for each of the given physical volumes, in the given order.
+//
+// The meshes are defined in the coordinates of the world volume and do not have to coincide with any
+// volume of the geometry. Each cell is binned in the kinetic energy and in the direction cosine
+// with respect to the z axis (i.e. the beam axis) at the beginning of the step.
+//
+// Within an event, the contributions are accumulated sparsely by each thread. At the end of the
+// event, each nonzero bin is filled into the histogram of the scorer once, so that the statistical
+// uncertainties of the histogram are those of the fluence per event. The 3D histogram 'flux_<SCORER>'
+// (x: cell index, y: kinetic energy in MeV, z: direction cosine) contains the fluence in 1/cm2 summed
+// over all events, i.e. it has to be divided by the number of events. It is merged over all threads
+// and written to the histogram file OUTPUTDIR/PREFIX<ID>_hist.root. Scorers with more than 10^7 bins
+// in total are skipped, since each thread holds the whole histogram.
+// The settings are shared by all threads and should only be modified between runs, e.g. via the
+// /utr/flux/ macro commands (see FluxScoringMessenger).
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4ParticleDefinition;
+class G4Step;
+class G4VPhysicalVolume;
+
+enum flux_scorer_type : short {
+  FLUX_BOX = 0,
+  FLUX_CYLINDER = 1,
+  FLUX_VOLUMES = 2
+};
+
+struct FluxScoring_Scorer {
+  G4String name;
+  flux_scorer_type type;
+  G4ThreeVector center;
+  G4ThreeVector half_lengths; // Box: half lengths, cylinder: (radius, radius, half length)
+  G4int n_x = 1; // Box: (NX, NY, NZ), cylinder: (NR, 1, NZ), volumes: (number of volumes, 1, 1)
+  G4int n_y = 1;
+  G4int n_z = 1;
+  std::vector<G4String> volume_names;
+
+  G4int n_energy = 1000;
+  G4double energy_min = 0.;
+  G4double energy_max = 10. * MeV;
+  G4int n_cos = 1;
+  G4String particle_name = "gamma"; // 'all' for all particles
+
+  // Set at the beginning of each run by the master thread
+  std::vector<G4double> cell_volumes;
+  std::unordered_map<const G4VPhysicalVolume *, G4int> volume_cells;
+  const G4ParticleDefinition *particle = nullptr;
+  G4int histogram_id = -1;
+
+  G4int GetNumberOfCells() const { return n_x * n_y * n_z; };
+  G4long GetNumberOfBins() const { return (G4long)GetNumberOfCells() * n_energy * n_cos; };
+};
+
+class FluxScoring {
+  public:
+  // Returns false if a scorer with this name exists already
+  static G4bool AddBox(const G4String &name, const G4ThreeVector &half_lengths, G4int nx, G4int ny, G4int nz, const G4ThreeVector &center);
+  static G4bool AddCylinder(const G4String &name, G4double radius, G4double half_length, G4int nr, G4int nz, const G4ThreeVector &center);
+  static G4bool AddVolumes(const G4String &name, const std::vector<G4String> &volume_names);
+  // Return false if the scorer does not exist
+  static G4bool SetEnergyBinning(const G4String &name, G4int n, G4double emin, G4double emax);
+  static G4bool SetCosBinning(const G4String &name, G4int n);
+  static G4bool SetParticle(const G4String &name, const G4String &particle_name);
+  static void Clear();
+  static G4bool IsActive() { return scorers.size() > 0; };
+
+  // Book the histograms of all scorers. Must be called on every thread in the same order, since the
+  // histogram IDs are only assigned by the master.
+  static void CreateHistograms(G4bool isMaster);
+  // Called by each thread for each step
+  static void Score(const G4Step *step);
+  static void EndOfEvent();
+
+  static void PrintInfo();
+
+  private:
+  static FluxScoring_Scorer *FindScorer(const G4String &name);
+  // Add the track length of the segment from p0 to p1 to the cells of a mesh
+  static void ScoreBox(const FluxScoring_Scorer &scorer, std::unordered_map<G4int, G4double> &event_bins, G4int bin_offset, const G4ThreeVector &p0, const G4ThreeVector &p1, G4double weight);
+  static void ScoreCylinder(const FluxScoring_Scorer &scorer, std::unordered_map<G4int, G4double> &event_bins, G4int bin_offset, const G4ThreeVector &p0, const G4ThreeVector &p1, G4double weight);
+
+  static std::vector<FluxScoring_Scorer> scorers;
+};
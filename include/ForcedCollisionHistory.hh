@@ -0,0 +1,71 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Bookkeeping of the alternative histories of an event with forced collisions (see
+// ForcedCollisionPhysics).
+//
+// Each time a G4BOptrForceCollision operator splits a track at the entrance of a volume, the
+// forced clone starts a new history, and the original track continues in another new history. The
+// part of the original track before the split, including all energy depositions, keeps its previous
+// history. All secondaries inherit the history of their parent. The history index is stored in a
+// ForcedCollisionHistory_TrackInformation of the track. Tracks without this information belong to
+// history 0, which is the only history of an event without forced collisions.
+//
+// All tracks of a history have the same weight. The energy depositions of the EnergyDepositionSD
+// detectors are summed for each history separately, and the trigger decides about each history
+// (see Trigger). The index is written next to the weight to the output file (build option
+// EVENT_WEIGHT). It is only unique within an event.
+#pragma once
+
+#include "G4VUserTrackInformation.hh"
+#include "globals.hh"
+
+class G4Step;
+class G4Track;
+
+class ForcedCollisionHistory_TrackInformation : public G4VUserTrackInformation {
+  public:
+  ForcedCollisionHistory_TrackInformation(G4int hist) : G4VUserTrackInformation(), history(hist){};
+
+  void SetHistory(G4int hist) { history = hist; };
+  G4int GetHistory() const { return history; };
+
+  private:
+  G4int history;
+};
+
+class ForcedCollisionHistory {
+  public:
+  // Set when the biasing operators are attached
+  static void SetActive(G4bool act) { active = act; };
+  static G4bool IsActive() { return active; };
+
+  static G4int GetHistory(const G4Track *track);
+
+  // Called by each thread at the beginning of an event and after each step
+  static void BeginOfEvent();
+  static void Step(const G4Step *step);
+
+  private:
+  static G4bool IsClone(const G4Track *secondary);
+  static void SetHistory(const G4Track *track, G4int history);
+
+  static G4bool active;
+};
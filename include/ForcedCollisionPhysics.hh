@@ -0,0 +1,68 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Physics constructor for the forced-collision variance reduction of Geant4 in thin volumes,
+// for example the targets. A particle (by default a photon) which enters one of the selected
+// logical volumes is cloned by a G4BOptrForceCollision biasing operator:
+//
+// - The original track crosses the volume without interacting and continues with its weight
+//   multiplied by the probability exp(-mu * L) to pass the volume, where L is the length of its
+//   path through the volume.
+// - The clone is forced to interact inside the volume, with its weight multiplied by the
+//   interaction probability 1 - exp(-mu * L).
+//
+// Each particle which enters the volume therefore produces an interaction inside it, and all
+// secondaries inherit the weight of their parent. The clone and the original track start new
+// histories of the event (see ForcedCollisionHistory). The sum of the weights is conserved, so the
+// weighted results are unbiased. Particles created inside the volume are not forced.
+//
+// The physics processes of the biased particles are wrapped by G4BiasingProcessInterface processes
+// after all other physics constructors have been constructed (see Physics::ConstructProcess()).
+// The biasing operators are thread-local and are attached to the logical volumes on each thread.
+// Only one particle can be forced per logical volume, and it should be neutral.
+#pragma once
+
+#include <map>
+
+#include "G4VPhysicsConstructor.hh"
+
+using std::map;
+
+class G4ParticleDefinition;
+
+class ForcedCollisionPhysics : public G4VPhysicsConstructor {
+  public:
+  ForcedCollisionPhysics();
+  ~ForcedCollisionPhysics();
+
+  void ConstructParticle() override{};
+  void ConstructProcess() override;
+
+  void AddVolume(const G4String &logical_volume_name, const G4String &particle_name) { volume_particles[logical_volume_name] = particle_name; };
+  G4bool HasVolumes() const { return volume_particles.size() > 0; };
+
+  void PrintInfo() const;
+  void StreamInfo(std::ostream &os) const;
+
+  private:
+  void WrapProcesses(G4ParticleDefinition *particle) const;
+
+  map<G4String, G4String> volume_particles;
+};
@@ -0,0 +1,48 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "G4VUserDetectorConstruction.hh"
+#include "globals.hh"
+
+#include "DetectorConstructionPlugin.hh"
+
+// Creates the DetectorConstruction selected by its name '<campaign>/<setup>', for example
+// 'Campaign_2018_2019/64Ni_271_279'.
+// If utr was built with the GEOMETRY_PLUGINS option, the corresponding shared library is searched for in
+// the directories listed in the environment variable UTR_GEOMETRY_PATH (separated by ':'), in the build
+// directory and in the installation directory. Instead of a name, the path to a library can be given as well.
+// Otherwise, only the DetectorConstruction which was compiled into utr is available.
+class GeometryLoader {
+  public:
+  static G4VUserDetectorConstruction *Create(const G4String &geometry);
+
+  // Selects a new geometry for the run manager. Only possible before /run/initialize.
+  static void SetGeometry(const G4String &geometry);
+
+  static G4String GetGeometryName() { return geometryName; };
+  static G4int GetMaxSensitiveDetectorID();
+
+  private:
+  static G4String FindLibrary(const G4String &geometry);
+
+  static G4String geometryName;
+  static utrGetMaxSensitiveDetectorID_t getMaxSensitiveDetectorID;
+};
@@ -0,0 +1,81 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Optimization of the navigation in the geometry after it has been constructed.
+//
+// Most setups place dozens of lead, concrete and aluminium pieces directly into the world volume,
+// which makes the world's smart voxels large and slow to navigate. Therefore, the daughters of the
+// world can be grouped into box-shaped envelope volumes made of the world material. This is
+// disabled by default, since it changes the volume hierarchy, and has to be activated with
+// /utr/geometry/envelopes:
+//
+// - Two groups of daughters are merged if the gap between their axis-aligned bounding boxes is
+//   at most envelope_gap. The closest groups are merged first. Since the pieces of a setup
+//   component (a shielding wall, a table, ...) are close to each other, but far from other
+//   components, each envelope usually corresponds to a setup component.
+// - An envelope is the bounding box of its pieces. Groups are only merged if the resulting box
+//   does not intersect the bounding box of any other volume. For example, pieces which surround
+//   the beam pipe can not be wrapped together, since the beam pipe would cut their envelope.
+// - Envelopes with a single piece are not created.
+// - No envelopes are created if any daughter of the world is replicated or parameterised.
+//
+// The envelopes are named 'Envelope_<N>'. The logical volumes, the sensitive detectors and the
+// names of all other volumes are unchanged, but the mother volume and the translation of the
+// wrapped physical volumes change, and with them the touchables (e.g. the depth of a volume in the
+// touchable history).
+//
+// Besides that, the smartless parameter (the average number of voxels per daughter, see
+// G4LogicalVolume::SetSmartless()) can be set for any logical volume.
+// The settings are usually modified via the /utr/geometry/ macro commands (see GeometryOptimizerMessenger)
+// and take effect when the geometry is constructed.
+#pragma once
+
+#include <map>
+
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "globals.hh"
+
+class GeometryOptimizer {
+  public:
+  static void SetEnvelopesActive(G4bool act) { envelopes_active = act; };
+  static G4bool AreEnvelopesActive() { return envelopes_active; };
+  static void SetEnvelopeGap(G4double gap) { envelope_gap = gap; };
+  static G4double GetEnvelopeGap() { return envelope_gap; };
+
+  // Set the smartless parameter of a logical volume. If the volume already exists, it is applied
+  // immediately, otherwise when the geometry is constructed.
+  static void SetSmartless(const G4String &logical_volume_name, G4double smartless);
+
+  // Called by the DetectorConstruction after the world has been constructed
+  static void Optimize(G4VPhysicalVolume *world);
+
+  // Rebuilds the smart voxels with the statistics of Geant4's G4GeometryManager and prints a
+  // summary of the voxels of all volumes with more than one daughter
+  static void PrintVoxelStatistics();
+
+  private:
+  static void BuildEnvelopes(G4LogicalVolume *mother_logical);
+  static G4bool ApplySmartless(const G4String &logical_volume_name, G4double smartless);
+
+  static G4bool envelopes_active;
+  static G4double envelope_gap;
+  static std::map<G4String, G4double> smartless_settings;
+};
@@ -27,6 +27,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Detector.hh"
 #include "HPGe_Clover_Properties.hh"
+#include "PolyconeProfile.hh"
 
 class HPGe_Clover : public Detector {
   public:
@@ -39,8 +40,22 @@ class HPGe_Clover : public Detector {
   void setProperties(HPGe_Clover_Properties &prop) { properties = prop; };
   void useDewar() { use_dewar = true; };
 
+  // Solids of a single crystal without the hole for the anode, and of the hole, which is placed
+  // inside each crystal at the back. The cylindrical parts of the crystal are approximated by a
+  // polygon with the given maximum deviation.
+  G4VSolid *crystal_extruded_solid(const G4double max_deviation = PolyconeProfile::default_max_deviation) const;
+  G4VSolid *anode_solid() const;
+
+  // Distance of the flat sides of a crystal from the axis of the original cylindrical crystal
+  static constexpr G4double crystal_inner_cut = 22. * CLHEP::mm;
+  static constexpr G4double crystal_outer_cut = 23. * CLHEP::mm;
+
   private:
+  // Name of the detector model in the DetectorCache
+  G4String Model_Key() const;
+
   HPGe_Clover_Properties properties;
   bool use_dewar;
   G4VSolid *rounded_box(const G4String name, const G4double side_length, const G4double length, const G4double rounding_radius, const G4int n_points_per_corner) const;
+  vector<G4TwoVector> crystal_cross_section(const G4double max_deviation) const;
 };
@@ -47,6 +47,9 @@ class HPGe_Coaxial : public Detector {
   void useDewar() { use_dewar = true; };
 
   private:
+  // Name of the detector model in the DetectorCache
+  G4String Model_Key() const;
+
   HPGe_Coaxial_Properties properties;
   bool use_filter_case;
   bool use_filter_case_ring;
@@ -21,6 +21,8 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 // Properties of available HPGe detectors
 #pragma once
 
+#include <map>
+
 #include "G4SystemOfUnits.hh"
 
 #include "HPGe_Clover_Properties.hh"
@@ -689,4 +691,35 @@ struct HPGe_Collection {
     HPGe_Clover_Yale.dewar_wall_thickness = 5. * mm;
     HPGe_Clover_Yale.dewar_material = "G4_Al";
   }
+
+  // Access to the properties by their name (e.g. 'HPGe_60_TUNL_40663'), used to read detector
+  // arrangements from text files. Return nullptr if the name is unknown.
+  HPGe_Coaxial_Properties *Get_Coaxial_Properties(const G4String &name) {
+    std::map<G4String, HPGe_Coaxial_Properties *> coaxial_properties = {
+        {"HPGe_55_TUNL_21638", &HPGe_55_TUNL_21638},
+        {"HPGe_55_TUNL_31524", &HPGe_55_TUNL_31524},
+        {"HPGe_60_TUNL_21033", &HPGe_60_TUNL_21033},
+        {"HPGe_60_TUNL_30986", &HPGe_60_TUNL_30986},
+        {"HPGe_60_TUNL_31061", &HPGe_60_TUNL_31061},
+        {"HPGe_60_TUNL_40663", &HPGe_60_TUNL_40663},
+        {"HPGe_120_TUNL_40383", &HPGe_120_TUNL_40383},
+        {"HPGe_80_TUD_90006", &HPGe_80_TUD_90006},
+        {"HPGe_100_TUD_72902", &HPGe_100_TUD_72902},
+        {"HPGe_100_TUD_72930", &HPGe_100_TUD_72930},
+        {"HPGe_100_TUD_73760", &HPGe_100_TUD_73760},
+        {"HPGe_100_Cologne_73954", &HPGe_100_Cologne_73954},
+        {"HPGe_86_Stuttgart_31120", &HPGe_86_Stuttgart_31120},
+        {"HPGe_ANL_31670", &HPGe_ANL_31670},
+        {"HPGe_ANL_41203", &HPGe_ANL_41203},
+    };
+    auto properties = coaxial_properties.find(name);
+    return properties == coaxial_properties.end() ? nullptr : properties->second;
+  }
+
+  HPGe_Clover_Properties *Get_Clover_Properties(const G4String &name) {
+    if (name == "HPGe_Clover_Yale") {
+      return &HPGe_Clover_Yale;
+    }
+    return nullptr;
+  }
 };
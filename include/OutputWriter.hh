@@ -0,0 +1,158 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Writes the rows of the output ntuple of the calling worker thread.
+//
+// The sensitive detectors use OutputWriter::FillNtupleDColumn() and OutputWriter::AddNtupleRow()
+// in the same way as the corresponding methods of the G4RootAnalysisManager. By default, the rows
+// are passed to the G4RootAnalysisManager of the worker thread immediately, i.e. the worker thread
+// also compresses and writes the baskets of the ntuple whenever they are full.
+//
+// In asynchronous mode (/utr/output/async), AddNtupleRow() only copies the row into a ring buffer
+// of the worker thread. One or more writer threads drain the ring buffers. The G4RootAnalysisManager
+// of a worker thread must only be used by that thread, which also fills the histograms. Therefore,
+// each worker thread has a second ntuple with the same columns in a file of its own, which is only
+// filled by the writer thread. Each ring buffer has a single producer (its worker thread) and a
+// single consumer (a writer thread), so no locks are needed. If a ring buffer is full, the worker
+// thread waits until the writer thread has made room (back-pressure). At the end of a run, each
+// worker thread waits until its ring buffer is empty, writes and closes both files, and replaces
+// the output file of the analysis manager, which only contains the empty ntuple, with the file of
+// the writer thread, i.e. the output files are unchanged. The sequential run manager writes the
+// histograms into the same file as the ntuple, so it always writes the rows synchronously.
+//
+// The compression level and the basket size of the output files can be set as well
+// (/utr/output/compression, /utr/output/basketSize, /utr/output/basketEntries). Note that Geant4
+// writes ROOT files with its own implementation, which only supports zlib compression.
+//
+// While the Trigger is active, the rows of an event are held back until the end of the event, and
+// only passed on if the history to which they belong (see ForcedCollisionHistory) was accepted.
+//
+// For each thread, the size of the uncompressed data, the size of the output file, the time spent
+// writing, and in asynchronous mode the maximum filling of the ring buffer and the time the worker
+// thread spent waiting for a full buffer are printed at the end of each run.
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "globals.hh"
+
+class G4RootAnalysisManager;
+struct OutputWriter_File;
+
+struct OutputWriter_Statistics {
+  G4long n_rows = 0;
+  G4double data_size = 0.; // Uncompressed size of the filled columns in bytes
+  G4double file_size = 0.; // In bytes
+  G4double write_time = 0.; // Time spent adding rows and writing the file, in seconds
+  G4long max_depth = 0; // Maximum number of rows in the ring buffer
+  G4long n_full = 0; // Number of rows which had to wait for a full ring buffer
+  G4double wait_time = 0.; // In seconds
+  G4long n_discarded = 0; // Rows of histories rejected by the trigger
+};
+
+// Output of one thread. In asynchronous mode, it contains a ring buffer in which each slot holds
+// the number of filled columns and the values. The head and tail counters only increase, the slot
+// of a row is given by the counter modulo n_slots.
+struct OutputWriter_Channel {
+  OutputWriter_Channel(size_t n_rows, size_t n_columns) : n_slots(n_rows), slot_size(n_columns + 1), values(n_rows * (n_columns + 1), 0.), head(0), tail(0), pending(n_columns, 0.), n_pending(0) {}
+
+  const size_t n_slots;
+  const size_t slot_size;
+  std::vector<G4double> values;
+  std::atomic<size_t> head; // Number of rows written by the worker thread
+  std::atomic<size_t> tail; // Number of rows added to the ntuple by the writer thread
+
+  G4RootAnalysisManager *analysis_manager = nullptr;
+  // Ntuple of the writer thread in asynchronous mode
+  std::shared_ptr<OutputWriter_File> file;
+  G4int writer_id = 0;
+
+  // Row which is currently filled by the worker thread
+  std::vector<G4double> pending;
+  G4int n_pending;
+
+  // Rows of the current event, each given by its history, the number of filled columns and the
+  // values, which are held back until the trigger decision
+  G4bool hold_events = false;
+  std::vector<G4double> event_rows;
+
+  // The writer thread only updates the write time, before it marks the ring buffer as empty
+  OutputWriter_Statistics statistics;
+};
+
+class OutputWriter {
+  public:
+  static void SetAsync(G4bool async) { asynchronous = async; };
+  static G4bool IsAsync() { return asynchronous; };
+  static void SetNumberOfWriterThreads(G4int n) { n_writer_threads = n > 0 ? n : 1; };
+  static G4int GetNumberOfWriterThreads() { return n_writer_threads; };
+  // Number of rows per worker thread
+  static void SetBufferSize(G4int n) { buffer_size = n; };
+  static G4int GetBufferSize() { return buffer_size; };
+
+  // zlib compression level between 0 (no compression) and 9, Geant4 default: 1
+  static void SetCompressionLevel(G4int level) { compression_level = level; };
+  static G4int GetCompressionLevel() { return compression_level; };
+  // Basket size in bytes and number of entries per basket. A value of 0 keeps the Geant4 defaults.
+  static void SetBasketSize(G4int size) { basket_size = size; };
+  static G4int GetBasketSize() { return basket_size; };
+  static void SetBasketEntries(G4int n) { basket_entries = n; };
+  static G4int GetBasketEntries() { return basket_entries; };
+
+  // Called by each thread before the output file is opened
+  static void Configure(G4RootAnalysisManager *analysis_manager);
+  // Book the output ntuple in the analysis manager of the calling thread. The names are also used
+  // for the ntuples of the writer threads.
+  static void CreateNtuple(const G4String &name, const G4String &title);
+  static void CreateNtupleDColumn(const G4String &name);
+  // Called by each thread after the output file has been opened
+  static void BeginOfRun(const G4String &filename);
+  // Called by each thread instead of writing and closing the output file
+  static void EndOfRun(const G4String &filename);
+
+  static void FillNtupleDColumn(G4int column, G4double value);
+  // The history of the row is only needed for the trigger decision
+  static void AddNtupleRow(G4int history = 0);
+  // Called by each thread at the end of an event, after the decision of the trigger
+  static void EndOfEvent();
+
+  // Called by the master thread at the end of a run
+  static void PrintStatistics();
+
+  private:
+  static void StartWriterThreads();
+  static void StopWriterThreads();
+  static void WriterThread(G4int writer_id);
+  static void WriteRow(OutputWriter_Channel &channel);
+
+  static G4bool asynchronous;
+  static G4int n_writer_threads;
+  static G4int buffer_size;
+  static G4int compression_level;
+  static G4int basket_size;
+  static G4int basket_entries;
+
+  static std::vector<std::shared_ptr<OutputWriter_Channel>> channels;
+  static G4int n_registered_channels;
+  static std::map<G4int, OutputWriter_Statistics> statistics;
+};
@@ -23,8 +23,51 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "utrConfig.h"
 
+class ForcedCollisionPhysics;
+class PhysicsMessenger;
+class RegionalEmPhysics;
+
 class Physics : public G4VModularPhysicsList {
 
   public:
   Physics();
+  ~Physics();
+
+  void ConstructParticle() override;
+  void ConstructProcess() override;
+  // Retrieves the physics tables from the PhysicsTableCache, if possible
+  void SetCuts() override;
+
+  // Runtime selection of the physics modules. The defaults are given by the
+  // EM_* and HADRON_* build options. All of these methods can only be used
+  // before the run manager is initialized (G4State_PreInit).
+  void SelectEmPhysics(const G4String &name);
+  void SelectEmExtraPhysics(G4bool use);
+  void SelectHadronElasticPhysics(const G4String &name);
+  void SelectHadronInelasticPhysics(const G4String &name);
+  // Adds the adjoint processes for the reverse Monte Carlo (see AdjointEmPhysics). Must be called
+  // before the physics list is passed to the run manager.
+  void SelectAdjointPhysics(G4bool use);
+
+  // Per-region EM models (see RegionalEmPhysics)
+  void AddVolumeToRegion(const G4String &region_name, const G4String &logical_volume_name);
+  void SetRegionEmPhysics(const G4String &region_name, const G4String &name);
+
+  // Forced collisions of a particle in a logical volume (see ForcedCollisionPhysics)
+  void AddForcedCollision(const G4String &logical_volume_name, const G4String &particle_name);
+  G4bool HasForcedCollisions() const;
+
+  void PrintInfo() const;
+  void StreamInfo(std::ostream &os) const;
+
+  private:
+  PhysicsMessenger *physicsMessenger;
+  RegionalEmPhysics *regionalEmPhysics;
+  ForcedCollisionPhysics *forcedCollisionPhysics;
+
+  G4String em_physics;
+  G4String hadron_elastic_physics;
+  G4String hadron_inelastic_physics;
+  G4bool use_em_extra;
+  G4bool use_adjoint;
 };
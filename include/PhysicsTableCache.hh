@@ -0,0 +1,65 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Disk cache for the physics tables (cross sections, stopping powers, ranges, ...) which Geant4
+// builds at the beginning of the first run for every combination of material and production cut.
+// For the low-energy EM physics lists, this takes a large part of the run time of short simulations.
+//
+// If a cache directory is set (/utr/physics/tableCache), the tables are stored by the master thread
+// at the beginning of the first run into the subdirectory
+//
+// <cache_directory>/geant4-<G4VERSION_NUMBER>/<key>/
+//
+// and retrieved from there by all later simulations with the same key. The key is a hash of the
+// Geant4 version, the data libraries, the physics lists and the EM parameters, the production
+// cuts of all regions and the composition of all materials. A human-readable version of the hashed
+// information is stored in the file 'configuration.txt' in each subdirectory.
+// Any change of these inputs results in a new key, i.e. outdated tables are never used. Old
+// subdirectories are not deleted automatically.
+//
+// The tables are written to a temporary directory first, which is renamed when it is complete.
+// Therefore, several simulations can share a cache directory.
+// If the tables of a process can not be retrieved, Geant4 builds them as usual.
+#pragma once
+
+#include <ostream>
+
+#include "globals.hh"
+
+class Physics;
+
+class PhysicsTableCache {
+  public:
+  // An empty directory or 'none' disables the cache (default)
+  static void SetDirectory(const G4String &dir);
+  static G4String GetDirectory() { return directory; };
+  static G4bool IsActive() { return directory != ""; };
+
+  // Called by Physics::SetCuts(), i.e. before the physics tables are built
+  static void Retrieve(Physics *physics);
+  // Called by the master thread at the beginning of each run, i.e. after the physics tables have been built
+  static void Store(Physics *physics);
+
+  private:
+  static void StreamConfiguration(const Physics *physics, std::ostream &os);
+  static G4String GetTableDirectory(const Physics *physics, G4String &configuration);
+
+  static G4String directory;
+};
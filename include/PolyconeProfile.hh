@@ -0,0 +1,75 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Builder for the (r, z) contour of a solid of revolution like a HPGe crystal or a cold finger.
+//
+// In contrast to sampling the whole profile at equidistant z positions (see OptimizePolycone.hh),
+// only the rounded sections (the edge of the crystal face, the bottom of the core hole, the tip of
+// the cold finger) are approximated by a polyline, whose maximum distance from the exact
+// elliptical arc is smaller than a given tolerance. Straight sections are represented by their
+// end points only. The contour is converted to a G4GenericPolycone, which does not require the
+// inner and outer radius to be given at common z planes.
+//
+// Usage: add the corners of the contour in the order in which they are traversed, for example
+//
+//   PolyconeProfile profile("Crystal_Solid");
+//   profile.Add_Point(0., 0.);
+//   profile.Add_Point(radius - face_radius, 0.);
+//   profile.Add_Arc(radius - face_radius, face_radius, face_radius, face_radius, -90. * deg, 0. * deg);
+//   profile.Add_Point(radius, length);
+//   profile.Add_Point(0., length);
+//   G4GenericPolycone *crystal_solid = profile.Construct();
+
+#pragma once
+
+#include <vector>
+
+#include "G4GenericPolycone.hh"
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+using std::vector;
+
+class PolyconeProfile {
+  public:
+  PolyconeProfile(const G4String &solid_name, const G4double max_dev = default_max_deviation) : name(solid_name), max_deviation(max_dev){};
+
+  // Add a corner at (r, z), which is connected to the previous corner by a straight line.
+  void Add_Point(const G4double r, const G4double z);
+  // Add the elliptical arc (r, z) = (r_center + semi_axis_r*cos(t), z_center + semi_axis_z*sin(t))
+  // with t from start_angle to end_angle, including its start and end point.
+  void Add_Arc(const G4double r_center, const G4double z_center, const G4double semi_axis_r, const G4double semi_axis_z, const G4double start_angle, const G4double end_angle);
+
+  G4GenericPolycone *Construct() const;
+
+  size_t Get_Number_Of_Corners() const { return r_corners.size(); };
+  const vector<G4double> &Get_R() const { return r_corners; };
+  const vector<G4double> &Get_Z() const { return z_corners; };
+
+  static const G4double default_max_deviation;
+
+  private:
+  void Subdivide_Arc(const G4double r_center, const G4double z_center, const G4double semi_axis_r, const G4double semi_axis_z, const G4double start_angle, const G4double end_angle, const unsigned int depth);
+
+  G4String name;
+  G4double max_deviation;
+  vector<G4double> r_corners;
+  vector<G4double> z_corners;
+};
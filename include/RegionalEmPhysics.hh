@@ -0,0 +1,62 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+// Physics constructor which replaces the photon interaction models of the
+// global EM physics list inside selected G4Regions. This allows, for example,
+// to use the expensive polarized Livermore models only in the targets and
+// detectors, and the much faster standard models everywhere else.
+//
+// The regions are created from lists of logical volume names when the
+// processes are constructed, i.e. after the geometry has been built.
+// Only the models of the photon processes 'phot', 'compt', 'conv' and 'Rayl'
+// are replaced, if the global EM physics contains them. Charged particles are
+// always treated by the global EM physics.
+
+#include <map>
+#include <vector>
+
+#include "G4VPhysicsConstructor.hh"
+
+using std::map;
+using std::vector;
+
+class RegionalEmPhysics : public G4VPhysicsConstructor {
+  public:
+  RegionalEmPhysics();
+  ~RegionalEmPhysics();
+
+  void ConstructParticle() override{};
+  void ConstructProcess() override;
+
+  void AddVolumeToRegion(const G4String &region_name, const G4String &logical_volume_name) { region_volumes[region_name].push_back(logical_volume_name); };
+  // Returns false if the name of the EM physics is unknown
+  G4bool SetRegionEmPhysics(const G4String &region_name, const G4String &name);
+  G4bool HasRegionEmPhysics() const { return region_em_physics.size() > 0; };
+
+  void PrintInfo() const;
+  void StreamInfo(std::ostream &os) const;
+
+  private:
+  void CreateRegions() const;
+
+  map<G4String, vector<G4String>> region_volumes;
+  map<G4String, G4String> region_em_physics;
+};
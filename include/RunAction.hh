@@ -38,7 +38,9 @@ enum output_flags : short {
   MOMX = 8,
   MOMY = 9,
   MOMZ = 10,
-  NFLAGS = 11
+  WEIGHT = 11,
+  HISTORY = 12,
+  NFLAGS = 13
 };
 
 class RunAction : public G4UserRunAction {
@@ -50,4 +52,8 @@ class RunAction : public G4UserRunAction {
   virtual void EndOfRunAction(const G4Run *);
 
   G4String GetOutputFlagName(unsigned int n);
+
+  private:
+  G4String output_filename;
+  G4bool temporary_output; // The master thread writes to a temporary file if there are no histograms
 };
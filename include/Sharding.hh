@@ -0,0 +1,92 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Splits a simulation into several processes (shards) on the same machine.
+//
+// On machines with many cores, several processes with fewer worker threads each are often faster
+// than a single process, because the threads of a process compete for the memory allocator and
+// access memory on other NUMA nodes. With 'utr --shards=K', the process forks K child processes
+// before Geant4 is initialized. Each shard
+//
+// - runs the whole macro with its share of the worker threads,
+// - simulates its share of the events of each /run/beamOn, and numbers them after the events of the
+//   previous shards, so that the event IDs in the merged output are unique,
+// - uses its own random number seeds, derived from the seed of the parent process and the shard number,
+//   and derived again at the beginning of each run, so that seeds set by the macro (/random/setSeeds)
+//   are not the same in all shards,
+// - is restricted to its share of the cores or NUMA nodes if the worker threads are pinned (see WorkerThreads),
+// - writes its output files to a hidden subdirectory of the output directory, and all shards except
+//   the first one also their terminal output.
+//
+// When all shards have finished, the parent process reserves a file ID for each run and renames the
+// output files of the shards as if they had been written by the worker threads of a single process,
+// i.e. thread j of shard k becomes thread (first thread of shard k) + j. Output processing is unchanged.
+// The histogram files of the master threads of the shards are summed with ROOT's hadd, if available.
+// The terminal output of the other shards is appended to the output of the parent process.
+#pragma once
+
+#include <vector>
+
+#include "globals.hh"
+
+class Sharding {
+  public:
+  // Forks n_shards processes, which share the n_threads worker threads. Returns in each child process,
+  // the parent process waits for the children, merges their output files and exits.
+  static void Fork(G4int n_shards, G4int n_threads);
+
+  static G4bool IsShard() { return shard >= 0; };
+  static G4int GetShard() { return shard; };
+  static G4int GetNumberOfThreads() { return shard_n_threads; };
+  // Share of this shard of the n_event events of a run
+  static G4int GetNumberOfEvents(G4int n_event);
+  // Called before each run with the n_event events of all shards
+  static void BeginOfRun(G4int n_event);
+  // Number of events of the previous shards in the current run, which is added to the event IDs in
+  // the output. 0 outside of a shard.
+  static G4int GetEventOffset() { return event_offset; };
+  // Replaces the seeds of the random number engine of a shard by seeds derived from its current state
+  // and the shard number. Does nothing outside of a shard.
+  static void DeriveSeeds();
+  // Called by the master thread of a shard at the beginning of each run. filename_id is -1 if no file ID is used.
+  static void RecordRun(const G4String &filename_prefix, G4int filename_id);
+
+  private:
+  static G4String ShardDirectory(G4int i);
+  static G4bool Merge(const std::vector<G4int> &first_threads, const std::vector<G4int> &n_threads);
+  static G4bool AddHistograms(const G4String &target, const std::vector<G4String> &sources);
+
+  static G4int shard;
+  static G4int n_shards;
+  static G4int shard_n_threads;
+  static G4int event_offset;
+  static G4String output_dir;
+  static G4int parent_pid;
+};
+
+// Run manager of a shard, which only simulates the share of the shard of the events of each /run/beamOn,
+// with random seeds of its own
+template <class RunManager> class Sharding_RunManager : public RunManager {
+  public:
+  void BeamOn(G4int n_event, const char *macroFile = 0, G4int n_select = -1) override {
+    Sharding::BeginOfRun(n_event);
+    RunManager::BeamOn(Sharding::GetNumberOfEvents(n_event), macroFile, n_select);
+  };
+};
@@ -0,0 +1,136 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Reproduction of single events, in particular of slow ones.
+//
+// With the Ranecu engine of utr, the state of the random number generator consists of two seeds.
+// The seeds at the beginning of each event, i.e. before the primary particles are generated,
+// determine the whole event. They are recorded by SlowEvents_PrimaryGenerator, which wraps the
+// primary generator, at the cost of copying two numbers per event.
+//
+// If a limit for the CPU time or the number of steps of an event is set, the tracks and steps of
+// each event are counted by SlowEvents_TrackingAction. Events which exceed one of the limits are
+// appended to the file OUTPUTDIR/slow_events.txt, one line per event
+//
+// RUN EVENT THREAD SEED1 SEED2 CPU_TIME[s] STEPS TRACKS
+//
+// followed by comment lines ('#') with the number of tracks and steps of each particle type and
+// the track with the most steps, for example a track which is stuck at a volume boundary.
+//
+// A replay simulates the events of such a file again, in the same order, by restoring their seeds
+// before their primary particles are generated. With verbose tracking, this shows each step of the
+// slow events. The geometry, physics and source settings must be the same as in the original run.
+// The settings are shared by all threads and should only be modified between runs, e.g. via the
+// /utr/slowEvents/ macro commands (see SlowEventsMessenger).
+#pragma once
+
+#include <vector>
+
+#include "G4UserTrackingAction.hh"
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "globals.hh"
+
+class G4Event;
+class G4ParticleDefinition;
+class G4Track;
+class G4VPhysicalVolume;
+
+struct SlowEvents_Particle {
+  const G4ParticleDefinition *particle = nullptr;
+  G4long n_tracks = 0;
+  G4long n_steps = 0;
+};
+
+// Summary of the current event of a thread
+struct SlowEvents_Event {
+  long seeds[2] = {0, 0};
+  G4bool started = false;
+  G4double cpu_time_start = 0.; // In seconds
+  G4long n_tracks = 0;
+  G4long n_steps = 0;
+  std::vector<SlowEvents_Particle> particles;
+  // Track with the most steps
+  G4int longest_track_id = 0;
+  G4int longest_track_n_steps = 0;
+  G4double longest_track_length = 0.;
+  const G4ParticleDefinition *longest_track_particle = nullptr;
+  const G4VPhysicalVolume *longest_track_volume = nullptr; // Volume in which the track ended, nullptr outside of the world
+};
+
+struct SlowEvents_Replay {
+  long seeds[2];
+  G4int run;
+  G4int event;
+};
+
+class SlowEvents {
+  public:
+  // A limit of 0 disables the limit. The CPU time is given in seconds.
+  static void SetMaxCPUTime(G4double t) { max_cpu_time = t; };
+  static G4double GetMaxCPUTime() { return max_cpu_time; };
+  static void SetMaxSteps(G4long n) { max_steps = n; };
+  static G4long GetMaxSteps() { return max_steps; };
+  static G4bool IsActive() { return max_cpu_time > 0. || max_steps > 0 || replaying; };
+  static G4String GetFilename() { return "slow_events.txt"; };
+
+  // Simulates the events of a file written by SlowEvents again, with the given tracking verbosity.
+  // Returns false if the file could not be read.
+  static G4bool Replay(const G4String &filename, G4int tracking_verbose);
+
+  // Called by each thread before the primary particles of an event are generated
+  static void BeginOfEvent(G4Event *event);
+  // Called by each thread at the end of each track
+  static void EndOfTrack(const G4Track *track);
+  static void EndOfEvent(const G4Event *event);
+
+  // Called by the master thread at the beginning and at the end of a run
+  static void BeginOfRun();
+  static void PrintStatistics();
+
+  private:
+  static G4String GetSummary();
+  static void WriteEvent(const G4Event *event, G4double cpu_time);
+
+  static G4double max_cpu_time;
+  static G4long max_steps;
+  static G4bool replaying;
+  static std::vector<SlowEvents_Replay> replay_events;
+  static G4long n_slow_events;
+};
+
+// Records the seeds of each event before the primary particles are generated by the wrapped generator
+class SlowEvents_PrimaryGenerator : public G4VUserPrimaryGeneratorAction {
+  public:
+  SlowEvents_PrimaryGenerator(G4VUserPrimaryGeneratorAction *gen) : G4VUserPrimaryGeneratorAction(), generator(gen){};
+  ~SlowEvents_PrimaryGenerator() { delete generator; };
+
+  void GeneratePrimaries(G4Event *event) override {
+    SlowEvents::BeginOfEvent(event);
+    generator->GeneratePrimaries(event);
+  };
+
+  private:
+  G4VUserPrimaryGeneratorAction *generator;
+};
+
+class SlowEvents_TrackingAction : public G4UserTrackingAction {
+  public:
+  void PostUserTrackingAction(const G4Track *track) override { SlowEvents::EndOfTrack(track); };
+};
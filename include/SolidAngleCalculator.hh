@@ -0,0 +1,105 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Geometry-only calculation of the solid angles of the detectors and of the material in front of
+// them, without any physics.
+//
+// Rays are cast isotropically from a source point or from points uniformly distributed inside a
+// source volume. Each ray is followed through the geometry with a G4Navigator, i.e. in the same
+// way as a geantino, but without the overhead of the event loop. The rays are distributed over
+// several threads with their own navigators and random number engines.
+//
+// For each detector with an EnergyDepositionSD, the following quantities are reported:
+//
+// - The fraction of the rays which enter the detector, i.e. its solid angle Omega / (4 pi). In
+//   contrast to the solid angle of a full simulation, shadowing objects do not need to be
+//   sensitive, since a ray is followed through all volumes.
+// - The mean path length through each material which a ray has traversed before it enters the
+//   detector, e.g. filters, wrappings and housings. Rays which pass another detector first
+//   include its material as well.
+// - For each selected photon energy, the mean transmission exp(-sum_i mu_i x_i) of these rays, with
+//   the total attenuation coefficients mu_i (photoelectric absorption, Compton and Rayleigh scattering,
+//   pair production) of the physics list, and the effective solid angle Omega * <transmission>.
+//
+// The calculation is started with /utr/solidAngle/beamOn (see SolidAngleCalculatorMessenger)
+// after /run/initialize. The attenuation coefficients require the physics tables, which are
+// built by a run without events if necessary.
+#pragma once
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "G4AffineTransform.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4LogicalVolume;
+class G4VPhysicalVolume;
+class G4VSolid;
+
+// Sums over the rays which entered a detector
+struct SolidAngleCalculator_Detector {
+  G4long n_hits = 0;
+  std::vector<G4double> path_length; // Per material index
+  std::vector<G4double> transmission; // Per energy
+};
+
+class SolidAngleCalculator {
+  public:
+  static void SetSourcePoint(const G4ThreeVector &point);
+  static G4ThreeVector GetSourcePoint() { return source_point; };
+  // Points uniformly distributed inside the physical volume. If the logical volume is placed
+  // several times, the first placement is used.
+  static void SetSourceVolume(const G4String &physical_volume);
+  static G4String GetSourceVolume() { return source_volume; };
+  static void AddEnergy(G4double energy) { energies.push_back(energy); };
+  static void ClearEnergies() { energies.clear(); };
+  // 0: number of available cores
+  static void SetNumberOfThreads(G4int n) { n_threads = n; };
+  static G4int GetNumberOfThreads() { return n_threads; };
+
+  static void Run(G4long n_rays);
+
+  static void PrintInfo();
+
+  private:
+  static G4bool FindSourceTransform(G4VPhysicalVolume *world);
+  static void BuildDetectorMap();
+  static void ComputeAttenuationCoefficients();
+  static void TraceRays(G4VPhysicalVolume *world, G4long n_rays, G4long seed);
+  static G4ThreeVector SampleSourcePoint(std::mt19937_64 &engine);
+  static void PrintResults(G4long n_rays, G4double run_time);
+
+  static G4ThreeVector source_point;
+  static G4String source_volume; // Empty for a point source
+  static std::vector<G4double> energies;
+  static G4int n_threads;
+
+  // State of the current calculation
+  static G4VSolid *source_solid;
+  static G4AffineTransform source_transform; // From the coordinate system of the source volume to the world
+  static G4ThreeVector source_min; // Bounding box of the source solid
+  static G4ThreeVector source_max;
+  static std::map<const G4LogicalVolume *, G4int> detector_ids; // Logical volume -> detector ID
+  static std::vector<std::vector<G4double>> attenuation_coefficients; // Per energy and material index
+  static std::map<G4int, SolidAngleCalculator_Detector> detectors; // Detector ID -> sums of all threads
+  static G4long n_stuck;
+};
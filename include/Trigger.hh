@@ -0,0 +1,120 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Event-level trigger, which decides at the end of each event whether its output is written.
+//
+// The trigger is based on the (digitized) energy depositions in the EnergyDepositionSD detectors.
+// Hits in ParticleSD or SecondarySD volumes do not fire it, their rows are only written for events
+// which are accepted because of the EnergyDepositionSD detectors.
+// A detector fires if its energy deposition is above its trigger threshold (default: any energy
+// deposition). Detectors are combined into named groups, and an event is accepted if at least one
+// detector fired and all of the following conditions are met:
+//
+// - Multiplicity: The number of fired detectors in a group is within the given limits.
+// - Coincidence: At least one detector fired in each of the given groups.
+// - Veto: No detector of the veto group fired (at the same time as a detector of a second group,
+//         if given). This allows, for example, an anti-Compton shield to veto only the events in
+//         which its own detector fired.
+//
+// While the trigger is active, the OutputWriter holds back all rows of an event until the
+// decision, and the online histograms of the Digitizer are only filled for accepted events.
+// With variance reduction, an event consists of several alternative histories (see
+// ForcedCollisionHistory). The conditions are evaluated for each history separately, using only
+// its own energy depositions, and only the rows and histogram entries of the accepted histories
+// are kept. The statistics then count histories instead of events.
+// The settings are shared by all threads and should only be modified between runs, e.g. via the
+// /utr/trigger/ macro commands (see TriggerMessenger).
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "globals.hh"
+
+enum trigger_condition_type : short {
+  MULTIPLICITY = 0,
+  COINCIDENCE = 1,
+  VETO = 2
+};
+
+struct Trigger_Condition {
+  trigger_condition_type type;
+  std::vector<G4String> groups;
+  G4int min_multiplicity = 1;
+  G4int max_multiplicity = -1; // -1 for no upper limit
+};
+
+struct Trigger_Deposition {
+  G4int detID;
+  G4double energy;
+  G4double weight;
+  G4int history;
+};
+
+struct Trigger_Statistics {
+  G4long n_events = 0;
+  G4long n_histories = 0; // Histories with an energy deposition, or 1 for an event without any
+  G4long n_no_hit = 0; // Histories without any fired detector
+  std::vector<G4long> n_failed; // Rejected histories for each condition, counting only the first condition which failed
+};
+
+class Trigger {
+  public:
+  static void SetActive(G4bool act) { active = act; };
+  static G4bool IsActive() { return active; };
+
+  static void SetThreshold(G4int detID, G4double thr);
+  static void DefineGroup(const G4String &name, const std::vector<G4int> &detIDs);
+  // Returns false if one of the groups does not exist
+  static G4bool AddMultiplicity(const G4String &group, G4int min_multiplicity, G4int max_multiplicity);
+  static G4bool AddCoincidence(const std::vector<G4String> &groups);
+  static G4bool AddVeto(const G4String &veto_group, const G4String &group);
+  // Removes all thresholds, groups and conditions
+  static void Clear();
+
+  // Called by the sensitive detectors for each detector with an energy deposition in the current event,
+  // once per history
+  static void AddEnergyDeposition(G4int detID, G4double energy, G4double weight = 1., G4int history = 0);
+  // Called by each thread at the end of an event
+  static void EndOfEvent();
+  // Returns true if the history was accepted in the last event of the calling thread, or if the trigger is inactive
+  static G4bool IsAccepted(G4int history);
+
+  // Called by the master thread at the beginning of a run, and by each thread which processes events at its end
+  static void BeginOfRun();
+  static void EndOfWorkerRun();
+  // Called by the master thread at the end of a run
+  static void PrintStatistics();
+  static void PrintInfo();
+
+  private:
+  // Warns if the trigger cannot accept any event or ignores some of the sensitive detectors
+  static void CheckSensitiveDetectors();
+  // Evaluates the conditions for the energy depositions of a single history and counts the rejections
+  static G4bool Accepts(const std::map<G4int, G4double> &energies);
+  static G4int CountFired(const G4String &group, const std::map<G4int, G4double> &energies);
+  static G4String GetDescription(const Trigger_Condition &condition);
+
+  static G4bool active;
+  static std::map<G4int, G4double> thresholds;
+  static std::map<G4String, std::vector<G4int>> groups;
+  static std::vector<Trigger_Condition> conditions;
+  static Trigger_Statistics statistics;
+};
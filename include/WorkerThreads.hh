@@ -0,0 +1,76 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Placement and load statistics of the worker threads.
+//
+// The worker threads can be pinned to the CPU cores or to the NUMA nodes which the process is
+// allowed to use (i.e. respecting taskset, cgroups and batch systems):
+//
+// - 'core': Worker thread i is pinned to the i-th available core.
+// - 'numa': Worker thread i may use all available cores of the NUMA node i % n_nodes, i.e. the
+//           threads are distributed evenly over the nodes, and the operating system is free to
+//           move them between the cores of a node.
+//
+// For each run, the number of events and the busy time (the total time spent inside events) of
+// each worker thread are recorded and printed by the master thread at the end of the run.
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+#include "globals.hh"
+
+struct WorkerThread_Statistics {
+  G4int n_events = 0;
+  G4double busy_time = 0.; // In seconds
+};
+
+class WorkerThreads {
+  public:
+  // Number of cores that the process is allowed to use
+  static G4int GetNumberOfAvailableCores();
+
+  // 'none' (default), 'core' or 'numa'. Returns false for an unknown mode.
+  static G4bool SetPinning(const G4String &mode);
+  static G4String GetPinning() { return pinning; };
+  // Called by each worker thread before its first event
+  static void PinWorkerThread();
+  // Called by each process of a sharded simulation (see Sharding) before the worker threads are started.
+  // If the worker threads are pinned, the process is restricted to the cores (or NUMA nodes) of its
+  // threads, so that the processes do not share cores.
+  static void RestrictToShard(G4int shard, G4int n_shards, G4int first_thread, G4int n_threads);
+
+  static void BeginOfEvent();
+  static void EndOfEvent();
+  // Called by the master thread at the beginning of a run, and by each worker thread at its end
+  static void BeginOfRun();
+  static void EndOfWorkerRun();
+  // Called by the master thread at the end of a run
+  static void PrintStatistics();
+
+  private:
+  static std::vector<G4int> GetAvailableCores();
+  static std::vector<std::vector<G4int>> GetNUMANodes(const std::vector<G4int> &available_cores);
+
+  static G4String pinning;
+  static std::chrono::steady_clock::time_point run_start;
+  static std::map<G4int, WorkerThread_Statistics> statistics;
+};
@@ -20,6 +20,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include "G4Types.hh"
+#include <set>
 #include <string>
 
 using std::string;
@@ -36,14 +37,28 @@ class utrFilenameTools {
   static string getFilenamePrefix() { return filenamePrefix; };
   static void setFilenameID(unsigned int fid) { filenameID = fid; };
   static unsigned int getFilenameID() { return filenameID; };
-  static unsigned int incrementFilenameID() { return ++filenameID; };
+  // Reserves the next free file ID (see reserveFilenameID) and returns it
+  static unsigned int incrementFilenameID();
   static void setUseFilenameID(unsigned int ufid) { useFilenameID = ufid; };
   static bool getUseFilenameID() { return useFilenameID; };
   static unsigned int findNextFreeFilenameID();
+  // Several utr processes may write to the same output directory. A file ID is reserved by creating the
+  // lock file '{filenamePrefix}N.lock' exclusively, which is removed again by releaseFilenameID() once
+  // the output files of the run have been written.
+  static unsigned int reserveFilenameID(unsigned int first_fid);
+  static void releaseFilenameID();
+  // '{outputDir}/{filenamePrefix}{filenameID}{suffix}', without the ID if no file IDs are used
+  static string getOutputFilename(const string &suffix);
+  // Output file of the master thread, which contains the histograms merged over all threads
+  static string getHistogramFilename() { return getOutputFilename("_hist.root"); };
+  // Temporary output file of the master thread for runs without any histograms
   static string getMasterFilename();
   static void deleteMasterFilename();
 
   private:
+  // File IDs in the output directory which are used by output files or lock files with the current prefix
+  static std::set<unsigned int> getUsedFilenameIDs();
+
   // statics are set as statics here so they are shared and available to all threads
   // they got introduced because the master thread did/does not run through utrFilenameTools::Build() and hence had no acess to these variables needed in RunAction::BeginOfRunAction
   static string outputDir;
@@ -51,4 +66,5 @@ class utrFilenameTools {
   static unsigned int filenameID;
   static bool useFilenameID;
   static string masterFilename;
+  static string lockFilename;
 };
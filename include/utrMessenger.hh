@@ -42,4 +42,6 @@ class utrMessenger : public G4UImessenger {
   G4UIcmdWithAString *setFilenameCmd;
   G4UIcmdWithABool *setUseFilenameIDCmd;
   G4UIcmdWithAString *appendZerosToVarCmd;
+  G4UIcmdWithAString *setGeometryCmd;
+  G4UIcommand *setArrangementFileCmd;
 };
@@ -30,8 +30,12 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "GeneralParticleSource.hh"
 #endif
 
+#include "AdjointSimulation.hh"
 #include "EventAction.hh"
 #include "RunAction.hh"
+#include "SlowEvents.hh"
+#include "SteppingAction.hh"
+#include "WorkerThreads.hh"
 
 using std::vector;
 
@@ -45,13 +49,19 @@ void ActionInitialization::BuildForMaster() const {
 }
 
 void ActionInitialization::Build() const {
+  // Build() is executed by each worker thread before its first event
+  WorkerThreads::PinWorkerThread();
+
+  // The seeds of each event are recorded before its primary particles are generated
 #ifdef GENERATOR_ANGDIST
-  SetUserAction(new AngularDistributionGenerator);
+  SetUserAction(new SlowEvents_PrimaryGenerator(new AngularDistributionGenerator));
 #elif defined GENERATOR_ANGCORR
-  SetUserAction(new AngularCorrelationGenerator);
+  SetUserAction(new SlowEvents_PrimaryGenerator(new AngularCorrelationGenerator));
 #else
-  SetUserAction(new GeneralParticleSource);
+  SetUserAction(new SlowEvents_PrimaryGenerator(new GeneralParticleSource));
 #endif
+  SetUserAction(new SlowEvents_TrackingAction);
+  SetUserAction(new SteppingAction);
 
   EventAction *eventAction = new EventAction();
 #ifdef G4MULTITHREADED
@@ -61,6 +71,11 @@ void ActionInitialization::Build() const {
 
   RunAction *runAction = new RunAction();
 
+  // The G4AdjointSimManager replaces the user actions during adjoint runs and calls them itself
+  if (AdjointSimulation::IsEnabled()) {
+    AdjointSimulation::SetUserActions(eventAction, runAction);
+  }
+
   vector<bool> record_quantity(NFLAGS);
   for (short i = 0; i < NFLAGS; ++i)
     record_quantity[i] = false;
@@ -98,6 +113,10 @@ void ActionInitialization::Build() const {
 #ifdef EVENT_MOMZ
   record_quantity[MOMZ] = true;
 #endif
+#ifdef EVENT_WEIGHT
+  record_quantity[WEIGHT] = true;
+  record_quantity[HISTORY] = true;
+#endif
 
   if (G4Threading::G4GetThreadId() == 0) {
     G4cout << "================================================================"
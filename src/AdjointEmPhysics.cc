@@ -0,0 +1,150 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "G4AdjointAlongStepWeightCorrection.hh"
+#include "G4AdjointBremsstrahlungModel.hh"
+#include "G4AdjointCSManager.hh"
+#include "G4AdjointComptonModel.hh"
+#include "G4AdjointElectron.hh"
+#include "G4AdjointGamma.hh"
+#include "G4AdjointPhotoElectricModel.hh"
+#include "G4AdjointSimManager.hh"
+#include "G4AdjointeIonisationModel.hh"
+#include "G4ContinuousGainOfEnergy.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4InversePEEffect.hh"
+#include "G4ProcessManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VEmProcess.hh"
+#include "G4VEnergyLossProcess.hh"
+#include "G4eInverseBremsstrahlung.hh"
+#include "G4eInverseCompton.hh"
+#include "G4eInverseIonisation.hh"
+
+#include "AdjointEmPhysics.hh"
+
+// Validity range of the adjoint models. The upper limit covers all gamma-ray lines of interest,
+// and the computing time of the adjoint cross section matrices grows with it.
+static const G4double adjoint_model_emin = 1. * keV;
+static const G4double adjoint_model_emax = 20. * MeV;
+
+AdjointEmPhysics::AdjointEmPhysics() : G4VPhysicsConstructor("AdjointEmPhysics") {}
+
+AdjointEmPhysics::~AdjointEmPhysics() {}
+
+void AdjointEmPhysics::ConstructParticle() {
+  G4AdjointGamma::AdjointGamma();
+  G4AdjointElectron::AdjointElectron();
+}
+
+// The forward processes have already been constructed by the global EM physics list
+template <class T>
+static T *FindForwardProcess(G4ParticleDefinition *particle, const G4String &process_name) {
+  T *process = dynamic_cast<T *>(particle->GetProcessManager()->GetProcess(process_name));
+  if (!process) {
+    G4cout << "AdjointEmPhysics: Warning! The EM physics list does not provide the process '" << process_name << "' for " << particle->GetParticleName() << ", the corresponding adjoint process will not be used" << G4endl;
+  }
+  return process;
+}
+
+void AdjointEmPhysics::ConstructProcess() {
+  G4AdjointCSManager *adjointCSManager = G4AdjointCSManager::GetAdjointCSManager();
+  G4AdjointSimManager *adjointSimManager = G4AdjointSimManager::GetInstance();
+
+  G4ParticleDefinition *gamma = G4Gamma::Gamma();
+  G4ParticleDefinition *electron = G4Electron::Electron();
+  G4ParticleDefinition *adjointGamma = G4AdjointGamma::AdjointGamma();
+  G4ParticleDefinition *adjointElectron = G4AdjointElectron::AdjointElectron();
+
+  adjointCSManager->RegisterAdjointParticle(adjointElectron);
+  adjointCSManager->RegisterAdjointParticle(adjointGamma);
+
+  G4VEmProcess *photoElectricEffect = FindForwardProcess<G4VEmProcess>(gamma, "phot");
+  G4VEmProcess *comptonScattering = FindForwardProcess<G4VEmProcess>(gamma, "compt");
+  G4VEmProcess *gammaConversion = FindForwardProcess<G4VEmProcess>(gamma, "conv");
+  G4VEnergyLossProcess *electronIonisation = FindForwardProcess<G4VEnergyLossProcess>(electron, "eIoni");
+  G4VEnergyLossProcess *electronBremsstrahlung = FindForwardProcess<G4VEnergyLossProcess>(electron, "eBrem");
+
+  // Forward cross sections for the weight correction of the adjoint particles
+  if (photoElectricEffect) {
+    adjointCSManager->RegisterEmProcess(photoElectricEffect, gamma);
+  }
+  if (comptonScattering) {
+    adjointCSManager->RegisterEmProcess(comptonScattering, gamma);
+  }
+  if (gammaConversion) {
+    adjointCSManager->RegisterEmProcess(gammaConversion, gamma);
+  }
+  if (electronIonisation) {
+    adjointCSManager->RegisterEnergyLossProcess(electronIonisation, electron);
+  }
+  if (electronBremsstrahlung) {
+    adjointCSManager->RegisterEnergyLossProcess(electronBremsstrahlung, electron);
+  }
+
+  G4ProcessManager *adjointGammaManager = adjointGamma->GetProcessManager();
+  G4ProcessManager *adjointElectronManager = adjointElectron->GetProcessManager();
+
+  // Continuous processes of the adjoint electron: Energy gain instead of the energy loss by ionisation
+  if (electronIonisation) {
+    G4ContinuousGainOfEnergy *continuousGainOfEnergy = new G4ContinuousGainOfEnergy();
+    continuousGainOfEnergy->SetLossFluctuations(true);
+    continuousGainOfEnergy->SetDirectEnergyLossProcess(electronIonisation);
+    continuousGainOfEnergy->SetDirectParticle(electron);
+    adjointElectronManager->AddContinuousProcess(continuousGainOfEnergy);
+  }
+  adjointElectronManager->AddContinuousProcess(new G4AdjointAlongStepWeightCorrection());
+  adjointGammaManager->AddContinuousProcess(new G4AdjointAlongStepWeightCorrection());
+
+  // Reverse processes. The 'projectile to projectile' case describes the scattered particle,
+  // the 'product to projectile' case the secondary particle of the forward process.
+  if (electronIonisation) {
+    G4AdjointeIonisationModel *ionisationModel = new G4AdjointeIonisationModel();
+    ionisationModel->SetLowEnergyLimit(adjoint_model_emin);
+    ionisationModel->SetHighEnergyLimit(adjoint_model_emax);
+    adjointElectronManager->AddDiscreteProcess(new G4eInverseIonisation(true, "Inv_eIon", ionisationModel));
+    adjointElectronManager->AddDiscreteProcess(new G4eInverseIonisation(false, "Inv_eIon1", ionisationModel));
+  }
+  if (electronIonisation && electronBremsstrahlung) {
+    G4AdjointBremsstrahlungModel *bremsstrahlungModel = new G4AdjointBremsstrahlungModel();
+    bremsstrahlungModel->SetLowEnergyLimit(adjoint_model_emin);
+    bremsstrahlungModel->SetHighEnergyLimit(adjoint_model_emax * 1.01);
+    adjointElectronManager->AddDiscreteProcess(new G4eInverseBremsstrahlung(true, "Inv_eBrem", bremsstrahlungModel));
+    adjointGammaManager->AddDiscreteProcess(new G4eInverseBremsstrahlung(false, "Inv_eBrem1", bremsstrahlungModel));
+  }
+  if (comptonScattering) {
+    G4AdjointComptonModel *comptonModel = new G4AdjointComptonModel();
+    comptonModel->SetLowEnergyLimit(adjoint_model_emin);
+    comptonModel->SetHighEnergyLimit(adjoint_model_emax);
+    comptonModel->SetDirectProcess(comptonScattering);
+    comptonModel->SetUseMatrix(false);
+    adjointGammaManager->AddDiscreteProcess(new G4eInverseCompton(true, "Inv_Compt", comptonModel));
+    adjointElectronManager->AddDiscreteProcess(new G4eInverseCompton(false, "Inv_Compt1", comptonModel));
+    adjointSimManager->ConsiderParticleAsPrimary("gamma");
+  }
+  if (photoElectricEffect) {
+    G4AdjointPhotoElectricModel *photoElectricModel = new G4AdjointPhotoElectricModel();
+    photoElectricModel->SetLowEnergyLimit(adjoint_model_emin);
+    photoElectricModel->SetHighEnergyLimit(adjoint_model_emax);
+    adjointElectronManager->AddDiscreteProcess(new G4InversePEEffect("Inv_PEEffect", photoElectricModel));
+    adjointSimManager->ConsiderParticleAsPrimary("gamma");
+  }
+}
@@ -0,0 +1,91 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include "G4Event.hh"
+#include "G4Gamma.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Navigator.hh"
+#include "G4ParticleGun.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "Randomize.hh"
+
+#include "AdjointForwardSource.hh"
+#include "AdjointSimulation.hh"
+
+AdjointForwardSource::AdjointForwardSource(const G4String &physical_volume, G4double emin, G4double emax)
+    : G4VUserPrimaryGeneratorAction(), particleGun(nullptr), solid(nullptr), area(0.), energy_min(emin), energy_max(emax) {
+  G4PhysicalVolumeStore *physicalVolumeStore = G4PhysicalVolumeStore::GetInstance();
+  const G4VPhysicalVolume *volume = physicalVolumeStore->GetVolume(physical_volume, false);
+  if (!volume) {
+    G4cerr << "ERROR: AdjointForwardSource: Physical volume '" << physical_volume << "' does not exist. Aborting..." << G4endl;
+    throw std::exception();
+  }
+  solid = volume->GetLogicalVolume()->GetSolid();
+  area = solid->GetSurfaceArea();
+
+  // Walk up the volume hierarchy. If a logical volume is placed several times, the first placement is used.
+  const G4VPhysicalVolume *world = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume();
+  const G4VPhysicalVolume *daughter = volume;
+  while (daughter != world) {
+    transform = transform * G4AffineTransform(daughter->GetRotation(), daughter->GetTranslation());
+    const G4VPhysicalVolume *mother = nullptr;
+    for (auto candidate : *physicalVolumeStore) {
+      if (candidate->GetLogicalVolume()->IsDaughter(daughter)) {
+        mother = candidate;
+        break;
+      }
+    }
+    if (!mother) {
+      G4cerr << "ERROR: AdjointForwardSource: Physical volume '" << physical_volume << "' is not part of the world volume. Aborting..." << G4endl;
+      throw std::exception();
+    }
+    daughter = mother;
+  }
+
+  particleGun = new G4ParticleGun(1);
+  particleGun->SetParticleDefinition(G4Gamma::Gamma());
+}
+
+AdjointForwardSource::~AdjointForwardSource() { delete particleGun; }
+
+void AdjointForwardSource::GeneratePrimaries(G4Event *anEvent) {
+  const G4ThreeVector local_position = solid->GetPointOnSurface();
+  // Cosine law with respect to the inward normal, i.e. an isotropic directional flux
+  const G4double cos_theta = sqrt(G4UniformRand());
+  const G4double sin_theta = sqrt(1. - cos_theta * cos_theta);
+  const G4double phi = twopi * G4UniformRand();
+  G4ThreeVector local_direction(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+  local_direction.rotateUz(-solid->SurfaceNormal(local_position));
+
+  const G4double energy = energy_min + (energy_max - energy_min) * G4UniformRand();
+
+  particleGun->SetParticlePosition(transform.TransformPoint(local_position));
+  particleGun->SetParticleMomentumDirection(transform.TransformAxis(local_direction));
+  particleGun->SetParticleEnergy(energy);
+  particleGun->GeneratePrimaryVertex(anEvent);
+
+  AdjointSimulation::SetForwardPrimary(energy, pi * area * (energy_max - energy_min));
+}
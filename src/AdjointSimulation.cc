@@ -0,0 +1,263 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#include "G4AdjointSimManager.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4UserEventAction.hh"
+#include "G4UserRunAction.hh"
+
+#include "AdjointForwardSource.hh"
+#include "AdjointSimulation.hh"
+#include "utrFilenameTools.hh"
+
+G4bool AdjointSimulation::enabled = false;
+G4String AdjointSimulation::detector_volume = "";
+std::vector<G4String> AdjointSimulation::source_volumes = std::vector<G4String>();
+G4double AdjointSimulation::energy_min = 0.1 * MeV;
+G4double AdjointSimulation::energy_max = 3. * MeV;
+G4int AdjointSimulation::n_bins = 290;
+std::vector<G4double> AdjointSimulation::lines = std::vector<G4double>();
+G4double AdjointSimulation::peak_window = 1. * keV;
+
+G4String AdjointSimulation::mode = "";
+std::map<G4int, G4double> AdjointSimulation::event_energies = std::map<G4int, G4double>();
+G4double AdjointSimulation::forward_energy = 0.;
+G4double AdjointSimulation::forward_weight = 0.;
+std::map<G4int, AdjointSimulation_Response> AdjointSimulation::responses = std::map<G4int, AdjointSimulation_Response>();
+
+void AdjointSimulation::SetUserActions(G4UserEventAction *event_action, G4UserRunAction *run_action) {
+  G4AdjointSimManager *adjointSimManager = G4AdjointSimManager::GetInstance();
+  adjointSimManager->SetAdjointEventAction(event_action);
+  adjointSimManager->SetAdjointRunAction(run_action);
+}
+
+void AdjointSimulation::SetEnergyRange(G4double emin, G4double emax) {
+  energy_min = emin;
+  energy_max = emax;
+}
+
+G4bool AdjointSimulation::CheckSettings() {
+  if (!enabled) {
+    G4cerr << "AdjointSimulation: Error! The adjoint simulation requires the '-a' command-line option" << G4endl;
+    return false;
+  }
+  if (source_volumes.size() == 0) {
+    G4cerr << "AdjointSimulation: Error! No source volume was given (/utr/adjoint/source)" << G4endl;
+    return false;
+  }
+  if (energy_min <= 0. || energy_max <= energy_min) {
+    G4cerr << "AdjointSimulation: Error! Invalid energy range (/utr/adjoint/energyRange)" << G4endl;
+    return false;
+  }
+  return true;
+}
+
+void AdjointSimulation::Run(G4int n_events) {
+  if (!CheckSettings()) {
+    return;
+  }
+  G4AdjointSimManager *adjointSimManager = G4AdjointSimManager::GetInstance();
+  if (detector_volume == "" || !adjointSimManager->DefineAdjointSourceOnTheExtSurfaceOfAVolume(detector_volume)) {
+    G4cerr << "AdjointSimulation: Error! Could not define the adjoint source on the physical volume '" << detector_volume << "' (/utr/adjoint/detector)" << G4endl;
+    return;
+  }
+  adjointSimManager->SetAdjointSourceEmin(energy_min);
+  adjointSimManager->SetAdjointSourceEmax(energy_max);
+  adjointSimManager->SetExtSourceEmax(energy_max);
+
+  for (auto &source : source_volumes) {
+    if (!adjointSimManager->DefineExtSourceOnTheExtSurfaceOfAVolume(source)) {
+      G4cerr << "AdjointSimulation: Error! Could not define the external source on the physical volume '" << source << "'" << G4endl;
+      continue;
+    }
+    G4cout << "AdjointSimulation: Adjoint simulation of " << n_events << " events for the source volume '" << source << "' ..." << G4endl;
+    ResetResponses();
+    mode = "adjoint";
+    adjointSimManager->RunAdjointSimulation(n_events);
+    mode = "";
+    WriteResponses("adjoint", source, 1. / n_events);
+  }
+}
+
+void AdjointSimulation::RunForward(G4int n_events) {
+  if (!CheckSettings()) {
+    return;
+  }
+  G4RunManager *runManager = G4RunManager::GetRunManager();
+  G4VUserPrimaryGeneratorAction *primaryGenerator = const_cast<G4VUserPrimaryGeneratorAction *>(runManager->GetUserPrimaryGeneratorAction());
+
+  for (auto &source : source_volumes) {
+    AdjointForwardSource *forwardSource = new AdjointForwardSource(source, energy_min, energy_max);
+    runManager->SetUserAction(forwardSource);
+    G4cout << "AdjointSimulation: Forward simulation of " << n_events << " events for the source volume '" << source << "' (area " << forwardSource->GetArea() / m2 << " m2) ..." << G4endl;
+    ResetResponses();
+    mode = "forward";
+    runManager->BeamOn(n_events);
+    mode = "";
+    WriteResponses("forward", source, 1. / n_events);
+    runManager->SetUserAction(primaryGenerator);
+    delete forwardSource;
+  }
+}
+
+G4bool AdjointSimulation::IsAdjointParticle(const G4ParticleDefinition *particle) {
+  return particle->GetParticleName().substr(0, 4) == "adj_";
+}
+
+void AdjointSimulation::AddEnergyDeposition(G4int detID, G4double energy) {
+  if (mode == "") {
+    return;
+  }
+  event_energies[detID] += energy;
+}
+
+void AdjointSimulation::SetForwardPrimary(G4double energy, G4double weight) {
+  forward_energy = energy;
+  forward_weight = weight;
+}
+
+void AdjointSimulation::EndOfEvent() {
+  if (mode == "") {
+    return;
+  }
+  if (mode == "adjoint") {
+    // Adjoint photons which reached the source surface, i.e. forward photons which started there
+    G4AdjointSimManager *adjointSimManager = G4AdjointSimManager::GetInstance();
+    for (size_t i = 0; i < adjointSimManager->GetNbOfAdointTracksReachingTheExternalSurface(); ++i) {
+      if (adjointSimManager->GetFwdParticleNameAtEndOfLastAdjointTrack(i) == "gamma") {
+        Score(adjointSimManager->GetEkinAtEndOfLastAdjointTrack(i), adjointSimManager->GetWeightAtEndOfLastAdjointTrack(i));
+      }
+    }
+  } else {
+    Score(forward_energy, forward_weight);
+  }
+  event_energies.clear();
+}
+
+G4int AdjointSimulation::GetBin(G4double energy) {
+  if (energy < energy_min || energy >= energy_max) {
+    return -1;
+  }
+  return (G4int)((energy - energy_min) / (energy_max - energy_min) * n_bins);
+}
+
+void AdjointSimulation::Score(G4double energy, G4double weight) {
+  const G4int bin = GetBin(energy);
+  if (bin < 0) {
+    return;
+  }
+  for (auto &detector : event_energies) {
+    if (detector.second <= 0.) {
+      continue;
+    }
+    AdjointSimulation_Response &response = responses[detector.first];
+    if (response.total.size() == 0) {
+      response.total = std::vector<G4double>(n_bins, 0.);
+      response.total_squared = std::vector<G4double>(n_bins, 0.);
+      response.peak = std::vector<G4double>(n_bins, 0.);
+      response.peak_squared = std::vector<G4double>(n_bins, 0.);
+    }
+    response.total[bin] += weight;
+    response.total_squared[bin] += weight * weight;
+    if (fabs(detector.second - energy) <= peak_window) {
+      response.peak[bin] += weight;
+      response.peak_squared[bin] += weight * weight;
+    }
+  }
+}
+
+void AdjointSimulation::ResetResponses() {
+  responses.clear();
+  event_energies.clear();
+}
+
+void AdjointSimulation::WriteResponses(const G4String &run_mode, const G4String &source, G4double normalization) {
+  const G4double bin_width = (energy_max - energy_min) / n_bins;
+  const G4String filename = utrFilenameTools::getOutputDir() + "/" + utrFilenameTools::getFilenamePrefix() + "_" + run_mode + "_" + source + ".txt";
+
+  std::ofstream file(filename);
+  file << "# Response to a unit directional differential flux in mm2 sr MeV on the external surface of '" << source << "' (" << run_mode << " simulation)" << std::endl;
+  file << "# E_low [MeV]\tE_high [MeV]";
+  for (auto &detector : responses) {
+    file << "\tdet" << detector.first << "_total\terror\tdet" << detector.first << "_peak\terror";
+  }
+  file << std::endl;
+  file << std::scientific << std::setprecision(6);
+  for (G4int bin = 0; bin < n_bins; ++bin) {
+    file << (energy_min + bin * bin_width) / MeV << "\t" << (energy_min + (bin + 1) * bin_width) / MeV;
+    for (auto &detector : responses) {
+      const AdjointSimulation_Response &response = detector.second;
+      file << "\t" << response.total[bin] * normalization / (mm2 * MeV) << "\t" << sqrt(response.total_squared[bin]) * normalization / (mm2 * MeV) << "\t" << response.peak[bin] * normalization / (mm2 * MeV) << "\t" << sqrt(response.peak_squared[bin]) * normalization / (mm2 * MeV);
+    }
+    file << std::endl;
+  }
+  file.close();
+
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  G4cout << "AdjointSimulation: Response of the " << run_mode << " simulation for the source volume '" << source << "' written to '" << filename << "'" << G4endl;
+  if (lines.size() > 0) {
+    G4cout << "Response coefficients R(E) / dE in mm2 sr (counts per unit directional fluence of the line):" << G4endl;
+    G4cout << "\tE [keV]\tdetector\ttotal\t\terror\t\tpeak\t\terror" << G4endl;
+    for (auto line : lines) {
+      const G4int bin = GetBin(line);
+      if (bin < 0) {
+        G4cout << "\t" << std::fixed << std::setprecision(1) << line / keV << "\toutside of the energy range" << G4endl;
+        continue;
+      }
+      for (auto &detector : responses) {
+        const AdjointSimulation_Response &response = detector.second;
+        const G4double factor = normalization / bin_width / mm2;
+        G4cout << "\t" << std::fixed << std::setprecision(1) << line / keV << "\t" << detector.first << "\t\t" << std::scientific << std::setprecision(3) << response.total[bin] * factor << "\t" << sqrt(response.total_squared[bin]) * factor << "\t" << response.peak[bin] * factor << "\t" << sqrt(response.peak_squared[bin]) * factor << G4endl;
+      }
+    }
+    G4cout << std::defaultfloat << std::setprecision(6);
+  }
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
+
+void AdjointSimulation::PrintInfo() {
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  if (!enabled) {
+    G4cout << "AdjointSimulation: Disabled, use the '-a' command-line option" << G4endl;
+  } else {
+    G4cout << "AdjointSimulation: Adjoint source on the physical volume '" << detector_volume << "'" << G4endl;
+    G4cout << "AdjointSimulation: Source volumes:";
+    for (auto &source : source_volumes) {
+      G4cout << " " << source;
+    }
+    G4cout << G4endl;
+    G4cout << "AdjointSimulation: " << n_bins << " bins from " << energy_min / MeV << " MeV to " << energy_max / MeV << " MeV, peak window " << peak_window / keV << " keV" << G4endl;
+  }
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
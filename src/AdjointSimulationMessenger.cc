@@ -0,0 +1,144 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4UIparameter.hh"
+
+#include "AdjointSimulation.hh"
+#include "AdjointSimulationMessenger.hh"
+
+AdjointSimulationMessenger::AdjointSimulationMessenger() {
+  adjointDirectory = new G4UIdirectory("/utr/adjoint/");
+  adjointDirectory->SetGuidance("Controls for the adjoint (reverse Monte Carlo) simulation of extended sources, requires the '-a' command-line option.");
+
+  detectorCmd = new G4UIcmdWithAString("/utr/adjoint/detector", this);
+  detectorCmd->SetGuidance("Set the physical volume on whose external surface the adjoint photons are started. It has to contain the detectors.");
+  detectorCmd->SetParameterName("physicalVolume", false);
+  detectorCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  sourceCmd = new G4UIcmdWithAString("/utr/adjoint/source", this);
+  sourceCmd->SetGuidance("Add a source volume. The response to photons which enter it through its external surface is calculated.");
+  sourceCmd->SetGuidance("The source volume has to enclose the detector volume.");
+  sourceCmd->SetParameterName("physicalVolume", false);
+  sourceCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  clearSourcesCmd = new G4UIcommand("/utr/adjoint/clearSources", this);
+  clearSourcesCmd->SetGuidance("Remove all source volumes.");
+  clearSourcesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  energyRangeCmd = new G4UIcommand("/utr/adjoint/energyRange", this);
+  energyRangeCmd->SetGuidance("Set the energy range of the response functions (default: 0.1 MeV to 3 MeV).");
+  energyRangeCmd->SetParameter(new G4UIparameter("emin", 'd', false));
+  energyRangeCmd->SetParameter(new G4UIparameter("emax", 'd', false));
+  G4UIparameter *energyRangeUnitParameter = new G4UIparameter("unit", 's', true);
+  energyRangeUnitParameter->SetDefaultValue("MeV");
+  energyRangeCmd->SetParameter(energyRangeUnitParameter);
+  energyRangeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  binsCmd = new G4UIcmdWithAnInteger("/utr/adjoint/bins", this);
+  binsCmd->SetGuidance("Set the number of energy bins of the response functions (default: 290).");
+  binsCmd->SetParameterName("nbins", false);
+  binsCmd->SetRange("nbins > 0");
+  binsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  lineCmd = new G4UIcmdWithADoubleAndUnit("/utr/adjoint/line", this);
+  lineCmd->SetGuidance("Print the response coefficients of the energy bin which contains a gamma-ray line, e.g. '/utr/adjoint/line 1460.8 keV'.");
+  lineCmd->SetParameterName("energy", false);
+  lineCmd->SetDefaultUnit("keV");
+  lineCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  peakWindowCmd = new G4UIcmdWithADoubleAndUnit("/utr/adjoint/peakWindow", this);
+  peakWindowCmd->SetGuidance("Set the maximum difference between the energy deposition and the photon energy for the full-energy peak (default: 1 keV).");
+  peakWindowCmd->SetParameterName("window", false);
+  peakWindowCmd->SetDefaultUnit("keV");
+  peakWindowCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  beamOnCmd = new G4UIcmdWithAnInteger("/utr/adjoint/beamOn", this);
+  beamOnCmd->SetGuidance("Start an adjoint simulation with the given number of events for each source volume.");
+  beamOnCmd->SetParameterName("nevents", false);
+  beamOnCmd->SetRange("nevents > 0");
+  beamOnCmd->AvailableForStates(G4State_Idle);
+
+  forwardBeamOnCmd = new G4UIcmdWithAnInteger("/utr/adjoint/forwardBeamOn", this);
+  forwardBeamOnCmd->SetGuidance("Start a forward simulation of the same source surfaces with the given number of events for each source volume, as a cross-check of the adjoint simulation.");
+  forwardBeamOnCmd->SetParameterName("nevents", false);
+  forwardBeamOnCmd->SetRange("nevents > 0");
+  forwardBeamOnCmd->AvailableForStates(G4State_Idle);
+
+  printCmd = new G4UIcommand("/utr/adjoint/print", this);
+  printCmd->SetGuidance("Print the current settings of the adjoint simulation.");
+}
+
+AdjointSimulationMessenger::~AdjointSimulationMessenger() {
+  delete detectorCmd;
+  delete sourceCmd;
+  delete clearSourcesCmd;
+  delete energyRangeCmd;
+  delete binsCmd;
+  delete lineCmd;
+  delete peakWindowCmd;
+  delete beamOnCmd;
+  delete forwardBeamOnCmd;
+  delete printCmd;
+  delete adjointDirectory;
+}
+
+void AdjointSimulationMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+
+  if (command == detectorCmd) {
+    AdjointSimulation::SetDetectorVolume(newValues);
+  } else if (command == sourceCmd) {
+    AdjointSimulation::AddSourceVolume(newValues);
+  } else if (command == clearSourcesCmd) {
+    AdjointSimulation::ClearSourceVolumes();
+  } else if (command == energyRangeCmd) {
+    G4double emin, emax;
+    G4String unit;
+    parameters >> emin >> emax >> unit;
+    AdjointSimulation::SetEnergyRange(emin * G4UIcommand::ValueOf(unit), emax * G4UIcommand::ValueOf(unit));
+  } else if (command == binsCmd) {
+    AdjointSimulation::SetNumberOfBins(binsCmd->GetNewIntValue(newValues));
+  } else if (command == lineCmd) {
+    AdjointSimulation::AddLine(lineCmd->GetNewDoubleValue(newValues));
+  } else if (command == peakWindowCmd) {
+    AdjointSimulation::SetPeakWindow(peakWindowCmd->GetNewDoubleValue(newValues));
+  } else if (command == beamOnCmd) {
+    AdjointSimulation::Run(beamOnCmd->GetNewIntValue(newValues));
+  } else if (command == forwardBeamOnCmd) {
+    AdjointSimulation::RunForward(forwardBeamOnCmd->GetNewIntValue(newValues));
+  } else if (command == printCmd) {
+    AdjointSimulation::PrintInfo();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String AdjointSimulationMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == detectorCmd) {
+    return AdjointSimulation::GetDetectorVolume();
+  } else if (command == binsCmd) {
+    return binsCmd->ConvertToString(AdjointSimulation::GetNumberOfBins());
+  } else if (command == peakWindowCmd) {
+    return peakWindowCmd->ConvertToString(AdjointSimulation::GetPeakWindow(), "keV");
+  }
+  return "";
+}
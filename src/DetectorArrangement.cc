@@ -0,0 +1,382 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "CeBr3_2x2.hh"
+#include "DetectorArrangement.hh"
+#include "EnergyDepositionSD.hh"
+#include "HPGe_Clover.hh"
+#include "HPGe_Coaxial.hh"
+#include "HPGe_Collection.hh"
+#include "LaBr_3x3.hh"
+#include "LaBr_Galatea.hh"
+
+map<G4String, G4String> DetectorArrangement::filenames = map<G4String, G4String>();
+map<G4String, map<G4String, G4double>> DetectorArrangement::parameters = map<G4String, map<G4String, G4double>>();
+
+// Options which are valid for each detector type, in addition to filter, wrap and offset
+static const map<G4String, vector<G4String>> valid_flags = {
+    {"HPGe_Coaxial", {"filter_case", "filter_case_ring", "dewar"}},
+    {"HPGe_Clover", {"dewar"}},
+    {"LaBr_3x3", {"filter_case", "filter_case_ring", "housing"}},
+    {"CeBr3_2x2", {"no_connectors"}},
+    {"LaBr_Galatea", {"old_configuration"}}};
+
+static void Parse_Error(const G4String &filename, const G4int line_number, const G4String &message) {
+  G4cerr << "ERROR: " << filename << ":" << line_number << ": " << message << ". Aborting..." << G4endl;
+  throw std::exception();
+}
+
+static G4double Parse_Double(const G4String &token, const G4String &filename, const G4int line_number) {
+  size_t n_characters = 0;
+  G4double value = 0.;
+  try {
+    value = std::stod(token, &n_characters);
+  } catch (std::exception &) {
+    n_characters = 0;
+  }
+  if (n_characters == 0 || n_characters != token.size()) {
+    Parse_Error(filename, line_number, "'" + token + "' is not a number");
+  }
+  return value;
+}
+
+// Index N of the parameters filter_thickness_N and wrap_thickness_N, 0 if the parameter has no valid index
+static size_t Parameter_Index(const G4String &parameter_name) {
+  const G4String index = parameter_name.substr(parameter_name.rfind('_') + 1);
+  if (index.empty() || index.find_first_not_of("0123456789") != G4String::npos || index.size() > 9) {
+    return 0;
+  }
+  return std::stoul(index);
+}
+
+static G4bool Is_Valid_Parameter(const G4String &parameter_name) {
+  if (parameter_name == "theta" || parameter_name == "phi" || parameter_name == "rotation" || parameter_name == "distance" || parameter_name == "offset_x" || parameter_name == "offset_y" || parameter_name == "offset_z") {
+    return true;
+  }
+  return (parameter_name.rfind("filter_thickness_", 0) == 0 || parameter_name.rfind("wrap_thickness_", 0) == 0) && Parameter_Index(parameter_name) > 0;
+}
+
+static vector<G4String> Split(const G4String &token, const char delimiter) {
+  vector<G4String> parts;
+  std::istringstream token_stream(token);
+  std::string part;
+  while (std::getline(token_stream, part, delimiter)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+DetectorArrangement::DetectorArrangement(G4LogicalVolume *World_Log, G4String arrangement_name, G4String default_file) : World_Logical(World_Log), name(arrangement_name), default_filename(default_file) {}
+
+void DetectorArrangement::Set_Filename(const G4String &arrangement_name, const G4String &filename) {
+  filenames[arrangement_name] = filename;
+}
+
+void DetectorArrangement::Set_Parameter(const G4String &detector_name, const G4String &parameter, const G4double value) {
+  parameters[detector_name][parameter] = value;
+}
+
+void DetectorArrangement::Print_Parameters() {
+  G4cout << "DetectorArrangement: Modified parameters" << G4endl;
+  for (auto &detector : parameters) {
+    for (auto &parameter : detector.second) {
+      const G4bool is_angle = parameter.first == "theta" || parameter.first == "phi" || parameter.first == "rotation";
+      G4cout << "\t" << detector.first << "\t" << parameter.first << "\t" << (is_angle ? parameter.second / deg : parameter.second / mm) << (is_angle ? " deg" : " mm") << G4endl;
+    }
+  }
+}
+
+void DetectorArrangement::Apply_Parameters(DetectorArrangement_Entry &entry) const {
+  auto detector_parameters = parameters.find(entry.name);
+  if (detector_parameters == parameters.end()) {
+    return;
+  }
+
+  for (auto &parameter : detector_parameters->second) {
+    const G4String &parameter_name = parameter.first;
+    const G4double value = parameter.second;
+    if (parameter_name == "theta") {
+      entry.theta = value;
+    } else if (parameter_name == "phi") {
+      entry.phi = value;
+    } else if (parameter_name == "rotation") {
+      entry.intrinsic_rotation_angle = value;
+    } else if (parameter_name == "distance") {
+      entry.dist_from_center = value;
+    } else if (parameter_name == "offset_x") {
+      entry.offset.setX(value);
+    } else if (parameter_name == "offset_y") {
+      entry.offset.setY(value);
+    } else if (parameter_name == "offset_z") {
+      entry.offset.setZ(value);
+    } else if (parameter_name.rfind("filter_thickness_", 0) == 0 || parameter_name.rfind("wrap_thickness_", 0) == 0) {
+      const G4bool is_filter = parameter_name.rfind("filter_thickness_", 0) == 0;
+      vector<G4double> &thicknesses = is_filter ? entry.filter_thicknesses : entry.wrap_thicknesses;
+      const size_t index = Parameter_Index(parameter_name);
+      if (index < 1 || index > thicknesses.size()) {
+        G4cerr << "ERROR: Detector '" << entry.name << "' has no " << (is_filter ? "filter" : "wrap") << " number " << index << ". Aborting..." << G4endl;
+        throw std::exception();
+      }
+      thicknesses[index - 1] = value;
+    } else {
+      G4cerr << "ERROR: Unknown parameter '" << parameter_name << "' for detector '" << entry.name << "'. Aborting..." << G4endl;
+      throw std::exception();
+    }
+  }
+  G4cout << "DetectorArrangement '" << name << "': Using modified parameters for detector " << entry.name << G4endl;
+}
+
+G4String DetectorArrangement::Get_Filename() const {
+  auto filename = filenames.find(name);
+  if (filename != filenames.end()) {
+    return filename->second;
+  }
+  return default_filename;
+}
+
+G4int DetectorArrangement::Get_Max_Sensitive_Detector_ID() const {
+  G4int max_sensitive_detector_id = -1;
+  for (auto &entry : entries) {
+    if (entry.sensitive_detector_id < 0) {
+      continue;
+    }
+    max_sensitive_detector_id = std::max(max_sensitive_detector_id, entry.type == "HPGe_Clover" ? entry.sensitive_detector_id + 3 : entry.sensitive_detector_id);
+  }
+  return max_sensitive_detector_id;
+}
+
+void DetectorArrangement::Read_File(const G4String &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    G4cerr << "ERROR: Could not open detector arrangement file '" << filename << "'. Aborting..." << G4endl;
+    throw std::exception();
+  }
+
+  entries.clear();
+
+  std::string line;
+  G4int line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    line = line.substr(0, line.find('#'));
+
+    vector<G4String> tokens;
+    std::istringstream line_stream(line);
+    for (std::string token; line_stream >> token;) {
+      tokens.push_back(token);
+    }
+    if (tokens.empty()) {
+      continue;
+    }
+    if (tokens.size() < 8) {
+      Parse_Error(filename, line_number, "Expected at least 8 columns (NAME TYPE PROPERTIES THETA PHI DISTANCE ROTATION SD_ID)");
+    }
+
+    DetectorArrangement_Entry entry;
+    entry.name = tokens[0];
+    entry.type = tokens[1];
+    entry.properties = tokens[2];
+    entry.theta = Parse_Double(tokens[3], filename, line_number) * deg;
+    entry.phi = Parse_Double(tokens[4], filename, line_number) * deg;
+    entry.dist_from_center = Parse_Double(tokens[5], filename, line_number) * mm;
+    entry.intrinsic_rotation_angle = Parse_Double(tokens[6], filename, line_number) * deg;
+    entry.offset = G4ThreeVector();
+    entry.sensitive_detector_id = tokens[7] == "-" ? -1 : (G4int)Parse_Double(tokens[7], filename, line_number);
+
+    auto flags = valid_flags.find(entry.type);
+    if (flags == valid_flags.end()) {
+      Parse_Error(filename, line_number, "Unknown detector type '" + entry.type + "'");
+    }
+
+    HPGe_Collection hpge_Collection;
+    if (entry.type == "HPGe_Coaxial" && !hpge_Collection.Get_Coaxial_Properties(entry.properties)) {
+      Parse_Error(filename, line_number, "Unknown coaxial HPGe detector '" + entry.properties + "' in HPGe_Collection");
+    }
+    if (entry.type == "HPGe_Clover" && !hpge_Collection.Get_Clover_Properties(entry.properties)) {
+      Parse_Error(filename, line_number, "Unknown clover HPGe detector '" + entry.properties + "' in HPGe_Collection");
+    }
+
+    for (size_t i = 8; i < tokens.size(); ++i) {
+      vector<G4String> option = Split(tokens[i], ':');
+      if (option[0] == "filter") {
+        if (option.size() != 4) {
+          Parse_Error(filename, line_number, "Expected filter:MATERIAL:THICKNESS:RADIUS, got '" + tokens[i] + "'");
+        }
+        entry.filter_materials.push_back(option[1]);
+        entry.filter_thicknesses.push_back(Parse_Double(option[2], filename, line_number) * mm);
+        entry.filter_radii.push_back(Parse_Double(option[3], filename, line_number) * mm);
+      } else if (option[0] == "wrap") {
+        if (option.size() != 3) {
+          Parse_Error(filename, line_number, "Expected wrap:MATERIAL:THICKNESS, got '" + tokens[i] + "'");
+        }
+        entry.wrap_materials.push_back(option[1]);
+        entry.wrap_thicknesses.push_back(Parse_Double(option[2], filename, line_number) * mm);
+      } else if (option[0] == "offset") {
+        if (option.size() != 4) {
+          Parse_Error(filename, line_number, "Expected offset:X:Y:Z, got '" + tokens[i] + "'");
+        }
+        entry.offset = G4ThreeVector(Parse_Double(option[1], filename, line_number), Parse_Double(option[2], filename, line_number), Parse_Double(option[3], filename, line_number)) * mm;
+      } else if (option.size() == 1 && std::find(flags->second.begin(), flags->second.end(), option[0]) != flags->second.end()) {
+        entry.flags.push_back(option[0]);
+      } else {
+        Parse_Error(filename, line_number, "Invalid option '" + tokens[i] + "' for detector type " + entry.type);
+      }
+    }
+
+    entries.push_back(entry);
+  }
+
+  G4cout << "DetectorArrangement '" << name << "': Read " << entries.size() << " detectors from '" << filename << "'" << G4endl;
+}
+
+void DetectorArrangement::Construct_Entry(const DetectorArrangement_Entry &entry, G4ThreeVector global_coordinates) const {
+  HPGe_Collection hpge_Collection;
+
+  auto has_flag = [&entry](const G4String &flag) { return std::find(entry.flags.begin(), entry.flags.end(), flag) != entry.flags.end(); };
+  auto add_filters_and_wraps = [&entry](Detector &detector) {
+    for (size_t i = 0; i < entry.filter_materials.size(); ++i) {
+      detector.Add_Filter(entry.filter_materials[i], entry.filter_thicknesses[i], entry.filter_radii[i]);
+    }
+    for (size_t i = 0; i < entry.wrap_materials.size(); ++i) {
+      detector.Add_Wrap(entry.wrap_materials[i], entry.wrap_thicknesses[i]);
+    }
+  };
+
+  const G4ThreeVector position = global_coordinates + entry.offset;
+
+  if (entry.type == "HPGe_Coaxial") {
+    HPGe_Coaxial hpge(World_Logical, entry.name);
+    hpge.setProperties(*hpge_Collection.Get_Coaxial_Properties(entry.properties));
+    if (has_flag("filter_case")) {
+      hpge.useFilterCase();
+    }
+    if (has_flag("filter_case_ring")) {
+      hpge.useFilterCaseRing();
+    }
+    if (has_flag("dewar")) {
+      hpge.useDewar();
+    }
+    add_filters_and_wraps(hpge);
+    hpge.Construct(position, entry.theta, entry.phi, entry.dist_from_center, entry.intrinsic_rotation_angle);
+  } else if (entry.type == "HPGe_Clover") {
+    HPGe_Clover clover(World_Logical, entry.name);
+    clover.setProperties(*hpge_Collection.Get_Clover_Properties(entry.properties));
+    if (has_flag("dewar")) {
+      clover.useDewar();
+    }
+    add_filters_and_wraps(clover);
+    clover.Construct(position, entry.theta, entry.phi, entry.dist_from_center, entry.intrinsic_rotation_angle);
+  } else if (entry.type == "LaBr_3x3") {
+    LaBr_3x3 labr(World_Logical, entry.name);
+    if (has_flag("filter_case")) {
+      labr.useFilterCase();
+    }
+    if (has_flag("filter_case_ring")) {
+      labr.useFilterCaseRing();
+    }
+    if (has_flag("housing")) {
+      labr.useHousing();
+    }
+    add_filters_and_wraps(labr);
+    labr.Construct(position, entry.theta, entry.phi, entry.dist_from_center, entry.intrinsic_rotation_angle);
+  } else if (entry.type == "CeBr3_2x2") {
+    CeBr3_2x2 cebr(World_Logical, entry.name);
+    if (has_flag("no_connectors")) {
+      cebr.disableConnectors();
+    }
+    add_filters_and_wraps(cebr);
+    cebr.Construct(position, entry.theta, entry.phi, entry.dist_from_center, entry.intrinsic_rotation_angle);
+  } else if (entry.type == "LaBr_Galatea") {
+    LaBr_Galatea labr(World_Logical, entry.name, has_flag("old_configuration"));
+    add_filters_and_wraps(labr);
+    labr.Construct(position, entry.theta, entry.phi, entry.dist_from_center, entry.intrinsic_rotation_angle);
+  }
+}
+
+void DetectorArrangement::Construct(G4ThreeVector global_coordinates) {
+  Read_File(Get_Filename());
+
+  // A parameter which does not match any detector, e.g. because of a typo, would silently have no effect
+  for (auto &detector_parameters : parameters) {
+    const G4String &detector_name = detector_parameters.first;
+    if (std::none_of(entries.begin(), entries.end(), [&detector_name](const DetectorArrangement_Entry &entry) { return entry.name == detector_name; })) {
+      G4cerr << "ERROR: DetectorArrangement '" << name << "': Parameters were set for the detector '" << detector_name << "', which is not in '" << Get_Filename() << "'. Aborting..." << G4endl;
+      throw std::exception();
+    }
+    for (auto &parameter : detector_parameters.second) {
+      if (!Is_Valid_Parameter(parameter.first)) {
+        G4cerr << "ERROR: DetectorArrangement '" << name << "': Unknown parameter '" << parameter.first << "' for detector '" << detector_name << "'. Aborting..." << G4endl;
+        throw std::exception();
+      }
+    }
+  }
+
+  for (auto &entry : entries) {
+    Apply_Parameters(entry);
+    Construct_Entry(entry, global_coordinates);
+  }
+}
+
+void DetectorArrangement::ConstructSDs() const {
+  G4LogicalVolumeStore *logicalVolumeStore = G4LogicalVolumeStore::GetInstance();
+  vector<G4String> sensitive_volumes;
+  vector<G4int> sensitive_detector_ids;
+
+  for (auto &entry : entries) {
+    if (entry.sensitive_detector_id < 0) {
+      continue;
+    }
+    if (entry.type == "HPGe_Clover") {
+      for (G4int i = 0; i < 4; ++i) {
+        sensitive_volumes.push_back(entry.name + "_" + std::to_string(i + 1));
+        sensitive_detector_ids.push_back(entry.sensitive_detector_id + i);
+      }
+    } else {
+      sensitive_volumes.push_back(entry.name);
+      sensitive_detector_ids.push_back(entry.sensitive_detector_id);
+    }
+  }
+
+  // Equivalent to G4VUserDetectorConstruction::SetSensitiveDetector(name, sd, true), which is
+  // not accessible from here.
+  // After a reinitialization of the geometry, the sensitive detectors of this thread still exist.
+  for (size_t i = 0; i < sensitive_volumes.size(); ++i) {
+    EnergyDepositionSD *sensitiveDetector = dynamic_cast<EnergyDepositionSD *>(G4SDManager::GetSDMpointer()->FindSensitiveDetector(sensitive_volumes[i], false));
+    if (!sensitiveDetector) {
+      sensitiveDetector = new EnergyDepositionSD(sensitive_volumes[i], sensitive_volumes[i]);
+      G4SDManager::GetSDMpointer()->AddNewDetector(sensitiveDetector);
+    }
+    sensitiveDetector->SetDetectorID(sensitive_detector_ids[i]);
+    for (auto logicalVolume : *logicalVolumeStore) {
+      if (logicalVolume->GetName() == sensitive_volumes[i]) {
+        logicalVolume->SetSensitiveDetector(sensitiveDetector);
+      }
+    }
+  }
+}
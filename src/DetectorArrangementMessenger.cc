@@ -0,0 +1,133 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4StateManager.hh"
+#include "G4UImanager.hh"
+#include "G4UIparameter.hh"
+
+#include "DetectorArrangement.hh"
+#include "DetectorArrangementMessenger.hh"
+
+DetectorArrangementMessenger::DetectorArrangementMessenger() {
+  arrangementDirectory = new G4UIdirectory("/utr/arrangement/");
+  arrangementDirectory->SetGuidance("Modification of single detectors of a DetectorArrangement between runs.");
+  arrangementDirectory->SetGuidance("After /run/initialize, each modification reinitializes the geometry before the next run.");
+
+  distanceCmd = CreateParameterCommand("distance", "Set the distance of a detector from the center.", "mm", false);
+  thetaCmd = CreateParameterCommand("theta", "Set the polar angle of a detector.", "deg", false);
+  phiCmd = CreateParameterCommand("phi", "Set the azimuthal angle of a detector.", "deg", false);
+  rotationCmd = CreateParameterCommand("rotation", "Set the intrinsic rotation angle of a detector.", "deg", false);
+  filterThicknessCmd = CreateParameterCommand("filterThickness", "Set the thickness of a filter of a detector. Filters are numbered from 1 in the order of the arrangement file.", "mm", true);
+  wrapThicknessCmd = CreateParameterCommand("wrapThickness", "Set the thickness of a wrap of a detector. Wraps are numbered from 1 in the order of the arrangement file.", "mm", true);
+
+  offsetCmd = new G4UIcommand("/utr/arrangement/offset", this);
+  offsetCmd->SetGuidance("Set the shift of a detector with respect to the center.");
+  offsetCmd->SetParameter(new G4UIparameter("detector", 's', false));
+  offsetCmd->SetParameter(new G4UIparameter("x", 'd', false));
+  offsetCmd->SetParameter(new G4UIparameter("y", 'd', false));
+  offsetCmd->SetParameter(new G4UIparameter("z", 'd', false));
+  G4UIparameter *offsetUnitParameter = new G4UIparameter("unit", 's', true);
+  offsetUnitParameter->SetDefaultValue("mm");
+  offsetCmd->SetParameter(offsetUnitParameter);
+  offsetCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  resetCmd = new G4UIcommand("/utr/arrangement/reset", this);
+  resetCmd->SetGuidance("Use the parameters of the arrangement files again.");
+  resetCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  printCmd = new G4UIcommand("/utr/arrangement/print", this);
+  printCmd->SetGuidance("Print all modified parameters.");
+}
+
+DetectorArrangementMessenger::~DetectorArrangementMessenger() {
+  delete distanceCmd;
+  delete thetaCmd;
+  delete phiCmd;
+  delete rotationCmd;
+  delete offsetCmd;
+  delete filterThicknessCmd;
+  delete wrapThicknessCmd;
+  delete resetCmd;
+  delete printCmd;
+  delete arrangementDirectory;
+}
+
+G4UIcommand *DetectorArrangementMessenger::CreateParameterCommand(const G4String &command_name, const G4String &guidance, const G4String &default_unit, const G4bool indexed) {
+  G4UIcommand *command = new G4UIcommand("/utr/arrangement/" + command_name, this);
+  command->SetGuidance(guidance);
+  command->SetParameter(new G4UIparameter("detector", 's', false));
+  if (indexed) {
+    G4UIparameter *indexParameter = new G4UIparameter("number", 'i', false);
+    indexParameter->SetParameterRange("number >= 1");
+    command->SetParameter(indexParameter);
+  }
+  command->SetParameter(new G4UIparameter("value", 'd', false));
+  G4UIparameter *unitParameter = new G4UIparameter("unit", 's', true);
+  unitParameter->SetDefaultValue(default_unit);
+  command->SetParameter(unitParameter);
+  command->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  return command;
+}
+
+void DetectorArrangementMessenger::GeometryModified() {
+  if (G4StateManager::GetStateManager()->GetCurrentState() != G4State_Idle) {
+    return;
+  }
+
+  // The Detector classes consist of many volumes whose solids depend on the parameters, so the
+  // geometry is rebuilt completely. Physics tables and worker threads are kept.
+  G4UImanager::GetUIpointer()->ApplyCommand("/run/reinitializeGeometry true");
+}
+
+void DetectorArrangementMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+  G4String detector, unit;
+  G4double value;
+
+  if (command == distanceCmd || command == thetaCmd || command == phiCmd || command == rotationCmd) {
+    parameters >> detector >> value >> unit;
+    G4String parameter = command == distanceCmd ? "distance" : command == thetaCmd ? "theta" : command == phiCmd ? "phi" : "rotation";
+    DetectorArrangement::Set_Parameter(detector, parameter, value * G4UIcommand::ValueOf(unit));
+    GeometryModified();
+  } else if (command == filterThicknessCmd || command == wrapThicknessCmd) {
+    G4int number;
+    parameters >> detector >> number >> value >> unit;
+    G4String parameter = (command == filterThicknessCmd ? "filter_thickness_" : "wrap_thickness_") + std::to_string(number);
+    DetectorArrangement::Set_Parameter(detector, parameter, value * G4UIcommand::ValueOf(unit));
+    GeometryModified();
+  } else if (command == offsetCmd) {
+    G4double x, y, z;
+    parameters >> detector >> x >> y >> z >> unit;
+    DetectorArrangement::Set_Parameter(detector, "offset_x", x * G4UIcommand::ValueOf(unit));
+    DetectorArrangement::Set_Parameter(detector, "offset_y", y * G4UIcommand::ValueOf(unit));
+    DetectorArrangement::Set_Parameter(detector, "offset_z", z * G4UIcommand::ValueOf(unit));
+    GeometryModified();
+  } else if (command == resetCmd) {
+    DetectorArrangement::Clear_Parameters();
+    GeometryModified();
+  } else if (command == printCmd) {
+    DetectorArrangement::Print_Parameters();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
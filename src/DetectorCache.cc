@@ -0,0 +1,55 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "G4NistManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "DetectorCache.hh"
+
+std::map<G4String, G4VSolid *> DetectorCache::solids = std::map<G4String, G4VSolid *>();
+
+G4VSolid *DetectorCache::Find_Solid(const G4String &model, const G4String &part) {
+  auto solid = solids.find(model + "/" + part);
+  return solid == solids.end() ? nullptr : solid->second;
+}
+
+G4VSolid *DetectorCache::Add_Solid(const G4String &model, const G4String &part, G4VSolid *solid) {
+  solids[model + "/" + part] = solid;
+  return solid;
+}
+
+void DetectorCache::Clear() {
+  solids.clear();
+}
+
+// Geant4 builds the cross section tables for each G4Material object, so identical copies of a
+// material would only cost memory and initialization time. Unlike the solids, the material
+// survives a reconstruction of the geometry and is therefore looked up in the material table.
+G4Material *DetectorCache::Find_Or_Build_LaBr3Ce() {
+  G4Material *LaBr3Ce = G4Material::GetMaterial("LaBr3Ce", false);
+  if (!LaBr3Ce) {
+    // Brillance 380 from Enrique Nacher (Santiago)
+    G4NistManager *nist = G4NistManager::Instance();
+    LaBr3Ce = new G4Material("LaBr3Ce", 5.06 * g / cm3, 3);
+    LaBr3Ce->AddElement(nist->FindOrBuildElement("La"), 34.855 * perCent);
+    LaBr3Ce->AddElement(nist->FindOrBuildElement("Br"), 60.145 * perCent);
+    LaBr3Ce->AddElement(nist->FindOrBuildElement("Ce"), 5.0 * perCent);
+  }
+  return LaBr3Ce;
+}
@@ -0,0 +1,180 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "G4AffineTransform.hh"
+#include "G4LogicalVolume.hh"
+#include "G4NavigationHistory.hh"
+#include "G4RootAnalysisManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4VTouchable.hh"
+#include "G4ios.hh"
+#include "Randomize.hh"
+
+#include "Digitizer.hh"
+
+// Conversion factor between the FWHM and the standard deviation of a normal distribution, 2*sqrt(2*ln(2))
+static const G4double fwhm_to_sigma = 1. / 2.3548200450309493;
+
+G4bool Digitizer::active = false;
+std::map<G4int, Digitizer_Channel> Digitizer::channels = std::map<G4int, Digitizer_Channel>();
+G4int Digitizer::histogram_nbins = 0;
+G4double Digitizer::histogram_emax = 10. * MeV;
+
+void Digitizer::SetResolution(G4int detID, G4double a, G4double b, G4double c) {
+  channels[detID].resolution_a = a;
+  channels[detID].resolution_b = b;
+  channels[detID].resolution_c = c;
+}
+
+void Digitizer::SetThreshold(G4int detID, G4double thr) {
+  channels[detID].threshold = thr;
+}
+
+void Digitizer::SetDeadLayer(G4int detID, G4double thickness) {
+  channels[detID].dead_layer_thickness = thickness;
+}
+
+void Digitizer::SetHistogramBinning(G4int nbins, G4double emax) {
+  histogram_nbins = nbins;
+  histogram_emax = emax;
+}
+
+G4double Digitizer::GetFWHM(G4int detID, G4double e) {
+  auto channel = channels.find(detID);
+  if (channel == channels.end()) {
+    return 0.;
+  }
+  const G4double e_MeV = e / MeV;
+  const G4double fwhm = channel->second.resolution_a + channel->second.resolution_b * sqrt(e_MeV + channel->second.resolution_c * e_MeV * e_MeV);
+
+  return fwhm > 0. ? fwhm * MeV : 0.;
+}
+
+G4bool Digitizer::IsInDeadLayer(G4int detID, const G4Step *step) {
+  if (!active) {
+    return false;
+  }
+  auto channel = channels.find(detID);
+  if (channel == channels.end() || channel->second.dead_layer_thickness <= 0.) {
+    return false;
+  }
+
+  // Charged particles lose their energy continuously along the step, so the position of the
+  // energy deposition is sampled uniformly between the pre- and the post-step point. The post-step
+  // point alone would lie on the surface for every step which ends at a boundary of the volume or
+  // of one of its daughters. Neutral particles deposit energy only where they interact, i.e. at the
+  // post-step point.
+  const G4StepPoint *preStepPoint = step->GetPreStepPoint();
+  const G4StepPoint *postStepPoint = step->GetPostStepPoint();
+  G4ThreeVector position = postStepPoint->GetPosition();
+  if (preStepPoint->GetCharge() != 0. || postStepPoint->GetStepStatus() == fGeomBoundary) {
+    position = preStepPoint->GetPosition() + G4UniformRand() * (postStepPoint->GetPosition() - preStepPoint->GetPosition());
+  }
+
+  // Transform the position of the energy deposition into the local coordinate system of
+  // the sensitive volume and determine its distance to the closest surface.
+  // Note that this includes inner surfaces like the hole of a coaxial detector, or holes which
+  // are daughter volumes of the sensitive volume like in the HPGe_Clover.
+  const G4VTouchable *touchable = preStepPoint->GetTouchable();
+  const G4ThreeVector local_position = touchable->GetHistory()->GetTopTransform().TransformPoint(position);
+
+  G4double distance = touchable->GetSolid()->DistanceToOut(local_position);
+  const G4LogicalVolume *logical_volume = touchable->GetVolume()->GetLogicalVolume();
+  for (size_t i = 0; i < logical_volume->GetNoDaughters(); ++i) {
+    const G4VPhysicalVolume *daughter = logical_volume->GetDaughter((G4int)i);
+    G4AffineTransform daughter_transform(daughter->GetRotation(), daughter->GetTranslation());
+    daughter_transform.Invert();
+    distance = std::min(distance, daughter->GetLogicalVolume()->GetSolid()->DistanceToIn(daughter_transform.TransformPoint(local_position)));
+  }
+
+  return distance < channel->second.dead_layer_thickness;
+}
+
+G4double Digitizer::Digitize(G4int detID, G4double edep) {
+  if (!active || edep <= 0.) {
+    return edep;
+  }
+  auto channel = channels.find(detID);
+  if (channel == channels.end()) {
+    return edep;
+  }
+
+  G4double energy = edep;
+  const G4double sigma = GetFWHM(detID, edep) * fwhm_to_sigma;
+  if (sigma > 0.) {
+    energy = G4RandGauss::shoot(edep, sigma);
+  }
+
+  if (energy < channel->second.threshold || energy <= 0.) {
+    return 0.;
+  }
+
+  return energy;
+}
+
+void Digitizer::CreateHistograms(G4bool isMaster) {
+  if (!active || histogram_nbins <= 0) {
+    return;
+  }
+
+  G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
+  G4int histogram_id;
+  for (auto &channel : channels) {
+    histogram_id = analysisManager->CreateH1("det" + std::to_string(channel.first), "Digitized energy in detector " + std::to_string(channel.first), histogram_nbins, 0., histogram_emax);
+    if (isMaster) {
+      channel.second.histogram_id = histogram_id;
+    }
+  }
+}
+
+void Digitizer::FillHistogram(G4int detID, G4double energy, G4double weight) {
+  auto channel = channels.find(detID);
+  if (channel == channels.end() || channel->second.histogram_id < 0) {
+    return;
+  }
+  G4RootAnalysisManager::Instance()->FillH1(channel->second.histogram_id, energy, weight);
+}
+
+void Digitizer::PrintInfo() {
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  if (!active) {
+    G4cout << "Digitizer: Inactive, raw energy depositions will be written to the output file" << G4endl;
+  } else {
+    G4cout << "Digitizer: Active for the following detectors:" << G4endl;
+    G4cout << "\tID\tFWHM(1.332 MeV) [keV]\tthreshold [keV]\tdead layer [mm]" << G4endl;
+    for (auto &channel : channels) {
+      G4cout << "\t" << channel.first << "\t" << GetFWHM(channel.first, 1.332 * MeV) / keV << "\t\t\t" << channel.second.threshold / keV << "\t\t" << channel.second.dead_layer_thickness / mm << G4endl;
+    }
+    if (histogram_nbins > 0) {
+      G4cout << "Digitizer: Filling online histograms with " << histogram_nbins << " bins up to " << histogram_emax / MeV << " MeV" << G4endl;
+    }
+  }
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
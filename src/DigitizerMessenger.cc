@@ -0,0 +1,133 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4SystemOfUnits.hh"
+#include "G4UIparameter.hh"
+
+#include "Digitizer.hh"
+#include "DigitizerMessenger.hh"
+
+DigitizerMessenger::DigitizerMessenger() {
+  digitizerDirectory = new G4UIdirectory("/utr/digitizer/");
+  digitizerDirectory->SetGuidance("Controls for the online digitization of energy depositions in EnergyDepositionSD detectors.");
+
+  activateCmd = new G4UIcmdWithABool("/utr/digitizer/activate", this);
+  activateCmd->SetGuidance("Apply resolution, thresholds and dead layers to the energy depositions before they are written (default: false)");
+  activateCmd->SetParameterName("active", true);
+  activateCmd->SetDefaultValue(true);
+  activateCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  resolutionCmd = new G4UIcommand("/utr/digitizer/resolution", this);
+  resolutionCmd->SetGuidance("Set the resolution function FWHM(E) = a + b*sqrt(E + c*E^2) of a detector.");
+  resolutionCmd->SetGuidance("E and FWHM in MeV, a in MeV, b in sqrt(MeV), c in 1/MeV (same convention as the MCNP GEB card).");
+  resolutionCmd->SetParameter(new G4UIparameter("detectorID", 'i', false));
+  resolutionCmd->SetParameter(new G4UIparameter("a", 'd', false));
+  resolutionCmd->SetParameter(new G4UIparameter("b", 'd', false));
+  G4UIparameter *resolutionCParameter = new G4UIparameter("c", 'd', true);
+  resolutionCParameter->SetDefaultValue(0.);
+  resolutionCmd->SetParameter(resolutionCParameter);
+  resolutionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  thresholdCmd = new G4UIcommand("/utr/digitizer/threshold", this);
+  thresholdCmd->SetGuidance("Set the energy threshold of a detector. Digitized energies below the threshold are discarded.");
+  thresholdCmd->SetParameter(new G4UIparameter("detectorID", 'i', false));
+  thresholdCmd->SetParameter(new G4UIparameter("threshold", 'd', false));
+  G4UIparameter *thresholdUnitParameter = new G4UIparameter("unit", 's', true);
+  thresholdUnitParameter->SetDefaultValue("keV");
+  thresholdCmd->SetParameter(thresholdUnitParameter);
+  thresholdCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  deadLayerCmd = new G4UIcommand("/utr/digitizer/deadLayer", this);
+  deadLayerCmd->SetGuidance("Set the thickness of the dead layer of a detector.");
+  deadLayerCmd->SetGuidance("Energy depositions closer to any surface of the sensitive volume than this thickness are ignored.");
+  deadLayerCmd->SetParameter(new G4UIparameter("detectorID", 'i', false));
+  deadLayerCmd->SetParameter(new G4UIparameter("thickness", 'd', false));
+  G4UIparameter *deadLayerUnitParameter = new G4UIparameter("unit", 's', true);
+  deadLayerUnitParameter->SetDefaultValue("mm");
+  deadLayerCmd->SetParameter(deadLayerUnitParameter);
+  deadLayerCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  histogramCmd = new G4UIcommand("/utr/digitizer/histograms", this);
+  histogramCmd->SetGuidance("Fill online histograms of the digitized energy for all configured detectors with the given binning.");
+  histogramCmd->SetGuidance("A number of bins of 0 disables the histograms (default).");
+  histogramCmd->SetParameter(new G4UIparameter("nbins", 'i', false));
+  histogramCmd->SetParameter(new G4UIparameter("emax", 'd', false));
+  G4UIparameter *histogramUnitParameter = new G4UIparameter("unit", 's', true);
+  histogramUnitParameter->SetDefaultValue("MeV");
+  histogramCmd->SetParameter(histogramUnitParameter);
+  histogramCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  printCmd = new G4UIcommand("/utr/digitizer/print", this);
+  printCmd->SetGuidance("Print the current digitizer settings.");
+}
+
+DigitizerMessenger::~DigitizerMessenger() {
+  delete activateCmd;
+  delete resolutionCmd;
+  delete thresholdCmd;
+  delete deadLayerCmd;
+  delete histogramCmd;
+  delete printCmd;
+  delete digitizerDirectory;
+}
+
+void DigitizerMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+
+  if (command == activateCmd) {
+    Digitizer::SetActive(activateCmd->GetNewBoolValue(newValues));
+  } else if (command == resolutionCmd) {
+    G4int detID;
+    G4double a, b, c;
+    parameters >> detID >> a >> b >> c;
+    Digitizer::SetResolution(detID, a, b, c);
+  } else if (command == thresholdCmd) {
+    G4int detID;
+    G4double threshold;
+    G4String unit;
+    parameters >> detID >> threshold >> unit;
+    Digitizer::SetThreshold(detID, threshold * G4UIcommand::ValueOf(unit));
+  } else if (command == deadLayerCmd) {
+    G4int detID;
+    G4double thickness;
+    G4String unit;
+    parameters >> detID >> thickness >> unit;
+    Digitizer::SetDeadLayer(detID, thickness * G4UIcommand::ValueOf(unit));
+  } else if (command == histogramCmd) {
+    G4int nbins;
+    G4double emax;
+    G4String unit;
+    parameters >> nbins >> emax >> unit;
+    Digitizer::SetHistogramBinning(nbins, emax * G4UIcommand::ValueOf(unit));
+  } else if (command == printCmd) {
+    Digitizer::PrintInfo();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String DigitizerMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == activateCmd) {
+    return activateCmd->ConvertToString(Digitizer::IsActive());
+  }
+  return "";
+}
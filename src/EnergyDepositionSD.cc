@@ -18,10 +18,13 @@ You should have received a copy of the GNU General Public License
 along with utr.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "EnergyDepositionSD.hh"
-#include "DetectorConstruction.hh"
+#include "AdjointSimulation.hh"
+#include "Digitizer.hh"
+#include "ForcedCollisionHistory.hh"
 #include "G4HCofThisEvent.hh"
-#include "G4RootAnalysisManager.hh"
 #include "G4RunManager.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
@@ -29,8 +32,12 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4ThreeVector.hh"
 #include "G4VProcess.hh"
 #include "G4ios.hh"
+#include "GeometryLoader.hh"
+#include "OutputWriter.hh"
 #include "RunAction.hh"
+#include "Sharding.hh"
 #include "TargetHit.hh"
+#include "Trigger.hh"
 
 #include "utrConfig.h"
 
@@ -57,9 +64,17 @@ void EnergyDepositionSD::Initialize(G4HCofThisEvent *hce) {
 
 G4bool EnergyDepositionSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
 
-  TargetHit *hit = new TargetHit();
+  if (Digitizer::IsInDeadLayer(GetDetectorID(), aStep)) {
+    return false;
+  }
 
   G4Track *track = aStep->GetTrack();
+  // Adjoint particles are tracked backwards and do not deposit energy
+  if (AdjointSimulation::IsAdjointParticle(track->GetDefinition())) {
+    return false;
+  }
+
+  TargetHit *hit = new TargetHit();
 
   hit->SetKineticEnergy(aStep->GetPreStepPoint()->GetKineticEnergy());
   hit->SetEnergyDeposition(aStep->GetTotalEnergyDeposit());
@@ -68,6 +83,8 @@ G4bool EnergyDepositionSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
   hit->SetEventID(eventID);
   hit->SetPosition(track->GetPosition());
   hit->SetMomentum(track->GetMomentum());
+  hit->SetWeight(aStep->GetPreStepPoint()->GetWeight());
+  hit->SetHistory(ForcedCollisionHistory::GetHistory(track));
 
   hitsCollection->insert(hit);
 
@@ -80,72 +97,111 @@ std::vector<bool> EnergyDepositionSD::anyDetectorHitInEvent = std::vector<bool>(
 void EnergyDepositionSD::EndOfEvent(G4HCofThisEvent *) {
 
   G4int nHits = hitsCollection->entries();
-  G4double totalEnergyDeposition = 0.;
 
+  // With variance reduction (see ForcedCollisionHistory), an event consists of several alternative
+  // histories, whose energy depositions must not be added up. The hits are grouped by the index of
+  // their history, and each group is treated like a separate event. Without variance reduction, all
+  // hits belong to history 0.
+  std::vector<G4int> firstHits; // Index of the first hit of each group
+  std::vector<G4double> energyDepositions;
   for (G4int i = 0; i < nHits; i++) {
-    totalEnergyDeposition += (*hitsCollection)[i]->GetEnergyDeposition();
+    size_t group = 0;
+    while (group < firstHits.size() && (*hitsCollection)[firstHits[group]]->GetHistory() != (*hitsCollection)[i]->GetHistory()) {
+      ++group;
+    }
+    if (group == firstHits.size()) {
+      firstHits.push_back(i);
+      energyDepositions.push_back(0.);
+    }
+    energyDepositions[group] += (*hitsCollection)[i]->GetEnergyDeposition();
+  }
+
+  for (size_t group = 0; group < firstHits.size(); ++group) {
+    // Apply resolution and threshold, if requested. Without an active digitizer, this returns the raw energy deposition.
+    energyDepositions[group] = Digitizer::Digitize(GetDetectorID(), energyDepositions[group]);
+    const G4double weight = (*hitsCollection)[firstHits[group]]->GetWeight();
+    if (energyDepositions[group] > 0.) {
+      // With an active trigger, the histograms are only filled for accepted histories at the end of the event
+      if (Trigger::IsActive()) {
+        Trigger::AddEnergyDeposition(GetDetectorID(), energyDepositions[group], weight, (*hitsCollection)[firstHits[group]]->GetHistory());
+      } else if (Digitizer::IsActive()) {
+        Digitizer::FillHistogram(GetDetectorID(), energyDepositions[group], weight);
+      }
+      AdjointSimulation::AddEnergyDeposition(GetDetectorID(), energyDepositions[group]);
+    }
   }
 
 #ifdef EVENT_EVENTWISE
-  G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
+  // Forced collisions are not supported in this mode (see RunAction), i.e. there is at most one group
+  const G4double totalEnergyDeposition = energyDepositions.size() ? energyDepositions[0] : 0.;
+  // The thread ID is -1 for the sequential run manager
+  const G4int threadID = std::max(G4Threading::G4GetThreadId(), 0);
   if (totalEnergyDeposition > 0.) {
-    analysisManager->FillNtupleDColumn(0, GetDetectorID(), totalEnergyDeposition);
-    anyDetectorHitInEvent[G4Threading::G4GetThreadId()] = true;
+    OutputWriter::FillNtupleDColumn(GetDetectorID(), totalEnergyDeposition);
+    anyDetectorHitInEvent[threadID] = true;
   }
-  if (anyDetectorHitInEvent[G4Threading::G4GetThreadId()] && GetDetectorID() == ((DetectorConstruction *)G4RunManager::GetRunManager()->GetUserDetectorConstruction())->Max_Sensitive_Detector_ID) {
-    analysisManager->AddNtupleRow();
-    anyDetectorHitInEvent[G4Threading::G4GetThreadId()] = false;
+  if (anyDetectorHitInEvent[threadID] && (G4int)GetDetectorID() == GeometryLoader::GetMaxSensitiveDetectorID()) {
+    OutputWriter::AddNtupleRow();
+    anyDetectorHitInEvent[threadID] = false;
   }
 #else
-  if (totalEnergyDeposition > 0.) {
-    G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
-
+  for (size_t group = 0; group < firstHits.size(); ++group) {
+    if (energyDepositions[group] <= 0.) {
+      continue;
+    }
+    TargetHit *firstHit = (*hitsCollection)[firstHits[group]];
     unsigned int nentry = 0;
 
 #ifdef EVENT_ID
-    analysisManager->FillNtupleDColumn(nentry, eventID);
+    OutputWriter::FillNtupleDColumn(nentry, eventID + Sharding::GetEventOffset());
     ++nentry;
 #endif
 #ifdef EVENT_EDEP
-    analysisManager->FillNtupleDColumn(nentry, totalEnergyDeposition);
+    OutputWriter::FillNtupleDColumn(nentry, energyDepositions[group]);
     ++nentry;
 #endif
 #ifdef EVENT_EKIN
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetKineticEnergy());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetKineticEnergy());
     ++nentry;
 #endif
 #ifdef EVENT_PARTICLE
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetParticleType());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetParticleType());
     ++nentry;
 #endif
 #ifdef EVENT_VOLUME
-    analysisManager->FillNtupleDColumn(nentry, GetDetectorID());
+    OutputWriter::FillNtupleDColumn(nentry, GetDetectorID());
     ++nentry;
 #endif
 #ifdef EVENT_POSX
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetPosition().x());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetPosition().x());
     ++nentry;
 #endif
 #ifdef EVENT_POSY
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetPosition().y());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetPosition().y());
     ++nentry;
 #endif
 #ifdef EVENT_POSZ
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetPosition().z());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetPosition().z());
     ++nentry;
 #endif
 #ifdef EVENT_MOMX
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetMomentum().x());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetMomentum().x());
     ++nentry;
 #endif
 #ifdef EVENT_MOMY
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetMomentum().y());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetMomentum().y());
     ++nentry;
 #endif
 #ifdef EVENT_MOMZ
-    analysisManager->FillNtupleDColumn(nentry, (*hitsCollection)[0]->GetMomentum().z());
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetMomentum().z());
+    ++nentry;
+#endif
+#ifdef EVENT_WEIGHT
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetWeight());
+    ++nentry;
+    OutputWriter::FillNtupleDColumn(nentry, firstHit->GetHistory());
 #endif
-    analysisManager->AddNtupleRow();
+    OutputWriter::AddNtupleRow(firstHit->GetHistory());
   }
 #endif
 }
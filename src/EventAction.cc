@@ -19,13 +19,21 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "EventAction.hh"
-#include "DetectorConstruction.hh"
 #include "G4Event.hh"
 #include "G4MTRunManager.hh"
 #include "G4RunManager.hh"
+#include <algorithm>
 #include <chrono>
+#include <iomanip>
 
+#include "AdjointSimulation.hh"
+#include "FluxScoring.hh"
+#include "ForcedCollisionHistory.hh"
 #include "G4LogicalVolume.hh"
+#include "OutputWriter.hh"
+#include "SlowEvents.hh"
+#include "Trigger.hh"
+#include "WorkerThreads.hh"
 #include "utrConfig.h"
 
 using std::setw;
@@ -39,7 +47,20 @@ EventAction::EventAction() : n_threads(1) {}
 
 EventAction::~EventAction() {}
 
+void EventAction::BeginOfEventAction(const G4Event *) {
+  WorkerThreads::BeginOfEvent();
+  ForcedCollisionHistory::BeginOfEvent();
+}
+
 void EventAction::EndOfEventAction(const G4Event *event) {
+  // The sensitive detectors have already filled the rows of this event
+  Trigger::EndOfEvent();
+  OutputWriter::EndOfEvent();
+  AdjointSimulation::EndOfEvent();
+  FluxScoring::EndOfEvent();
+  WorkerThreads::EndOfEvent();
+  SlowEvents::EndOfEvent(event);
+
   int eID = event->GetEventID();
   if (0 == (eID % print_progress)) {
 #ifdef G4MULTITHREADED
@@ -52,7 +73,7 @@ void EventAction::EndOfEventAction(const G4Event *event) {
 
    int NbEvents = runManager->GetNumberOfEventsToBeProcessed();
     int threadID = G4Threading::G4GetThreadId();
-    int numberofpadchars = to_string(n_threads - 1).length() - to_string(threadID).length();
+    int numberofpadchars = std::max((int)(to_string(n_threads - 1).length() - to_string(threadID).length()), 0);
     string padchars(numberofpadchars, ' ');
 
 /******************************************
@@ -0,0 +1,431 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "G4LogicalVolume.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4RootAnalysisManager.hh"
+#include "G4Step.hh"
+#include "G4Threading.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4ios.hh"
+
+#include "FluxScoring.hh"
+
+// Contributions of the current event of the calling thread, for each scorer. Only few bins are hit
+// in a single event, so they are stored sparsely.
+struct FluxScoring_Event {
+  std::vector<std::unordered_map<G4int, G4double>> bins;
+  std::vector<G4double> crossings; // Parameters of the cell boundaries along the current step
+};
+
+// Each thread holds the histogram of each scorer with about 70 bytes per bin
+static const G4long flux_warn_bins = 1000000;
+static const G4long flux_max_bins = 10000000;
+
+static G4ThreadLocal FluxScoring_Event *thread_event = nullptr;
+
+std::vector<FluxScoring_Scorer> FluxScoring::scorers = std::vector<FluxScoring_Scorer>();
+
+FluxScoring_Scorer *FluxScoring::FindScorer(const G4String &name) {
+  for (auto &scorer : scorers) {
+    if (scorer.name == name) {
+      return &scorer;
+    }
+  }
+  return nullptr;
+}
+
+G4bool FluxScoring::AddBox(const G4String &name, const G4ThreeVector &half_lengths, G4int nx, G4int ny, G4int nz, const G4ThreeVector &center) {
+  if (FindScorer(name)) {
+    return false;
+  }
+  FluxScoring_Scorer scorer;
+  scorer.name = name;
+  scorer.type = FLUX_BOX;
+  scorer.center = center;
+  scorer.half_lengths = half_lengths;
+  scorer.n_x = nx;
+  scorer.n_y = ny;
+  scorer.n_z = nz;
+  scorers.push_back(scorer);
+  return true;
+}
+
+G4bool FluxScoring::AddCylinder(const G4String &name, G4double radius, G4double half_length, G4int nr, G4int nz, const G4ThreeVector &center) {
+  if (FindScorer(name)) {
+    return false;
+  }
+  FluxScoring_Scorer scorer;
+  scorer.name = name;
+  scorer.type = FLUX_CYLINDER;
+  scorer.center = center;
+  scorer.half_lengths = G4ThreeVector(radius, radius, half_length);
+  scorer.n_x = nr;
+  scorer.n_z = nz;
+  scorers.push_back(scorer);
+  return true;
+}
+
+G4bool FluxScoring::AddVolumes(const G4String &name, const std::vector<G4String> &volume_names) {
+  if (FindScorer(name)) {
+    return false;
+  }
+  FluxScoring_Scorer scorer;
+  scorer.name = name;
+  scorer.type = FLUX_VOLUMES;
+  scorer.volume_names = volume_names;
+  scorer.n_x = (G4int)volume_names.size();
+  scorers.push_back(scorer);
+  return true;
+}
+
+G4bool FluxScoring::SetEnergyBinning(const G4String &name, G4int n, G4double emin, G4double emax) {
+  FluxScoring_Scorer *scorer = FindScorer(name);
+  if (!scorer) {
+    return false;
+  }
+  scorer->n_energy = n;
+  scorer->energy_min = emin;
+  scorer->energy_max = emax;
+  return true;
+}
+
+G4bool FluxScoring::SetCosBinning(const G4String &name, G4int n) {
+  FluxScoring_Scorer *scorer = FindScorer(name);
+  if (!scorer) {
+    return false;
+  }
+  scorer->n_cos = n;
+  return true;
+}
+
+G4bool FluxScoring::SetParticle(const G4String &name, const G4String &particle_name) {
+  FluxScoring_Scorer *scorer = FindScorer(name);
+  if (!scorer) {
+    return false;
+  }
+  scorer->particle_name = particle_name;
+  return true;
+}
+
+void FluxScoring::Clear() {
+  scorers.clear();
+}
+
+void FluxScoring::CreateHistograms(G4bool isMaster) {
+  if (!IsActive()) {
+    return;
+  }
+
+  // The cells and particles are only looked up once per run by the master
+  if (isMaster) {
+    for (auto &scorer : scorers) {
+      scorer.histogram_id = -1;
+      scorer.particle = nullptr;
+      if (scorer.GetNumberOfBins() > flux_max_bins) {
+        G4cerr << "FluxScoring: Error! The scorer '" << scorer.name << "' has " << scorer.GetNumberOfBins() << " bins (cells x energy bins x cos bins), more than the limit of " << flux_max_bins << ". It is skipped, reduce the number of cells or bins." << G4endl;
+        continue;
+      }
+      if (scorer.GetNumberOfBins() > flux_warn_bins) {
+        G4cout << "FluxScoring: Warning! The histogram of the scorer '" << scorer.name << "' has " << scorer.GetNumberOfBins() << " bins and needs about " << scorer.GetNumberOfBins() * 70 / 1000000 << " MB of memory per thread." << G4endl;
+      }
+      if (scorer.particle_name != "all") {
+        scorer.particle = G4ParticleTable::GetParticleTable()->FindParticle(scorer.particle_name);
+        if (!scorer.particle) {
+          G4cerr << "FluxScoring: Error! Unknown particle '" << scorer.particle_name << "', the scorer '" << scorer.name << "' is skipped." << G4endl;
+          continue;
+        }
+      }
+
+      scorer.cell_volumes.clear();
+      scorer.volume_cells.clear();
+      if (scorer.type == FLUX_BOX) {
+        const G4double cell_volume = 8. * scorer.half_lengths.x() * scorer.half_lengths.y() * scorer.half_lengths.z() / scorer.GetNumberOfCells();
+        scorer.cell_volumes.assign((size_t)scorer.GetNumberOfCells(), cell_volume);
+      } else if (scorer.type == FLUX_CYLINDER) {
+        const G4double ring_width = scorer.half_lengths.x() / scorer.n_x;
+        const G4double slice_length = 2. * scorer.half_lengths.z() / scorer.n_z;
+        for (G4int iz = 0; iz < scorer.n_z; ++iz) {
+          for (G4int ir = 0; ir < scorer.n_x; ++ir) {
+            scorer.cell_volumes.push_back(pi * (2 * ir + 1) * ring_width * ring_width * slice_length);
+          }
+        }
+      } else {
+        for (auto &volume_name : scorer.volume_names) {
+          G4VPhysicalVolume *volume = G4PhysicalVolumeStore::GetInstance()->GetVolume(volume_name, false);
+          if (!volume) {
+            G4cerr << "FluxScoring: Error! Unknown physical volume '" << volume_name << "', the scorer '" << scorer.name << "' is skipped." << G4endl;
+            break;
+          }
+          scorer.volume_cells[volume] = (G4int)scorer.cell_volumes.size();
+          scorer.cell_volumes.push_back(volume->GetLogicalVolume()->GetSolid()->GetCubicVolume());
+        }
+        if (scorer.cell_volumes.size() != scorer.volume_names.size()) {
+          continue;
+        }
+      }
+      // Marks the scorer as valid
+      scorer.histogram_id = 0;
+    }
+  }
+
+  // A single histogram for all cells of a scorer
+  G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
+  for (auto &scorer : scorers) {
+    if (scorer.histogram_id < 0) {
+      continue;
+    }
+    const G4int histogram_id = analysisManager->CreateH3("flux_" + scorer.name, "Fluence of " + scorer.particle_name + " in the cells of " + scorer.name + " [1/cm2], x: cell, y: kinetic energy [MeV], z: cos(theta)", scorer.GetNumberOfCells(), -0.5, scorer.GetNumberOfCells() - 0.5, scorer.n_energy, scorer.energy_min / MeV, scorer.energy_max / MeV, scorer.n_cos, -1., 1.);
+    if (isMaster) {
+      scorer.histogram_id = histogram_id;
+    }
+  }
+
+  // The master thread of a multithreaded run does not process any events
+  if (isMaster && G4Threading::IsMultithreadedApplication()) {
+    return;
+  }
+  if (!thread_event) {
+    thread_event = new FluxScoring_Event();
+  }
+  thread_event->bins.resize(scorers.size());
+  for (auto &event_bins : thread_event->bins) {
+    event_bins.clear();
+  }
+}
+
+// Restricts the parameter range [t0, t1] of the segment p + t * d to the slab -h <= x <= h
+static inline G4bool ClipToSlab(G4double p, G4double d, G4double h, G4double &t0, G4double &t1) {
+  if (d == 0.) {
+    return std::abs(p) <= h;
+  }
+  G4double t_enter = (-h - p) / d;
+  G4double t_exit = (h - p) / d;
+  if (t_enter > t_exit) {
+    std::swap(t_enter, t_exit);
+  }
+  t0 = std::max(t0, t_enter);
+  t1 = std::min(t1, t_exit);
+  return t0 < t1;
+}
+
+// Appends the parameters at which the segment p + t * d, t0 < t < t1, crosses the n - 1 inner planes of n slices of -h <= x <= h
+static inline void AddPlaneCrossings(G4double p, G4double d, G4double h, G4int n, G4double t0, G4double t1, std::vector<G4double> &crossings) {
+  if (n < 2 || d == 0.) {
+    return;
+  }
+  const G4double width = 2. * h / n;
+  const G4double x0 = (p + t0 * d + h) / width;
+  const G4double x1 = (p + t1 * d + h) / width;
+  const G4int k_min = std::max((G4int)std::floor(std::min(x0, x1)) + 1, 1);
+  const G4int k_max = std::min((G4int)std::ceil(std::max(x0, x1)) - 1, n - 1);
+  for (G4int k = k_min; k <= k_max; ++k) {
+    crossings.push_back((-h + k * width - p) / d);
+  }
+}
+
+static inline G4int CellIndex(G4double x, G4double h, G4int n) {
+  return std::min(std::max((G4int)std::floor((x + h) / (2. * h) * n), 0), n - 1);
+}
+
+void FluxScoring::ScoreBox(const FluxScoring_Scorer &scorer, std::unordered_map<G4int, G4double> &event_bins, G4int bin_offset, const G4ThreeVector &p0, const G4ThreeVector &p1, G4double weight) {
+  const G4ThreeVector p = p0 - scorer.center;
+  const G4ThreeVector d = p1 - p0;
+  const G4ThreeVector &h = scorer.half_lengths;
+  G4double t0 = 0., t1 = 1.;
+  if (!ClipToSlab(p.x(), d.x(), h.x(), t0, t1) || !ClipToSlab(p.y(), d.y(), h.y(), t0, t1) || !ClipToSlab(p.z(), d.z(), h.z(), t0, t1)) {
+    return;
+  }
+
+  std::vector<G4double> &crossings = thread_event->crossings;
+  crossings.clear();
+  crossings.push_back(t0);
+  AddPlaneCrossings(p.x(), d.x(), h.x(), scorer.n_x, t0, t1, crossings);
+  AddPlaneCrossings(p.y(), d.y(), h.y(), scorer.n_y, t0, t1, crossings);
+  AddPlaneCrossings(p.z(), d.z(), h.z(), scorer.n_z, t0, t1, crossings);
+  crossings.push_back(t1);
+  std::sort(crossings.begin() + 1, crossings.end() - 1);
+
+  const G4double length = d.mag();
+  const G4int bins_per_cell = scorer.n_energy * scorer.n_cos;
+  for (size_t i = 1; i < crossings.size(); ++i) {
+    if (crossings[i] <= crossings[i - 1]) {
+      continue;
+    }
+    const G4ThreeVector middle = p + 0.5 * (crossings[i - 1] + crossings[i]) * d;
+    const G4int cell = CellIndex(middle.x(), h.x(), scorer.n_x) + scorer.n_x * (CellIndex(middle.y(), h.y(), scorer.n_y) + scorer.n_y * CellIndex(middle.z(), h.z(), scorer.n_z));
+    event_bins[cell * bins_per_cell + bin_offset] += weight * (crossings[i] - crossings[i - 1]) * length / scorer.cell_volumes[(size_t)cell];
+  }
+}
+
+void FluxScoring::ScoreCylinder(const FluxScoring_Scorer &scorer, std::unordered_map<G4int, G4double> &event_bins, G4int bin_offset, const G4ThreeVector &p0, const G4ThreeVector &p1, G4double weight) {
+  const G4ThreeVector p = p0 - scorer.center;
+  const G4ThreeVector d = p1 - p0;
+  const G4double radius = scorer.half_lengths.x();
+  const G4double half_length = scorer.half_lengths.z();
+  G4double t0 = 0., t1 = 1.;
+  if (!ClipToSlab(p.z(), d.z(), half_length, t0, t1)) {
+    return;
+  }
+
+  // r^2(t) = a * t^2 + b * t + c
+  const G4double a = d.x() * d.x() + d.y() * d.y();
+  const G4double b = 2. * (p.x() * d.x() + p.y() * d.y());
+  const G4double c = p.x() * p.x() + p.y() * p.y();
+  if (a == 0.) {
+    if (c > radius * radius) {
+      return;
+    }
+  } else {
+    const G4double discriminant = b * b - 4. * a * (c - radius * radius);
+    if (discriminant <= 0.) {
+      return;
+    }
+    t0 = std::max(t0, (-b - std::sqrt(discriminant)) / (2. * a));
+    t1 = std::min(t1, (-b + std::sqrt(discriminant)) / (2. * a));
+    if (t0 >= t1) {
+      return;
+    }
+  }
+
+  std::vector<G4double> &crossings = thread_event->crossings;
+  crossings.clear();
+  crossings.push_back(t0);
+  AddPlaneCrossings(p.z(), d.z(), half_length, scorer.n_z, t0, t1, crossings);
+  if (scorer.n_x > 1 && a > 0.) {
+    // Only the rings between the smallest and the largest radius along the segment are crossed
+    const G4double t_closest = std::min(std::max(-b / (2. * a), t0), t1);
+    const G4double r2_min = (a * t_closest + b) * t_closest + c;
+    const G4double r2_max = std::max((a * t0 + b) * t0 + c, (a * t1 + b) * t1 + c);
+    const G4double ring_width = radius / scorer.n_x;
+    const G4int k_min = std::max((G4int)std::floor(std::sqrt(r2_min) / ring_width) + 1, 1);
+    const G4int k_max = std::min((G4int)std::ceil(std::sqrt(r2_max) / ring_width) - 1, scorer.n_x - 1);
+    for (G4int k = k_min; k <= k_max; ++k) {
+      const G4double r_k = k * ring_width;
+      const G4double discriminant = b * b - 4. * a * (c - r_k * r_k);
+      if (discriminant <= 0.) {
+        continue;
+      }
+      for (G4double sign : {-1., 1.}) {
+        const G4double t = (-b + sign * std::sqrt(discriminant)) / (2. * a);
+        if (t > t0 && t < t1) {
+          crossings.push_back(t);
+        }
+      }
+    }
+  }
+  crossings.push_back(t1);
+  std::sort(crossings.begin() + 1, crossings.end() - 1);
+
+  const G4double length = d.mag();
+  const G4int bins_per_cell = scorer.n_energy * scorer.n_cos;
+  for (size_t i = 1; i < crossings.size(); ++i) {
+    if (crossings[i] <= crossings[i - 1]) {
+      continue;
+    }
+    const G4ThreeVector middle = p + 0.5 * (crossings[i - 1] + crossings[i]) * d;
+    const G4int cell = std::min((G4int)(middle.perp() / radius * scorer.n_x), scorer.n_x - 1) + scorer.n_x * CellIndex(middle.z(), half_length, scorer.n_z);
+    event_bins[cell * bins_per_cell + bin_offset] += weight * (crossings[i] - crossings[i - 1]) * length / scorer.cell_volumes[(size_t)cell];
+  }
+}
+
+void FluxScoring::Score(const G4Step *step) {
+  const G4StepPoint *pre_step_point = step->GetPreStepPoint();
+  // The fluence is given in 1/cm2
+  const G4double weight = pre_step_point->GetWeight() * cm2;
+  const G4double energy = pre_step_point->GetKineticEnergy();
+  if (!thread_event || weight <= 0. || step->GetStepLength() <= 0.) {
+    return;
+  }
+  const G4ParticleDefinition *particle = step->GetTrack()->GetParticleDefinition();
+  const G4double cos_theta = pre_step_point->GetMomentumDirection().z();
+
+  for (size_t i = 0; i < scorers.size(); ++i) {
+    const FluxScoring_Scorer &scorer = scorers[i];
+    if (scorer.histogram_id < 0 || (scorer.particle && particle != scorer.particle) || energy < scorer.energy_min || energy >= scorer.energy_max) {
+      continue;
+    }
+    const G4int energy_bin = std::min((G4int)((energy - scorer.energy_min) / (scorer.energy_max - scorer.energy_min) * scorer.n_energy), scorer.n_energy - 1);
+    const G4int cos_bin = std::min(std::max((G4int)((cos_theta + 1.) * 0.5 * scorer.n_cos), 0), scorer.n_cos - 1);
+    const G4int bin_offset = energy_bin * scorer.n_cos + cos_bin;
+
+    if (scorer.type == FLUX_BOX) {
+      ScoreBox(scorer, thread_event->bins[i], bin_offset, pre_step_point->GetPosition(), step->GetPostStepPoint()->GetPosition(), weight);
+    } else if (scorer.type == FLUX_CYLINDER) {
+      ScoreCylinder(scorer, thread_event->bins[i], bin_offset, pre_step_point->GetPosition(), step->GetPostStepPoint()->GetPosition(), weight);
+    } else {
+      auto cell = scorer.volume_cells.find(pre_step_point->GetPhysicalVolume());
+      if (cell != scorer.volume_cells.end()) {
+        thread_event->bins[i][cell->second * scorer.n_energy * scorer.n_cos + bin_offset] += weight * step->GetStepLength() / scorer.cell_volumes[(size_t)cell->second];
+      }
+    }
+  }
+}
+
+void FluxScoring::EndOfEvent() {
+  if (!thread_event || !IsActive()) {
+    return;
+  }
+  G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
+  for (size_t i = 0; i < scorers.size() && i < thread_event->bins.size(); ++i) {
+    const FluxScoring_Scorer &scorer = scorers[i];
+    const G4int bins_per_cell = scorer.n_energy * scorer.n_cos;
+    const G4double energy_bin_width = (scorer.energy_max - scorer.energy_min) / scorer.n_energy;
+    for (auto &bin : thread_event->bins[i]) {
+      const G4int energy_bin = (bin.first % bins_per_cell) / scorer.n_cos;
+      const G4int cos_bin = bin.first % scorer.n_cos;
+      analysisManager->FillH3(scorer.histogram_id, bin.first / bins_per_cell, (scorer.energy_min + (energy_bin + 0.5) * energy_bin_width) / MeV, -1. + (cos_bin + 0.5) * 2. / scorer.n_cos, bin.second);
+    }
+    thread_event->bins[i].clear();
+  }
+}
+
+void FluxScoring::PrintInfo() {
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  if (!IsActive()) {
+    G4cout << "FluxScoring: No scorers defined" << G4endl;
+  } else {
+    G4cout << "FluxScoring: The fluence is scored with the following scorers:" << G4endl;
+    G4cout << "\tname\ttype\t\tcells\t\tparticle\tenergy bins\tcos bins" << G4endl;
+    for (auto &scorer : scorers) {
+      G4cout << "\t" << scorer.name << "\t";
+      if (scorer.type == FLUX_BOX) {
+        G4cout << "box\t\t" << scorer.n_x << " x " << scorer.n_y << " x " << scorer.n_z;
+      } else if (scorer.type == FLUX_CYLINDER) {
+        G4cout << "cylinder\t" << scorer.n_x << " x " << scorer.n_z;
+      } else {
+        G4cout << "volumes\t\t" << scorer.n_x;
+      }
+      G4cout << "\t\t" << scorer.particle_name << "\t\t" << scorer.n_energy << " (" << scorer.energy_min / MeV << " - " << scorer.energy_max / MeV << " MeV)\t" << scorer.n_cos << G4endl;
+    }
+  }
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
@@ -0,0 +1,187 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4UIparameter.hh"
+
+#include "FluxScoring.hh"
+#include "FluxScoringMessenger.hh"
+
+// Appends the optional parameters X, Y, Z and UNIT of the position of a mesh
+static void SetCenterParameters(G4UIcommand *command) {
+  for (auto coordinate : {"x", "y", "z"}) {
+    G4UIparameter *parameter = new G4UIparameter(coordinate, 'd', true);
+    parameter->SetDefaultValue("0");
+    command->SetParameter(parameter);
+  }
+  G4UIparameter *unitParameter = new G4UIparameter("unit", 's', true);
+  unitParameter->SetDefaultValue("mm");
+  command->SetParameter(unitParameter);
+}
+
+FluxScoringMessenger::FluxScoringMessenger() {
+  fluxDirectory = new G4UIdirectory("/utr/flux/");
+  fluxDirectory->SetGuidance("Scoring of the particle fluence with track-length estimators, written to the histograms 'flux_<SCORER>_<CELL>' of the master output file.");
+
+  boxCmd = new G4UIcommand("/utr/flux/box", this);
+  boxCmd->SetGuidance("Define a cartesian mesh of NX x NY x NZ cells around the center (x, y, z) in world coordinates, e.g. '/utr/flux/box target 10 10 50 1 1 100 0 0 0 mm'.");
+  boxCmd->SetGuidance("The index of the cell (ix, iy, iz) is ix + NX * (iy + NY * iz).");
+  boxCmd->SetParameter(new G4UIparameter("name", 's', false));
+  boxCmd->SetParameter(new G4UIparameter("halfX", 'd', false));
+  boxCmd->SetParameter(new G4UIparameter("halfY", 'd', false));
+  boxCmd->SetParameter(new G4UIparameter("halfZ", 'd', false));
+  boxCmd->SetParameter(new G4UIparameter("nx", 'i', false));
+  boxCmd->SetParameter(new G4UIparameter("ny", 'i', false));
+  boxCmd->SetParameter(new G4UIparameter("nz", 'i', false));
+  SetCenterParameters(boxCmd);
+  boxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  cylinderCmd = new G4UIcommand("/utr/flux/cylinder", this);
+  cylinderCmd->SetGuidance("Define a mesh of NR rings times NZ slices of a cylinder parallel to the z axis around the center (x, y, z) in world coordinates, e.g. '/utr/flux/cylinder target 10 50 1 100 0 0 0 mm'.");
+  cylinderCmd->SetGuidance("The index of the cell (ir, iz) is ir + NR * iz.");
+  cylinderCmd->SetParameter(new G4UIparameter("name", 's', false));
+  cylinderCmd->SetParameter(new G4UIparameter("radius", 'd', false));
+  cylinderCmd->SetParameter(new G4UIparameter("halfZ", 'd', false));
+  cylinderCmd->SetParameter(new G4UIparameter("nr", 'i', false));
+  cylinderCmd->SetParameter(new G4UIparameter("nz", 'i', false));
+  SetCenterParameters(cylinderCmd);
+  cylinderCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  volumeCmd = new G4UIcommand("/utr/flux/volume", this);
+  volumeCmd->SetGuidance("Define a scorer with one cell for each of the given physical volumes, e.g. '/utr/flux/volume targets Target_Ni64 Target_Nd150'.");
+  volumeCmd->SetParameter(new G4UIparameter("name", 's', false));
+  volumeCmd->SetParameter(new G4UIparameter("physicalVolumes", 's', false));
+  volumeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  energyBinsCmd = new G4UIcommand("/utr/flux/energyBins", this);
+  energyBinsCmd->SetGuidance("Set the binning of the kinetic energy of a scorer (default: 1000 bins from 0 to 10 MeV).");
+  energyBinsCmd->SetParameter(new G4UIparameter("name", 's', false));
+  energyBinsCmd->SetParameter(new G4UIparameter("nbins", 'i', false));
+  energyBinsCmd->SetParameter(new G4UIparameter("emin", 'd', false));
+  energyBinsCmd->SetParameter(new G4UIparameter("emax", 'd', false));
+  G4UIparameter *energyUnitParameter = new G4UIparameter("unit", 's', true);
+  energyUnitParameter->SetDefaultValue("MeV");
+  energyBinsCmd->SetParameter(energyUnitParameter);
+  energyBinsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  cosBinsCmd = new G4UIcommand("/utr/flux/cosBins", this);
+  cosBinsCmd->SetGuidance("Set the number of bins of the direction cosine with respect to the z axis from -1 to 1 of a scorer (default: 1).");
+  cosBinsCmd->SetParameter(new G4UIparameter("name", 's', false));
+  cosBinsCmd->SetParameter(new G4UIparameter("nbins", 'i', false));
+  cosBinsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  particleCmd = new G4UIcommand("/utr/flux/particle", this);
+  particleCmd->SetGuidance("Set the particle whose fluence is scored, or 'all' (default: gamma).");
+  particleCmd->SetParameter(new G4UIparameter("name", 's', false));
+  particleCmd->SetParameter(new G4UIparameter("particle", 's', false));
+  particleCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  clearCmd = new G4UIcommand("/utr/flux/clear", this);
+  clearCmd->SetGuidance("Remove all scorers.");
+  clearCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  printCmd = new G4UIcommand("/utr/flux/print", this);
+  printCmd->SetGuidance("Print the current scorers.");
+}
+
+FluxScoringMessenger::~FluxScoringMessenger() {
+  delete boxCmd;
+  delete cylinderCmd;
+  delete volumeCmd;
+  delete energyBinsCmd;
+  delete cosBinsCmd;
+  delete particleCmd;
+  delete clearCmd;
+  delete printCmd;
+  delete fluxDirectory;
+}
+
+void FluxScoringMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+  G4String name;
+  parameters >> name;
+
+  if (command == boxCmd) {
+    G4double half_x, half_y, half_z, x, y, z;
+    G4int nx, ny, nz;
+    G4String unit;
+    parameters >> half_x >> half_y >> half_z >> nx >> ny >> nz >> x >> y >> z >> unit;
+    const G4double length_unit = G4UIcommand::ValueOf(unit);
+    if (half_x <= 0. || half_y <= 0. || half_z <= 0. || nx < 1 || ny < 1 || nz < 1) {
+      G4cerr << "Error! The dimensions and numbers of cells of the mesh '" << name << "' have to be positive!" << G4endl;
+    } else if (!FluxScoring::AddBox(name, G4ThreeVector(half_x, half_y, half_z) * length_unit, nx, ny, nz, G4ThreeVector(x, y, z) * length_unit)) {
+      G4cerr << "Error! A scorer with the name '" << name << "' exists already!" << G4endl;
+    }
+  } else if (command == cylinderCmd) {
+    G4double radius, half_z, x, y, z;
+    G4int nr, nz;
+    G4String unit;
+    parameters >> radius >> half_z >> nr >> nz >> x >> y >> z >> unit;
+    const G4double length_unit = G4UIcommand::ValueOf(unit);
+    if (radius <= 0. || half_z <= 0. || nr < 1 || nz < 1) {
+      G4cerr << "Error! The dimensions and numbers of cells of the mesh '" << name << "' have to be positive!" << G4endl;
+    } else if (!FluxScoring::AddCylinder(name, radius * length_unit, half_z * length_unit, nr, nz, G4ThreeVector(x, y, z) * length_unit)) {
+      G4cerr << "Error! A scorer with the name '" << name << "' exists already!" << G4endl;
+    }
+  } else if (command == volumeCmd) {
+    std::vector<G4String> volume_names;
+    for (G4String volume_name; parameters >> volume_name;) {
+      volume_names.push_back(volume_name);
+    }
+    if (!FluxScoring::AddVolumes(name, volume_names)) {
+      G4cerr << "Error! A scorer with the name '" << name << "' exists already!" << G4endl;
+    }
+  } else if (command == energyBinsCmd) {
+    G4int nbins;
+    G4double emin, emax;
+    G4String unit;
+    parameters >> nbins >> emin >> emax >> unit;
+    if (nbins < 1 || emax <= emin) {
+      G4cerr << "Error! Invalid energy binning '" << newValues << "'!" << G4endl;
+    } else if (!FluxScoring::SetEnergyBinning(name, nbins, emin * G4UIcommand::ValueOf(unit), emax * G4UIcommand::ValueOf(unit))) {
+      G4cerr << "Error! Unknown scorer '" << name << "'!" << G4endl;
+    }
+  } else if (command == cosBinsCmd) {
+    G4int nbins;
+    parameters >> nbins;
+    if (nbins < 1) {
+      G4cerr << "Error! The number of bins has to be positive!" << G4endl;
+    } else if (!FluxScoring::SetCosBinning(name, nbins)) {
+      G4cerr << "Error! Unknown scorer '" << name << "'!" << G4endl;
+    }
+  } else if (command == particleCmd) {
+    G4String particle_name;
+    parameters >> particle_name;
+    if (!FluxScoring::SetParticle(name, particle_name)) {
+      G4cerr << "Error! Unknown scorer '" << name << "'!" << G4endl;
+    }
+  } else if (command == clearCmd) {
+    FluxScoring::Clear();
+  } else if (command == printCmd) {
+    FluxScoring::PrintInfo();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String FluxScoringMessenger::GetCurrentValue(G4UIcommand *) {
+  return "";
+}
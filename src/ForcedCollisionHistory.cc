@@ -0,0 +1,82 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "G4BiasingProcessInterface.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+
+#include "ForcedCollisionHistory.hh"
+
+// Last history index which was assigned in the current event of the calling thread
+static G4ThreadLocal G4int last_history = 0;
+
+G4bool ForcedCollisionHistory::active = false;
+
+G4int ForcedCollisionHistory::GetHistory(const G4Track *track) {
+  if (!active) {
+    return 0;
+  }
+  auto information = dynamic_cast<ForcedCollisionHistory_TrackInformation *>(track->GetUserInformation());
+  return information ? information->GetHistory() : 0;
+}
+
+void ForcedCollisionHistory::BeginOfEvent() {
+  last_history = 0;
+}
+
+// The clones are created by the biasing process interface without a wrapped physics process,
+// all other secondaries by the (wrapped) physics processes
+G4bool ForcedCollisionHistory::IsClone(const G4Track *secondary) {
+  auto creator = dynamic_cast<const G4BiasingProcessInterface *>(secondary->GetCreatorProcess());
+  return creator && !creator->GetWrappedProcess();
+}
+
+// The user information is not part of the physical state of a track, so it can be set on const tracks
+void ForcedCollisionHistory::SetHistory(const G4Track *track, G4int history) {
+  auto information = dynamic_cast<ForcedCollisionHistory_TrackInformation *>(track->GetUserInformation());
+  if (information) {
+    information->SetHistory(history);
+  } else if (history != 0) {
+    track->SetUserInformation(new ForcedCollisionHistory_TrackInformation(history));
+  }
+}
+
+void ForcedCollisionHistory::Step(const G4Step *step) {
+  const std::vector<const G4Track *> *secondaries = step->GetSecondaryInCurrentStep();
+  if (!secondaries || secondaries->empty()) {
+    return;
+  }
+
+  const G4Track *track = step->GetTrack();
+  const G4int history = GetHistory(track);
+  G4bool split = false;
+  for (auto secondary : *secondaries) {
+    if (IsClone(secondary)) {
+      SetHistory(secondary, ++last_history);
+      split = true;
+    } else {
+      SetHistory(secondary, history);
+    }
+  }
+  // The steps of the original track up to here remain in the old history
+  if (split) {
+    SetHistory(track, ++last_history);
+  }
+}
@@ -0,0 +1,102 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <set>
+#include <vector>
+
+#include "G4BOptrForceCollision.hh"
+#include "G4BiasingHelper.hh"
+#include "G4BiasingProcessInterface.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4Threading.hh"
+
+#include "ForcedCollisionHistory.hh"
+#include "ForcedCollisionPhysics.hh"
+
+ForcedCollisionPhysics::ForcedCollisionPhysics() : G4VPhysicsConstructor("ForcedCollisionPhysics") {}
+
+ForcedCollisionPhysics::~ForcedCollisionPhysics() {}
+
+void ForcedCollisionPhysics::WrapProcesses(G4ParticleDefinition *particle) const {
+  G4ProcessManager *processManager = particle->GetProcessManager();
+  G4ProcessVector *processes = processManager->GetProcessList();
+
+  // Wrapping modifies the process list, so collect the names first
+  std::vector<G4String> process_names;
+  for (G4int i = 0; i < (G4int)processes->size(); ++i) {
+    G4VProcess *process = (*processes)[i];
+    if ((process->GetProcessType() == fElectromagnetic || process->GetProcessType() == fHadronic) && !dynamic_cast<G4BiasingProcessInterface *>(process)) {
+      process_names.push_back(process->GetProcessName());
+    }
+  }
+  for (auto &process_name : process_names) {
+    G4BiasingHelper::ActivatePhysicsBiasing(processManager, process_name);
+  }
+  // Needed for the cloning and the free flight through the volume
+  G4BiasingHelper::ActivateNonPhysicsBiasing(processManager);
+}
+
+void ForcedCollisionPhysics::ConstructProcess() {
+  G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
+
+  std::set<G4String> particle_names;
+  for (auto &volume_particle : volume_particles) {
+    particle_names.insert(volume_particle.second);
+  }
+  for (auto &particle_name : particle_names) {
+    G4ParticleDefinition *particle = particleTable->FindParticle(particle_name);
+    if (!particle) {
+      G4cerr << "ForcedCollisionPhysics: Error! Particle '" << particle_name << "' not found." << G4endl;
+      continue;
+    }
+    WrapProcesses(particle);
+  }
+
+  // The biasing operators are thread-local, so they have to be attached on each thread
+  G4LogicalVolume *logical_volume;
+  for (auto &volume_particle : volume_particles) {
+    logical_volume = G4LogicalVolumeStore::GetInstance()->GetVolume(volume_particle.first, false);
+    if (!logical_volume) {
+      G4cerr << "ForcedCollisionPhysics: Error! Logical volume '" << volume_particle.first << "' not found." << G4endl;
+      continue;
+    }
+    if (!particleTable->FindParticle(volume_particle.second)) {
+      continue;
+    }
+    G4BOptrForceCollision *forceCollision = new G4BOptrForceCollision(volume_particle.second, "ForceCollision_" + volume_particle.first);
+    forceCollision->AttachTo(logical_volume);
+    // The master constructs the processes before the worker threads
+    if (G4Threading::IsMasterThread()) {
+      ForcedCollisionHistory::SetActive(true);
+    }
+  }
+}
+
+void ForcedCollisionPhysics::PrintInfo() const { StreamInfo(G4cout); }
+
+void ForcedCollisionPhysics::StreamInfo(std::ostream &os) const {
+  for (auto &volume_particle : volume_particles) {
+    os << "\tForced collisions of " << volume_particle.second << " in '" << volume_particle.first << "'" << G4endl;
+  }
+}
@@ -0,0 +1,132 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <sstream>
+#include <exception>
+#include <vector>
+
+#include "G4FileUtilities.hh"
+#include "G4RunManager.hh"
+
+#include "GeometryLoader.hh"
+#include "utrConfig.h"
+
+#ifdef GEOMETRY_PLUGINS
+#include <dlfcn.h>
+#endif
+
+G4String GeometryLoader::geometryName = "";
+utrGetMaxSensitiveDetectorID_t GeometryLoader::getMaxSensitiveDetectorID = nullptr;
+
+G4String GeometryLoader::FindLibrary(const G4String &geometry) {
+  G4FileUtilities fileUtilities;
+
+  // Path to a library
+  if (fileUtilities.FileExists(geometry)) {
+    return geometry;
+  }
+
+  // Name of a geometry, search in all known directories
+  std::vector<std::string> directories;
+  std::string directory;
+  if (getenv("UTR_GEOMETRY_PATH")) {
+    std::istringstream userPath(getenv("UTR_GEOMETRY_PATH"));
+    while (std::getline(userPath, directory, ':')) {
+      directories.push_back(directory);
+    }
+  }
+  std::istringstream defaultPath(geometry_plugin_path);
+  while (std::getline(defaultPath, directory, ':')) {
+    directories.push_back(directory);
+  }
+
+  for (auto &dir : directories) {
+    if (dir.empty()) {
+      continue;
+    }
+    G4String library = dir + "/" + geometry + ".so";
+    if (fileUtilities.FileExists(library)) {
+      return library;
+    }
+  }
+
+  G4cerr << "ERROR: Could not find a library for the geometry '" << geometry << "'. Searched in:" << G4endl;
+  for (auto &dir : directories) {
+    G4cerr << "\t" << dir << G4endl;
+  }
+  G4cerr << "Aborting..." << G4endl;
+  throw std::exception();
+}
+
+G4VUserDetectorConstruction *GeometryLoader::Create(const G4String &geometry) {
+#ifdef GEOMETRY_PLUGINS
+  const G4String library = FindLibrary(geometry);
+  G4cout << "Loading geometry '" << geometry << "' from " << library << " ..." << G4endl;
+
+  // The libraries are never closed, because Geant4 keeps references to their objects (solids, SDs, ...) until the end of the program
+  void *handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    G4cerr << "ERROR: Could not load geometry library '" << library << "': " << dlerror() << ". Aborting..." << G4endl;
+    throw std::exception();
+  }
+
+  auto pluginVersion = (utrDetectorConstructionPluginVersion_t)dlsym(handle, "utrDetectorConstructionPluginVersion");
+  auto createDetectorConstruction = (utrCreateDetectorConstruction_t)dlsym(handle, "utrCreateDetectorConstruction");
+  auto maxSensitiveDetectorID = (utrGetMaxSensitiveDetectorID_t)dlsym(handle, "utrGetMaxSensitiveDetectorID");
+  if (!pluginVersion || !createDetectorConstruction || !maxSensitiveDetectorID) {
+    G4cerr << "ERROR: '" << library << "' is not a utr geometry library. Aborting..." << G4endl;
+    throw std::exception();
+  }
+  if (pluginVersion() != UTR_DETECTOR_CONSTRUCTION_PLUGIN_VERSION) {
+    G4cerr << "ERROR: Geometry library '" << library << "' was built for interface version " << pluginVersion() << ", but utr requires version " << UTR_DETECTOR_CONSTRUCTION_PLUGIN_VERSION << ". Rebuild the geometry. Aborting..." << G4endl;
+    throw std::exception();
+  }
+
+  geometryName = geometry;
+  getMaxSensitiveDetectorID = maxSensitiveDetectorID;
+  return createDetectorConstruction();
+#else
+  if (geometry != "" && geometry != default_geometry) {
+    G4cerr << "ERROR: utr was built with the geometry '" << default_geometry << "' only, but '" << geometry << "' was requested. Select it with the CAMPAIGN and DETECTOR_CONSTRUCTION build options, or build utr with the GEOMETRY_PLUGINS option. Aborting..." << G4endl;
+    throw std::exception();
+  }
+  geometryName = default_geometry;
+  getMaxSensitiveDetectorID = &utrGetMaxSensitiveDetectorID;
+  return utrCreateDetectorConstruction();
+#endif
+}
+
+void GeometryLoader::SetGeometry(const G4String &geometry) {
+  if (geometry == geometryName) {
+    return;
+  }
+  G4RunManager *runManager = G4RunManager::GetRunManager();
+  const G4VUserDetectorConstruction *previousDetectorConstruction = runManager->GetUserDetectorConstruction();
+  runManager->SetUserInitialization(Create(geometry));
+  delete previousDetectorConstruction;
+}
+
+G4int GeometryLoader::GetMaxSensitiveDetectorID() {
+  if (!getMaxSensitiveDetectorID) {
+    return -1;
+  }
+  return getMaxSensitiveDetectorID(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+}
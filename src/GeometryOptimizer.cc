@@ -0,0 +1,296 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "G4Box.hh"
+#include "G4GeometryManager.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PVPlacement.hh"
+#include "G4SmartVoxelHeader.hh"
+#include "G4StateManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4UImanager.hh"
+#include "G4VSolid.hh"
+#include "G4VisAttributes.hh"
+#include "G4ios.hh"
+
+#include "GeometryOptimizer.hh"
+
+G4bool GeometryOptimizer::envelopes_active = false;
+G4double GeometryOptimizer::envelope_gap = 5. * cm;
+std::map<G4String, G4double> GeometryOptimizer::smartless_settings = std::map<G4String, G4double>();
+
+// Axis-aligned bounding box in the coordinate system of the mother volume
+struct Bounding_Box {
+  G4ThreeVector min;
+  G4ThreeVector max;
+};
+
+static Bounding_Box Get_Bounding_Box(const G4VPhysicalVolume *physical_volume) {
+  G4ThreeVector local_min, local_max;
+  physical_volume->GetLogicalVolume()->GetSolid()->BoundingLimits(local_min, local_max);
+
+  const G4RotationMatrix rotation = physical_volume->GetObjectRotationValue();
+  const G4ThreeVector translation = physical_volume->GetObjectTranslation();
+  const G4double infinity = std::numeric_limits<G4double>::infinity();
+  Bounding_Box box{G4ThreeVector(infinity, infinity, infinity), G4ThreeVector(-infinity, -infinity, -infinity)};
+
+  // The box around the rotated corners of the local bounding box contains the solid
+  for (unsigned int i = 0; i < 8; ++i) {
+    const G4ThreeVector corner = rotation * G4ThreeVector(i & 1 ? local_max.x() : local_min.x(), i & 2 ? local_max.y() : local_min.y(), i & 4 ? local_max.z() : local_min.z()) + translation;
+    for (int axis = 0; axis < 3; ++axis) {
+      box.min[axis] = std::min(box.min[axis], corner[axis]);
+      box.max[axis] = std::max(box.max[axis], corner[axis]);
+    }
+  }
+
+  return box;
+}
+
+static Bounding_Box Union(const Bounding_Box &a, const Bounding_Box &b) {
+  Bounding_Box box;
+  for (int axis = 0; axis < 3; ++axis) {
+    box.min[axis] = std::min(a.min[axis], b.min[axis]);
+    box.max[axis] = std::max(a.max[axis], b.max[axis]);
+  }
+  return box;
+}
+
+// Distance between the closest points of two boxes, 0 if they touch or intersect
+static G4double Gap(const Bounding_Box &a, const Bounding_Box &b) {
+  G4double gap2 = 0.;
+  for (int axis = 0; axis < 3; ++axis) {
+    const G4double gap = std::max({0., b.min[axis] - a.max[axis], a.min[axis] - b.max[axis]});
+    gap2 += gap * gap;
+  }
+  return sqrt(gap2);
+}
+
+// Boxes which only touch each other do not intersect
+static G4bool Intersect(const Bounding_Box &a, const Bounding_Box &b, const G4double tolerance) {
+  for (int axis = 0; axis < 3; ++axis) {
+    if (a.max[axis] <= b.min[axis] + tolerance || b.max[axis] <= a.min[axis] + tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static G4bool Contains(const Bounding_Box &outer, const Bounding_Box &inner, const G4double tolerance) {
+  for (int axis = 0; axis < 3; ++axis) {
+    if (inner.min[axis] < outer.min[axis] - tolerance || inner.max[axis] > outer.max[axis] + tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void GeometryOptimizer::SetSmartless(const G4String &logical_volume_name, G4double smartless) {
+  smartless_settings[logical_volume_name] = smartless;
+
+  if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_Idle && ApplySmartless(logical_volume_name, smartless)) {
+    // The voxels are rebuilt before the next run
+    G4UImanager::GetUIpointer()->ApplyCommand("/run/geometryModified");
+  }
+}
+
+G4bool GeometryOptimizer::ApplySmartless(const G4String &logical_volume_name, G4double smartless) {
+  G4LogicalVolume *logical_volume = G4LogicalVolumeStore::GetInstance()->GetVolume(logical_volume_name, false);
+  if (!logical_volume) {
+    G4cout << "WARNING: GeometryOptimizer: Logical volume '" << logical_volume_name << "' does not exist, its smartless parameter is not set." << G4endl;
+    return false;
+  }
+  logical_volume->SetSmartless(smartless);
+  return true;
+}
+
+void GeometryOptimizer::Optimize(G4VPhysicalVolume *world) {
+  if (envelopes_active) {
+    BuildEnvelopes(world->GetLogicalVolume());
+  }
+
+  for (auto &setting : smartless_settings) {
+    ApplySmartless(setting.first, setting.second);
+  }
+}
+
+void GeometryOptimizer::BuildEnvelopes(G4LogicalVolume *mother_logical) {
+  const G4Box *mother_solid = dynamic_cast<const G4Box *>(mother_logical->GetSolid());
+  const size_t n_daughters = mother_logical->GetNoDaughters();
+  if (!mother_solid || n_daughters < 2) {
+    return;
+  }
+  // Replicas and parameterised volumes fill their mother and can not be moved into an envelope
+  for (size_t i = 0; i < n_daughters; ++i) {
+    if (mother_logical->GetDaughter((G4int)i)->IsReplicated()) {
+      G4cout << "GeometryOptimizer: Warning! '" << mother_logical->GetName() << "' contains the replicated volume '" << mother_logical->GetDaughter((G4int)i)->GetName() << "', no envelopes are built." << G4endl;
+      return;
+    }
+  }
+  const G4double tolerance = G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+  const G4ThreeVector mother_half_lengths(mother_solid->GetXHalfLength(), mother_solid->GetYHalfLength(), mother_solid->GetZHalfLength());
+  const Bounding_Box mother_box{-mother_half_lengths, mother_half_lengths};
+
+  // Start with one group per daughter. Merged groups are appended and the original ones
+  // deactivated, so every pair in the queue refers to two fixed boxes.
+  std::vector<G4VPhysicalVolume *> daughters(n_daughters);
+  std::vector<Bounding_Box> boxes;
+  std::vector<std::vector<size_t>> members;
+  std::vector<G4bool> active;
+  for (size_t i = 0; i < n_daughters; ++i) {
+    daughters[i] = mother_logical->GetDaughter((G4int)i);
+    boxes.push_back(Get_Bounding_Box(daughters[i]));
+    members.push_back(std::vector<size_t>(1, i));
+    active.push_back(true);
+  }
+
+  typedef std::tuple<G4double, size_t, size_t> Pair;
+  std::priority_queue<Pair, std::vector<Pair>, std::greater<Pair>> pairs;
+  for (size_t i = 0; i < n_daughters; ++i) {
+    for (size_t j = i + 1; j < n_daughters; ++j) {
+      const G4double gap = Gap(boxes[i], boxes[j]);
+      if (gap <= envelope_gap) {
+        pairs.push(Pair(gap, i, j));
+      }
+    }
+  }
+
+  while (!pairs.empty()) {
+    const size_t a = std::get<1>(pairs.top());
+    const size_t b = std::get<2>(pairs.top());
+    pairs.pop();
+    if (!active[a] || !active[b]) {
+      continue;
+    }
+
+    // Groups which lie completely inside the merged box are absorbed, for example the third
+    // side of a U-shaped arrangement of pieces
+    const Bounding_Box merged = Union(boxes[a], boxes[b]);
+    G4bool valid = Contains(mother_box, merged, tolerance);
+    std::vector<size_t> merged_groups = {a, b};
+    for (size_t i = 0; valid && i < boxes.size(); ++i) {
+      if (active[i] && i != a && i != b && Intersect(merged, boxes[i], tolerance)) {
+        if (Contains(merged, boxes[i], tolerance)) {
+          merged_groups.push_back(i);
+        } else {
+          valid = false;
+        }
+      }
+    }
+    if (!valid) {
+      continue;
+    }
+
+    const size_t c = boxes.size();
+    boxes.push_back(merged);
+    members.push_back(std::vector<size_t>());
+    active.push_back(true);
+    for (auto group : merged_groups) {
+      members[c].insert(members[c].end(), members[group].begin(), members[group].end());
+      active[group] = false;
+    }
+    for (size_t i = 0; i < c; ++i) {
+      if (active[i]) {
+        const G4double gap = Gap(boxes[c], boxes[i]);
+        if (gap <= envelope_gap) {
+          pairs.push(Pair(gap, std::min(i, c), std::max(i, c)));
+        }
+      }
+    }
+  }
+
+  // Move the daughters of each group into an envelope
+  G4int n_envelopes = 0;
+  size_t n_wrapped = 0;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    if (!active[i] || members[i].size() < 2) {
+      continue;
+    }
+    std::sort(members[i].begin(), members[i].end());
+
+    const G4String name = "Envelope_" + std::to_string(n_envelopes);
+    const G4ThreeVector center = 0.5 * (boxes[i].min + boxes[i].max);
+    const G4ThreeVector half_lengths = 0.5 * (boxes[i].max - boxes[i].min);
+
+    G4Box *Envelope_Solid = new G4Box(name + "_Solid", half_lengths.x(), half_lengths.y(), half_lengths.z());
+    G4LogicalVolume *Envelope_Logical = new G4LogicalVolume(Envelope_Solid, mother_logical->GetMaterial(), name + "_Logical");
+    Envelope_Logical->SetVisAttributes(G4VisAttributes::GetInvisible());
+
+    for (auto member : members[i]) {
+      G4VPhysicalVolume *daughter = daughters[member];
+      mother_logical->RemoveDaughter(daughter);
+      daughter->SetTranslation(daughter->GetTranslation() - center);
+      daughter->SetMotherLogical(Envelope_Logical);
+      Envelope_Logical->AddDaughter(daughter);
+    }
+    new G4PVPlacement(0, center, Envelope_Logical, name, mother_logical, false, 0, false);
+
+    ++n_envelopes;
+    n_wrapped += members[i].size();
+  }
+
+  G4cout << "GeometryOptimizer: Wrapped " << n_wrapped << " of " << n_daughters << " daughters of '" << mother_logical->GetName() << "' into " << n_envelopes << " envelopes, '" << mother_logical->GetName() << "' has " << mother_logical->GetNoDaughters() << " daughters now." << G4endl;
+}
+
+void GeometryOptimizer::PrintVoxelStatistics() {
+  // Geant4 prints the CPU time and memory of the most expensive voxel structures when they are
+  // built in verbose mode
+  G4GeometryManager *geometryManager = G4GeometryManager::GetInstance();
+  if (geometryManager->IsGeometryClosed()) {
+    geometryManager->OpenGeometry();
+  }
+  geometryManager->CloseGeometry(true, true);
+
+  std::vector<G4LogicalVolume *> logical_volumes;
+  for (auto logical_volume : *G4LogicalVolumeStore::GetInstance()) {
+    if (logical_volume->GetNoDaughters() > 1) {
+      logical_volumes.push_back(logical_volume);
+    }
+  }
+  std::stable_sort(logical_volumes.begin(), logical_volumes.end(), [](const G4LogicalVolume *a, const G4LogicalVolume *b) { return a->GetNoDaughters() > b->GetNoDaughters(); });
+
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  G4cout << "GeometryOptimizer: Voxels of all volumes with more than one daughter:" << G4endl;
+  G4cout << "\tdaughters\tsmartless\tslices\taxis\tvolume" << G4endl;
+  const char *axis_names[] = {"x", "y", "z", "rho", "radius", "phi"};
+  for (auto logical_volume : logical_volumes) {
+    const G4SmartVoxelHeader *header = logical_volume->GetVoxelHeader();
+    G4cout << "\t" << logical_volume->GetNoDaughters() << "\t\t" << logical_volume->GetSmartless() << "\t\t";
+    if (header) {
+      G4cout << header->GetNoSlices() << "\t" << (header->GetAxis() <= kPhi ? axis_names[header->GetAxis()] : "-");
+    } else {
+      G4cout << "-\t-";
+    }
+    G4cout << "\t" << logical_volume->GetName() << G4endl;
+  }
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
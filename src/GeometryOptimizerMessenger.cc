@@ -0,0 +1,99 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <sstream>
+
+#include "G4UIparameter.hh"
+
+#include "GeometryOptimizer.hh"
+#include "GeometryOptimizerMessenger.hh"
+
+GeometryOptimizerMessenger::GeometryOptimizerMessenger() {
+  geometryDirectory = new G4UIdirectory("/utr/geometry/");
+  geometryDirectory->SetGuidance("Controls for the optimization of the navigation in the geometry.");
+
+  envelopesCmd = new G4UIcmdWithABool("/utr/geometry/envelopes", this);
+  envelopesCmd->SetGuidance("Wrap groups of neighbouring daughters of the world volume into box-shaped envelopes made of the world material (default: false).");
+  envelopesCmd->SetGuidance("The wrapped volumes get an envelope as their new mother volume, their names are unchanged.");
+  envelopesCmd->SetGuidance("Takes effect when the geometry is constructed.");
+  envelopesCmd->SetParameterName("active", true);
+  envelopesCmd->SetDefaultValue(true);
+  envelopesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  envelopeGapCmd = new G4UIcommand("/utr/geometry/envelopeGap", this);
+  envelopeGapCmd->SetGuidance("Set the maximum gap between the bounding boxes of volumes which are wrapped into the same envelope (default: 5 cm).");
+  envelopeGapCmd->SetGuidance("Takes effect when the geometry is constructed.");
+  G4UIparameter *gapParameter = new G4UIparameter("gap", 'd', false);
+  gapParameter->SetParameterRange("gap >= 0.");
+  envelopeGapCmd->SetParameter(gapParameter);
+  G4UIparameter *gapUnitParameter = new G4UIparameter("unit", 's', true);
+  gapUnitParameter->SetDefaultValue("cm");
+  envelopeGapCmd->SetParameter(gapUnitParameter);
+  envelopeGapCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  smartlessCmd = new G4UIcommand("/utr/geometry/smartless", this);
+  smartlessCmd->SetGuidance("Set the smartless parameter (average number of voxels per daughter, Geant4 default: 2) of a logical volume.");
+  smartlessCmd->SetGuidance("Larger values speed up the navigation in volumes with many daughters at the cost of memory.");
+  smartlessCmd->SetParameter(new G4UIparameter("logicalVolume", 's', false));
+  G4UIparameter *smartlessParameter = new G4UIparameter("smartless", 'd', false);
+  smartlessParameter->SetParameterRange("smartless > 0.");
+  smartlessCmd->SetParameter(smartlessParameter);
+  smartlessCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  voxelStatisticsCmd = new G4UIcommand("/utr/geometry/printVoxelStatistics", this);
+  voxelStatisticsCmd->SetGuidance("Rebuild the voxels of the geometry and print their statistics.");
+  voxelStatisticsCmd->AvailableForStates(G4State_Idle);
+}
+
+GeometryOptimizerMessenger::~GeometryOptimizerMessenger() {
+  delete envelopesCmd;
+  delete envelopeGapCmd;
+  delete smartlessCmd;
+  delete voxelStatisticsCmd;
+  delete geometryDirectory;
+}
+
+void GeometryOptimizerMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+
+  if (command == envelopesCmd) {
+    GeometryOptimizer::SetEnvelopesActive(envelopesCmd->GetNewBoolValue(newValues));
+  } else if (command == envelopeGapCmd) {
+    G4double gap;
+    G4String unit;
+    parameters >> gap >> unit;
+    GeometryOptimizer::SetEnvelopeGap(gap * G4UIcommand::ValueOf(unit));
+  } else if (command == smartlessCmd) {
+    G4String logical_volume_name;
+    G4double smartless;
+    parameters >> logical_volume_name >> smartless;
+    GeometryOptimizer::SetSmartless(logical_volume_name, smartless);
+  } else if (command == voxelStatisticsCmd) {
+    GeometryOptimizer::PrintVoxelStatistics();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String GeometryOptimizerMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == envelopesCmd) {
+    return envelopesCmd->ConvertToString(GeometryOptimizer::AreEnvelopesActive());
+  }
+  return "";
+}
@@ -23,11 +23,11 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 //**************************************************************//
 
 #include "HPGe_55_TUNL_31524.hh"
+#include "G4GenericPolycone.hh"
 #include "G4LogicalVolume.hh"
 #include "G4Material.hh"
 #include "G4MaterialTable.hh"
 #include "G4PVPlacement.hh"
-#include "G4Polycone.hh"
 #include "G4RotationMatrix.hh"
 #include "G4ThreeVector.hh"
 #include "G4Tubs.hh"
@@ -39,7 +39,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4PhysicalConstants.hh"
 #include "G4SystemOfUnits.hh"
 
-#include "OptimizePolycone.hh"
+#include "PolyconeProfile.hh"
 #include "Units.hh"
 
 #include "NamedColors.hh"
@@ -207,46 +207,12 @@ HPGe_55_TUNL_31524::HPGe_55_TUNL_31524(G4String Detector_Name) {
 
   // Cold Finger
 
-  const G4int nsteps = 500;
+  PolyconeProfile ColdFinger_Profile("ColdFinger_Solid");
+  ColdFinger_Profile.Add_Point(0., 0.);
+  ColdFinger_Profile.Add_Point(ColdFinger_Radius, 0.);
+  ColdFinger_Profile.Add_Arc(0., ColdFinger_Length - ColdFinger_Radius, ColdFinger_Radius, ColdFinger_Radius, 0. * deg, 90. * deg);
 
-  G4double zPlaneTemp[nsteps];
-  G4double rInnerTemp[nsteps];
-  G4double rOuterTemp[nsteps];
-
-  G4double z;
-
-  for (int i = 0; i < nsteps; i++) {
-    z = (double)i / (nsteps - 1) * ColdFinger_Length;
-
-    zPlaneTemp[i] = z;
-
-    rInnerTemp[i] = 0. * mm;
-
-    if (z <= ColdFinger_Length - ColdFinger_Radius) {
-      rOuterTemp[i] = ColdFinger_Radius;
-    } else if (z <= ColdFinger_Length) {
-      rOuterTemp[i] =
-          ColdFinger_Radius *
-          sqrt(1 - pow((z - (ColdFinger_Length - ColdFinger_Radius)) /
-                           ColdFinger_Radius,
-                       2));
-    } else {
-      rOuterTemp[i] = 0. * mm;
-    }
-  }
-
-  G4double zPlane[nsteps];
-  G4double rInner[nsteps];
-  G4double rOuter[nsteps];
-
-  OptimizePolycone *opt = new OptimizePolycone();
-  G4int nsteps_optimized =
-      opt->Optimize(zPlaneTemp, rInnerTemp, rOuterTemp, zPlane, rInner,
-                    rOuter, nsteps, "ColdFinger_Solid");
-
-  G4Polycone *ColdFinger_Solid =
-      new G4Polycone("ColdFinger_Solid", 0. * deg, 360. * deg,
-                     nsteps_optimized, zPlane, rInner, rOuter);
+  G4GenericPolycone *ColdFinger_Solid = ColdFinger_Profile.Construct();
 
   G4LogicalVolume *ColdFinger_Logical = new G4LogicalVolume(
       ColdFinger_Solid, ColdFinger_Material, "ColdFinger_Logical", 0, 0, 0);
@@ -259,45 +225,14 @@ HPGe_55_TUNL_31524::HPGe_55_TUNL_31524(G4String Detector_Name) {
 
   // Germanium Detector Crystal
 
-  for (int i = 0; i < nsteps; i++) {
-    z = (double)i / (nsteps - 1) * Detector_Length;
-
-    zPlaneTemp[i] = z;
-
-    if (z <= Hole_Depth) {
-      if (z <= Hole_Depth - Hole_Bottom_Radius) {
-        rInnerTemp[i] = Hole_Radius;
-      } else {
-        rInnerTemp[i] =
-            Hole_Radius *
-            sqrt(1 - pow((z - (Hole_Depth - Hole_Bottom_Radius)) /
-                             Hole_Bottom_Radius,
-                         2));
-      }
-    } else {
-      rInnerTemp[i] = 0. * mm;
-    }
-
-    if (z <= Detector_Length - Detector_End_Radius) {
-      rOuterTemp[i] = Detector_Radius;
-    } else if (z <= Detector_Length) {
-      rOuterTemp[i] =
-          Detector_End_Radius *
-              sqrt(1 - pow((z - (Detector_Length - Detector_End_Radius)) /
-                               Detector_End_Radius,
-                           2)) +
-          (Detector_Radius - Detector_End_Radius);
-    } else {
-      rOuterTemp[i] = 0. * mm;
-    }
-  }
-
-  nsteps_optimized = opt->Optimize(zPlaneTemp, rInnerTemp, rOuterTemp, zPlane,
-                                   rInner, rOuter, nsteps, "Crystal_Solid");
-
-  G4Polycone *Crystal_Solid =
-      new G4Polycone("Crystal_Solid", 0. * deg, 360. * deg, nsteps_optimized,
-                     zPlane, rInner, rOuter);
+  PolyconeProfile Crystal_Profile("Crystal_Solid");
+  Crystal_Profile.Add_Point(0., Detector_Length);
+  Crystal_Profile.Add_Arc(Detector_Radius - Detector_End_Radius, Detector_Length - Detector_End_Radius, Detector_End_Radius, Detector_End_Radius, 90. * deg, 0. * deg);
+  Crystal_Profile.Add_Point(Detector_Radius, 0.);
+  Crystal_Profile.Add_Point(Hole_Radius, 0.);
+  Crystal_Profile.Add_Arc(0., Hole_Depth - Hole_Bottom_Radius, Hole_Radius, Hole_Bottom_Radius, 0. * deg, 90. * deg);
+
+  G4GenericPolycone *Crystal_Solid = Crystal_Profile.Construct();
 
   G4LogicalVolume *Crystal_Logical = new G4LogicalVolume(
       Crystal_Solid, Crystal_Material, Detector_Name, 0, 0, 0);
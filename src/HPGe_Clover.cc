@@ -23,6 +23,8 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
  * Eurysis manual for clover detectors.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 using std::stringstream;
 
@@ -31,12 +33,13 @@ using std::stringstream;
 #include "G4NistManager.hh"
 #include "G4PVPlacement.hh"
 #include "G4PhysicalConstants.hh"
-#include "G4SubtractionSolid.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Tubs.hh"
 #include "G4VisAttributes.hh"
 
+#include "DetectorCache.hh"
 #include "HPGe_Clover.hh"
+#include "PolyconeProfile.hh"
 
 void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4double phi, G4double dist_from_center, G4double intrinsic_rotation_angle) const {
 
@@ -50,15 +53,24 @@ void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4
     rotation->rotateZ(intrinsic_rotation_angle);
   }
 
+  // Identical detectors share the solids, each detector has its own logical volumes.
+  const G4String model = Model_Key();
+
   /******** Front end cap *********/
 
-  G4VSolid *end_cap_front_solid = rounded_box("_end_cap_front_solid", properties.end_cap_front_side_length, properties.end_cap_front_length, properties.end_cap_front_rounding_radius, 20);
+  G4VSolid *end_cap_front_solid = DetectorCache::Find_Solid(model, "end_cap_front");
+  if (!end_cap_front_solid) {
+    end_cap_front_solid = DetectorCache::Add_Solid(model, "end_cap_front", rounded_box("_end_cap_front_solid", properties.end_cap_front_side_length, properties.end_cap_front_length, properties.end_cap_front_rounding_radius, 20));
+  }
   G4LogicalVolume *end_cap_front_logical = new G4LogicalVolume(end_cap_front_solid, nist->FindOrBuildMaterial(properties.end_cap_material), detector_name + "_end_cap_front_logical");
   new G4PVPlacement(rotation, global_coordinates + (dist_from_center + 0.5 * properties.end_cap_front_length) * symmetry_axis, end_cap_front_logical, detector_name + "_end_cap_front", world_Logical, 0, 0, false);
 
   /******** Vacuum around crystal ********/
 
-  G4VSolid *vacuum_solid = rounded_box("_vacuum_solid", properties.end_cap_front_side_length - 2. * properties.end_cap_front_thickness, properties.vacuum_length, properties.end_cap_front_rounding_radius, 20);
+  G4VSolid *vacuum_solid = DetectorCache::Find_Solid(model, "vacuum");
+  if (!vacuum_solid) {
+    vacuum_solid = DetectorCache::Add_Solid(model, "vacuum", rounded_box("_vacuum_solid", properties.end_cap_front_side_length - 2. * properties.end_cap_front_thickness, properties.vacuum_length, properties.end_cap_front_rounding_radius, 20));
+  }
 
   G4LogicalVolume *vacuum_logical = new G4LogicalVolume(vacuum_solid, nist->FindOrBuildMaterial("G4_Galactic"), detector_name + "_vacuum_logical");
   vacuum_logical->SetVisAttributes(G4Color::Cyan());
@@ -66,7 +78,10 @@ void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4
 
   /******** Air at the back of the front end cap ********/
 
-  G4VSolid *air_front_solid = rounded_box("_air_front_solid", properties.end_cap_front_side_length - 2. * properties.end_cap_front_thickness, properties.end_cap_front_length - properties.end_cap_window_thickness - properties.end_cap_front_thickness - properties.vacuum_length, properties.end_cap_front_rounding_radius, 20);
+  G4VSolid *air_front_solid = DetectorCache::Find_Solid(model, "air_front");
+  if (!air_front_solid) {
+    air_front_solid = DetectorCache::Add_Solid(model, "air_front", rounded_box("_air_front_solid", properties.end_cap_front_side_length - 2. * properties.end_cap_front_thickness, properties.end_cap_front_length - properties.end_cap_window_thickness - properties.end_cap_front_thickness - properties.vacuum_length, properties.end_cap_front_rounding_radius, 20));
+  }
 
   G4LogicalVolume *air_front_logical = new G4LogicalVolume(air_front_solid, nist->FindOrBuildMaterial("G4_AIR"), detector_name + "_air_front_logical");
   air_front_logical->SetVisAttributes(G4Color::Red());
@@ -74,57 +89,72 @@ void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4
 
   /******** Crystals ********/
 
-  G4Tubs *crystal_full_solid = new G4Tubs(detector_name + "_crystal_full_solid", 0., properties.crystal_radius, properties.crystal_length * 0.5, 0., twopi);
-  G4Tubs *anode_solid = new G4Tubs(detector_name + "_anode_solid", 0., properties.anode_radius, properties.anode_length * 0.5, 0., twopi);
-  G4SubtractionSolid *crystal_original = new G4SubtractionSolid(detector_name + "_crystal_original", crystal_full_solid, anode_solid, 0, G4ThreeVector(0., 0., 0.5 * properties.crystal_length - 0.5 * properties.anode_length));
-  G4Box *subtraction_solid = new G4Box(detector_name + "_subtraction_solid", properties.crystal_radius, properties.crystal_radius, properties.crystal_length);
-  G4SubtractionSolid *crystal_step1_solid = new G4SubtractionSolid(detector_name + "_crystal_step1_solid", crystal_original, subtraction_solid, 0, G4ThreeVector(properties.crystal_radius + 23. * mm, 0., 0.));
-  G4SubtractionSolid *crystal_step2_solid = new G4SubtractionSolid(detector_name + "_crystal_step2_solid", crystal_step1_solid, subtraction_solid, 0, G4ThreeVector(-properties.crystal_radius - 22. * mm, 0., 0.));
-  G4SubtractionSolid *crystal_step3_solid = new G4SubtractionSolid(detector_name + "_crystal_step3_solid", crystal_step2_solid, subtraction_solid, 0, G4ThreeVector(0., -properties.crystal_radius - 22. * mm, 0.));
-  G4SubtractionSolid *crystal_step4_solid = new G4SubtractionSolid(detector_name + "_crystal_step4_solid", crystal_step3_solid, subtraction_solid, 0, G4ThreeVector(0., properties.crystal_radius + 23. * mm, 0.));
-   std::cout << "Crystal Radius: " << properties.crystal_radius << std::endl;
-   std::cout << "Crystal Length: " << properties.crystal_length << std::endl;
-   std::cout << "Crystal Face Radius: " << properties.crystal_face_radius << std::endl;
-  
-  G4LogicalVolume *crystal1_logical = new G4LogicalVolume(crystal_step4_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_1");
+  // The hole for the anode is a daughter volume of each crystal, so that the navigation inside
+  // the crystals does not have to evaluate boolean solids.
+  G4VSolid *crystal_solid = DetectorCache::Find_Solid(model, "crystal");
+  if (!crystal_solid) {
+    crystal_solid = DetectorCache::Add_Solid(model, "crystal", crystal_extruded_solid());
+  }
+  G4VSolid *anode_cached_solid = DetectorCache::Find_Solid(model, "anode");
+  if (!anode_cached_solid) {
+    anode_cached_solid = DetectorCache::Add_Solid(model, "anode", anode_solid());
+  }
+  G4LogicalVolume *anode_logical = new G4LogicalVolume(anode_cached_solid, nist->FindOrBuildMaterial("G4_Galactic"), detector_name + "_anode_logical");
+  anode_logical->SetVisAttributes(G4VisAttributes::GetInvisible());
+  const G4ThreeVector anode_position(0., 0., 0.5 * properties.crystal_length - 0.5 * properties.anode_length);
+
+  G4LogicalVolume *crystal1_logical = new G4LogicalVolume(crystal_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_1");
   crystal1_logical->SetVisAttributes(new G4VisAttributes(G4Color::Blue()));
+  new G4PVPlacement(0, anode_position, anode_logical, detector_name + "_anode_1", crystal1_logical, 0, 0, false);
   new G4PVPlacement(0, G4ThreeVector(22. * mm + 0.5 * properties.crystal_gap, 22. * mm + 0.5 * properties.crystal_gap, -0.5 * properties.vacuum_length + 0.5 * properties.crystal_length + properties.end_cap_to_crystal_gap_front), crystal1_logical, detector_name + "_crystal_1", vacuum_logical, 0, 0, false);
 
   G4RotationMatrix *rotate2 = new G4RotationMatrix();
   rotate2->rotateZ(-90. * deg);
-  G4LogicalVolume *crystal2_logical = new G4LogicalVolume(crystal_step4_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_2");
+  G4LogicalVolume *crystal2_logical = new G4LogicalVolume(crystal_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_2");
   crystal2_logical->SetVisAttributes(new G4VisAttributes(G4Color::Red()));
+  new G4PVPlacement(0, anode_position, anode_logical, detector_name + "_anode_2", crystal2_logical, 0, 0, false);
   new G4PVPlacement(rotate2, G4ThreeVector(-22. * mm - 0.5 * properties.crystal_gap, 22. * mm + 0.5 * properties.crystal_gap, -0.5 * properties.vacuum_length + 0.5 * properties.crystal_length + properties.end_cap_to_crystal_gap_front), crystal2_logical, detector_name + "_crystal_2", vacuum_logical, 0, 0, false);
 
   G4RotationMatrix *rotate3 = new G4RotationMatrix();
   rotate3->rotateZ(-180. * deg);
-  G4LogicalVolume *crystal3_logical = new G4LogicalVolume(crystal_step4_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_3");
+  G4LogicalVolume *crystal3_logical = new G4LogicalVolume(crystal_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_3");
   crystal3_logical->SetVisAttributes(new G4VisAttributes(G4Color::Green()));
+  new G4PVPlacement(0, anode_position, anode_logical, detector_name + "_anode_3", crystal3_logical, 0, 0, false);
   new G4PVPlacement(rotate3, G4ThreeVector(-22. * mm - 0.5 * properties.crystal_gap, -22. * mm - 0.5 * properties.crystal_gap, -0.5 * properties.vacuum_length + 0.5 * properties.crystal_length + properties.end_cap_to_crystal_gap_front), crystal3_logical, detector_name + "_crystal_3", vacuum_logical, 0, 0, false);
 
   G4RotationMatrix *rotate4 = new G4RotationMatrix();
   rotate4->rotateZ(-270. * deg);
-  G4LogicalVolume *crystal4_logical = new G4LogicalVolume(crystal_step4_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_4");
+  G4LogicalVolume *crystal4_logical = new G4LogicalVolume(crystal_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name + "_4");
   crystal4_logical->SetVisAttributes(new G4VisAttributes(G4Color::Brown()));
+  new G4PVPlacement(0, anode_position, anode_logical, detector_name + "_anode_4", crystal4_logical, 0, 0, false);
   new G4PVPlacement(rotate4, G4ThreeVector(22. * mm + 0.5 * properties.crystal_gap, -22. * mm - 0.5 * properties.crystal_gap, -0.5 * properties.vacuum_length + 0.5 * properties.crystal_length + properties.end_cap_to_crystal_gap_front), crystal4_logical, detector_name + "_crystal_4", vacuum_logical, 0, 0, false);
 
   /******** Back end cap *********/
 
-  G4VSolid *end_cap_back_solid = rounded_box("_end_cap_back_solid", properties.end_cap_back_side_length, properties.end_cap_back_length, properties.end_cap_back_rounding_radius, 20);
+  G4VSolid *end_cap_back_solid = DetectorCache::Find_Solid(model, "end_cap_back");
+  if (!end_cap_back_solid) {
+    end_cap_back_solid = DetectorCache::Add_Solid(model, "end_cap_back", rounded_box("_end_cap_back_solid", properties.end_cap_back_side_length, properties.end_cap_back_length, properties.end_cap_back_rounding_radius, 20));
+  }
   G4LogicalVolume *end_cap_back_logical = new G4LogicalVolume(end_cap_back_solid, nist->FindOrBuildMaterial(properties.end_cap_material), detector_name + "_end_cap_back_logical");
-  new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_front_length + 0.5 * properties.end_cap_back_length) * symmetry_axis, end_cap_back_logical, detector_name + "_end_cap_back", world_Logical, 0, 0, false);
 
   /******** Air inside the back end cap ********/
 
-  G4VSolid *air_back_solid = rounded_box("_air_back_solid", properties.end_cap_back_side_length - 2. * properties.end_cap_back_thickness, properties.end_cap_back_length - 2. * properties.end_cap_back_thickness, properties.end_cap_back_rounding_radius, 20);
+  G4VSolid *air_back_solid = DetectorCache::Find_Solid(model, "air_back");
+  if (!air_back_solid) {
+    air_back_solid = DetectorCache::Add_Solid(model, "air_back", rounded_box("_air_back_solid", properties.end_cap_back_side_length - 2. * properties.end_cap_back_thickness, properties.end_cap_back_length - 2. * properties.end_cap_back_thickness, properties.end_cap_back_rounding_radius, 20));
+  }
 
   G4LogicalVolume *air_back_logical = new G4LogicalVolume(air_back_solid, nist->FindOrBuildMaterial("G4_AIR"), detector_name + "_air_back_logical");
   air_back_logical->SetVisAttributes(G4Color::Red());
   new G4PVPlacement(0, G4ThreeVector(0., 0., -0.5 * properties.end_cap_back_length + properties.end_cap_back_thickness + 0.5 * (properties.end_cap_back_length - 2. * properties.end_cap_back_thickness)), air_back_logical, detector_name + "_air_back", end_cap_back_logical, 0, 0, false);
+  new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_front_length + 0.5 * properties.end_cap_back_length) * symmetry_axis, end_cap_back_logical, detector_name + "_end_cap_back", world_Logical, 0, 0, false);
 
   if (use_dewar) {
     /************* Connection dewar-detector *************/
-    G4Tubs *connection_solid = new G4Tubs(detector_name + "_dewar_connection_solid", 0., properties.connection_radius, properties.connection_length * 0.5, 0., twopi);
+    G4VSolid *connection_solid = DetectorCache::Find_Solid(model, "dewar_connection");
+    if (!connection_solid) {
+      connection_solid = DetectorCache::Add_Solid(model, "dewar_connection", new G4Tubs(detector_name + "_dewar_connection_solid", 0., properties.connection_radius, properties.connection_length * 0.5, 0., twopi));
+    }
     G4LogicalVolume *connection_logical = new G4LogicalVolume(connection_solid, nist->FindOrBuildMaterial(properties.connection_material), detector_name + "_dewar_connection_logical");
     connection_logical->SetVisAttributes(new G4VisAttributes(G4Color::White()));
     new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_front_length + properties.end_cap_back_length + properties.connection_length * 0.5) * symmetry_axis, connection_logical, detector_name + "_dewar_connection", world_Logical, 0, 0, false);
@@ -132,16 +162,22 @@ void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4
     /************* Dewar *************/
 
     // Dewar face
-    G4Tubs *dewar_solid = new G4Tubs(detector_name + "_dewar_solid", 0., properties.dewar_outer_radius, properties.dewar_length * 0.5, 0., twopi);
+    G4VSolid *dewar_solid = DetectorCache::Find_Solid(model, "dewar");
+    if (!dewar_solid) {
+      dewar_solid = DetectorCache::Add_Solid(model, "dewar", new G4Tubs(detector_name + "_dewar_solid", 0., properties.dewar_outer_radius, properties.dewar_length * 0.5, 0., twopi));
+    }
     G4LogicalVolume *dewar_logical = new G4LogicalVolume(dewar_solid, nist->FindOrBuildMaterial(properties.dewar_material), detector_name + "_dewar_logical");
     dewar_logical->SetVisAttributes(G4Color::Brown());
-    new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_front_length + properties.end_cap_back_length + properties.connection_length + properties.dewar_length * 0.5) * symmetry_axis, dewar_logical, detector_name + "_dewar", world_Logical, 0, 0, false);
 
     // Dewar interior
-    G4Tubs *dewar_interior_solid = new G4Tubs(detector_name + "_dewar_interior_solid", 0., properties.dewar_outer_radius - properties.dewar_wall_thickness, properties.dewar_length * 0.5 - properties.dewar_wall_thickness, 0., twopi);
+    G4VSolid *dewar_interior_solid = DetectorCache::Find_Solid(model, "dewar_interior");
+    if (!dewar_interior_solid) {
+      dewar_interior_solid = DetectorCache::Add_Solid(model, "dewar_interior", new G4Tubs(detector_name + "_dewar_interior_solid", 0., properties.dewar_outer_radius - properties.dewar_wall_thickness, properties.dewar_length * 0.5 - properties.dewar_wall_thickness, 0., twopi));
+    }
     G4LogicalVolume *dewar_interior_logical = new G4LogicalVolume(dewar_interior_solid, nist->FindOrBuildMaterial("G4_N"), detector_name + "_dewar_interior_logical");
     dewar_interior_logical->SetVisAttributes(G4Color::Red());
     new G4PVPlacement(0, G4ThreeVector(0., 0., 0.), dewar_interior_logical, detector_name + "_dewar_interior", dewar_logical, 0, 0, false);
+    new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_front_length + properties.end_cap_back_length + properties.connection_length + properties.dewar_length * 0.5) * symmetry_axis, dewar_logical, detector_name + "_dewar", world_Logical, 0, 0, false);
   }
 
   /************* Filters *************/
@@ -168,6 +204,10 @@ void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4
   }
 }
 
+G4String HPGe_Clover::Model_Key() const {
+  return DetectorCache::Model_Key("HPGe_Clover", properties.crystal_radius, properties.crystal_length, properties.crystal_face_radius, properties.crystal_gap, properties.end_cap_to_crystal_gap_front, properties.vacuum_length, properties.anode_length, properties.anode_radius, properties.end_cap_front_side_length, properties.end_cap_front_rounding_radius, properties.end_cap_front_length, properties.end_cap_front_thickness, properties.end_cap_window_thickness, properties.end_cap_back_side_length, properties.end_cap_back_rounding_radius, properties.end_cap_back_length, properties.end_cap_back_thickness, properties.end_cap_material, properties.connection_length, properties.connection_radius, properties.connection_material, properties.dewar_length, properties.dewar_outer_radius, properties.dewar_wall_thickness, properties.dewar_material);
+}
+
 void HPGe_Clover::Construct(G4ThreeVector global_coordinates, G4double theta, G4double phi, G4double dist_from_center) const {
   Construct(global_coordinates, theta, phi, dist_from_center, 0.);
 }
@@ -186,3 +226,55 @@ G4VSolid *HPGe_Clover::rounded_box(const G4String name, const G4double side_leng
 
   return new G4ExtrudedSolid(name, base, length * 0.5, 0., 1., 0., 1.);
 }
+
+vector<G4TwoVector> HPGe_Clover::crystal_cross_section(const G4double max_deviation) const {
+
+  // Regular polygon which approximates the circular cross section of the original cylindrical
+  // crystal, in clockwise order as required by G4ExtrudedSolid. The number of corners is chosen
+  // such that an inscribed polygon would deviate from the circle by at most max_deviation. The
+  // corners are moved outwards to preserve the area of the circle, which reduces the deviation
+  // further.
+  const G4double max_angle_step = 2. * acos(1. - std::min(max_deviation, properties.crystal_radius) / properties.crystal_radius);
+  const size_t n_circle_points = std::max((size_t)8, (size_t)ceil(twopi / max_angle_step));
+  const G4double angle_step = twopi / n_circle_points;
+  const G4double polygon_radius = properties.crystal_radius * sqrt(angle_step / sin(angle_step));
+  vector<G4TwoVector> polygon(n_circle_points);
+  for (size_t i = 0; i < n_circle_points; ++i) {
+    polygon[i] = G4TwoVector(polygon_radius * cos(-angle_step * i), polygon_radius * sin(-angle_step * i));
+  }
+
+  // Cut the polygon at the flat sides of the crystal. The sides which face the neighboring
+  // crystals (negative x and y) are at a distance of crystal_inner_cut from the axis of the
+  // original cylinder, the outer sides at crystal_outer_cut.
+  const G4TwoVector cut_normals[4] = {G4TwoVector(1., 0.), G4TwoVector(-1., 0.), G4TwoVector(0., 1.), G4TwoVector(0., -1.)};
+  const G4double cut_distances[4] = {crystal_outer_cut, crystal_inner_cut, crystal_outer_cut, crystal_inner_cut};
+
+  vector<G4TwoVector> cut_polygon;
+  G4double distance_current, distance_next;
+  for (unsigned int i = 0; i < 4; ++i) {
+    cut_polygon.clear();
+    for (size_t j = 0; j < polygon.size(); ++j) {
+      const G4TwoVector &current = polygon[j];
+      const G4TwoVector &next = polygon[(j + 1) % polygon.size()];
+      distance_current = cut_normals[i].dot(current) - cut_distances[i];
+      distance_next = cut_normals[i].dot(next) - cut_distances[i];
+      if (distance_current <= 0.) {
+        cut_polygon.push_back(current);
+      }
+      if ((distance_current < 0. && distance_next > 0.) || (distance_current > 0. && distance_next < 0.)) {
+        cut_polygon.push_back(current + (next - current) * (distance_current / (distance_current - distance_next)));
+      }
+    }
+    polygon = cut_polygon;
+  }
+
+  return polygon;
+}
+
+G4VSolid *HPGe_Clover::crystal_extruded_solid(const G4double max_deviation) const {
+  return new G4ExtrudedSolid(detector_name + "_crystal_solid", crystal_cross_section(max_deviation), properties.crystal_length * 0.5, 0., 1., 0., 1.);
+}
+
+G4VSolid *HPGe_Clover::anode_solid() const {
+  return new G4Tubs(detector_name + "_anode_solid", 0., properties.anode_radius, properties.anode_length * 0.5, 0., twopi);
+}
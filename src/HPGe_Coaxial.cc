@@ -21,16 +21,17 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include <sstream>
 
 #include "G4Color.hh"
+#include "G4GenericPolycone.hh"
 #include "G4NistManager.hh"
 #include "G4PVPlacement.hh"
 #include "G4PhysicalConstants.hh"
-#include "G4Polycone.hh"
 #include "G4Tubs.hh"
 #include "G4VisAttributes.hh"
 
+#include "DetectorCache.hh"
 #include "Filter_Case.hh"
 #include "HPGe_Coaxial.hh"
-#include "OptimizePolycone.hh"
+#include "PolyconeProfile.hh"
 
 using std::stringstream;
 
@@ -47,25 +48,37 @@ void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G
     rotation->rotateZ(intrinsic_rotation_angle);
   }
 
+  // Identical detectors share the solids, each detector has its own logical volumes.
+  const G4String model = Model_Key();
+
   /************* End cap *************/
   // End cap side
   G4double end_cap_inner_radius = properties.detector_radius + properties.mount_cup_thickness + properties.end_cap_to_crystal_gap_side;
   G4double end_cap_outer_radius = properties.detector_radius + properties.mount_cup_thickness + properties.end_cap_to_crystal_gap_side + properties.end_cap_thickness;
   G4double end_cap_side_length = properties.mount_cup_length + properties.end_cap_to_crystal_gap_front;
 
-  G4Tubs *end_cap_side_solid = new G4Tubs(detector_name + "_end_cap_side_solid", end_cap_inner_radius, end_cap_outer_radius, end_cap_side_length * 0.5, 0., twopi);
+  G4VSolid *end_cap_side_solid = DetectorCache::Find_Solid(model, "end_cap_side");
+  if (!end_cap_side_solid) {
+    end_cap_side_solid = DetectorCache::Add_Solid(model, "end_cap_side", new G4Tubs(detector_name + "_end_cap_side_solid", end_cap_inner_radius, end_cap_outer_radius, end_cap_side_length * 0.5, 0., twopi));
+  }
   G4LogicalVolume *end_cap_side_logical = new G4LogicalVolume(end_cap_side_solid, nist->FindOrBuildMaterial(properties.end_cap_material), detector_name + "_end_cap_side_logical");
   end_cap_side_logical->SetVisAttributes(new G4VisAttributes(G4Color::White()));
   new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_window_thickness + end_cap_side_length * 0.5) * symmetry_axis, end_cap_side_logical, detector_name + "_end_cap_side", world_Logical, 0, 0, false);
 
   // End cap window
-  G4Tubs *end_cap_window_solid = new G4Tubs(detector_name + "_end_cap_window_solid", 0., end_cap_outer_radius, properties.end_cap_window_thickness * 0.5, 0., twopi);
+  G4VSolid *end_cap_window_solid = DetectorCache::Find_Solid(model, "end_cap_window");
+  if (!end_cap_window_solid) {
+    end_cap_window_solid = DetectorCache::Add_Solid(model, "end_cap_window", new G4Tubs(detector_name + "_end_cap_window_solid", 0., end_cap_outer_radius, properties.end_cap_window_thickness * 0.5, 0., twopi));
+  }
   G4LogicalVolume *end_cap_window_logical = new G4LogicalVolume(end_cap_window_solid, nist->FindOrBuildMaterial(properties.end_cap_window_material), detector_name + "_end_cap_window_logical");
   end_cap_window_logical->SetVisAttributes(new G4VisAttributes(G4Color::White()));
   new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_window_thickness * 0.5) * symmetry_axis, end_cap_window_logical, detector_name + "_end_cap_window", world_Logical, 0, 0, false);
 
   // Vacuum inside end cap
-  G4Tubs *end_cap_vacuum_solid = new G4Tubs(detector_name + "_end_cap_vacuum_solid", 0., end_cap_inner_radius, end_cap_side_length * 0.5, 0., twopi);
+  G4VSolid *end_cap_vacuum_solid = DetectorCache::Find_Solid(model, "end_cap_vacuum");
+  if (!end_cap_vacuum_solid) {
+    end_cap_vacuum_solid = DetectorCache::Add_Solid(model, "end_cap_vacuum", new G4Tubs(detector_name + "_end_cap_vacuum_solid", 0., end_cap_inner_radius, end_cap_side_length * 0.5, 0., twopi));
+  }
   G4LogicalVolume *end_cap_vacuum_logical = new G4LogicalVolume(end_cap_vacuum_solid, nist->FindOrBuildMaterial("G4_Galactic"), detector_name + "_end_cap_vacuum_logical");
   end_cap_vacuum_logical->SetVisAttributes(G4VisAttributes::GetInvisible());
   new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_window_thickness + end_cap_side_length * 0.5) * symmetry_axis, end_cap_vacuum_logical, detector_name + "_end_cap_vacuum", world_Logical, 0, 0, false);
@@ -76,19 +89,28 @@ void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G
   G4double mount_cup_outer_radius = properties.detector_radius + properties.mount_cup_thickness;
   G4double mount_cup_side_length = properties.mount_cup_length - properties.mount_cup_thickness - properties.mount_cup_base_thickness;
 
-  G4Tubs *mount_cup_side_solid = new G4Tubs(detector_name + "_mount_cup_side_solid", mount_cup_inner_radius, mount_cup_outer_radius, mount_cup_side_length * 0.5, 0., twopi);
+  G4VSolid *mount_cup_side_solid = DetectorCache::Find_Solid(model, "mount_cup_side");
+  if (!mount_cup_side_solid) {
+    mount_cup_side_solid = DetectorCache::Add_Solid(model, "mount_cup_side", new G4Tubs(detector_name + "_mount_cup_side_solid", mount_cup_inner_radius, mount_cup_outer_radius, mount_cup_side_length * 0.5, 0., twopi));
+  }
   G4LogicalVolume *mount_cup_side_logical = new G4LogicalVolume(mount_cup_side_solid, nist->FindOrBuildMaterial(properties.mount_cup_material), detector_name + "_mount_cup_side_logical");
   mount_cup_side_logical->SetVisAttributes(new G4VisAttributes(G4Color::Cyan()));
   new G4PVPlacement(0, G4ThreeVector(0., 0., -end_cap_side_length * 0.5 + properties.end_cap_to_crystal_gap_front + properties.mount_cup_thickness + mount_cup_side_length * 0.5), mount_cup_side_logical, detector_name + "_mount_cup_side", end_cap_vacuum_logical, 0, 0, false);
 
   // Mount cup face
-  G4Tubs *mount_cup_face_solid = new G4Tubs(detector_name + "_mount_cup_face_solid", 0., mount_cup_outer_radius, properties.mount_cup_thickness * 0.5, 0., twopi);
+  G4VSolid *mount_cup_face_solid = DetectorCache::Find_Solid(model, "mount_cup_face");
+  if (!mount_cup_face_solid) {
+    mount_cup_face_solid = DetectorCache::Add_Solid(model, "mount_cup_face", new G4Tubs(detector_name + "_mount_cup_face_solid", 0., mount_cup_outer_radius, properties.mount_cup_thickness * 0.5, 0., twopi));
+  }
   G4LogicalVolume *mount_cup_face_logical = new G4LogicalVolume(mount_cup_face_solid, nist->FindOrBuildMaterial(properties.mount_cup_material), detector_name + "_mount_cup_face_logical");
   mount_cup_face_logical->SetVisAttributes(new G4VisAttributes(G4Color::Cyan()));
   new G4PVPlacement(0, G4ThreeVector(0., 0., -end_cap_side_length * 0.5 + properties.end_cap_to_crystal_gap_front + properties.mount_cup_thickness * 0.5), mount_cup_face_logical, detector_name + "_mount_cup_face", end_cap_vacuum_logical, 0, 0, false);
 
   // Mount cup base
-  G4Tubs *mount_cup_base_solid = new G4Tubs(detector_name + "_mount_cup_base_solid", properties.hole_radius, mount_cup_outer_radius, properties.mount_cup_base_thickness * 0.5, 0., twopi);
+  G4VSolid *mount_cup_base_solid = DetectorCache::Find_Solid(model, "mount_cup_base");
+  if (!mount_cup_base_solid) {
+    mount_cup_base_solid = DetectorCache::Add_Solid(model, "mount_cup_base", new G4Tubs(detector_name + "_mount_cup_base_solid", properties.hole_radius, mount_cup_outer_radius, properties.mount_cup_base_thickness * 0.5, 0., twopi));
+  }
   G4LogicalVolume *mount_cup_base_logical = new G4LogicalVolume(mount_cup_base_solid, nist->FindOrBuildMaterial(properties.mount_cup_material), detector_name + "_mount_cup_base_logical");
   mount_cup_base_logical->SetVisAttributes(new G4VisAttributes(G4Color::Cyan()));
   new G4PVPlacement(0, G4ThreeVector(0., 0., -end_cap_side_length * 0.5 + properties.end_cap_to_crystal_gap_front + properties.mount_cup_thickness + mount_cup_side_length + 0.5 * properties.mount_cup_base_thickness), mount_cup_base_logical, detector_name + "_mount_cup_base", end_cap_vacuum_logical, 0, 0, false);
@@ -97,39 +119,17 @@ void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G
 
   G4double cold_finger_length = properties.cold_finger_penetration_depth + mount_cup_side_length + properties.mount_cup_base_thickness - properties.detector_length;
 
-  const G4int nsteps = 500;
-
-  G4double zPlaneTemp[nsteps];
-  G4double rInnerTemp[nsteps];
-  G4double rOuterTemp[nsteps];
+  G4VSolid *cold_finger_solid = DetectorCache::Find_Solid(model, "cold_finger");
+  if (!cold_finger_solid) {
+    // The cold finger ends in a hemisphere at z = 0.
+    PolyconeProfile cold_finger_profile(detector_name + "_cold_finger_solid");
+    cold_finger_profile.Add_Point(0., cold_finger_length);
+    cold_finger_profile.Add_Point(properties.cold_finger_radius, cold_finger_length);
+    cold_finger_profile.Add_Arc(0., properties.cold_finger_radius, properties.cold_finger_radius, properties.cold_finger_radius, 0., -90. * deg);
 
-  G4double z;
-
-  for (int i = 0; i < nsteps; i++) {
-    z = (1. - (double)i / (nsteps - 1)) * cold_finger_length;
-
-    zPlaneTemp[i] = z;
-
-    rInnerTemp[i] = 0. * mm;
-
-    if (z >= properties.cold_finger_radius) {
-      rOuterTemp[i] = properties.cold_finger_radius;
-    } else if (z >= 0.) {
-      rOuterTemp[i] = properties.cold_finger_radius * sqrt(1. - pow((z - properties.cold_finger_radius) / properties.cold_finger_radius, 2));
-    } else {
-      rOuterTemp[i] = 0. * mm;
-    }
+    cold_finger_solid = DetectorCache::Add_Solid(model, "cold_finger", cold_finger_profile.Construct());
   }
 
-  G4double zPlane[nsteps];
-  G4double rInner[nsteps];
-  G4double rOuter[nsteps];
-
-  OptimizePolycone *opt = new OptimizePolycone();
-  G4int nsteps_optimized = opt->Optimize(zPlaneTemp, rInnerTemp, rOuterTemp, zPlane, rInner, rOuter, nsteps, detector_name + "_cold_finger_solid");
-
-  G4Polycone *cold_finger_solid = new G4Polycone(detector_name + "_cold_finger_solid", 0. * deg, 360. * deg, nsteps_optimized, zPlane, rInner, rOuter);
-
   G4LogicalVolume *cold_finger_logical = new G4LogicalVolume(cold_finger_solid, nist->FindOrBuildMaterial(properties.cold_finger_material), detector_name + "_cold_finger_logical", 0, 0, 0);
 
   cold_finger_logical->SetVisAttributes(new G4VisAttributes(G4Color(1.0, 0.5, 0.0)));
@@ -138,41 +138,33 @@ void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G
 
   /************* Detector crystal *************/
 
-  for (int i = 0; i < nsteps; i++) {
-    z = (1. - (double)i / (nsteps - 1)) * properties.detector_length;
-
-    zPlaneTemp[i] = z;
-
-    // rInnerTemp[i] = 0. * mm;
-    if (z >= properties.detector_length - properties.hole_depth) {
-      if (z >= properties.detector_length - properties.hole_depth + properties.hole_radius) {
-        rInnerTemp[i] = properties.hole_radius;
-      } else {
-        rInnerTemp[i] = properties.hole_radius * sqrt(1. - pow((z - (properties.detector_length - properties.hole_depth + properties.hole_radius)) / properties.hole_radius, 2));
-      }
+  G4VSolid *crystal_solid = DetectorCache::Find_Solid(model, "crystal");
+  if (!crystal_solid) {
+    // The front face of the crystal (z = 0) has a rounded edge, and the core hole, which is open at
+    // the back, ends in a hemisphere.
+    PolyconeProfile crystal_profile(detector_name + "_crystal_solid");
+    crystal_profile.Add_Point(0., 0.);
+    crystal_profile.Add_Arc(properties.detector_radius - properties.detector_face_radius, properties.detector_face_radius, properties.detector_face_radius, properties.detector_face_radius, -90. * deg, 0.);
+    crystal_profile.Add_Point(properties.detector_radius, properties.detector_length);
+    if (properties.hole_radius > 0. && properties.hole_depth > 0.) {
+      crystal_profile.Add_Point(properties.hole_radius, properties.detector_length);
+      crystal_profile.Add_Arc(0., properties.detector_length - properties.hole_depth + properties.hole_radius, properties.hole_radius, properties.hole_radius, 0., -90. * deg);
     } else {
-      rInnerTemp[i] = 0.;
+      crystal_profile.Add_Point(0., properties.detector_length);
     }
 
-    if (z >= properties.detector_face_radius) {
-      rOuterTemp[i] = properties.detector_radius;
-    } else if (z >= 0.) {
-      rOuterTemp[i] = properties.detector_face_radius * sqrt(1. - pow((z - properties.detector_face_radius) / properties.detector_face_radius, 2)) + (properties.detector_radius - properties.detector_face_radius);
-    } else {
-      rOuterTemp[i] = 0. * mm;
-    }
+    crystal_solid = DetectorCache::Add_Solid(model, "crystal", crystal_profile.Construct());
   }
-
-  nsteps_optimized = opt->Optimize(zPlaneTemp, rInnerTemp, rOuterTemp, zPlane, rInner, rOuter, nsteps, detector_name + "_crystal_solid");
-
-  G4Polycone *crystal_solid = new G4Polycone("crystal_solid", 0. * deg, 360. * deg, nsteps_optimized, zPlane, rInner, rOuter);
   G4LogicalVolume *crystal_logical = new G4LogicalVolume(crystal_solid, nist->FindOrBuildMaterial("G4_Ge"), detector_name, 0, 0, 0);
   crystal_logical->SetVisAttributes(new G4VisAttributes(G4Color::Green()));
   new G4PVPlacement(0, G4ThreeVector(0., 0., -end_cap_side_length * 0.5 + properties.end_cap_to_crystal_gap_front + properties.mount_cup_thickness), crystal_logical, detector_name + "_crystal", end_cap_vacuum_logical, 0, 0, false);
 
   if (use_dewar) {
     /************* Connection dewar-detector *************/
-    G4Tubs *connection_solid = new G4Tubs(detector_name + "_dewar_connection_solid", 0., properties.connection_radius, properties.connection_length * 0.5, 0., twopi);
+    G4VSolid *connection_solid = DetectorCache::Find_Solid(model, "dewar_connection");
+    if (!connection_solid) {
+      connection_solid = DetectorCache::Add_Solid(model, "dewar_connection", new G4Tubs(detector_name + "_dewar_connection_solid", 0., properties.connection_radius, properties.connection_length * 0.5, 0., twopi));
+    }
     G4LogicalVolume *connection_logical = new G4LogicalVolume(connection_solid, nist->FindOrBuildMaterial(properties.connection_material), detector_name + "_dewar_connection_logical");
     connection_logical->SetVisAttributes(new G4VisAttributes(G4Color::White()));
     new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_window_thickness + end_cap_side_length + properties.connection_length * 0.5) * symmetry_axis, connection_logical, detector_name + "_dewar_connection", world_Logical, 0, 0, false);
@@ -182,16 +174,22 @@ void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G
 
     /************* Dewar *************/
     // Dewar face
-    G4Tubs *dewar_solid = new G4Tubs(detector_name + "_dewar_solid", 0., properties.dewar_outer_radius, properties.dewar_length * 0.5, 0., twopi);
+    G4VSolid *dewar_solid = DetectorCache::Find_Solid(model, "dewar");
+    if (!dewar_solid) {
+      dewar_solid = DetectorCache::Add_Solid(model, "dewar", new G4Tubs(detector_name + "_dewar_solid", 0., properties.dewar_outer_radius, properties.dewar_length * 0.5, 0., twopi));
+    }
     G4LogicalVolume *dewar_logical = new G4LogicalVolume(dewar_solid, nist->FindOrBuildMaterial(properties.dewar_material), detector_name + "_dewar_logical");
     dewar_logical->SetVisAttributes(G4Color::Brown());
-    new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_window_thickness + end_cap_side_length + properties.connection_length + properties.dewar_length * 0.5) * symmetry_axis, dewar_logical, detector_name + "_dewar", world_Logical, 0, 0, false);
 
     // Dewar interior
-    G4Tubs *dewar_interior_solid = new G4Tubs(detector_name + "_dewar_interior_solid", 0., properties.dewar_outer_radius - properties.dewar_wall_thickness, properties.dewar_length * 0.5 - properties.dewar_wall_thickness, 0., twopi);
+    G4VSolid *dewar_interior_solid = DetectorCache::Find_Solid(model, "dewar_interior");
+    if (!dewar_interior_solid) {
+      dewar_interior_solid = DetectorCache::Add_Solid(model, "dewar_interior", new G4Tubs(detector_name + "_dewar_interior_solid", 0., properties.dewar_outer_radius - properties.dewar_wall_thickness, properties.dewar_length * 0.5 - properties.dewar_wall_thickness, 0., twopi));
+    }
     G4LogicalVolume *dewar_interior_logical = new G4LogicalVolume(dewar_interior_solid, nist->FindOrBuildMaterial("G4_N"), detector_name + "_dewar_interior_logical");
     dewar_interior_logical->SetVisAttributes(G4Color::Red());
     new G4PVPlacement(0, G4ThreeVector(0., 0., 0.), dewar_interior_logical, detector_name + "_dewar_interior", dewar_logical, 0, 0, false);
+    new G4PVPlacement(rotation, global_coordinates + (dist_from_center + properties.end_cap_window_thickness + end_cap_side_length + properties.connection_length + properties.dewar_length * 0.5) * symmetry_axis, dewar_logical, detector_name + "_dewar", world_Logical, 0, 0, false);
   }
 
   // Filters
@@ -251,6 +249,10 @@ void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G
   }
 }
 
+G4String HPGe_Coaxial::Model_Key() const {
+  return DetectorCache::Model_Key("HPGe_Coaxial", properties.detector_radius, properties.detector_length, properties.detector_face_radius, properties.hole_radius, properties.hole_depth, properties.hole_face_radius, properties.mount_cup_length, properties.mount_cup_thickness, properties.mount_cup_base_thickness, properties.mount_cup_material, properties.end_cap_to_crystal_gap_front, properties.end_cap_to_crystal_gap_side, properties.end_cap_thickness, properties.end_cap_length, properties.end_cap_outer_radius, properties.end_cap_window_thickness, properties.end_cap_material, properties.end_cap_window_material, properties.cold_finger_radius, properties.cold_finger_penetration_depth, properties.cold_finger_material, properties.connection_length, properties.connection_radius, properties.dewar_offset, properties.connection_material, properties.dewar_length, properties.dewar_outer_radius, properties.dewar_wall_thickness, properties.dewar_material);
+}
+
 void HPGe_Coaxial::Construct(G4ThreeVector global_coordinates, G4double theta, G4double phi,
                              G4double dist_from_center) const {
   Construct(global_coordinates, theta, phi, dist_from_center, 0.);
@@ -32,6 +32,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4Tubs.hh"
 #include "G4VisAttributes.hh"
 
+#include "DetectorCache.hh"
 #include "Filter_Case.hh"
 #include "LaBr_3x3.hh"
 #include "Units.hh"
@@ -88,29 +89,37 @@ void LaBr_3x3::Construct(G4ThreeVector global_coordinates, G4double theta, G4dou
   const auto circuit_housing_3_and_pmt_length = circuit_housing_3_length + pmt_housing_length;
   const auto circuit_housing_3_and_pmt_radius = circuit_housing_3_radius;
 
+  // Identical detectors share the solids, each detector has its own logical volumes.
+  const G4String model = DetectorCache::Model_Key("LaBr_3x3", use_housing);
+
   /************** Crystal housing *************/
 
-  auto *crystal_housing_solid = new G4Tubs(detector_name + "_crystal_housing_solid", 0., crystal_housing_outer_radius, crystal_housing_length / 2., 0., twopi);
+  G4VSolid *crystal_housing_solid = DetectorCache::Find_Solid(model, "crystal_housing");
+  if (!crystal_housing_solid) {
+    crystal_housing_solid = DetectorCache::Add_Solid(model, "crystal_housing", new G4Tubs(detector_name + "_crystal_housing_solid", 0., crystal_housing_outer_radius, crystal_housing_length / 2., 0., twopi));
+  }
   auto *crystal_housing_logical = new G4LogicalVolume(crystal_housing_solid, nist->FindOrBuildMaterial("G4_Al"), detector_name + "_crystal_housing_logical");
   crystal_housing_logical->SetVisAttributes(G4Color::Grey());
   new G4PVPlacement(rotation, global_coordinates + (dist_from_center + crystal_housing_length / 2.) * symmetry_axis, crystal_housing_logical, detector_name + "_crystal_housing", world_Logical, 0, 0, CheckOverlaps);
 
   /************** Vacuum around crystal *************/
 
-  auto *vacuum_solid = new G4Tubs(detector_name + "_vacuum_solid", 0., crystal_housing_outer_radius - crystal_housing_thickness, vacuum_length / 2., 0., twopi);
+  G4VSolid *vacuum_solid = DetectorCache::Find_Solid(model, "vacuum");
+  if (!vacuum_solid) {
+    vacuum_solid = DetectorCache::Add_Solid(model, "vacuum", new G4Tubs(detector_name + "_vacuum_solid", 0., crystal_housing_outer_radius - crystal_housing_thickness, vacuum_length / 2., 0., twopi));
+  }
   auto *vacuum_logical = new G4LogicalVolume(vacuum_solid, nist->FindOrBuildMaterial("G4_Galactic"), detector_name + "_vacuum_logical");
   vacuum_logical->SetVisAttributes(G4Color::Cyan());
   new G4PVPlacement(nullptr, G4ThreeVector(0., 0., crystal_housing_thickness / 2. - crystal_housing_thickness_back / 2.), vacuum_logical, detector_name + "_vacuum", crystal_housing_logical, 0, 0, CheckOverlaps);
 
   /************** Detector crystal *************/
 
-  // Brillance 380 from Enrique Nacher (Santiago)
-  auto *LaBr3Ce = new G4Material("LaBr3Ce", 5.06 * g / cm3, 3);
-  LaBr3Ce->AddElement(nist->FindOrBuildElement("La"), 34.855 * perCent);
-  LaBr3Ce->AddElement(nist->FindOrBuildElement("Br"), 60.145 * perCent);
-  LaBr3Ce->AddElement(nist->FindOrBuildElement("Ce"), 5.0 * perCent);
+  auto *LaBr3Ce = DetectorCache::Find_Or_Build_LaBr3Ce();
 
-  auto *crystal_solid = new G4Tubs(detector_name + "_crystal_solid", 0., crystal_radius, crystal_length / 2., 0., twopi);
+  G4VSolid *crystal_solid = DetectorCache::Find_Solid(model, "crystal");
+  if (!crystal_solid) {
+    crystal_solid = DetectorCache::Add_Solid(model, "crystal", new G4Tubs(detector_name + "_crystal_solid", 0., crystal_radius, crystal_length / 2., 0., twopi));
+  }
   auto *crystal_logical = new G4LogicalVolume(crystal_solid, LaBr3Ce, detector_name);
   crystal_logical->SetVisAttributes(G4Color::Green());
   new G4PVPlacement(nullptr, G4ThreeVector(0., 0., vacuum_thickness_front / 2. - vacuum_thickness_back / 2.), crystal_logical, detector_name + "_crystal", vacuum_logical, 0, 0, CheckOverlaps);
@@ -118,29 +127,41 @@ void LaBr_3x3::Construct(G4ThreeVector global_coordinates, G4double theta, G4dou
   if (use_housing) {
     /************** Circuit housing 1 *************/
 
-    auto *circuit_housing_1_solid = new G4Tubs(detector_name + "_circuit_housing_1_solid", crystal_housing_outer_radius - crystal_housing_thickness, circuit_housing_1_radius, circuit_housing_1_length / 2., 0., twopi);
+    G4VSolid *circuit_housing_1_solid = DetectorCache::Find_Solid(model, "circuit_housing_1");
+    if (!circuit_housing_1_solid) {
+      circuit_housing_1_solid = DetectorCache::Add_Solid(model, "circuit_housing_1", new G4Tubs(detector_name + "_circuit_housing_1_solid", crystal_housing_outer_radius - crystal_housing_thickness, circuit_housing_1_radius, circuit_housing_1_length / 2., 0., twopi));
+    }
     auto *circuit_housing_1_logical = new G4LogicalVolume(circuit_housing_1_solid, nist->FindOrBuildMaterial("G4_Al"), detector_name + "_circuit_housing_1_logical");
     circuit_housing_1_logical->SetVisAttributes(G4Color::Grey());
     new G4PVPlacement(rotation, global_coordinates + (dist_from_center + crystal_housing_length + circuit_housing_1_length / 2.) * symmetry_axis, circuit_housing_1_logical, detector_name + "_circuit_housing_1", world_Logical, 0, 0, CheckOverlaps);
 
     /************** Circuit housing 2 *************/
 
-    G4Cons *circuit_housing_2_solid = new G4Cons("circuit_housing_2_solid", circuit_housing_2_rmax - circuit_housing_thickness, circuit_housing_2_rmax, circuit_housing_2_rmin - circuit_housing_thickness, circuit_housing_2_rmin, circuit_housing_2_length / 2., 0., twopi);
+    G4VSolid *circuit_housing_2_solid = DetectorCache::Find_Solid(model, "circuit_housing_2");
+    if (!circuit_housing_2_solid) {
+      circuit_housing_2_solid = DetectorCache::Add_Solid(model, "circuit_housing_2", new G4Cons("circuit_housing_2_solid", circuit_housing_2_rmax - circuit_housing_thickness, circuit_housing_2_rmax, circuit_housing_2_rmin - circuit_housing_thickness, circuit_housing_2_rmin, circuit_housing_2_length / 2., 0., twopi));
+    }
     auto *circuit_housing_2_logical = new G4LogicalVolume(circuit_housing_2_solid, nist->FindOrBuildMaterial("G4_Al"), detector_name + "_circuit_housing_2_logical");
     circuit_housing_2_logical->SetVisAttributes(G4Color::Grey());
     new G4PVPlacement(rotation, global_coordinates + (dist_from_center + crystal_housing_length + circuit_housing_1_length + circuit_housing_2_length / 2.) * symmetry_axis, circuit_housing_2_logical, detector_name + "_circuit_housing_2", world_Logical, 0, 0, CheckOverlaps);
 
     /************** Circuit housing 3 with PMT *************/
 
-    auto *circuit_housing_3_and_pmt_solid = new G4Tubs(detector_name + "_circuit_housing_3_and_pmt_solid", 0., circuit_housing_3_and_pmt_radius, circuit_housing_3_and_pmt_length / 2., 0., twopi);
+    G4VSolid *circuit_housing_3_and_pmt_solid = DetectorCache::Find_Solid(model, "circuit_housing_3_and_pmt");
+    if (!circuit_housing_3_and_pmt_solid) {
+      circuit_housing_3_and_pmt_solid = DetectorCache::Add_Solid(model, "circuit_housing_3_and_pmt", new G4Tubs(detector_name + "_circuit_housing_3_and_pmt_solid", 0., circuit_housing_3_and_pmt_radius, circuit_housing_3_and_pmt_length / 2., 0., twopi));
+    }
     auto *circuit_housing_3_and_pmt_logical = new G4LogicalVolume(circuit_housing_3_and_pmt_solid, nist->FindOrBuildMaterial("G4_Al"), detector_name + "_circuit_housing_3_and_pmt_logical");
     circuit_housing_3_and_pmt_logical->SetVisAttributes(G4Color::Grey());
-    new G4PVPlacement(rotation, global_coordinates + (dist_from_center + crystal_housing_length + circuit_housing_1_length + circuit_housing_2_length + circuit_housing_3_and_pmt_length / 2.) * symmetry_axis, circuit_housing_3_and_pmt_logical, detector_name + "_circuit_housing_3_and_pmt", world_Logical, 0, 0, CheckOverlaps);
 
-    auto *circuit_housing_3_and_pmt_interior_solid = new G4Tubs(detector_name + "_circuit_housing_3_and_pmt_interior_solid", 0., circuit_housing_3_and_pmt_radius - circuit_housing_thickness, (circuit_housing_3_and_pmt_length - circuit_housing_thickness) / 2., 0., twopi);
+    G4VSolid *circuit_housing_3_and_pmt_interior_solid = DetectorCache::Find_Solid(model, "circuit_housing_3_and_pmt_interior");
+    if (!circuit_housing_3_and_pmt_interior_solid) {
+      circuit_housing_3_and_pmt_interior_solid = DetectorCache::Add_Solid(model, "circuit_housing_3_and_pmt_interior", new G4Tubs(detector_name + "_circuit_housing_3_and_pmt_interior_solid", 0., circuit_housing_3_and_pmt_radius - circuit_housing_thickness, (circuit_housing_3_and_pmt_length - circuit_housing_thickness) / 2., 0., twopi));
+    }
     auto *circuit_housing_3_and_pmt_interior_logical = new G4LogicalVolume(circuit_housing_3_and_pmt_interior_solid, nist->FindOrBuildMaterial("G4_AIR"), detector_name + "_circuit_housing_3_and_pmt_interior_logical");
     circuit_housing_3_and_pmt_interior_logical->SetVisAttributes(G4Color::White());
     new G4PVPlacement(nullptr, G4ThreeVector(0., 0., -circuit_housing_thickness / 2.), circuit_housing_3_and_pmt_interior_logical, detector_name + "_circuit_housing_3_and_pmt_interior", circuit_housing_3_and_pmt_logical, 0, 0, CheckOverlaps);
+    new G4PVPlacement(rotation, global_coordinates + (dist_from_center + crystal_housing_length + circuit_housing_1_length + circuit_housing_2_length + circuit_housing_3_and_pmt_length / 2.) * symmetry_axis, circuit_housing_3_and_pmt_logical, detector_name + "_circuit_housing_3_and_pmt", world_Logical, 0, 0, CheckOverlaps);
   }
 
   // Filters
@@ -41,6 +41,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4UnitsTable.hh"
 #include "Units.hh"
 
+#include "DetectorCache.hh"
 #include "NamedColors.hh"
 
 LaBr_TUD::LaBr_TUD(G4String Detector_Name) {
@@ -80,18 +81,30 @@ LaBr_TUD::LaBr_TUD(G4String Detector_Name) {
   Radius = Circuit_Housing_1_Radius;
   Front_Radius = Crystal_Housing_Outer_Radius;
 
-  G4Tubs *LaBr_TUD_Solid = new G4Tubs("LaBr_TUD_Solid", 0., Radius, Length * 0.5, 0., twopi);
+  // All detectors share the solids, each detector has its own logical volumes
+  const G4String model = "LaBr_TUD";
+
+  G4VSolid *LaBr_TUD_Solid = DetectorCache::Find_Solid(model, "LaBr_TUD");
+  if (!LaBr_TUD_Solid) {
+    LaBr_TUD_Solid = DetectorCache::Add_Solid(model, "LaBr_TUD", new G4Tubs("LaBr_TUD_Solid", 0., Radius, Length * 0.5, 0., twopi));
+  }
   LaBr_TUD_Logical = new G4LogicalVolume(LaBr_TUD_Solid, air, "LaBr_TUD_Logical");
   LaBr_TUD_Logical->SetVisAttributes(G4VisAttributes::GetInvisible());
 
   /*********************** LaBr Crystal Housing *********************/
 
-  G4Tubs *Crystal_Housing_Lid_Solid = new G4Tubs("Crystal_Housing_Lid_Solid", 0., Crystal_Housing_Outer_Radius, Crystal_Housing_Thickness * 0.5, 0., twopi);
+  G4VSolid *Crystal_Housing_Lid_Solid = DetectorCache::Find_Solid(model, "Crystal_Housing_Lid");
+  if (!Crystal_Housing_Lid_Solid) {
+    Crystal_Housing_Lid_Solid = DetectorCache::Add_Solid(model, "Crystal_Housing_Lid", new G4Tubs("Crystal_Housing_Lid_Solid", 0., Crystal_Housing_Outer_Radius, Crystal_Housing_Thickness * 0.5, 0., twopi));
+  }
   G4LogicalVolume *Crystal_Housing_Lid_Logical = new G4LogicalVolume(Crystal_Housing_Lid_Solid, Al, "Crystal_Housing_Lid_Logical");
   Crystal_Housing_Lid_Logical->SetVisAttributes(grey);
 
   G4double Crystal_Housing_Wall_Length = Vacuum_Thickness_Front + Crystal_Length + Vacuum_Thickness_Back;
-  G4Tubs *Crystal_Housing_Wall_Solid = new G4Tubs("Crystal_Housing_Wall_Solid", Crystal_Housing_Outer_Radius - Crystal_Housing_Thickness, Crystal_Housing_Outer_Radius, Crystal_Housing_Wall_Length * 0.5, 0., twopi);
+  G4VSolid *Crystal_Housing_Wall_Solid = DetectorCache::Find_Solid(model, "Crystal_Housing_Wall");
+  if (!Crystal_Housing_Wall_Solid) {
+    Crystal_Housing_Wall_Solid = DetectorCache::Add_Solid(model, "Crystal_Housing_Wall", new G4Tubs("Crystal_Housing_Wall_Solid", Crystal_Housing_Outer_Radius - Crystal_Housing_Thickness, Crystal_Housing_Outer_Radius, Crystal_Housing_Wall_Length * 0.5, 0., twopi));
+  }
   G4LogicalVolume *Crystal_Housing_Wall_Logical = new G4LogicalVolume(Crystal_Housing_Wall_Solid, Al, "Crystal_Housing_Wall_Logical");
   Crystal_Housing_Wall_Logical->SetVisAttributes(cyan);
 
@@ -103,36 +116,32 @@ LaBr_TUD::LaBr_TUD(G4String Detector_Name) {
 
   /************************ Vacuum Layer *****************************/
 
-  G4Tubs *Vacuum_Front_Solid = new G4Tubs("Vacuum_Front_Solid", 0, Crystal_Housing_Outer_Radius - Crystal_Housing_Thickness, Vacuum_Thickness_Front * 0.5, 0., twopi);
-  G4LogicalVolume *Vacuum_Front_Logical =
-      new G4LogicalVolume(Vacuum_Front_Solid, vacuum, "Vacuum_Front_Logical");
+  G4VSolid *Vacuum_Front_Solid = DetectorCache::Find_Solid(model, "Vacuum_Front");
+  if (!Vacuum_Front_Solid) {
+    Vacuum_Front_Solid = DetectorCache::Add_Solid(model, "Vacuum_Front", new G4Tubs("Vacuum_Front_Solid", 0, Crystal_Housing_Outer_Radius - Crystal_Housing_Thickness, Vacuum_Thickness_Front * 0.5, 0., twopi));
+  }
+  G4LogicalVolume *Vacuum_Front_Logical = new G4LogicalVolume(Vacuum_Front_Solid, vacuum, "Vacuum_Front_Logical");
   Vacuum_Front_Logical->SetVisAttributes(white);
 
   new G4PVPlacement(0, G4ThreeVector(0., 0., Length * 0.5 - Crystal_Housing_Thickness - Vacuum_Thickness_Front * 0.5), Vacuum_Front_Logical, "Vacuum_Front", LaBr_TUD_Logical, false, 0, false);
 
-  G4Tubs *Vacuum_Back_Solid = new G4Tubs("Vacuum_Back_Solid", 0, Crystal_Housing_Outer_Radius - Crystal_Housing_Thickness, Vacuum_Thickness_Back * 0.5, 0., twopi);
-  G4LogicalVolume *Vacuum_Back_Logical =
-      new G4LogicalVolume(Vacuum_Back_Solid, vacuum, "Vacuum_Back_Logical");
+  G4VSolid *Vacuum_Back_Solid = DetectorCache::Find_Solid(model, "Vacuum_Back");
+  if (!Vacuum_Back_Solid) {
+    Vacuum_Back_Solid = DetectorCache::Add_Solid(model, "Vacuum_Back", new G4Tubs("Vacuum_Back_Solid", 0, Crystal_Housing_Outer_Radius - Crystal_Housing_Thickness, Vacuum_Thickness_Back * 0.5, 0., twopi));
+  }
+  G4LogicalVolume *Vacuum_Back_Logical = new G4LogicalVolume(Vacuum_Back_Solid, vacuum, "Vacuum_Back_Logical");
   Vacuum_Back_Logical->SetVisAttributes(white);
 
   new G4PVPlacement(0, G4ThreeVector(0., 0., Length * 0.5 - Crystal_Housing_Thickness - Vacuum_Thickness_Front - Crystal_Length - Vacuum_Thickness_Back * 0.5), Vacuum_Back_Logical, "Vacuum_Back", LaBr_TUD_Logical, false, 0, false);
 
   /************************LaBr Crystal*************************/
 
-  G4Element *nat_La = nist->FindOrBuildElement("La");
-  G4Element *nat_Br = nist->FindOrBuildElement("Br");
-  G4Element *nat_Ce = nist->FindOrBuildElement("Ce");
-  G4double labr_density = 5.06 * g / cm3;
-
-  // Brillance 380 from Enrique Nacher (Santiago)
-  G4Material *LaBr3Ce = new G4Material("LaBr3Ce", labr_density, 3);
-  LaBr3Ce->AddElement(nat_La, 34.855 * perCent);
-  LaBr3Ce->AddElement(nat_Br, 60.145 * perCent);
-  LaBr3Ce->AddElement(nat_Ce, 5.0 * perCent);
+  G4Material *LaBr3Ce = DetectorCache::Find_Or_Build_LaBr3Ce();
 
-  G4Tubs *Crystal_Solid =
-      new G4Tubs("Crystal_Solid", 0., Crystal_Radius,
-                 Crystal_Length * 0.5, 0. * deg, 360. * deg);
+  G4VSolid *Crystal_Solid = DetectorCache::Find_Solid(model, "Crystal");
+  if (!Crystal_Solid) {
+    Crystal_Solid = DetectorCache::Add_Solid(model, "Crystal", new G4Tubs("Crystal_Solid", 0., Crystal_Radius, Crystal_Length * 0.5, 0. * deg, 360. * deg));
+  }
   G4LogicalVolume *Crystal_Logical =
       new G4LogicalVolume(Crystal_Solid, LaBr3Ce, Detector_Name, 0, 0, 0);
 
@@ -142,47 +151,44 @@ LaBr_TUD::LaBr_TUD(G4String Detector_Name) {
 
   /************************ Circuit Housing 1 *************************/
 
-  G4Tubs *Circuit_Housing_1_Solid =
-      new G4Tubs("Circuit_Housing_1_Solid", 0., Circuit_Housing_1_Radius,
-                 Circuit_Housing_1_Length * 0.5, 0. * deg, 360. * deg);
-  G4LogicalVolume *Circuit_Housing_1_Logical =
-      new G4LogicalVolume(Circuit_Housing_1_Solid, Al, "Circuit_Housing_1_Logical", 0, 0, 0);
-
+  G4VSolid *Circuit_Housing_1_Solid = DetectorCache::Find_Solid(model, "Circuit_Housing_1");
+  if (!Circuit_Housing_1_Solid) {
+    Circuit_Housing_1_Solid = DetectorCache::Add_Solid(model, "Circuit_Housing_1", new G4Tubs("Circuit_Housing_1_Solid", 0., Circuit_Housing_1_Radius, Circuit_Housing_1_Length * 0.5, 0. * deg, 360. * deg));
+  }
+  G4LogicalVolume *Circuit_Housing_1_Logical = new G4LogicalVolume(Circuit_Housing_1_Solid, Al, "Circuit_Housing_1_Logical", 0, 0, 0);
   Circuit_Housing_1_Logical->SetVisAttributes(grey);
 
   new G4PVPlacement(0, G4ThreeVector(0., 0., Length * 0.5 - Vacuum_Thickness_Front - Crystal_Length - Vacuum_Thickness_Back - Crystal_Housing_Thickness * 2. - Circuit_Housing_1_Length * 0.5), Circuit_Housing_1_Logical, "Circuit_Housing_1", LaBr_TUD_Logical, false, 0, false);
 
   /************************ Circuit Housing 2 *************************/
 
-  G4Cons *Circuit_Housing_2_Solid =
-      new G4Cons("Circuit_Housing_2_Solid", 0., Circuit_Housing_2_Rmin, 0., Circuit_Housing_2_Rmax, Circuit_Housing_2_Length * 0.5, 0. * deg, 360. * deg);
-  G4LogicalVolume *Circuit_Housing_2_Logical =
-      new G4LogicalVolume(Circuit_Housing_2_Solid, Al, "Circuit_Housing_2_Logical", 0, 0, 0);
-
+  G4VSolid *Circuit_Housing_2_Solid = DetectorCache::Find_Solid(model, "Circuit_Housing_2");
+  if (!Circuit_Housing_2_Solid) {
+    Circuit_Housing_2_Solid = DetectorCache::Add_Solid(model, "Circuit_Housing_2", new G4Cons("Circuit_Housing_2_Solid", 0., Circuit_Housing_2_Rmin, 0., Circuit_Housing_2_Rmax, Circuit_Housing_2_Length * 0.5, 0. * deg, 360. * deg));
+  }
+  G4LogicalVolume *Circuit_Housing_2_Logical = new G4LogicalVolume(Circuit_Housing_2_Solid, Al, "Circuit_Housing_2_Logical", 0, 0, 0);
   Circuit_Housing_2_Logical->SetVisAttributes(grey);
 
   new G4PVPlacement(0, G4ThreeVector(0., 0., Length * 0.5 - Vacuum_Thickness_Front - Crystal_Length - Vacuum_Thickness_Back - Crystal_Housing_Thickness * 2. - Circuit_Housing_1_Length - Circuit_Housing_2_Length * 0.5), Circuit_Housing_2_Logical, "Circuit_Housing_2", LaBr_TUD_Logical, false, 0, false);
 
   /************************ Circuit Housing 3 *************************/
 
-  G4Tubs *Circuit_Housing_3_Solid =
-      new G4Tubs("Circuit_Housing_3_Solid", 0., Circuit_Housing_3_Radius,
-                 Circuit_Housing_3_Length * 0.5, 0. * deg, 360. * deg);
-  G4LogicalVolume *Circuit_Housing_3_Logical =
-      new G4LogicalVolume(Circuit_Housing_3_Solid, Al, "Circuit_Housing_3_Logical", 0, 0, 0);
-
+  G4VSolid *Circuit_Housing_3_Solid = DetectorCache::Find_Solid(model, "Circuit_Housing_3");
+  if (!Circuit_Housing_3_Solid) {
+    Circuit_Housing_3_Solid = DetectorCache::Add_Solid(model, "Circuit_Housing_3", new G4Tubs("Circuit_Housing_3_Solid", 0., Circuit_Housing_3_Radius, Circuit_Housing_3_Length * 0.5, 0. * deg, 360. * deg));
+  }
+  G4LogicalVolume *Circuit_Housing_3_Logical = new G4LogicalVolume(Circuit_Housing_3_Solid, Al, "Circuit_Housing_3_Logical", 0, 0, 0);
   Circuit_Housing_3_Logical->SetVisAttributes(grey);
 
   new G4PVPlacement(0, G4ThreeVector(0., 0., Length * 0.5 - Vacuum_Thickness_Front - Crystal_Length - Vacuum_Thickness_Back - Crystal_Housing_Thickness * 2. - Circuit_Housing_1_Length - Circuit_Housing_2_Length - Circuit_Housing_3_Length * 0.5), Circuit_Housing_3_Logical, "Circuit_Housing_3", LaBr_TUD_Logical, false, 0, false);
 
   /************************ PMT Housing *************************/
 
-  G4Tubs *PMT_Housing_Solid =
-      new G4Tubs("PMT_Housing_Solid", 0., PMT_Housing_Radius,
-                 PMT_Housing_Length * 0.5, 0. * deg, 360. * deg);
-  G4LogicalVolume *PMT_Housing_Logical =
-      new G4LogicalVolume(PMT_Housing_Solid, Al, "PMT_Housing_Logical", 0, 0, 0);
-
+  G4VSolid *PMT_Housing_Solid = DetectorCache::Find_Solid(model, "PMT_Housing");
+  if (!PMT_Housing_Solid) {
+    PMT_Housing_Solid = DetectorCache::Add_Solid(model, "PMT_Housing", new G4Tubs("PMT_Housing_Solid", 0., PMT_Housing_Radius, PMT_Housing_Length * 0.5, 0. * deg, 360. * deg));
+  }
+  G4LogicalVolume *PMT_Housing_Logical = new G4LogicalVolume(PMT_Housing_Solid, Al, "PMT_Housing_Logical", 0, 0, 0);
   PMT_Housing_Logical->SetVisAttributes(grey);
 
   new G4PVPlacement(0, G4ThreeVector(0., 0., Length * 0.5 - Vacuum_Thickness_Front - Crystal_Length - Vacuum_Thickness_Back - Crystal_Housing_Thickness * 2. - Circuit_Housing_1_Length - Circuit_Housing_2_Length - Circuit_Housing_2_Length - PMT_Housing_Length * 0.5), PMT_Housing_Logical, "PMT_Housing", LaBr_TUD_Logical, false, 0, false);
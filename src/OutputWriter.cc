@@ -0,0 +1,426 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sys/stat.h>
+#include <thread>
+
+#include "G4AutoLock.hh"
+#include "G4RootAnalysisManager.hh"
+#include "G4Threading.hh"
+#include "G4Version.hh"
+
+#include "tools/wroot/file"
+#include "tools/wroot/ntuple"
+#include "tools/zlib"
+
+#include "GeometryLoader.hh"
+#include "OutputWriter.hh"
+#include "RunAction.hh"
+#include "Trigger.hh"
+
+#include "utrConfig.h"
+
+namespace {
+  G4Mutex channelsMutex = G4MUTEX_INITIALIZER;
+  std::vector<std::thread> writer_threads;
+  std::atomic<bool> stop_writer_threads(false);
+}
+
+// Names of the ntuple and its columns, as booked in the analysis manager
+struct OutputWriter_Booking {
+  G4String name;
+  G4String title;
+  std::vector<G4String> columns;
+};
+
+// Output file with the ntuple which is filled by a writer thread. The ntuple belongs to the
+// directory of the file and is deleted when the file is closed.
+struct OutputWriter_File {
+  G4String filename;
+  tools::wroot::file file;
+  tools::wroot::ntuple *ntuple = nullptr;
+  std::vector<tools::wroot::ntuple::column<G4double> *> columns;
+
+  OutputWriter_File(const G4String &name) : filename(name), file(G4cout, name) {}
+};
+
+// Output of the calling thread
+static G4ThreadLocal OutputWriter_Channel *thread_channel = nullptr;
+static G4ThreadLocal OutputWriter_Booking *thread_booking = nullptr;
+
+G4bool OutputWriter::asynchronous = false;
+G4int OutputWriter::n_writer_threads = 1;
+G4int OutputWriter::buffer_size = 65536;
+G4int OutputWriter::compression_level = 1;
+G4int OutputWriter::basket_size = 0;
+G4int OutputWriter::basket_entries = 0;
+std::vector<std::shared_ptr<OutputWriter_Channel>> OutputWriter::channels = std::vector<std::shared_ptr<OutputWriter_Channel>>();
+G4int OutputWriter::n_registered_channels = 0;
+std::map<G4int, OutputWriter_Statistics> OutputWriter::statistics = std::map<G4int, OutputWriter_Statistics>();
+
+static G4double SecondsSince(const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OutputWriter::Configure(G4RootAnalysisManager *analysis_manager) {
+  analysis_manager->SetCompressionLevel(compression_level);
+  if (basket_size > 0) {
+    analysis_manager->SetBasketSize((unsigned int)basket_size);
+  }
+  if (basket_entries > 0) {
+#if G4VERSION_NUMBER >= 1070
+    analysis_manager->SetBasketEntries((unsigned int)basket_entries);
+#else
+    if (G4Threading::IsMasterThread()) {
+      G4cout << "OutputWriter: Warning! Setting the number of entries per basket requires Geant4 10.7 or later, ignoring /utr/output/basketEntries" << G4endl;
+    }
+#endif
+  }
+}
+
+void OutputWriter::CreateNtuple(const G4String &name, const G4String &title) {
+  G4RootAnalysisManager::Instance()->CreateNtuple(name, title);
+  if (!thread_booking) {
+    thread_booking = new OutputWriter_Booking();
+  }
+  thread_booking->name = name;
+  thread_booking->title = title;
+  thread_booking->columns.clear();
+}
+
+void OutputWriter::CreateNtupleDColumn(const G4String &name) {
+  G4RootAnalysisManager::Instance()->CreateNtupleDColumn(name);
+  thread_booking->columns.push_back(name);
+}
+
+void OutputWriter::BeginOfRun(const G4String &filename) {
+  if (G4Threading::IsMasterThread()) {
+    {
+      G4AutoLock lock(&channelsMutex);
+      statistics.clear();
+    }
+    if (asynchronous) {
+      StartWriterThreads();
+    }
+    // In multithreaded mode, the master thread does not process any events
+    if (G4Threading::IsMultithreadedApplication()) {
+      return;
+    }
+  }
+
+#ifdef EVENT_EVENTWISE
+  const G4int n_columns = GeometryLoader::GetMaxSensitiveDetectorID() + 1;
+#else
+  const G4int n_columns = NFLAGS;
+#endif
+
+  // Without asynchronous output, the channel is only used for the statistics
+  const G4bool async_channel = asynchronous && !G4Threading::IsMasterThread();
+  auto channel = std::make_shared<OutputWriter_Channel>(async_channel ? (size_t)std::max(buffer_size, 1) : 0, (size_t)n_columns);
+  channel->analysis_manager = G4RootAnalysisManager::Instance();
+  channel->hold_events = Trigger::IsActive();
+  if (async_channel) {
+    channel->file = std::make_shared<OutputWriter_File>(filename + ".async");
+    OutputWriter_File &file = *channel->file;
+    if (!file.file.is_open()) {
+      G4cerr << "ERROR: OutputWriter: Could not open '" << file.filename << "'. Aborting..." << G4endl;
+      throw std::exception();
+    }
+    file.file.add_ziper('Z', tools::compress_buffer);
+    file.file.set_compression((unsigned int)compression_level);
+    file.ntuple = new tools::wroot::ntuple(file.file.dir(), thread_booking->name, thread_booking->title);
+    if (basket_size > 0) {
+      file.ntuple->set_basket_size((unsigned int)basket_size);
+    }
+    for (auto &column : thread_booking->columns) {
+      file.columns.push_back(file.ntuple->create_column<G4double>(column));
+    }
+  } else if (asynchronous) {
+    G4cout << "OutputWriter: Warning! The sequential run manager writes the histograms into the output file, ignoring /utr/output/async" << G4endl;
+  }
+  thread_channel = channel.get();
+
+  // Channels without a ring buffer are never assigned to a writer thread
+  G4AutoLock lock(&channelsMutex);
+  channel->writer_id = async_channel ? n_registered_channels++ % n_writer_threads : -1;
+  channels.push_back(channel);
+}
+
+void OutputWriter::EndOfRun(const G4String &filename) {
+  if (thread_channel && thread_channel->n_slots > 0) {
+    // Wait until the writer thread has added all rows to its ntuple. The writer thread updates the
+    // statistics before it marks the ring buffer as empty, and does not touch them or its ntuple afterwards.
+    while (thread_channel->tail.load(std::memory_order_acquire) != thread_channel->head.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
+  const auto write_start = std::chrono::steady_clock::now();
+  analysisManager->Write();
+  analysisManager->CloseFile();
+
+  if (thread_channel && thread_channel->file) {
+    OutputWriter_File &file = *thread_channel->file;
+    unsigned int n_bytes = 0;
+    if (!file.file.write(n_bytes)) {
+      G4cout << "OutputWriter: Error! Could not write '" << file.filename << "'" << G4endl;
+    }
+    file.file.close();
+    // The output file of the analysis manager only contains the empty ntuple
+    if (std::rename(file.filename.c_str(), filename.c_str()) != 0) {
+      G4cout << "OutputWriter: Error! Could not rename '" << file.filename << "' to '" << filename << "'" << G4endl;
+    }
+    thread_channel->file.reset();
+  }
+
+  if (thread_channel) {
+    thread_channel->statistics.write_time += SecondsSince(write_start);
+    struct stat file_info;
+    if (stat(filename.c_str(), &file_info) == 0) {
+      thread_channel->statistics.file_size = (G4double)file_info.st_size;
+    }
+
+    G4AutoLock lock(&channelsMutex);
+    statistics[G4Threading::G4GetThreadId()] = thread_channel->statistics;
+    for (auto channel = channels.begin(); channel != channels.end(); ++channel) {
+      if (channel->get() == thread_channel) {
+        channels.erase(channel);
+        break;
+      }
+    }
+    thread_channel = nullptr;
+  }
+
+  // The worker threads end their runs before the master thread
+  if (G4Threading::IsMasterThread()) {
+    StopWriterThreads();
+  }
+}
+
+void OutputWriter::FillNtupleDColumn(G4int column, G4double value) {
+  if (!thread_channel || (thread_channel->n_slots == 0 && !thread_channel->hold_events)) {
+    G4RootAnalysisManager::Instance()->FillNtupleDColumn(column, value);
+    if (thread_channel) {
+      thread_channel->n_pending = std::max(thread_channel->n_pending, column + 1);
+    }
+    return;
+  }
+
+  if (column < 0 || column >= (G4int)thread_channel->pending.size()) {
+    G4cerr << "ERROR: OutputWriter: Column " << column << " does not exist. Aborting..." << G4endl;
+    throw std::exception();
+  }
+  thread_channel->pending[column] = value;
+  thread_channel->n_pending = std::max(thread_channel->n_pending, column + 1);
+}
+
+void OutputWriter::AddNtupleRow(G4int history) {
+  if (!thread_channel) {
+    G4RootAnalysisManager::Instance()->AddNtupleRow();
+    return;
+  }
+
+  OutputWriter_Channel &channel = *thread_channel;
+  if (channel.hold_events) {
+    // Keep the row until the trigger decision at the end of the event
+    channel.event_rows.push_back(history);
+    channel.event_rows.push_back(channel.n_pending);
+    channel.event_rows.insert(channel.event_rows.end(), channel.pending.begin(), channel.pending.begin() + channel.n_pending);
+    std::fill(channel.pending.begin(), channel.pending.begin() + channel.n_pending, 0.);
+    channel.n_pending = 0;
+    return;
+  }
+
+  WriteRow(channel);
+}
+
+void OutputWriter::EndOfEvent() {
+  if (!thread_channel || !thread_channel->hold_events) {
+    return;
+  }
+
+  OutputWriter_Channel &channel = *thread_channel;
+  for (size_t row = 0; row < channel.event_rows.size(); row += 2 + (size_t)channel.event_rows[row + 1]) {
+    if (!Trigger::IsAccepted((G4int)channel.event_rows[row])) {
+      ++channel.statistics.n_discarded;
+      continue;
+    }
+    channel.n_pending = (G4int)channel.event_rows[row + 1];
+    std::copy(channel.event_rows.begin() + row + 2, channel.event_rows.begin() + row + 2 + channel.n_pending, channel.pending.begin());
+    if (channel.n_slots == 0) {
+      for (G4int column = 0; column < channel.n_pending; ++column) {
+        channel.analysis_manager->FillNtupleDColumn(column, channel.pending[column]);
+      }
+    }
+    WriteRow(channel);
+  }
+  channel.event_rows.clear();
+}
+
+void OutputWriter::WriteRow(OutputWriter_Channel &channel) {
+  ++channel.statistics.n_rows;
+  channel.statistics.data_size += channel.n_pending * sizeof(G4double);
+
+  if (channel.n_slots == 0) {
+    const auto write_start = std::chrono::steady_clock::now();
+    channel.analysis_manager->AddNtupleRow();
+    channel.statistics.write_time += SecondsSince(write_start);
+    std::fill(channel.pending.begin(), channel.pending.begin() + channel.n_pending, 0.);
+    channel.n_pending = 0;
+    return;
+  }
+
+  const size_t head = channel.head.load(std::memory_order_relaxed);
+
+  // Back-pressure: wait until the writer thread has made room for a new row
+  if (head - channel.tail.load(std::memory_order_acquire) >= channel.n_slots) {
+    ++channel.statistics.n_full;
+    const auto wait_start = std::chrono::steady_clock::now();
+    while (head - channel.tail.load(std::memory_order_acquire) >= channel.n_slots) {
+      std::this_thread::yield();
+    }
+    channel.statistics.wait_time += SecondsSince(wait_start);
+  }
+
+  G4double *slot = &channel.values[(head % channel.n_slots) * channel.slot_size];
+  slot[0] = channel.n_pending;
+  std::copy(channel.pending.begin(), channel.pending.begin() + channel.n_pending, slot + 1);
+  std::fill(channel.pending.begin(), channel.pending.begin() + channel.n_pending, 0.);
+  channel.n_pending = 0;
+
+  channel.head.store(head + 1, std::memory_order_release);
+
+  channel.statistics.max_depth = std::max(channel.statistics.max_depth, (G4long)(head + 1 - channel.tail.load(std::memory_order_relaxed)));
+}
+
+void OutputWriter::WriterThread(G4int writer_id) {
+  std::vector<std::shared_ptr<OutputWriter_Channel>> writer_channels;
+
+  while (!stop_writer_threads.load(std::memory_order_acquire)) {
+    {
+      G4AutoLock lock(&channelsMutex);
+      writer_channels.clear();
+      for (auto &channel : channels) {
+        if (channel->writer_id == writer_id) {
+          writer_channels.push_back(channel);
+        }
+      }
+    }
+
+    G4bool idle = true;
+    for (auto &channel : writer_channels) {
+      size_t tail = channel->tail.load(std::memory_order_relaxed);
+      const size_t head = channel->head.load(std::memory_order_acquire);
+      if (tail == head) {
+        continue;
+      }
+      OutputWriter_File &file = *channel->file;
+      const auto write_start = std::chrono::steady_clock::now();
+      for (; tail != head; ++tail) {
+        const G4double *slot = &channel->values[(tail % channel->n_slots) * channel->slot_size];
+        const G4int n_filled = (G4int)slot[0];
+        for (G4int column = 0; column < (G4int)file.columns.size(); ++column) {
+          file.columns[column]->fill(column < n_filled ? slot[column + 1] : 0.);
+        }
+        file.ntuple->add_row();
+        // Make room for the worker thread in between, but only mark the ring buffer as empty below
+        if ((tail & 1023) == 1023 && tail + 1 != head) {
+          channel->tail.store(tail + 1, std::memory_order_release);
+        }
+      }
+      // The worker thread reads the statistics once it sees an empty ring buffer
+      channel->statistics.write_time += SecondsSince(write_start);
+      channel->tail.store(tail, std::memory_order_release);
+      idle = false;
+    }
+
+    if (idle) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+}
+
+void OutputWriter::StartWriterThreads() {
+  StopWriterThreads();
+  stop_writer_threads.store(false, std::memory_order_release);
+  n_registered_channels = 0;
+  for (G4int i = 0; i < n_writer_threads; ++i) {
+    writer_threads.push_back(std::thread(WriterThread, i));
+  }
+}
+
+void OutputWriter::StopWriterThreads() {
+  stop_writer_threads.store(true, std::memory_order_release);
+  for (auto &writer_thread : writer_threads) {
+    writer_thread.join();
+  }
+  writer_threads.clear();
+}
+
+void OutputWriter::PrintStatistics() {
+  G4AutoLock lock(&channelsMutex);
+  if (statistics.size() == 0) {
+    return;
+  }
+
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  G4cout << "OutputWriter: Compression level " << compression_level;
+  if (asynchronous) {
+    G4cout << ", " << n_writer_threads << " writer thread(s), ring buffers with " << buffer_size << " rows";
+  }
+  G4cout << G4endl;
+  G4cout << "\tthread\trows\t\tdata [MB]\tfile [MB]\tratio\twrite time [s]\tthroughput [MB/s]";
+  if (asynchronous) {
+    G4cout << "\tmax. depth\tfull\twait time [s]";
+  }
+  G4cout << G4endl;
+
+  OutputWriter_Statistics total;
+  G4cout << std::fixed;
+  for (auto &thread : statistics) {
+    const OutputWriter_Statistics &s = thread.second;
+    G4cout << "\t" << thread.first << "\t" << std::setw(12) << s.n_rows << "\t" << std::setprecision(1) << std::setw(9) << s.data_size * 1e-6 << "\t" << std::setw(9) << s.file_size * 1e-6 << "\t" << std::setprecision(2) << (s.file_size > 0. ? s.data_size / s.file_size : 0.) << "\t" << std::setw(14) << s.write_time << "\t" << std::setprecision(1) << std::setw(17) << (s.write_time > 0. ? s.data_size * 1e-6 / s.write_time : 0.);
+    if (asynchronous) {
+      G4cout << "\t" << std::setw(10) << s.max_depth << "\t" << s.n_full << "\t" << std::setprecision(3) << s.wait_time;
+    }
+    G4cout << G4endl;
+    total.data_size += s.data_size;
+    total.file_size += s.file_size;
+    total.write_time += s.write_time;
+    total.n_discarded += s.n_discarded;
+  }
+  if (total.file_size > 0.) {
+    G4cout << "OutputWriter: Total " << std::setprecision(1) << total.data_size * 1e-6 << " MB of data in " << total.file_size * 1e-6 << " MB of files (compression ratio " << std::setprecision(2) << total.data_size / total.file_size << ")" << G4endl;
+  }
+  if (total.n_discarded > 0) {
+    G4cout << "OutputWriter: Discarded " << total.n_discarded << " rows of events or histories which were rejected by the trigger" << G4endl;
+  }
+  G4cout << std::defaultfloat << std::setprecision(6);
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
@@ -0,0 +1,112 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OutputWriter.hh"
+#include "OutputWriterMessenger.hh"
+
+OutputWriterMessenger::OutputWriterMessenger() {
+  outputDirectory = new G4UIdirectory("/utr/output/");
+  outputDirectory->SetGuidance("Controls for writing the output files.");
+
+  asyncCmd = new G4UIcmdWithABool("/utr/output/async", this);
+  asyncCmd->SetGuidance("Pass the rows of the output ntuples to writer threads, so that the worker threads do not wait for the compression and writing of the output (default: false).");
+  asyncCmd->SetGuidance("Takes effect at the beginning of the next run.");
+  asyncCmd->SetParameterName("async", true);
+  asyncCmd->SetDefaultValue(true);
+  asyncCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  writerThreadsCmd = new G4UIcmdWithAnInteger("/utr/output/writerThreads", this);
+  writerThreadsCmd->SetGuidance("Set the number of writer threads in asynchronous mode (default: 1). The worker threads are distributed evenly over the writer threads.");
+  writerThreadsCmd->SetParameterName("nWriterThreads", false);
+  writerThreadsCmd->SetRange("nWriterThreads > 0");
+  writerThreadsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  bufferSizeCmd = new G4UIcmdWithAnInteger("/utr/output/bufferSize", this);
+  bufferSizeCmd->SetGuidance("Set the number of rows of the ring buffer of each worker thread in asynchronous mode (default: 65536).");
+  bufferSizeCmd->SetGuidance("A worker thread waits if its ring buffer is full.");
+  bufferSizeCmd->SetParameterName("nRows", false);
+  bufferSizeCmd->SetRange("nRows > 0");
+  bufferSizeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  compressionCmd = new G4UIcmdWithAnInteger("/utr/output/compression", this);
+  compressionCmd->SetGuidance("Set the zlib compression level of the output files between 0 (no compression) and 9 (default: 1).");
+  compressionCmd->SetGuidance("Lower levels reduce the time the threads spend writing the output at the cost of larger files.");
+  compressionCmd->SetParameterName("level", false);
+  compressionCmd->SetRange("level >= 0 && level <= 9");
+  compressionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  basketSizeCmd = new G4UIcmdWithAnInteger("/utr/output/basketSize", this);
+  basketSizeCmd->SetGuidance("Set the size of the baskets of the output ntuples in bytes (default: 0, i.e. the Geant4 default of 32000).");
+  basketSizeCmd->SetGuidance("A basket is compressed and written to the output file when it is full.");
+  basketSizeCmd->SetParameterName("size", false);
+  basketSizeCmd->SetRange("size >= 0");
+  basketSizeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  basketEntriesCmd = new G4UIcmdWithAnInteger("/utr/output/basketEntries", this);
+  basketEntriesCmd->SetGuidance("Set the number of entries per basket of the output ntuples (default: 0, i.e. the Geant4 default). Requires Geant4 10.7 or later.");
+  basketEntriesCmd->SetParameterName("nEntries", false);
+  basketEntriesCmd->SetRange("nEntries >= 0");
+  basketEntriesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+OutputWriterMessenger::~OutputWriterMessenger() {
+  delete asyncCmd;
+  delete writerThreadsCmd;
+  delete bufferSizeCmd;
+  delete compressionCmd;
+  delete basketSizeCmd;
+  delete basketEntriesCmd;
+  delete outputDirectory;
+}
+
+void OutputWriterMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  if (command == asyncCmd) {
+    OutputWriter::SetAsync(asyncCmd->GetNewBoolValue(newValues));
+  } else if (command == writerThreadsCmd) {
+    OutputWriter::SetNumberOfWriterThreads(writerThreadsCmd->GetNewIntValue(newValues));
+  } else if (command == bufferSizeCmd) {
+    OutputWriter::SetBufferSize(bufferSizeCmd->GetNewIntValue(newValues));
+  } else if (command == compressionCmd) {
+    OutputWriter::SetCompressionLevel(compressionCmd->GetNewIntValue(newValues));
+  } else if (command == basketSizeCmd) {
+    OutputWriter::SetBasketSize(basketSizeCmd->GetNewIntValue(newValues));
+  } else if (command == basketEntriesCmd) {
+    OutputWriter::SetBasketEntries(basketEntriesCmd->GetNewIntValue(newValues));
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String OutputWriterMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == asyncCmd) {
+    return asyncCmd->ConvertToString(OutputWriter::IsAsync());
+  } else if (command == writerThreadsCmd) {
+    return writerThreadsCmd->ConvertToString(OutputWriter::GetNumberOfWriterThreads());
+  } else if (command == bufferSizeCmd) {
+    return bufferSizeCmd->ConvertToString(OutputWriter::GetBufferSize());
+  } else if (command == compressionCmd) {
+    return compressionCmd->ConvertToString(OutputWriter::GetCompressionLevel());
+  } else if (command == basketSizeCmd) {
+    return basketSizeCmd->ConvertToString(OutputWriter::GetBasketSize());
+  } else if (command == basketEntriesCmd) {
+    return basketEntriesCmd->ConvertToString(OutputWriter::GetBasketEntries());
+  }
+  return "";
+}
@@ -19,14 +19,17 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "ParticleSD.hh"
+#include "AdjointSimulation.hh"
+#include "ForcedCollisionHistory.hh"
 #include "G4Event.hh"
 #include "G4HCofThisEvent.hh"
-#include "G4RootAnalysisManager.hh"
 #include "G4RunManager.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
 #include "G4ThreeVector.hh"
+#include "OutputWriter.hh"
 #include "RunAction.hh"
+#include "Sharding.hh"
 
 #include "utrConfig.h"
 
@@ -45,6 +48,10 @@ void ParticleSD::Initialize(G4HCofThisEvent *) {}
 
 G4bool ParticleSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
   G4Track *track = aStep->GetTrack();
+  // Adjoint particles are tracked backwards and do not deposit energy
+  if (AdjointSimulation::IsAdjointParticle(track->GetDefinition())) {
+    return false;
+  }
 
   G4int trackID = track->GetTrackID();
   G4int eventID = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
@@ -56,55 +63,59 @@ G4bool ParticleSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
     if (aStep->GetPreStepPoint()->GetKineticEnergy() == 0.)
       return false;
 
-    G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
-
     unsigned int nentry = 0;
 
 #ifdef EVENT_ID
-    analysisManager->FillNtupleDColumn(nentry, eventID);
+    OutputWriter::FillNtupleDColumn(nentry, eventID + Sharding::GetEventOffset());
     ++nentry;
 #endif
 #ifdef EVENT_EDEP
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetTotalEnergyDeposit());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetTotalEnergyDeposit());
     ++nentry;
 #endif
 #ifdef EVENT_EKIN
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetKineticEnergy());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetKineticEnergy());
     ++nentry;
 #endif
 #ifdef EVENT_PARTICLE
-    analysisManager->FillNtupleDColumn(nentry, track->GetDefinition()->GetPDGEncoding());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetDefinition()->GetPDGEncoding());
     ++nentry;
 #endif
 #ifdef EVENT_VOLUME
-    analysisManager->FillNtupleDColumn(nentry, getDetectorID());
+    OutputWriter::FillNtupleDColumn(nentry, getDetectorID());
     ++nentry;
 #endif
 #ifdef EVENT_POSX
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetPosition().x());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetPosition().x());
     ++nentry;
 #endif
 #ifdef EVENT_POSY
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetPosition().y());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetPosition().y());
     ++nentry;
 #endif
 #ifdef EVENT_POSZ
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetPosition().z());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetPosition().z());
     ++nentry;
 #endif
 #ifdef EVENT_MOMX
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetMomentum().x());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetMomentum().x());
     ++nentry;
 #endif
 #ifdef EVENT_MOMY
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetMomentum().y());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetMomentum().y());
     ++nentry;
 #endif
 #ifdef EVENT_MOMZ
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetMomentum().z());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetMomentum().z());
+    ++nentry;
+#endif
+#ifdef EVENT_WEIGHT
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetWeight());
+    ++nentry;
+    OutputWriter::FillNtupleDColumn(nentry, ForcedCollisionHistory::GetHistory(track));
 #endif
 
-    analysisManager->AddNtupleRow();
+    OutputWriter::AddNtupleRow(ForcedCollisionHistory::GetHistory(track));
   }
 
   return true;
@@ -18,122 +18,323 @@ You should have received a copy of the GNU General Public License
 along with utr.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "AdjointEmPhysics.hh"
+#include "ForcedCollisionPhysics.hh"
 #include "Physics.hh"
+#include "PhysicsMessenger.hh"
+#include "PhysicsTableCache.hh"
+#include "RegionalEmPhysics.hh"
 
-// Electromagnetic modular physics lists
-#ifdef EM_FAST
-#include "G4EmStandardPhysics_option1.hh"
-#endif
+// All modular physics lists are included, since they can be selected at runtime.
+// The EM_* and HADRON_* build options only determine the defaults.
 
-#ifdef EM_LIVERMORE
+// Electromagnetic modular physics lists
 #include "G4EmLivermorePhysics.hh"
-#endif
-
-#ifdef EM_LIVERMORE_POLARIZED
 #include "G4EmLivermorePolarizedPhysics.hh"
-#endif
-
-#ifdef EM_PENELOPE
 #include "G4EmPenelopePhysics.hh"
-#endif
-
-#ifdef EM_STANDARD
+#include "G4EmStandardPhysics_option1.hh"
 #include "G4EmStandardPhysics_option4.hh"
-#endif
 
 // Hadronic elastic modular physics lists
-#ifdef HADRON_ELASTIC_STANDARD
 #include "G4HadronElasticPhysics.hh"
-#endif
-#ifdef HADRON_ELASTIC_HP
 #include "G4HadronElasticPhysicsHP.hh"
-#endif
-#ifdef HADRON_ELASTIC_LEND
 #include "G4HadronElasticPhysicsLEND.hh"
-#endif
 
-// Hadronic elastic modular physics lists
-#ifdef HADRON_INELASTIC_STANDARD
+// Hadronic inelastic modular physics lists
 #include "G4HadronPhysicsFTFP_BERT.hh"
-#endif
-#ifdef HADRON_INELASTIC_HP
 #include "G4HadronPhysicsFTFP_BERT_HP.hh"
-#endif
-#ifdef HADRON_INELASTIC_LEND
 #include "G4HadronPhysicsShieldingLEND.hh"
-#endif
 
-#ifdef EM_EXTRA
 #include "G4EmExtraPhysics.hh"
-#endif
 
-Physics::Physics() {
-  G4cout << "================================================================"
-            "================"
-         << G4endl;
-  G4cout << "Using the following physics lists:" << G4endl;
+#include "G4BaryonConstructor.hh"
+#include "G4BosonConstructor.hh"
+#include "G4EmParameters.hh"
+#include "G4IonConstructor.hh"
+#include "G4LeptonConstructor.hh"
+#include "G4MesonConstructor.hh"
+#include "G4ShortLivedConstructor.hh"
+#include "G4Threading.hh"
+
+static G4VPhysicsConstructor *CreateEmPhysics(const G4String &name) {
+  if (name == "fast") {
+    return new G4EmStandardPhysics_option1();
+  } else if (name == "standard") {
+    return new G4EmStandardPhysics_option4();
+  } else if (name == "livermore") {
+    return new G4EmLivermorePhysics();
+  } else if (name == "livermore_polarized") {
+    return new G4EmLivermorePolarizedPhysics();
+  } else if (name == "penelope") {
+    return new G4EmPenelopePhysics();
+  }
+  return nullptr;
+}
+
+static G4VPhysicsConstructor *CreateHadronElasticPhysics(const G4String &name) {
+  if (name == "standard") {
+    return new G4HadronElasticPhysics();
+  } else if (name == "hp") {
+    return new G4HadronElasticPhysicsHP();
+  } else if (name == "lend") {
+    return new G4HadronElasticPhysicsLEND();
+  }
+  return nullptr;
+}
+
+static G4VPhysicsConstructor *CreateHadronInelasticPhysics(const G4String &name) {
+  if (name == "standard") {
+    return new G4HadronPhysicsFTFP_BERT();
+  } else if (name == "hp") {
+    return new G4HadronPhysicsFTFP_BERT_HP();
+  } else if (name == "lend") {
+    return new G4HadronPhysicsShieldingLEND();
+  }
+  return nullptr;
+}
+
+Physics::Physics() : physicsMessenger(nullptr), regionalEmPhysics(nullptr), forcedCollisionPhysics(nullptr), em_physics("none"), hadron_elastic_physics("none"), hadron_inelastic_physics("none"), use_em_extra(false), use_adjoint(false) {
 
 // Electromagnetic modular physics lists
 #ifdef EM_FAST
-  G4cout << "\tG4EmStandardPhysics_option1 ..." << G4endl;
-  RegisterPhysics(new G4EmStandardPhysics_option1());
+  em_physics = "fast";
 #endif
 #ifdef EM_LIVERMORE
-  G4cout << "\tG4EmLivermorePhysics ..." << G4endl;
-  RegisterPhysics(new G4EmLivermorePhysics());
+  em_physics = "livermore";
 #endif
 #ifdef EM_LIVERMORE_POLARIZED
-  G4cout << "\tG4EmLivermorePolarizedPhysics ..." << G4endl;
-  RegisterPhysics(new G4EmLivermorePolarizedPhysics());
+  em_physics = "livermore_polarized";
 #endif
 #ifdef EM_PENELOPE
-  G4cout << "\tG4EmPenelopePhysics ..." << G4endl;
-  RegisterPhysics(new G4EmPenelopePhysics());
+  em_physics = "penelope";
 #endif
 #ifdef EM_STANDARD
-  G4cout << "\tG4EmStandardPhysics_option4 ..." << G4endl;
-  RegisterPhysics(new G4EmStandardPhysics_option4());
+  em_physics = "standard";
 #endif
 
 // EM extra physics. Contains photonuclear processes.
 #ifdef EM_EXTRA
-  G4cout << "\tG4EmExtraPhysics ..." << G4endl;
-  RegisterPhysics(new G4EmExtraPhysics());
+  use_em_extra = true;
 #endif
 
 // Hadronic elastic modular physics lists
 #ifdef HADRON_ELASTIC_STANDARD
-  G4cout << "\tG4HadronElasticPhysics ..." << G4endl;
-  RegisterPhysics(new G4HadronElasticPhysics());
+  hadron_elastic_physics = "standard";
 #endif
-
 #ifdef HADRON_ELASTIC_HP
-  G4cout << "\tG4HadronElasticPhysicsHP ..." << G4endl;
-  RegisterPhysics(new G4HadronElasticPhysicsHP());
+  hadron_elastic_physics = "hp";
 #endif
-
 #ifdef HADRON_ELASTIC_LEND
-  G4cout << "\tG4HadronElasticPhysicsLEND ..." << G4endl;
-  RegisterPhysics(new G4HadronElasticPhysicsLEND());
+  hadron_elastic_physics = "lend";
 #endif
 
 // Hadronic inelastic modular physics lists
 #ifdef HADRON_INELASTIC_STANDARD
-  G4cout << "\tG4HadronPhysicsFTFP_BERT ..." << G4endl;
-  RegisterPhysics(new G4HadronPhysicsFTFP_BERT());
+  hadron_inelastic_physics = "standard";
 #endif
-
 #ifdef HADRON_INELASTIC_HP
-  G4cout << "\tG4HadronPhysicsFTFP_BERT_HP ..." << G4endl;
-  RegisterPhysics(new G4HadronPhysicsFTFP_BERT_HP());
+  hadron_inelastic_physics = "hp";
 #endif
-
 #ifdef HADRON_INELASTIC_LEND
-  G4cout << "\tG4HadronPhysicsShieldingLEND ..." << G4endl;
-  RegisterPhysics(new G4HadronPhysicsShieldingLEND());
+  hadron_inelastic_physics = "lend";
 #endif
 
+  if (em_physics != "none") {
+    RegisterPhysics(CreateEmPhysics(em_physics));
+  }
+  if (use_em_extra) {
+    RegisterPhysics(new G4EmExtraPhysics());
+  }
+  if (hadron_elastic_physics != "none") {
+    RegisterPhysics(CreateHadronElasticPhysics(hadron_elastic_physics));
+  }
+  if (hadron_inelastic_physics != "none") {
+    RegisterPhysics(CreateHadronInelasticPhysics(hadron_inelastic_physics));
+  }
+
+  physicsMessenger = new PhysicsMessenger(this);
+
+  PrintInfo();
+}
+
+Physics::~Physics() {
+  delete physicsMessenger;
+  delete forcedCollisionPhysics;
+}
+
+void Physics::ConstructParticle() {
+  // Particles are constructed when the physics list is passed to the run manager, i.e. before any
+  // macro command could select a different physics list. Therefore, construct all particles here
+  // to make sure that physics lists which are selected later find the particles they need.
+  G4BosonConstructor bosonConstructor;
+  bosonConstructor.ConstructParticle();
+  G4LeptonConstructor leptonConstructor;
+  leptonConstructor.ConstructParticle();
+  G4MesonConstructor mesonConstructor;
+  mesonConstructor.ConstructParticle();
+  G4BaryonConstructor baryonConstructor;
+  baryonConstructor.ConstructParticle();
+  G4IonConstructor ionConstructor;
+  ionConstructor.ConstructParticle();
+  G4ShortLivedConstructor shortLivedConstructor;
+  shortLivedConstructor.ConstructParticle();
+
+  G4VModularPhysicsList::ConstructParticle();
+}
+
+void Physics::ConstructProcess() {
+  // The regional models are assigned to the individual processes. Disable the G4GammaGeneralProcess,
+  // which would otherwise hide them from the G4EmConfigurator. The adjoint processes need the
+  // individual forward processes as well, and so do the biasing wrappers of the forced collisions.
+  if ((regionalEmPhysics && regionalEmPhysics->HasRegionEmPhysics()) || use_adjoint || HasForcedCollisions()) {
+    G4EmParameters::Instance()->SetGeneralProcessActive(false);
+  }
+
+  G4VModularPhysicsList::ConstructProcess();
+
+  // The forced collisions wrap the existing processes, so they are not registered like the other
+  // physics constructors, which could be constructed after them.
+  if (HasForcedCollisions()) {
+    forcedCollisionPhysics->ConstructProcess();
+  }
+}
+
+void Physics::SetCuts() {
+  G4VModularPhysicsList::SetCuts();
+
+  // The geometry, i.e. all materials, and the cuts are known at this point, but the physics tables
+  // have not been built yet.
+  if (G4Threading::IsMasterThread()) {
+    PhysicsTableCache::Retrieve(this);
+  }
+}
+
+void Physics::SelectEmPhysics(const G4String &name) {
+  if (name == em_physics) {
+    return;
+  }
+  if (name == "none") {
+    RemovePhysics(bElectromagnetic);
+  } else {
+    G4VPhysicsConstructor *physicsConstructor = CreateEmPhysics(name);
+    if (!physicsConstructor) {
+      G4cerr << "Physics: Error! Unknown EM physics list '" << name << "'" << G4endl;
+      return;
+    }
+    ReplacePhysics(physicsConstructor);
+  }
+  em_physics = name;
+  PrintInfo();
+}
+
+void Physics::SelectEmExtraPhysics(G4bool use) {
+  if (use == use_em_extra) {
+    return;
+  }
+  if (use) {
+    RegisterPhysics(new G4EmExtraPhysics());
+  } else {
+    RemovePhysics(bEmExtra);
+  }
+  use_em_extra = use;
+  PrintInfo();
+}
+
+void Physics::SelectHadronElasticPhysics(const G4String &name) {
+  if (name == hadron_elastic_physics) {
+    return;
+  }
+  if (name == "none") {
+    RemovePhysics(bHadronElastic);
+  } else {
+    G4VPhysicsConstructor *physicsConstructor = CreateHadronElasticPhysics(name);
+    if (!physicsConstructor) {
+      G4cerr << "Physics: Error! Unknown hadronic elastic physics list '" << name << "'" << G4endl;
+      return;
+    }
+    ReplacePhysics(physicsConstructor);
+  }
+  hadron_elastic_physics = name;
+  PrintInfo();
+}
+
+void Physics::SelectHadronInelasticPhysics(const G4String &name) {
+  if (name == hadron_inelastic_physics) {
+    return;
+  }
+  if (name == "none") {
+    RemovePhysics(bHadronInelastic);
+  } else {
+    G4VPhysicsConstructor *physicsConstructor = CreateHadronInelasticPhysics(name);
+    if (!physicsConstructor) {
+      G4cerr << "Physics: Error! Unknown hadronic inelastic physics list '" << name << "'" << G4endl;
+      return;
+    }
+    ReplacePhysics(physicsConstructor);
+  }
+  hadron_inelastic_physics = name;
+  PrintInfo();
+}
+
+void Physics::SelectAdjointPhysics(G4bool use) {
+  if (use == use_adjoint) {
+    return;
+  }
+  if (use) {
+    RegisterPhysics(new AdjointEmPhysics());
+  } else {
+    RemovePhysics("AdjointEmPhysics");
+  }
+  use_adjoint = use;
+  PrintInfo();
+}
+
+void Physics::AddVolumeToRegion(const G4String &region_name, const G4String &logical_volume_name) {
+  if (!regionalEmPhysics) {
+    regionalEmPhysics = new RegionalEmPhysics();
+    RegisterPhysics(regionalEmPhysics);
+  }
+  regionalEmPhysics->AddVolumeToRegion(region_name, logical_volume_name);
+}
+
+void Physics::SetRegionEmPhysics(const G4String &region_name, const G4String &name) {
+  if (!regionalEmPhysics) {
+    regionalEmPhysics = new RegionalEmPhysics();
+    RegisterPhysics(regionalEmPhysics);
+  }
+  if (!regionalEmPhysics->SetRegionEmPhysics(region_name, name)) {
+    G4cerr << "Physics: Error! Unknown regional EM physics '" << name << "'" << G4endl;
+  }
+}
+
+void Physics::AddForcedCollision(const G4String &logical_volume_name, const G4String &particle_name) {
+  if (!forcedCollisionPhysics) {
+    forcedCollisionPhysics = new ForcedCollisionPhysics();
+  }
+  forcedCollisionPhysics->AddVolume(logical_volume_name, particle_name);
+}
+
+G4bool Physics::HasForcedCollisions() const { return forcedCollisionPhysics && forcedCollisionPhysics->HasVolumes(); }
+
+void Physics::PrintInfo() const {
   G4cout << "================================================================"
             "================"
          << G4endl;
+  StreamInfo(G4cout);
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
+
+void Physics::StreamInfo(std::ostream &os) const {
+  os << "Using the following physics lists:" << G4endl;
+  for (G4int i = 0; GetPhysics(i) != nullptr; ++i) {
+    os << "\t" << GetPhysics(i)->GetPhysicsName() << " ..." << G4endl;
+  }
+  if (regionalEmPhysics) {
+    regionalEmPhysics->StreamInfo(os);
+  }
+  if (forcedCollisionPhysics) {
+    forcedCollisionPhysics->StreamInfo(os);
+  }
 }
@@ -0,0 +1,148 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4UIparameter.hh"
+
+#include "Physics.hh"
+#include "PhysicsMessenger.hh"
+#include "PhysicsTableCache.hh"
+
+PhysicsMessenger::PhysicsMessenger(Physics *phys) : physics(phys) {
+  physicsDirectory = new G4UIdirectory("/utr/physics/");
+  physicsDirectory->SetGuidance("Runtime selection of the physics lists. All commands have to be issued before /run/initialize.");
+
+  emCmd = new G4UIcmdWithAString("/utr/physics/em", this);
+  emCmd->SetGuidance("Select the global EM physics list (default: set by the EM_* build options).");
+  emCmd->SetGuidance("fast: G4EmStandardPhysics_option1, standard: G4EmStandardPhysics_option4, livermore: G4EmLivermorePhysics,");
+  emCmd->SetGuidance("livermore_polarized: G4EmLivermorePolarizedPhysics, penelope: G4EmPenelopePhysics");
+  emCmd->SetParameterName("emPhysics", false);
+  emCmd->SetCandidates("fast standard livermore livermore_polarized penelope none");
+  emCmd->AvailableForStates(G4State_PreInit);
+
+  emExtraCmd = new G4UIcmdWithABool("/utr/physics/emExtra", this);
+  emExtraCmd->SetGuidance("Use G4EmExtraPhysics, which contains photonuclear processes (default: set by the EM_EXTRA build option).");
+  emExtraCmd->SetParameterName("useEmExtra", true);
+  emExtraCmd->SetDefaultValue(true);
+  emExtraCmd->AvailableForStates(G4State_PreInit);
+
+  hadronElasticCmd = new G4UIcmdWithAString("/utr/physics/hadronElastic", this);
+  hadronElasticCmd->SetGuidance("Select the hadronic elastic physics list (default: set by the HADRON_ELASTIC_* build options).");
+  hadronElasticCmd->SetGuidance("standard: G4HadronElasticPhysics, hp: G4HadronElasticPhysicsHP, lend: G4HadronElasticPhysicsLEND");
+  hadronElasticCmd->SetParameterName("hadronElasticPhysics", false);
+  hadronElasticCmd->SetCandidates("standard hp lend none");
+  hadronElasticCmd->AvailableForStates(G4State_PreInit);
+
+  hadronInelasticCmd = new G4UIcmdWithAString("/utr/physics/hadronInelastic", this);
+  hadronInelasticCmd->SetGuidance("Select the hadronic inelastic physics list (default: set by the HADRON_INELASTIC_* build options).");
+  hadronInelasticCmd->SetGuidance("standard: G4HadronPhysicsFTFP_BERT, hp: G4HadronPhysicsFTFP_BERT_HP, lend: G4HadronPhysicsShieldingLEND");
+  hadronInelasticCmd->SetParameterName("hadronInelasticPhysics", false);
+  hadronInelasticCmd->SetCandidates("standard hp lend none");
+  hadronInelasticCmd->AvailableForStates(G4State_PreInit);
+
+  addVolumeToRegionCmd = new G4UIcommand("/utr/physics/addVolumeToRegion", this);
+  addVolumeToRegionCmd->SetGuidance("Add a logical volume (and all its daughters) to a region. The region is created if it does not exist.");
+  addVolumeToRegionCmd->SetParameter(new G4UIparameter("region", 's', false));
+  addVolumeToRegionCmd->SetParameter(new G4UIparameter("logicalVolume", 's', false));
+  addVolumeToRegionCmd->AvailableForStates(G4State_PreInit);
+
+  regionEmCmd = new G4UIcommand("/utr/physics/regionEm", this);
+  regionEmCmd->SetGuidance("Replace the photon interaction models of the global EM physics list inside a region.");
+  regionEmCmd->SetGuidance("For example, use the global 'fast' list and 'livermore_polarized' only in the target and detector regions.");
+  regionEmCmd->SetParameter(new G4UIparameter("region", 's', false));
+  G4UIparameter *regionEmPhysicsParameter = new G4UIparameter("emPhysics", 's', false);
+  regionEmPhysicsParameter->SetParameterCandidates("fast standard livermore livermore_polarized penelope");
+  regionEmCmd->SetParameter(regionEmPhysicsParameter);
+  regionEmCmd->AvailableForStates(G4State_PreInit);
+
+  forceCollisionCmd = new G4UIcommand("/utr/physics/forceCollision", this);
+  forceCollisionCmd->SetGuidance("Force each particle which enters a logical volume to interact inside it, e.g. in a thin target.");
+  forceCollisionCmd->SetGuidance("The weight of the interacting copy is the interaction probability, a non-interacting copy carries the rest.");
+  forceCollisionCmd->SetGuidance("Only one (neutral) particle per volume. The weights and the history indices are written to the 'weight' and 'history' branches of the output (EVENT_WEIGHT).");
+  forceCollisionCmd->SetParameter(new G4UIparameter("logicalVolume", 's', false));
+  G4UIparameter *forceCollisionParticleParameter = new G4UIparameter("particle", 's', true);
+  forceCollisionParticleParameter->SetDefaultValue("gamma");
+  forceCollisionParticleParameter->SetParameterCandidates("gamma neutron");
+  forceCollisionCmd->SetParameter(forceCollisionParticleParameter);
+  forceCollisionCmd->AvailableForStates(G4State_PreInit);
+
+  tableCacheCmd = new G4UIcmdWithAString("/utr/physics/tableCache", this);
+  tableCacheCmd->SetGuidance("Store the physics tables in the given directory and retrieve them in later simulations with the same physics lists, cuts and materials.");
+  tableCacheCmd->SetGuidance("'none' disables the cache (default).");
+  tableCacheCmd->SetParameterName("directory", false);
+  tableCacheCmd->AvailableForStates(G4State_PreInit);
+
+  printCmd = new G4UIcmdWithoutParameter("/utr/physics/print", this);
+  printCmd->SetGuidance("Print the currently selected physics lists.");
+}
+
+PhysicsMessenger::~PhysicsMessenger() {
+  delete emCmd;
+  delete emExtraCmd;
+  delete hadronElasticCmd;
+  delete hadronInelasticCmd;
+  delete addVolumeToRegionCmd;
+  delete regionEmCmd;
+  delete forceCollisionCmd;
+  delete tableCacheCmd;
+  delete printCmd;
+  delete physicsDirectory;
+}
+
+void PhysicsMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  if (command == emCmd) {
+    physics->SelectEmPhysics(newValues);
+  } else if (command == emExtraCmd) {
+    physics->SelectEmExtraPhysics(emExtraCmd->GetNewBoolValue(newValues));
+  } else if (command == hadronElasticCmd) {
+    physics->SelectHadronElasticPhysics(newValues);
+  } else if (command == hadronInelasticCmd) {
+    physics->SelectHadronInelasticPhysics(newValues);
+  } else if (command == addVolumeToRegionCmd) {
+    std::istringstream parameters(newValues);
+    G4String region_name, logical_volume_name;
+    parameters >> region_name >> logical_volume_name;
+    physics->AddVolumeToRegion(region_name, logical_volume_name);
+  } else if (command == regionEmCmd) {
+    std::istringstream parameters(newValues);
+    G4String region_name, em_physics_name;
+    parameters >> region_name >> em_physics_name;
+    physics->SetRegionEmPhysics(region_name, em_physics_name);
+  } else if (command == forceCollisionCmd) {
+    std::istringstream parameters(newValues);
+    G4String logical_volume_name, particle_name;
+    parameters >> logical_volume_name >> particle_name;
+    physics->AddForcedCollision(logical_volume_name, particle_name);
+  } else if (command == tableCacheCmd) {
+    PhysicsTableCache::SetDirectory(newValues);
+  } else if (command == printCmd) {
+    physics->PrintInfo();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String PhysicsMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == tableCacheCmd) {
+    return PhysicsTableCache::IsActive() ? PhysicsTableCache::GetDirectory() : G4String("none");
+  }
+  return "";
+}
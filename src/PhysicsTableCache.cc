@@ -0,0 +1,206 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "G4EmParameters.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
+
+#include "Physics.hh"
+#include "PhysicsTableCache.hh"
+
+// Increase if the content of the cache directories changes
+static const G4int cache_format_version = 1;
+
+// Environment variables of the Geant4 data libraries which the physics tables may depend on
+static const char *data_library_variables[] = {"G4LEDATA", "G4LEVELGAMMADATA", "G4PARTICLEXSDATA", "G4NEUTRONHPDATA", "G4SAIDXSDATA", "G4ENSDFSTATEDATA", "G4PIIDATA", "G4INCLDATA"};
+
+G4String PhysicsTableCache::directory = "";
+
+void PhysicsTableCache::SetDirectory(const G4String &dir) {
+  if (dir == "none") {
+    directory = "";
+  } else {
+    directory = dir;
+  }
+}
+
+static G4bool DirectoryExists(const G4String &dir) {
+  struct stat info;
+  return stat(dir.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Create a directory including all missing parent directories (like 'mkdir -p')
+static G4bool CreateDirectories(const G4String &dir) {
+  for (size_t pos = dir.find('/', 1); pos != std::string::npos; pos = dir.find('/', pos + 1)) {
+    const G4String parent = dir.substr(0, pos);
+    if (!DirectoryExists(parent) && mkdir(parent.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == -1) {
+      return false;
+    }
+  }
+  return DirectoryExists(dir) || mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == 0;
+}
+
+// Geant4 stores all tables of a physics list in a flat directory
+static void RemoveDirectory(const G4String &dir) {
+  DIR *d = opendir(dir.c_str());
+  if (d) {
+    for (struct dirent *entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+      const G4String name = entry->d_name;
+      if (name != "." && name != "..") {
+        unlink((dir + "/" + name).c_str());
+      }
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+void PhysicsTableCache::StreamConfiguration(const Physics *physics, std::ostream &os) {
+  os << std::setprecision(17);
+  os << "utr physics table cache, format version " << cache_format_version << G4endl;
+  os << G4Version << G4endl;
+
+  os << "Data libraries:" << G4endl;
+  for (auto variable : data_library_variables) {
+    const char *value = std::getenv(variable);
+    os << "\t" << variable << "=" << (value ? value : "") << G4endl;
+  }
+
+  physics->StreamInfo(os);
+  os << *G4EmParameters::Instance();
+
+  G4ProductionCutsTable *cuts_table = G4ProductionCutsTable::GetProductionCutsTable();
+  os << "Production cuts (energy range " << cuts_table->GetLowEdgeEnergy() / keV << " keV to " << cuts_table->GetHighEdgeEnergy() / keV << " keV):" << G4endl;
+  for (auto region : *G4RegionStore::GetInstance()) {
+    os << "\tRegion '" << region->GetName() << "' :";
+    const G4ProductionCuts *cuts = region->GetProductionCuts();
+    if (cuts) {
+      // Order of the particles: gamma, e-, e+, proton
+      for (G4int i = 0; i < 4; ++i) {
+        os << " " << cuts->GetProductionCut(i) / mm << " mm";
+      }
+    }
+    os << G4endl;
+    auto root_logical_volume = region->GetRootLogicalVolumeIterator();
+    for (size_t i = 0; i < region->GetNumberOfRootVolumes(); ++i, ++root_logical_volume) {
+      os << "\t\t" << (*root_logical_volume)->GetName() << G4endl;
+    }
+  }
+
+  os << "Materials:" << G4endl;
+  for (auto material : *G4Material::GetMaterialTable()) {
+    os << "\t" << material->GetName() << " : " << material->GetDensity() / (g / cm3) << " g/cm3, state " << material->GetState() << ", " << material->GetTemperature() / kelvin << " K, " << material->GetPressure() / atmosphere << " atm, I = " << material->GetIonisation()->GetMeanExcitationEnergy() / eV << " eV" << G4endl;
+    const G4double *fractions = material->GetFractionVector();
+    for (size_t i = 0; i < material->GetNumberOfElements(); ++i) {
+      const G4Element *element = material->GetElement((G4int)i);
+      os << "\t\t" << element->GetName() << " (Z = " << element->GetZ() << ", A = " << element->GetA() / (g / mole) << " g/mole) : " << fractions[i] << G4endl;
+    }
+  }
+}
+
+G4String PhysicsTableCache::GetTableDirectory(const Physics *physics, G4String &configuration) {
+  std::ostringstream configuration_stream;
+  StreamConfiguration(physics, configuration_stream);
+  configuration = configuration_stream.str();
+
+  // 64-bit FNV-1a hash
+  unsigned long long hash = 14695981039346656037ULL;
+  for (unsigned char c : configuration) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+
+  std::ostringstream table_directory;
+  table_directory << directory << "/geant4-" << G4VERSION_NUMBER << "/" << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return table_directory.str();
+}
+
+void PhysicsTableCache::Retrieve(Physics *physics) {
+  if (!IsActive()) {
+    return;
+  }
+
+  G4String configuration;
+  const G4String table_directory = GetTableDirectory(physics, configuration);
+  if (DirectoryExists(table_directory)) {
+    G4cout << "PhysicsTableCache: Retrieving physics tables from '" << table_directory << "'" << G4endl;
+    physics->SetPhysicsTableRetrieved(table_directory);
+  } else {
+    G4cout << "PhysicsTableCache: No physics tables found for the current configuration, they will be stored in '" << table_directory << "'" << G4endl;
+  }
+}
+
+void PhysicsTableCache::Store(Physics *physics) {
+  if (!IsActive()) {
+    return;
+  }
+
+  G4String configuration;
+  const G4String table_directory = GetTableDirectory(physics, configuration);
+  if (DirectoryExists(table_directory)) {
+    return;
+  }
+
+  const G4String parent_directory = table_directory.substr(0, table_directory.rfind('/'));
+  if (!CreateDirectories(parent_directory)) {
+    G4cerr << "PhysicsTableCache: Error! Could not create directory '" << parent_directory << "', physics tables will not be stored." << G4endl;
+    return;
+  }
+
+  // Store the tables in a temporary directory first, so that other simulations never see incomplete tables
+  std::string temporary_directory_template = table_directory + ".tmpXXXXXX";
+  if (!mkdtemp(&temporary_directory_template[0])) {
+    G4cerr << "PhysicsTableCache: Error! Could not create a temporary directory in '" << parent_directory << "', physics tables will not be stored." << G4endl;
+    return;
+  }
+  const G4String temporary_directory = temporary_directory_template;
+
+  G4cout << "PhysicsTableCache: Storing physics tables in '" << table_directory << "'" << G4endl;
+  if (!physics->StorePhysicsTable(temporary_directory)) {
+    G4cerr << "PhysicsTableCache: Error! Geant4 could not store all physics tables, they will not be cached." << G4endl;
+    RemoveDirectory(temporary_directory);
+    return;
+  }
+
+  std::ofstream configuration_file(temporary_directory + "/configuration.txt");
+  configuration_file << configuration;
+  configuration_file.close();
+
+  // Fails if another simulation has stored the same tables in the meantime
+  if (rename(temporary_directory.c_str(), table_directory.c_str()) != 0) {
+    RemoveDirectory(temporary_directory);
+  }
+}
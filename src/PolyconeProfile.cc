@@ -0,0 +1,100 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include "G4PhysicalConstants.hh"
+#include "G4ios.hh"
+
+#include "PolyconeProfile.hh"
+
+const G4double PolyconeProfile::default_max_deviation = 0.05 * mm;
+
+// Corners which are closer than this are merged
+static const G4double corner_tolerance = 1e-9 * mm;
+// Number of points at which the distance of an arc from its chord is evaluated
+static const unsigned int n_arc_test_points = 8;
+// Limit for the recursive subdivision of an arc (2^max_arc_depth segments)
+static const unsigned int max_arc_depth = 12;
+
+void PolyconeProfile::Add_Point(const G4double r, const G4double z) {
+  if (r_corners.size() && fabs(r - r_corners.back()) < corner_tolerance && fabs(z - z_corners.back()) < corner_tolerance) {
+    return;
+  }
+  r_corners.push_back(r);
+  z_corners.push_back(z);
+}
+
+void PolyconeProfile::Add_Arc(const G4double r_center, const G4double z_center, const G4double semi_axis_r, const G4double semi_axis_z, const G4double start_angle, const G4double end_angle) {
+  Add_Point(r_center + semi_axis_r * cos(start_angle), z_center + semi_axis_z * sin(start_angle));
+  if (semi_axis_r <= 0. || semi_axis_z <= 0.) {
+    Add_Point(r_center + semi_axis_r * cos(end_angle), z_center + semi_axis_z * sin(end_angle));
+    return;
+  }
+  Subdivide_Arc(r_center, z_center, semi_axis_r, semi_axis_z, start_angle, end_angle, 0);
+}
+
+void PolyconeProfile::Subdivide_Arc(const G4double r_center, const G4double z_center, const G4double semi_axis_r, const G4double semi_axis_z, const G4double start_angle, const G4double end_angle, const unsigned int depth) {
+  const G4double r_start = r_center + semi_axis_r * cos(start_angle);
+  const G4double z_start = z_center + semi_axis_z * sin(start_angle);
+  const G4double r_end = r_center + semi_axis_r * cos(end_angle);
+  const G4double z_end = z_center + semi_axis_z * sin(end_angle);
+  const G4double chord_length = sqrt((r_end - r_start) * (r_end - r_start) + (z_end - z_start) * (z_end - z_start));
+
+  // Maximum distance of the arc from the chord between its end points
+  G4double deviation = 0.;
+  G4double r, z, distance;
+  for (unsigned int i = 1; i < n_arc_test_points; ++i) {
+    r = r_center + semi_axis_r * cos(start_angle + (end_angle - start_angle) * i / n_arc_test_points);
+    z = z_center + semi_axis_z * sin(start_angle + (end_angle - start_angle) * i / n_arc_test_points);
+    if (chord_length > corner_tolerance) {
+      distance = fabs((r_end - r_start) * (z - z_start) - (z_end - z_start) * (r - r_start)) / chord_length;
+    } else {
+      distance = sqrt((r - r_start) * (r - r_start) + (z - z_start) * (z - z_start));
+    }
+    if (distance > deviation) {
+      deviation = distance;
+    }
+  }
+
+  if (deviation > max_deviation && depth < max_arc_depth) {
+    Subdivide_Arc(r_center, z_center, semi_axis_r, semi_axis_z, start_angle, 0.5 * (start_angle + end_angle), depth + 1);
+    Subdivide_Arc(r_center, z_center, semi_axis_r, semi_axis_z, 0.5 * (start_angle + end_angle), end_angle, depth + 1);
+  } else {
+    Add_Point(r_end, z_end);
+  }
+}
+
+G4GenericPolycone *PolyconeProfile::Construct() const {
+  vector<G4double> r(r_corners);
+  vector<G4double> z(z_corners);
+  // The contour is closed implicitly
+  if (r.size() > 1 && fabs(r.front() - r.back()) < corner_tolerance && fabs(z.front() - z.back()) < corner_tolerance) {
+    r.pop_back();
+    z.pop_back();
+  }
+
+  if (r.size() < 3) {
+    G4cerr << "ERROR: Polycone " << name << " needs at least 3 corners, but only " << r.size() << " were given. Aborting..." << G4endl;
+    throw std::exception();
+  }
+
+  return new G4GenericPolycone(name, 0., twopi, (G4int)r.size(), r.data(), z.data());
+}
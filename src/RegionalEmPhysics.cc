@@ -0,0 +1,161 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "G4BetheHeitler5DModel.hh"
+#include "G4BetheHeitlerModel.hh"
+#include "G4EmConfigurator.hh"
+#include "G4Gamma.hh"
+#include "G4KleinNishinaCompton.hh"
+#include "G4KleinNishinaModel.hh"
+#include "G4LivermoreComptonModel.hh"
+#include "G4LivermorePhotoElectricModel.hh"
+#include "G4LivermorePolarizedComptonModel.hh"
+#include "G4LivermorePolarizedRayleighModel.hh"
+#include "G4LivermoreRayleighModel.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4LossTableManager.hh"
+#include "G4LowEPComptonModel.hh"
+#include "G4PEEffectFluoModel.hh"
+#include "G4PenelopeComptonModel.hh"
+#include "G4PenelopeGammaConversionModel.hh"
+#include "G4PenelopePhotoElectricModel.hh"
+#include "G4PenelopeRayleighModel.hh"
+#include "G4PhotoElectricAngularGeneratorPolarized.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include "RegionalEmPhysics.hh"
+
+// Upper limit of the validity range of the regional models.
+// Far above any energy that is relevant at HIGS.
+static const G4double regional_model_emax = 100. * GeV;
+// Transition between the low-energy and the Klein-Nishina Compton model of G4EmStandardPhysics_option4
+static const G4double standard_compton_emax = 20. * MeV;
+
+RegionalEmPhysics::RegionalEmPhysics() : G4VPhysicsConstructor("RegionalEmPhysics") {}
+
+RegionalEmPhysics::~RegionalEmPhysics() {}
+
+G4bool RegionalEmPhysics::SetRegionEmPhysics(const G4String &region_name, const G4String &name) {
+  if (name != "fast" && name != "standard" && name != "livermore" && name != "livermore_polarized" && name != "penelope") {
+    return false;
+  }
+  region_em_physics[region_name] = name;
+  return true;
+}
+
+void RegionalEmPhysics::CreateRegions() const {
+  G4LogicalVolumeStore *logicalVolumeStore = G4LogicalVolumeStore::GetInstance();
+  G4Region *region;
+  G4LogicalVolume *logical_volume;
+
+  for (auto &region_volume : region_volumes) {
+    region = G4RegionStore::GetInstance()->GetRegion(region_volume.first, false);
+    if (!region) {
+      region = new G4Region(region_volume.first);
+      region->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+    }
+    for (auto &logical_volume_name : region_volume.second) {
+      logical_volume = logicalVolumeStore->GetVolume(logical_volume_name, false);
+      if (!logical_volume) {
+        G4cerr << "RegionalEmPhysics: Error! Logical volume '" << logical_volume_name << "' for region '" << region_volume.first << "' not found." << G4endl;
+        continue;
+      }
+      region->AddRootLogicalVolume(logical_volume);
+    }
+  }
+}
+
+// Assigns a model to a photon process in a region. The G4EmConfigurator only prints a warning if
+// the global EM physics list does not contain the process, so check this here.
+static void SetRegionModel(const G4String &process_name, G4VEmModel *model, const G4String &region_name, G4double emin = 0., G4double emax = regional_model_emax) {
+  if (!G4Gamma::Gamma()->GetProcessManager()->GetProcess(process_name)) {
+    if (G4Threading::IsMasterThread()) {
+      G4cerr << "RegionalEmPhysics: Error! The global EM physics list has no photon process '" << process_name << "', its model in region '" << region_name << "' is not replaced." << G4endl;
+    }
+    delete model;
+    return;
+  }
+  G4LossTableManager::Instance()->EmConfigurator()->SetExtraEmModel("gamma", process_name, model, region_name, emin, emax);
+}
+
+void RegionalEmPhysics::ConstructProcess() {
+  // The geometry already exists at this point, and the regions are shared among all threads
+  if (G4Threading::IsMasterThread()) {
+    CreateRegions();
+  }
+
+  // The EM configurator is thread-local, so the models have to be set for each thread
+  for (auto &region : region_em_physics) {
+    if (!G4RegionStore::GetInstance()->GetRegion(region.first, false)) {
+      G4cerr << "RegionalEmPhysics: Error! Region '" << region.first << "' does not exist. Add volumes to it with /utr/physics/addVolumeToRegion." << G4endl;
+      continue;
+    }
+
+    if (region.second == "fast") {
+      SetRegionModel("phot", new G4PEEffectFluoModel(), region.first);
+      SetRegionModel("compt", new G4KleinNishinaCompton(), region.first);
+      SetRegionModel("conv", new G4BetheHeitlerModel(), region.first);
+      SetRegionModel("Rayl", new G4LivermoreRayleighModel(), region.first);
+    } else if (region.second == "standard") {
+      // The photon models of G4EmStandardPhysics_option4
+      SetRegionModel("phot", new G4LivermorePhotoElectricModel(), region.first);
+      SetRegionModel("compt", new G4LowEPComptonModel(), region.first, 0., standard_compton_emax);
+      SetRegionModel("compt", new G4KleinNishinaModel(), region.first, standard_compton_emax, regional_model_emax);
+      SetRegionModel("conv", new G4BetheHeitler5DModel(), region.first);
+      SetRegionModel("Rayl", new G4LivermoreRayleighModel(), region.first);
+    } else if (region.second == "livermore") {
+      SetRegionModel("phot", new G4LivermorePhotoElectricModel(), region.first);
+      SetRegionModel("compt", new G4LivermoreComptonModel(), region.first);
+      SetRegionModel("conv", new G4BetheHeitler5DModel(), region.first);
+      SetRegionModel("Rayl", new G4LivermoreRayleighModel(), region.first);
+    } else if (region.second == "livermore_polarized") {
+      G4VEmModel *photoElectricModel = new G4LivermorePhotoElectricModel();
+      photoElectricModel->SetAngularDistribution(new G4PhotoElectricAngularGeneratorPolarized());
+      SetRegionModel("phot", photoElectricModel, region.first);
+      SetRegionModel("compt", new G4LivermorePolarizedComptonModel(), region.first);
+      SetRegionModel("conv", new G4BetheHeitler5DModel(), region.first);
+      SetRegionModel("Rayl", new G4LivermorePolarizedRayleighModel(), region.first);
+    } else if (region.second == "penelope") {
+      SetRegionModel("phot", new G4PenelopePhotoElectricModel(), region.first);
+      SetRegionModel("compt", new G4PenelopeComptonModel(), region.first);
+      SetRegionModel("conv", new G4PenelopeGammaConversionModel(), region.first);
+      SetRegionModel("Rayl", new G4PenelopeRayleighModel(), region.first);
+    }
+  }
+}
+
+void RegionalEmPhysics::PrintInfo() const { StreamInfo(G4cout); }
+
+void RegionalEmPhysics::StreamInfo(std::ostream &os) const {
+  for (auto &region : region_em_physics) {
+    os << "\tRegion '" << region.first << "' : " << region.second << " photon models" << G4endl;
+    auto volumes = region_volumes.find(region.first);
+    if (volumes != region_volumes.end()) {
+      for (auto &logical_volume_name : volumes->second) {
+        os << "\t\t" << logical_volume_name << G4endl;
+      }
+    }
+  }
+}
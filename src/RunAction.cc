@@ -22,72 +22,97 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "G4Run.hh"
 #include "G4RunManager.hh"
+#include "G4RunManagerKernel.hh"
 #include "G4SDManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4UnitsTable.hh"
 
 #include "G4FileUtilities.hh"
 
-#include "DetectorConstruction.hh"
+#include "Digitizer.hh"
+#include "FluxScoring.hh"
 #include "G4RootAnalysisManager.hh"
+#include "GeometryLoader.hh"
+#include "OutputWriter.hh"
+#include "Physics.hh"
+#include "PhysicsTableCache.hh"
 #include "RunAction.hh"
+#include "Sharding.hh"
+#include "SlowEvents.hh"
+#include "Trigger.hh"
+#include "WorkerThreads.hh"
 #include "utrFilenameTools.hh"
 #include <limits.h>
 
 #include "utrConfig.h"
 
-RunAction::RunAction() : G4UserRunAction() {}
+RunAction::RunAction() : G4UserRunAction(), temporary_output(false) {}
 
 RunAction::~RunAction() { delete G4RootAnalysisManager::Instance(); }
 
 void RunAction::BeginOfRunAction(const G4Run *) {
+  WorkerThreads::BeginOfRun();
+  Trigger::BeginOfRun();
+
   // Get analysis manager
   G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
+  OutputWriter::Configure(analysisManager);
 
 #ifdef EVENT_EVENTWISE
-  analysisManager->CreateNtuple("edep", "Energy Deposition");
-  auto max_sensitive_detector_ID = ((DetectorConstruction *)G4RunManager::GetRunManager()->GetUserDetectorConstruction())->Max_Sensitive_Detector_ID;
-  for (size_t i = 0; i < max_sensitive_detector_ID + 1; ++i) {
-    analysisManager->CreateNtupleDColumn("det" + std::to_string(i));
+  OutputWriter::CreateNtuple("edep", "Energy Deposition");
+  auto max_sensitive_detector_ID = GeometryLoader::GetMaxSensitiveDetectorID();
+  if (max_sensitive_detector_ID < 0) {
+    G4cerr << "ERROR: EVENT_EVENTWISE output requires the geometry '" << GeometryLoader::GetGeometryName() << "' to set DetectorConstruction::Max_Sensitive_Detector_ID. Aborting..." << G4endl;
+    throw std::exception();
+  }
+  for (G4int i = 0; i < max_sensitive_detector_ID + 1; ++i) {
+    OutputWriter::CreateNtupleDColumn("det" + std::to_string(i));
   }
 #else
-  analysisManager->CreateNtuple("utr", "Particle information");
+  OutputWriter::CreateNtuple("utr", "Particle information");
 #ifdef EVENT_ID
-  analysisManager->CreateNtupleDColumn("event");
+  OutputWriter::CreateNtupleDColumn("event");
 #endif
 #ifdef EVENT_EDEP
-  analysisManager->CreateNtupleDColumn("edep");
+  OutputWriter::CreateNtupleDColumn("edep");
 #endif
 #ifdef EVENT_EKIN
-  analysisManager->CreateNtupleDColumn("ekin");
+  OutputWriter::CreateNtupleDColumn("ekin");
 #endif
 #ifdef EVENT_PARTICLE
-  analysisManager->CreateNtupleDColumn("particle");
+  OutputWriter::CreateNtupleDColumn("particle");
 #endif
 #ifdef EVENT_VOLUME
-  analysisManager->CreateNtupleDColumn("volume");
+  OutputWriter::CreateNtupleDColumn("volume");
 #endif
 #ifdef EVENT_POSX
-  analysisManager->CreateNtupleDColumn("x");
+  OutputWriter::CreateNtupleDColumn("x");
 #endif
 #ifdef EVENT_POSY
-  analysisManager->CreateNtupleDColumn("y");
+  OutputWriter::CreateNtupleDColumn("y");
 #endif
 #ifdef EVENT_POSZ
-  analysisManager->CreateNtupleDColumn("z");
+  OutputWriter::CreateNtupleDColumn("z");
 #endif
 #ifdef EVENT_MOMX
-  analysisManager->CreateNtupleDColumn("vx");
+  OutputWriter::CreateNtupleDColumn("vx");
 #endif
 #ifdef EVENT_MOMY
-  analysisManager->CreateNtupleDColumn("vy");
+  OutputWriter::CreateNtupleDColumn("vy");
 #endif
 #ifdef EVENT_MOMZ
-  analysisManager->CreateNtupleDColumn("vz");
+  OutputWriter::CreateNtupleDColumn("vz");
+#endif
+#ifdef EVENT_WEIGHT
+  OutputWriter::CreateNtupleDColumn("weight");
+  OutputWriter::CreateNtupleDColumn("history");
 #endif
 #endif
   analysisManager->FinishNtuple();
 
+  Digitizer::CreateHistograms(IsMaster());
+  FluxScoring::CreateHistograms(IsMaster());
+
   // Open an output file
   // Geant4 in Multithreading mode creates files with naming convention
   //
@@ -96,11 +121,44 @@ void RunAction::BeginOfRunAction(const G4Run *) {
   // where the filename is given by the user in analysisManager->OpenFile()
 
   if (IsMaster()) { // G4UserRunAction::IsMaster should be equivalent to G4Threading::G4GetThreadId() == -1
+    SlowEvents::BeginOfRun();
+
+    // The master has built the physics tables at this point
+    Physics *physics = dynamic_cast<Physics *>(G4RunManagerKernel::GetRunManagerKernel()->GetPhysicsList());
+    if (physics) {
+      PhysicsTableCache::Store(physics);
+#ifdef EVENT_EVENTWISE
+      if (physics->HasForcedCollisions()) {
+        G4cerr << "ERROR: Forced collisions (/utr/physics/forceCollision) are not supported in the EVENT_EVENTWISE output mode, which cannot hold several weighted histories of an event. Aborting..." << G4endl;
+        throw std::exception();
+      }
+#elif !defined(EVENT_WEIGHT)
+      if (physics->HasForcedCollisions()) {
+        G4cout << "RunAction: Warning! Forced collisions are used, but the weights are not written to the output file (build option EVENT_WEIGHT)." << G4endl;
+      }
+#endif
+    }
+
     // Master thread (running this function before all other threads) increments the file ID to use, if used
     if (utrFilenameTools::getUseFilenameID()) {
       utrFilenameTools::incrementFilenameID();
     }
-    analysisManager->OpenFile(utrFilenameTools::getMasterFilename());
+    if (Sharding::IsShard()) {
+      Sharding::RecordRun(utrFilenameTools::getFilenamePrefix(), utrFilenameTools::getUseFilenameID() ? (G4int)utrFilenameTools::getFilenameID() : -1);
+    }
+    temporary_output = false;
+    if (!G4Threading::IsMultithreadedApplication()) {
+      // The sequential run manager processes the events in the master thread
+      output_filename = utrFilenameTools::getOutputFilename(".root");
+    } else if (analysisManager->GetNofH1s() > 0 || analysisManager->GetNofH2s() > 0 || analysisManager->GetNofH3s() > 0) {
+      // The histograms of all threads are merged into the file of the master thread
+      output_filename = utrFilenameTools::getHistogramFilename();
+      G4cout << "RunAction: Writing the histograms of this run to '" << output_filename << "'" << G4endl;
+    } else {
+      output_filename = utrFilenameTools::getMasterFilename();
+      temporary_output = true;
+    }
+    analysisManager->OpenFile(output_filename);
   } else {
     // Worker threads check whether their designated output file already exists and if so abort
     G4FileUtilities fu;
@@ -116,18 +174,37 @@ void RunAction::BeginOfRunAction(const G4Run *) {
       G4cerr << "ERROR: Designated outputfile '" << filenameWithThreadID.str() << "' already exists! Aborting..." << G4endl;
       throw std::exception();
     } else {
+      output_filename = filenameWithThreadID.str();
       analysisManager->OpenFile(filename.str());
     }
   }
+
+  OutputWriter::BeginOfRun(output_filename);
 }
 
 void RunAction::EndOfRunAction(const G4Run *) {
-  G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
-
-  analysisManager->Write();
-  analysisManager->CloseFile();
+  // Write and close the output file, after all rows of this thread have been written in asynchronous output mode
+  OutputWriter::EndOfRun(output_filename);
 
   delete G4RootAnalysisManager::Instance();
+
+  // In sequential mode, the master thread processes the events itself
+  if (!IsMaster() || !G4Threading::IsMultithreadedApplication()) {
+    WorkerThreads::EndOfWorkerRun();
+    Trigger::EndOfWorkerRun();
+  }
+  if (IsMaster()) {
+    // The temporary file of the master thread does not contain anything without histograms
+    if (temporary_output) {
+      utrFilenameTools::deleteMasterFilename();
+    }
+    // The output files of all threads have been written, so they mark the file ID as used from now on
+    utrFilenameTools::releaseFilenameID();
+    WorkerThreads::PrintStatistics();
+    Trigger::PrintStatistics();
+    OutputWriter::PrintStatistics();
+    SlowEvents::PrintStatistics();
+  }
 }
 
 G4String RunAction::GetOutputFlagName(unsigned int n) {
@@ -154,6 +231,10 @@ G4String RunAction::GetOutputFlagName(unsigned int n) {
       return "MOMY";
     case MOMZ:
       return "MOMZ";
+    case WEIGHT:
+      return "WEIGHT";
+    case HISTORY:
+      return "HISTORY";
     default:
       G4cout << "RunAction: Error! Output flag index not found." << G4endl;
       return "";
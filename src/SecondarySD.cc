@@ -19,9 +19,10 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "SecondarySD.hh"
+#include "AdjointSimulation.hh"
+#include "ForcedCollisionHistory.hh"
 #include "G4Event.hh"
 #include "G4HCofThisEvent.hh"
-#include "G4RootAnalysisManager.hh"
 #include "G4RunManager.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
@@ -29,7 +30,9 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4ThreeVector.hh"
 #include "G4VProcess.hh"
 #include "G4ios.hh"
+#include "OutputWriter.hh"
 #include "RunAction.hh"
+#include "Sharding.hh"
 
 #include "utrConfig.h"
 
@@ -49,6 +52,10 @@ void SecondarySD::Initialize(G4HCofThisEvent *) {}
 
 G4bool SecondarySD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
   G4Track *track = aStep->GetTrack();
+  // Adjoint particles are tracked backwards and do not deposit energy
+  if (AdjointSimulation::IsAdjointParticle(track->GetDefinition())) {
+    return false;
+  }
   G4int trackID = track->GetTrackID();
 
   G4int eventID = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
@@ -62,55 +69,59 @@ G4bool SecondarySD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
     if (track->GetKineticEnergy() == 0.)
       return false;
 
-    G4RootAnalysisManager *analysisManager = G4RootAnalysisManager::Instance();
-
     unsigned int nentry = 0;
 
 #ifdef EVENT_ID
-    analysisManager->FillNtupleDColumn(nentry, eventID);
+    OutputWriter::FillNtupleDColumn(nentry, eventID + Sharding::GetEventOffset());
     ++nentry;
 #endif
 #ifdef EVENT_EDEP
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetTotalEnergyDeposit());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetTotalEnergyDeposit());
     ++nentry;
 #endif
 #ifdef EVENT_EKIN
-    analysisManager->FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetKineticEnergy());
+    OutputWriter::FillNtupleDColumn(nentry, aStep->GetPreStepPoint()->GetKineticEnergy());
     ++nentry;
 #endif
 #ifdef EVENT_PARTICLE
-    analysisManager->FillNtupleDColumn(nentry, track->GetDefinition()->GetPDGEncoding());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetDefinition()->GetPDGEncoding());
     ++nentry;
 #endif
 #ifdef EVENT_VOLUME
-    analysisManager->FillNtupleDColumn(nentry, getDetectorID());
+    OutputWriter::FillNtupleDColumn(nentry, getDetectorID());
     ++nentry;
 #endif
 #ifdef EVENT_POSX
-    analysisManager->FillNtupleDColumn(nentry, track->GetPosition().x());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetPosition().x());
     ++nentry;
 #endif
 #ifdef EVENT_POSY
-    analysisManager->FillNtupleDColumn(nentry, track->GetPosition().y());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetPosition().y());
     ++nentry;
 #endif
 #ifdef EVENT_POSZ
-    analysisManager->FillNtupleDColumn(nentry, track->GetPosition().z());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetPosition().z());
     ++nentry;
 #endif
 #ifdef EVENT_MOMX
-    analysisManager->FillNtupleDColumn(nentry, track->GetMomentum().x());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetMomentum().x());
     ++nentry;
 #endif
 #ifdef EVENT_MOMY
-    analysisManager->FillNtupleDColumn(nentry, track->GetMomentum().y());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetMomentum().y());
     ++nentry;
 #endif
 #ifdef EVENT_MOMZ
-    analysisManager->FillNtupleDColumn(nentry, track->GetMomentum().z());
+    OutputWriter::FillNtupleDColumn(nentry, track->GetMomentum().z());
+    ++nentry;
+#endif
+#ifdef EVENT_WEIGHT
+    OutputWriter::FillNtupleDColumn(nentry, track->GetWeight());
+    ++nentry;
+    OutputWriter::FillNtupleDColumn(nentry, ForcedCollisionHistory::GetHistory(track));
 #endif
 
-    analysisManager->AddNtupleRow();
+    OutputWriter::AddNtupleRow(ForcedCollisionHistory::GetHistory(track));
   }
 
   return true;
@@ -0,0 +1,284 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Randomize.hh"
+
+#include "Sharding.hh"
+#include "SlowEvents.hh"
+#include "WorkerThreads.hh"
+#include "utrFilenameTools.hh"
+
+G4int Sharding::shard = -1;
+G4int Sharding::n_shards = 1;
+G4int Sharding::shard_n_threads = 0;
+G4int Sharding::event_offset = 0;
+G4String Sharding::output_dir = ".";
+G4int Sharding::parent_pid = 0;
+
+G4String Sharding::ShardDirectory(G4int i) {
+  return output_dir + "/.shard" + std::to_string(parent_pid) + "_" + std::to_string(i);
+}
+
+void Sharding::Fork(G4int n, G4int n_threads) {
+#ifndef G4MULTITHREADED
+  G4cerr << "ERROR: Splitting the simulation into several processes requires a multithreaded build of Geant4. Aborting..." << G4endl;
+  throw std::exception();
+#endif
+  if (n_threads < n) {
+    G4cerr << "ERROR: The number of threads (" << n_threads << ") must be at least the number of processes (" << n << "). Aborting..." << G4endl;
+    throw std::exception();
+  }
+  n_shards = n;
+  output_dir = utrFilenameTools::getOutputDir();
+  parent_pid = (G4int)getpid();
+  std::vector<G4int> first_threads;
+  std::vector<G4int> shard_threads;
+  for (G4int i = 0; i < n_shards; ++i) {
+    first_threads.push_back(i == 0 ? 0 : first_threads[i - 1] + shard_threads[i - 1]);
+    shard_threads.push_back(n_threads / n_shards + (i < n_threads % n_shards ? 1 : 0));
+  }
+
+  G4cout << "Sharding: Splitting the simulation into " << n_shards << " processes with " << n_threads << " threads in total ..." << G4endl;
+  // Buffered output would be written by each child process again
+  G4cout.flush();
+  G4cerr.flush();
+
+  std::vector<pid_t> pids;
+  for (G4int i = 0; i < n_shards; ++i) {
+    const G4String directory = ShardDirectory(i);
+    if (mkdir(directory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) != 0) {
+      G4cerr << "ERROR: Could not create the directory '" << directory << "' for the output of shard " << i << ". Aborting..." << G4endl;
+      throw std::exception();
+    }
+    const pid_t pid = fork();
+    if (pid == -1) {
+      G4cerr << "ERROR: Could not start shard " << i << ". Aborting..." << G4endl;
+      throw std::exception();
+    }
+    if (pid == 0) {
+      shard = i;
+      shard_n_threads = shard_threads[i];
+      // Only the first shard writes to the terminal
+      if (shard > 0) {
+        const int fd = open((directory + "/utr.log").c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (fd != -1) {
+          dup2(fd, STDOUT_FILENO);
+          dup2(fd, STDERR_FILENO);
+          close(fd);
+        }
+      }
+
+      DeriveSeeds();
+
+      utrFilenameTools::setOutputDir(directory);
+      WorkerThreads::RestrictToShard(shard, n_shards, first_threads[i], shard_threads[i]);
+      G4cout << "Sharding: Shard " << shard << " uses the threads " << first_threads[i] << " to " << first_threads[i] + shard_threads[i] - 1 << G4endl;
+      return;
+    }
+    pids.push_back(pid);
+  }
+
+  G4bool success = true;
+  for (G4int i = 0; i < n_shards; ++i) {
+    int status = 0;
+    waitpid(pids[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      G4cerr << "Sharding: Error! Shard " << i << " failed";
+      if (i > 0) {
+        G4cerr << ", see '" << ShardDirectory(i) << "/utr.log'";
+      }
+      G4cerr << "." << G4endl;
+      success = false;
+    }
+  }
+  if (!success) {
+    G4cerr << "ERROR: Not all shards finished successfully, their output files in '" << output_dir << "/.shard" << parent_pid << "_*' were not merged. Aborting..." << G4endl;
+    exit(1);
+  }
+  exit(Merge(first_threads, shard_threads) ? 0 : 1);
+}
+
+void Sharding::DeriveSeeds() {
+  if (shard < 0) {
+    return;
+  }
+  // The state of the Ranecu engine, G4Random::getTheSeed() only returns the index of its seed table
+  const long current_seeds[2] = {G4Random::getTheSeeds()[0], G4Random::getTheSeeds()[1]};
+  std::seed_seq seed_sequence{(unsigned long)current_seeds[0], (unsigned long)current_seeds[1], (unsigned long)shard};
+  std::vector<std::uint32_t> seeds(2);
+  seed_sequence.generate(seeds.begin(), seeds.end());
+  const long ranecu_seeds[3] = {(long)(seeds[0] % 2147483562) + 1, (long)(seeds[1] % 2147483398) + 1, 0};
+  G4Random::setTheSeeds(ranecu_seeds);
+}
+
+G4int Sharding::GetNumberOfEvents(G4int n_event) {
+  if (shard < 0) {
+    return n_event;
+  }
+  return n_event / n_shards + (shard < n_event % n_shards ? 1 : 0);
+}
+
+void Sharding::BeginOfRun(G4int n_event) {
+  if (shard < 0) {
+    return;
+  }
+  DeriveSeeds();
+  event_offset = shard * (n_event / n_shards) + std::min(shard, n_event % n_shards);
+}
+
+void Sharding::RecordRun(const G4String &filename_prefix, G4int filename_id) {
+  std::ofstream runs_file(ShardDirectory(shard) + "/runs", std::ios::app);
+  runs_file << filename_prefix << "\t" << filename_id << "\n";
+}
+
+// Sums the histograms of the sources into the new file target with ROOT's hadd, if it is available
+G4bool Sharding::AddHistograms(const G4String &target, const std::vector<G4String> &sources) {
+  std::vector<char *> hadd_arguments = {(char *)"hadd", (char *)"-f", (char *)target.c_str()};
+  for (auto &source : sources) {
+    hadd_arguments.push_back((char *)source.c_str());
+  }
+  hadd_arguments.push_back(nullptr);
+
+  G4cout.flush();
+  G4cerr.flush();
+  const pid_t pid = fork();
+  if (pid == -1) {
+    return false;
+  }
+  if (pid == 0) {
+    const int fd = open("/dev/null", O_WRONLY);
+    if (fd != -1) {
+      dup2(fd, STDOUT_FILENO);
+      close(fd);
+    }
+    execvp(hadd_arguments[0], hadd_arguments.data());
+    _exit(127);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+G4bool Sharding::Merge(const std::vector<G4int> &first_threads, const std::vector<G4int> &n_threads) {
+  // All shards execute the same macro, i.e. they have the same runs with the same file names
+  std::ifstream runs_file(ShardDirectory(0) + "/runs");
+  G4bool success = true;
+  G4int run = 0;
+  for (std::string line; std::getline(runs_file, line); ++run) {
+    const size_t tab = line.rfind('\t');
+    const G4String filename_prefix = line.substr(0, tab);
+    const G4int filename_id = std::stoi(line.substr(tab + 1));
+
+    std::stringstream shard_filename;
+    std::stringstream filename;
+    shard_filename << filename_prefix;
+    filename << output_dir << "/" << filename_prefix;
+    if (filename_id >= 0) {
+      shard_filename << filename_id;
+      utrFilenameTools::setFilenamePrefix(filename_prefix);
+      filename << utrFilenameTools::reserveFilenameID(0);
+    }
+
+    for (G4int i = 0; i < n_shards; ++i) {
+      for (G4int j = 0; j < n_threads[i]; ++j) {
+        const G4String source = ShardDirectory(i) + "/" + shard_filename.str() + "_t" + std::to_string(j) + ".root";
+        const G4String target = filename.str() + "_t" + std::to_string(first_threads[i] + j) + ".root";
+        if (access(source.c_str(), F_OK) != 0) {
+          continue;
+        }
+        if (access(target.c_str(), F_OK) == 0 || rename(source.c_str(), target.c_str()) != 0) {
+          G4cerr << "Sharding: Error! Could not move '" << source << "' to '" << target << "'." << G4endl;
+          success = false;
+        }
+      }
+    }
+
+    // The histograms of the master thread of each shard are moved next to the merged output and summed if possible
+    std::vector<G4String> histogram_files;
+    for (G4int i = 0; i < n_shards; ++i) {
+      const G4String source = ShardDirectory(i) + "/" + shard_filename.str() + "_hist.root";
+      const G4String target = filename.str() + "_hist_s" + std::to_string(i) + ".root";
+      if (access(source.c_str(), F_OK) != 0) {
+        continue;
+      }
+      if (access(target.c_str(), F_OK) == 0 || rename(source.c_str(), target.c_str()) != 0) {
+        G4cerr << "Sharding: Error! Could not move '" << source << "' to '" << target << "'." << G4endl;
+        success = false;
+        continue;
+      }
+      histogram_files.push_back(target);
+    }
+    utrFilenameTools::releaseFilenameID();
+    G4cout << "Sharding: Output files of run " << run << ": '" << filename.str() << "_t*.root'" << G4endl;
+    if (!histogram_files.empty()) {
+      if (AddHistograms(filename.str() + "_hist.root", histogram_files)) {
+        for (auto &histogram_file : histogram_files) {
+          unlink(histogram_file.c_str());
+        }
+        G4cout << "Sharding: Histograms of run " << run << ": '" << filename.str() << "_hist.root'" << G4endl;
+      } else {
+        G4cout << "Sharding: Warning! The histograms of run " << run << " could not be summed with 'hadd', the histograms of each shard are in '" << filename.str() << "_hist_s*.root'." << G4endl;
+      }
+    }
+  }
+
+  if (!success) {
+    return false;
+  }
+  for (G4int i = 0; i < n_shards; ++i) {
+    const G4String directory = ShardDirectory(i);
+    // The slow events of all shards are collected in a single file
+    const G4String slow_events = directory + "/" + SlowEvents::GetFilename();
+    std::ifstream slow_events_file(slow_events);
+    if (slow_events_file.is_open()) {
+      std::ofstream(output_dir + "/" + SlowEvents::GetFilename(), std::ios::app) << slow_events_file.rdbuf();
+      slow_events_file.close();
+      unlink(slow_events.c_str());
+    }
+    unlink((directory + "/runs").c_str());
+    // The first shard writes to the terminal, the output of the others follows after the merge
+    const G4String log = directory + "/utr.log";
+    std::ifstream log_file(log);
+    if (log_file.is_open()) {
+      G4cout << "Sharding: Output of shard " << i << ":" << G4endl;
+      if (log_file.peek() != std::ifstream::traits_type::eof()) {
+        G4cout << log_file.rdbuf();
+      }
+      G4cout.flush();
+      log_file.close();
+      unlink(log.c_str());
+    }
+    if (rmdir(directory.c_str()) != 0) {
+      G4cerr << "Sharding: Warning! '" << directory << "' contains further files and was not removed." << G4endl;
+    }
+  }
+  return true;
+}
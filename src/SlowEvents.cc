@@ -0,0 +1,241 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <time.h>
+
+#include "G4AutoLock.hh"
+#include "G4Event.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4Track.hh"
+#include "G4UImanager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "Randomize.hh"
+
+#include "Sharding.hh"
+#include "SlowEvents.hh"
+#include "utrFilenameTools.hh"
+
+namespace {
+  G4Mutex fileMutex = G4MUTEX_INITIALIZER;
+}
+
+// Summary of the current event of the calling thread
+static G4ThreadLocal SlowEvents_Event *thread_event = nullptr;
+
+G4double SlowEvents::max_cpu_time = 0.;
+G4long SlowEvents::max_steps = 0;
+G4bool SlowEvents::replaying = false;
+std::vector<SlowEvents_Replay> SlowEvents::replay_events = std::vector<SlowEvents_Replay>();
+G4long SlowEvents::n_slow_events = 0;
+
+// CPU time of the calling thread in seconds
+static G4double CPUTime() {
+  struct timespec cpu_time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time);
+  return (G4double)cpu_time.tv_sec + 1e-9 * (G4double)cpu_time.tv_nsec;
+}
+
+static G4int CurrentRunID() {
+  const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+  return run ? run->GetRunID() : -1;
+}
+
+G4bool SlowEvents::Replay(const G4String &filename, G4int tracking_verbose) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    G4cerr << "SlowEvents: Error! Could not open '" << filename << "'." << G4endl;
+    return false;
+  }
+  replay_events.clear();
+  for (std::string line; std::getline(file, line);) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream columns(line);
+    SlowEvents_Replay replay_event;
+    G4int thread;
+    if (!(columns >> replay_event.run >> replay_event.event >> thread >> replay_event.seeds[0] >> replay_event.seeds[1])) {
+      G4cerr << "SlowEvents: Error! Could not read the line '" << line << "' of '" << filename << "'." << G4endl;
+      replay_events.clear();
+      return false;
+    }
+    replay_events.push_back(replay_event);
+  }
+  if (replay_events.size() == 0) {
+    G4cout << "SlowEvents: '" << filename << "' does not contain any events." << G4endl;
+    return true;
+  }
+  // The events of a run would be distributed over the shards, which all start with the first event
+  if (Sharding::IsShard()) {
+    G4cerr << "SlowEvents: Error! Events can not be replayed in a simulation which is split into several processes." << G4endl;
+    replay_events.clear();
+    return false;
+  }
+
+  G4cout << "SlowEvents: Replaying " << replay_events.size() << " events of '" << filename << "' ..." << G4endl;
+  // Applied as a command, so that it is passed on to the worker threads
+  G4UImanager *UImanager = G4UImanager::GetUIpointer();
+  UImanager->ApplyCommand("/tracking/verbose " + std::to_string(tracking_verbose));
+  replaying = true;
+  G4RunManager::GetRunManager()->BeamOn((G4int)replay_events.size());
+  replaying = false;
+  UImanager->ApplyCommand("/tracking/verbose 0");
+  replay_events.clear();
+  return true;
+}
+
+void SlowEvents::BeginOfEvent(G4Event *event) {
+  if (!thread_event) {
+    thread_event = new SlowEvents_Event();
+  }
+
+  if (replaying) {
+    const G4int event_id = event->GetEventID();
+    if (event_id >= 0 && event_id < (G4int)replay_events.size()) {
+      const long seeds[3] = {replay_events[event_id].seeds[0], replay_events[event_id].seeds[1], 0};
+      G4Random::setTheSeeds(seeds);
+    }
+  }
+  const long *seeds = G4Random::getTheSeeds();
+  thread_event->seeds[0] = seeds[0];
+  thread_event->seeds[1] = seeds[1];
+
+  thread_event->started = IsActive();
+  if (!thread_event->started) {
+    return;
+  }
+  thread_event->cpu_time_start = CPUTime();
+  thread_event->n_tracks = 0;
+  thread_event->n_steps = 0;
+  thread_event->particles.clear();
+  thread_event->longest_track_n_steps = 0;
+}
+
+void SlowEvents::EndOfTrack(const G4Track *track) {
+  if (!thread_event || !thread_event->started) {
+    return;
+  }
+  const G4int n_steps = track->GetCurrentStepNumber();
+  ++thread_event->n_tracks;
+  thread_event->n_steps += n_steps;
+
+  // Only a few different particle types occur in an event
+  const G4ParticleDefinition *particle = track->GetParticleDefinition();
+  auto event_particle = thread_event->particles.begin();
+  while (event_particle != thread_event->particles.end() && event_particle->particle != particle) {
+    ++event_particle;
+  }
+  if (event_particle == thread_event->particles.end()) {
+    thread_event->particles.push_back(SlowEvents_Particle());
+    event_particle = thread_event->particles.end() - 1;
+    event_particle->particle = particle;
+  }
+  ++event_particle->n_tracks;
+  event_particle->n_steps += n_steps;
+
+  if (n_steps > thread_event->longest_track_n_steps) {
+    thread_event->longest_track_id = track->GetTrackID();
+    thread_event->longest_track_n_steps = n_steps;
+    thread_event->longest_track_length = track->GetTrackLength();
+    thread_event->longest_track_particle = particle;
+    thread_event->longest_track_volume = track->GetVolume();
+  }
+}
+
+void SlowEvents::EndOfEvent(const G4Event *event) {
+  // Events of other primary generators, e.g. of the adjoint simulation, are not recorded
+  if (!thread_event || !thread_event->started) {
+    return;
+  }
+  thread_event->started = false;
+  const G4double cpu_time = CPUTime() - thread_event->cpu_time_start;
+
+  if (replaying) {
+    const G4int event_id = event->GetEventID();
+    std::stringstream message;
+    message << "SlowEvents: Replayed event " << event_id;
+    if (event_id < (G4int)replay_events.size()) {
+      message << " (event " << replay_events[event_id].event << " of run " << replay_events[event_id].run << ")";
+    }
+    message << ": " << cpu_time << " s CPU time, " << thread_event->n_steps << " steps, " << thread_event->n_tracks << " tracks\n"
+            << GetSummary();
+    G4AutoLock lock(&fileMutex);
+    G4cout << message.str() << G4endl;
+    return;
+  }
+
+  if ((max_cpu_time > 0. && cpu_time > max_cpu_time) || (max_steps > 0 && thread_event->n_steps > max_steps)) {
+    WriteEvent(event, cpu_time);
+  }
+}
+
+G4String SlowEvents::GetSummary() {
+  std::stringstream summary;
+  for (auto &particle : thread_event->particles) {
+    summary << "#\t" << std::setw(12) << particle.particle->GetParticleName() << std::setw(12) << particle.n_tracks << " tracks" << std::setw(14) << particle.n_steps << " steps\n";
+  }
+  if (thread_event->longest_track_n_steps > 0) {
+    summary << "#\tlongest track: " << thread_event->longest_track_id << " (" << thread_event->longest_track_particle->GetParticleName() << "), "
+            << thread_event->longest_track_n_steps << " steps, " << thread_event->longest_track_length / mm << " mm, ended in '"
+            << (thread_event->longest_track_volume ? thread_event->longest_track_volume->GetName() : G4String("OutOfWorld")) << "'\n";
+  }
+  return summary.str();
+}
+
+void SlowEvents::WriteEvent(const G4Event *event, G4double cpu_time) {
+  std::stringstream record;
+  record << CurrentRunID() << "\t" << event->GetEventID() << "\t" << G4Threading::G4GetThreadId() << "\t"
+         << thread_event->seeds[0] << "\t" << thread_event->seeds[1] << "\t" << cpu_time << "\t" << thread_event->n_steps << "\t" << thread_event->n_tracks << "\n"
+         << GetSummary();
+
+  const G4String filename = utrFilenameTools::getOutputDir() + "/" + GetFilename();
+  G4AutoLock lock(&fileMutex);
+  std::ofstream file(filename, std::ios::app | std::ios::ate);
+  if (file.tellp() == 0) {
+    file << "# RUN\tEVENT\tTHREAD\tSEED1\tSEED2\tCPU_TIME[s]\tSTEPS\tTRACKS\n";
+  }
+  file << record.str();
+  if (!file.good()) {
+    G4cerr << "SlowEvents: Error! Could not write event " << event->GetEventID() << " to '" << filename << "'." << G4endl;
+  }
+  ++n_slow_events;
+  G4cout << "SlowEvents: Event " << event->GetEventID() << " took " << cpu_time << " s CPU time and " << thread_event->n_steps << " steps, written to '" << filename << "'" << G4endl;
+}
+
+void SlowEvents::BeginOfRun() {
+  G4AutoLock lock(&fileMutex);
+  n_slow_events = 0;
+}
+
+void SlowEvents::PrintStatistics() {
+  G4AutoLock lock(&fileMutex);
+  if (n_slow_events == 0) {
+    return;
+  }
+  G4cout << "SlowEvents: " << n_slow_events << " events exceeded the limits of " << max_cpu_time << " s CPU time or " << max_steps << " steps (0: no limit), see '"
+         << utrFilenameTools::getOutputDir() << "/" << GetFilename() << "'" << G4endl;
+}
@@ -0,0 +1,87 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4SystemOfUnits.hh"
+#include "G4UIparameter.hh"
+
+#include "SlowEvents.hh"
+#include "SlowEventsMessenger.hh"
+
+SlowEventsMessenger::SlowEventsMessenger() {
+  slowEventsDirectory = new G4UIdirectory("/utr/slowEvents/");
+  slowEventsDirectory->SetGuidance("Controls for the detection and replay of slow events.");
+
+  maxCPUTimeCmd = new G4UIcmdWithADoubleAndUnit("/utr/slowEvents/maxCPUTime", this);
+  maxCPUTimeCmd->SetGuidance("Write the seeds and a summary of the events which take more CPU time than the limit to OUTPUTDIR/slow_events.txt (default: 0, no limit).");
+  maxCPUTimeCmd->SetParameterName("time", false);
+  maxCPUTimeCmd->SetRange("time >= 0.");
+  maxCPUTimeCmd->SetDefaultUnit("s");
+  maxCPUTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  maxStepsCmd = new G4UIcmdWithAnInteger("/utr/slowEvents/maxSteps", this);
+  maxStepsCmd->SetGuidance("Write the seeds and a summary of the events with more steps than the limit to OUTPUTDIR/slow_events.txt (default: 0, no limit).");
+  maxStepsCmd->SetParameterName("steps", false);
+  maxStepsCmd->SetRange("steps >= 0");
+  maxStepsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  replayCmd = new G4UIcommand("/utr/slowEvents/replay", this);
+  replayCmd->SetGuidance("Simulate the events of a file written by /utr/slowEvents/maxCPUTime or /utr/slowEvents/maxSteps again, with the given tracking verbosity (default: 1).");
+  replayCmd->SetGuidance("The geometry, physics and source settings have to be the same as in the original run.");
+  replayCmd->SetParameter(new G4UIparameter("filename", 's', false));
+  G4UIparameter *replayVerboseParameter = new G4UIparameter("trackingVerbose", 'i', true);
+  replayVerboseParameter->SetDefaultValue(1);
+  replayCmd->SetParameter(replayVerboseParameter);
+  replayCmd->AvailableForStates(G4State_Idle);
+}
+
+SlowEventsMessenger::~SlowEventsMessenger() {
+  delete maxCPUTimeCmd;
+  delete maxStepsCmd;
+  delete replayCmd;
+  delete slowEventsDirectory;
+}
+
+void SlowEventsMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+
+  if (command == maxCPUTimeCmd) {
+    SlowEvents::SetMaxCPUTime(maxCPUTimeCmd->GetNewDoubleValue(newValues) / s);
+  } else if (command == maxStepsCmd) {
+    SlowEvents::SetMaxSteps(maxStepsCmd->GetNewIntValue(newValues));
+  } else if (command == replayCmd) {
+    G4String filename;
+    G4int tracking_verbose;
+    parameters >> filename >> tracking_verbose;
+    SlowEvents::Replay(filename, tracking_verbose);
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String SlowEventsMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == maxCPUTimeCmd) {
+    return maxCPUTimeCmd->ConvertToString(SlowEvents::GetMaxCPUTime() * s, "s");
+  } else if (command == maxStepsCmd) {
+    return maxStepsCmd->ConvertToString((G4int)SlowEvents::GetMaxSteps());
+  }
+  return "";
+}
@@ -0,0 +1,382 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+#include "G4AutoLock.hh"
+#include "G4EmCalculator.hh"
+#include "G4Gamma.hh"
+#include "G4GeometryWorkspace.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Material.hh"
+#include "G4Navigator.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4RunManager.hh"
+#include "G4SolidsWorkspace.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "Randomize.hh"
+
+#include "EnergyDepositionSD.hh"
+#include "SolidAngleCalculator.hh"
+#include "WorkerThreads.hh"
+
+namespace {
+  G4Mutex detectorsMutex = G4MUTEX_INITIALIZER;
+}
+
+// Rays which have not left the world after this number of steps are counted as stuck
+static const G4int max_steps = 100000;
+
+G4ThreeVector SolidAngleCalculator::source_point = G4ThreeVector();
+G4String SolidAngleCalculator::source_volume = "";
+std::vector<G4double> SolidAngleCalculator::energies = std::vector<G4double>();
+G4int SolidAngleCalculator::n_threads = 0;
+
+G4VSolid *SolidAngleCalculator::source_solid = nullptr;
+G4AffineTransform SolidAngleCalculator::source_transform = G4AffineTransform();
+G4ThreeVector SolidAngleCalculator::source_min = G4ThreeVector();
+G4ThreeVector SolidAngleCalculator::source_max = G4ThreeVector();
+std::map<const G4LogicalVolume *, G4int> SolidAngleCalculator::detector_ids = std::map<const G4LogicalVolume *, G4int>();
+std::vector<std::vector<G4double>> SolidAngleCalculator::attenuation_coefficients = std::vector<std::vector<G4double>>();
+std::map<G4int, SolidAngleCalculator_Detector> SolidAngleCalculator::detectors = std::map<G4int, SolidAngleCalculator_Detector>();
+G4long SolidAngleCalculator::n_stuck = 0;
+
+void SolidAngleCalculator::SetSourcePoint(const G4ThreeVector &point) {
+  source_point = point;
+  source_volume = "";
+}
+
+void SolidAngleCalculator::SetSourceVolume(const G4String &physical_volume) {
+  source_volume = physical_volume;
+}
+
+G4bool SolidAngleCalculator::FindSourceTransform(G4VPhysicalVolume *world) {
+  source_solid = nullptr;
+  source_transform = G4AffineTransform();
+  if (source_volume == "") {
+    return true;
+  }
+
+  G4PhysicalVolumeStore *physicalVolumeStore = G4PhysicalVolumeStore::GetInstance();
+  const G4VPhysicalVolume *volume = physicalVolumeStore->GetVolume(source_volume, false);
+  if (!volume) {
+    G4cerr << "SolidAngleCalculator: Error! Physical volume '" << source_volume << "' does not exist." << G4endl;
+    return false;
+  }
+
+  const G4VPhysicalVolume *daughter = volume;
+  while (daughter != world) {
+    source_transform = source_transform * G4AffineTransform(daughter->GetRotation(), daughter->GetTranslation());
+    const G4VPhysicalVolume *mother = nullptr;
+    for (auto candidate : *physicalVolumeStore) {
+      if (candidate->GetLogicalVolume()->IsDaughter(daughter)) {
+        mother = candidate;
+        break;
+      }
+    }
+    if (!mother) {
+      G4cerr << "SolidAngleCalculator: Error! Physical volume '" << source_volume << "' is not part of the world volume." << G4endl;
+      return false;
+    }
+    daughter = mother;
+  }
+
+  source_solid = volume->GetLogicalVolume()->GetSolid();
+  source_solid->BoundingLimits(source_min, source_max);
+  return true;
+}
+
+// The sensitive detectors are constructed for the master thread as well, so they can be found here
+void SolidAngleCalculator::BuildDetectorMap() {
+  detector_ids.clear();
+  for (auto logicalVolume : *G4LogicalVolumeStore::GetInstance()) {
+    EnergyDepositionSD *sensitiveDetector = dynamic_cast<EnergyDepositionSD *>(logicalVolume->GetSensitiveDetector());
+    if (sensitiveDetector) {
+      detector_ids[logicalVolume] = sensitiveDetector->GetDetectorID();
+    }
+  }
+}
+
+void SolidAngleCalculator::ComputeAttenuationCoefficients() {
+  attenuation_coefficients.clear();
+  if (energies.size() == 0) {
+    return;
+  }
+
+  // Builds the physics tables if this has not happened yet
+  G4RunManager::GetRunManager()->BeamOn(0);
+
+  G4EmCalculator emCalculator;
+  const std::vector<G4String> processes = {"phot", "compt", "Rayl", "conv"};
+  const G4MaterialTable *materialTable = G4Material::GetMaterialTable();
+  for (auto energy : energies) {
+    std::vector<G4double> coefficients(materialTable->size(), 0.);
+    for (auto material : *materialTable) {
+      for (auto &process : processes) {
+        coefficients[material->GetIndex()] += emCalculator.ComputeCrossSectionPerVolume(energy, G4Gamma::Gamma(), process, material);
+      }
+    }
+    attenuation_coefficients.push_back(coefficients);
+  }
+}
+
+G4ThreeVector SolidAngleCalculator::SampleSourcePoint(std::mt19937_64 &engine) {
+  if (!source_solid) {
+    return source_point;
+  }
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+  G4ThreeVector point;
+  do {
+    point = G4ThreeVector(source_min.x() + (source_max.x() - source_min.x()) * uniform(engine),
+                          source_min.y() + (source_max.y() - source_min.y()) * uniform(engine),
+                          source_min.z() + (source_max.z() - source_min.z()) * uniform(engine));
+  } while (source_solid->Inside(point) == kOutside);
+  return source_transform.TransformPoint(point);
+}
+
+void SolidAngleCalculator::TraceRays(G4VPhysicalVolume *world, G4long n_rays, G4long seed) {
+#ifdef G4MULTITHREADED
+  // Like a worker thread of Geant4, each thread needs its own copy of the thread-local data of the
+  // logical and physical volumes and of the solids
+  G4GeometryWorkspace::GetPool()->CreateAndUseWorkspace();
+  G4SolidsWorkspace::GetPool()->CreateAndUseWorkspace();
+#endif
+
+  std::mt19937_64 engine(seed);
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+
+  G4Navigator navigator;
+  navigator.SetWorldVolume(world);
+  navigator.SetPushVerbosity(false);
+
+  const size_t n_materials = G4Material::GetNumberOfMaterials();
+  const size_t n_energies = energies.size();
+  std::map<G4int, SolidAngleCalculator_Detector> thread_detectors;
+  G4long thread_n_stuck = 0;
+
+  // Path lengths of the current ray. Only the touched materials are reset after each ray.
+  std::vector<G4double> ray_path_length(n_materials, 0.);
+  std::vector<size_t> touched_materials;
+  std::vector<G4int> hit_detectors;
+
+  for (G4long ray = 0; ray < n_rays; ++ray) {
+    G4ThreeVector position = SampleSourcePoint(engine);
+    const G4double cos_theta = 2. * uniform(engine) - 1.;
+    const G4double sin_theta = sqrt(1. - cos_theta * cos_theta);
+    const G4double phi = twopi * uniform(engine);
+    const G4ThreeVector direction(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+
+    G4VPhysicalVolume *volume = navigator.LocateGlobalPointAndSetup(position, &direction, false, false);
+    for (G4int step = 0; volume; ++step) {
+      if (step == max_steps) {
+        ++thread_n_stuck;
+        break;
+      }
+      const G4LogicalVolume *logicalVolume = volume->GetLogicalVolume();
+
+      auto detector_id = detector_ids.find(logicalVolume);
+      if (detector_id != detector_ids.end() && std::find(hit_detectors.begin(), hit_detectors.end(), detector_id->second) == hit_detectors.end()) {
+        hit_detectors.push_back(detector_id->second);
+        SolidAngleCalculator_Detector &detector = thread_detectors[detector_id->second];
+        if (detector.path_length.size() == 0) {
+          detector.path_length = std::vector<G4double>(n_materials, 0.);
+          detector.transmission = std::vector<G4double>(n_energies, 0.);
+        }
+        ++detector.n_hits;
+        for (auto material : touched_materials) {
+          detector.path_length[material] += ray_path_length[material];
+        }
+        for (size_t i = 0; i < n_energies; ++i) {
+          G4double attenuation = 0.;
+          for (auto material : touched_materials) {
+            attenuation += attenuation_coefficients[i][material] * ray_path_length[material];
+          }
+          detector.transmission[i] += exp(-attenuation);
+        }
+      }
+
+      G4double safety = 0.;
+      const G4double step_length = navigator.ComputeStep(position, direction, kInfinity, safety);
+      if (step_length == kInfinity) {
+        break;
+      }
+      const G4Material *material = logicalVolume->GetMaterial();
+      if (material) {
+        if (ray_path_length[material->GetIndex()] == 0.) {
+          touched_materials.push_back(material->GetIndex());
+        }
+        ray_path_length[material->GetIndex()] += step_length;
+      }
+
+      position += step_length * direction;
+      navigator.SetGeometricallyLimitedStep();
+      volume = navigator.LocateGlobalPointAndSetup(position, &direction, true);
+    }
+
+    for (auto material : touched_materials) {
+      ray_path_length[material] = 0.;
+    }
+    touched_materials.clear();
+    hit_detectors.clear();
+  }
+
+  G4AutoLock lock(&detectorsMutex);
+  for (auto &thread_detector : thread_detectors) {
+    SolidAngleCalculator_Detector &detector = detectors[thread_detector.first];
+    if (detector.path_length.size() == 0) {
+      detector.path_length = std::vector<G4double>(n_materials, 0.);
+      detector.transmission = std::vector<G4double>(n_energies, 0.);
+    }
+    detector.n_hits += thread_detector.second.n_hits;
+    for (size_t i = 0; i < n_materials; ++i) {
+      detector.path_length[i] += thread_detector.second.path_length[i];
+    }
+    for (size_t i = 0; i < n_energies; ++i) {
+      detector.transmission[i] += thread_detector.second.transmission[i];
+    }
+  }
+  n_stuck += thread_n_stuck;
+  lock.unlock();
+
+#ifdef G4MULTITHREADED
+  G4SolidsWorkspace::GetPool()->ReleaseWorkspace();
+  G4GeometryWorkspace::GetPool()->ReleaseWorkspace();
+#endif
+}
+
+void SolidAngleCalculator::Run(G4long n_rays) {
+  G4VPhysicalVolume *world = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume();
+  if (!world) {
+    G4cerr << "SolidAngleCalculator: Error! The geometry has not been constructed yet, use /run/initialize first." << G4endl;
+    return;
+  }
+  if (!FindSourceTransform(world)) {
+    return;
+  }
+  BuildDetectorMap();
+  if (detector_ids.size() == 0) {
+    G4cerr << "SolidAngleCalculator: Error! No EnergyDepositionSD was found in the geometry." << G4endl;
+    return;
+  }
+  ComputeAttenuationCoefficients();
+
+  detectors.clear();
+  n_stuck = 0;
+
+  const G4int n_calculation_threads = n_threads > 0 ? n_threads : WorkerThreads::GetNumberOfAvailableCores();
+  G4cout << "SolidAngleCalculator: Tracing " << n_rays << " rays with " << n_calculation_threads << " threads ..." << G4endl;
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (G4int i = 0; i < n_calculation_threads; ++i) {
+    const G4long n_thread_rays = n_rays / n_calculation_threads + (i < n_rays % n_calculation_threads ? 1 : 0);
+    // The seeds are drawn from the random number engine of utr, so the results are reproducible for a fixed seed
+    const G4long seed = (G4long)(G4UniformRand() * 4294967296.);
+    threads.push_back(std::thread(TraceRays, world, n_thread_rays, seed));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  PrintResults(n_rays, std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void SolidAngleCalculator::PrintResults(G4long n_rays, G4double run_time) {
+  const G4MaterialTable *materialTable = G4Material::GetMaterialTable();
+
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  G4cout << "SolidAngleCalculator: " << n_rays << " rays from ";
+  if (source_volume == "") {
+    G4cout << "the point " << source_point / mm << " mm";
+  } else {
+    G4cout << "the volume '" << source_volume << "'";
+  }
+  G4cout << " in " << std::fixed << std::setprecision(1) << run_time << " s" << G4endl;
+  if (n_stuck > 0) {
+    G4cout << "SolidAngleCalculator: Warning! " << n_stuck << " rays were stuck in the geometry." << G4endl;
+  }
+
+  G4cout << "\tdetector\trays\t\tOmega/4pi [%]\terror [%]";
+  for (auto energy : energies) {
+    G4cout << "\t<T> at " << std::setprecision(1) << energy / keV << " keV";
+  }
+  G4cout << G4endl;
+  for (auto &detector : detectors) {
+    const G4double fraction = (G4double)detector.second.n_hits / n_rays;
+    G4cout << "\t" << detector.first << "\t\t" << std::setw(12) << detector.second.n_hits << "\t" << std::scientific << std::setprecision(4) << 100. * fraction << "\t" << 100. * sqrt((G4double)detector.second.n_hits) / n_rays;
+    for (auto transmission : detector.second.transmission) {
+      G4cout << "\t" << transmission / detector.second.n_hits;
+    }
+    G4cout << std::fixed << G4endl;
+  }
+
+  // Mean material in front of each detector, in the order of decreasing areal density
+  G4cout << "SolidAngleCalculator: Mean path length [mm] (areal density [g/cm2]) in front of the detectors:" << G4endl;
+  for (auto &detector : detectors) {
+    std::vector<std::pair<G4double, size_t>> areal_densities;
+    for (size_t i = 0; i < detector.second.path_length.size(); ++i) {
+      if (detector.second.path_length[i] > 0.) {
+        areal_densities.push_back(std::make_pair(detector.second.path_length[i] / detector.second.n_hits * (*materialTable)[i]->GetDensity(), i));
+      }
+    }
+    std::sort(areal_densities.rbegin(), areal_densities.rend());
+
+    G4cout << "\t" << detector.first << ":";
+    for (auto &areal_density : areal_densities) {
+      G4cout << " " << (*materialTable)[areal_density.second]->GetName() << " " << std::setprecision(3) << detector.second.path_length[areal_density.second] / detector.second.n_hits / mm << " (" << areal_density.first / (g / cm2) << ")";
+    }
+    G4cout << G4endl;
+  }
+  G4cout << std::defaultfloat << std::setprecision(6);
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
+
+void SolidAngleCalculator::PrintInfo() {
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  if (source_volume == "") {
+    G4cout << "SolidAngleCalculator: Source point " << source_point / mm << " mm" << G4endl;
+  } else {
+    G4cout << "SolidAngleCalculator: Source volume '" << source_volume << "'" << G4endl;
+  }
+  G4cout << "SolidAngleCalculator: Energies for the attenuation:";
+  for (auto energy : energies) {
+    G4cout << " " << energy / keV << " keV";
+  }
+  G4cout << G4endl;
+  G4cout << "SolidAngleCalculator: Number of threads: " << (n_threads > 0 ? n_threads : WorkerThreads::GetNumberOfAvailableCores()) << G4endl;
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
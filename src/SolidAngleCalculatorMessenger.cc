@@ -0,0 +1,105 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SolidAngleCalculator.hh"
+#include "SolidAngleCalculatorMessenger.hh"
+
+SolidAngleCalculatorMessenger::SolidAngleCalculatorMessenger() {
+  solidAngleDirectory = new G4UIdirectory("/utr/solidAngle/");
+  solidAngleDirectory->SetGuidance("Geometry-only calculation of the solid angles of the detectors and of the material in front of them.");
+
+  sourcePointCmd = new G4UIcmdWith3VectorAndUnit("/utr/solidAngle/sourcePoint", this);
+  sourcePointCmd->SetGuidance("Cast the rays from a point (default: the origin).");
+  sourcePointCmd->SetParameterName("x", "y", "z", false);
+  sourcePointCmd->SetDefaultUnit("mm");
+  sourcePointCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  sourceVolumeCmd = new G4UIcmdWithAString("/utr/solidAngle/sourceVolume", this);
+  sourceVolumeCmd->SetGuidance("Cast the rays from points uniformly distributed inside a physical volume, e.g. the target.");
+  sourceVolumeCmd->SetParameterName("physicalVolume", false);
+  sourceVolumeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  energyCmd = new G4UIcmdWithADoubleAndUnit("/utr/solidAngle/energy", this);
+  energyCmd->SetGuidance("Add a photon energy for which the transmission through the material in front of the detectors is calculated.");
+  energyCmd->SetParameterName("energy", false);
+  energyCmd->SetDefaultUnit("keV");
+  energyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  clearEnergiesCmd = new G4UIcommand("/utr/solidAngle/clearEnergies", this);
+  clearEnergiesCmd->SetGuidance("Remove all photon energies.");
+  clearEnergiesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  threadsCmd = new G4UIcmdWithAnInteger("/utr/solidAngle/threads", this);
+  threadsCmd->SetGuidance("Set the number of threads (default: 0, i.e. the number of available cores).");
+  threadsCmd->SetParameterName("nthreads", false);
+  threadsCmd->SetRange("nthreads >= 0");
+  threadsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  beamOnCmd = new G4UIcmdWithADouble("/utr/solidAngle/beamOn", this);
+  beamOnCmd->SetGuidance("Cast the given number of rays, e.g. '/utr/solidAngle/beamOn 1e9'.");
+  beamOnCmd->SetParameterName("nrays", false);
+  beamOnCmd->SetRange("nrays >= 1");
+  beamOnCmd->AvailableForStates(G4State_Idle);
+
+  printCmd = new G4UIcommand("/utr/solidAngle/print", this);
+  printCmd->SetGuidance("Print the current settings of the solid angle calculation.");
+}
+
+SolidAngleCalculatorMessenger::~SolidAngleCalculatorMessenger() {
+  delete sourcePointCmd;
+  delete sourceVolumeCmd;
+  delete energyCmd;
+  delete clearEnergiesCmd;
+  delete threadsCmd;
+  delete beamOnCmd;
+  delete printCmd;
+  delete solidAngleDirectory;
+}
+
+void SolidAngleCalculatorMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  if (command == sourcePointCmd) {
+    SolidAngleCalculator::SetSourcePoint(sourcePointCmd->GetNew3VectorValue(newValues));
+  } else if (command == sourceVolumeCmd) {
+    SolidAngleCalculator::SetSourceVolume(newValues);
+  } else if (command == energyCmd) {
+    SolidAngleCalculator::AddEnergy(energyCmd->GetNewDoubleValue(newValues));
+  } else if (command == clearEnergiesCmd) {
+    SolidAngleCalculator::ClearEnergies();
+  } else if (command == threadsCmd) {
+    SolidAngleCalculator::SetNumberOfThreads(threadsCmd->GetNewIntValue(newValues));
+  } else if (command == beamOnCmd) {
+    SolidAngleCalculator::Run((G4long)beamOnCmd->GetNewDoubleValue(newValues));
+  } else if (command == printCmd) {
+    SolidAngleCalculator::PrintInfo();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String SolidAngleCalculatorMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == sourcePointCmd) {
+    return sourcePointCmd->ConvertToString(SolidAngleCalculator::GetSourcePoint(), "mm");
+  } else if (command == sourceVolumeCmd) {
+    return SolidAngleCalculator::GetSourceVolume();
+  } else if (command == threadsCmd) {
+    return threadsCmd->ConvertToString(SolidAngleCalculator::GetNumberOfThreads());
+  }
+  return "";
+}
@@ -24,7 +24,7 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 
 G4ThreadLocal G4Allocator<TargetHit> *TargetHitAllocator = 0;
 
-TargetHit::TargetHit() : G4VHit() {}
+TargetHit::TargetHit() : G4VHit(), weight(1.), history(0) {}
 
 TargetHit::~TargetHit() {}
 
@@ -35,6 +35,8 @@ TargetHit::TargetHit(const TargetHit &right) : G4VHit() {
   detectorID = right.detectorID;
   pos = right.pos;
   mom = right.mom;
+  weight = right.weight;
+  history = right.history;
 }
 
 const TargetHit &TargetHit::operator=(const TargetHit &right) {
@@ -45,6 +47,8 @@ const TargetHit &TargetHit::operator=(const TargetHit &right) {
   detectorID = right.detectorID;
   pos = right.pos;
   mom = right.mom;
+  weight = right.weight;
+  history = right.history;
 
   return *this;
 }
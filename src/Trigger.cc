@@ -0,0 +1,354 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "G4AutoLock.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4ios.hh"
+
+#include "Digitizer.hh"
+#include "EnergyDepositionSD.hh"
+#include "Trigger.hh"
+
+namespace {
+  G4Mutex statisticsMutex = G4MUTEX_INITIALIZER;
+}
+
+// Energy depositions of each history in the current event, the accepted histories of the last
+// event and statistics of the current run of the calling thread
+static G4ThreadLocal std::map<G4int, std::map<G4int, G4double>> *event_energies = nullptr;
+static G4ThreadLocal std::vector<Trigger_Deposition> *event_depositions = nullptr;
+static G4ThreadLocal std::set<G4int> *accepted_histories = nullptr;
+static G4ThreadLocal Trigger_Statistics *thread_statistics = nullptr;
+
+G4bool Trigger::active = false;
+std::map<G4int, G4double> Trigger::thresholds = std::map<G4int, G4double>();
+std::map<G4String, std::vector<G4int>> Trigger::groups = std::map<G4String, std::vector<G4int>>();
+std::vector<Trigger_Condition> Trigger::conditions = std::vector<Trigger_Condition>();
+Trigger_Statistics Trigger::statistics = Trigger_Statistics();
+
+void Trigger::SetThreshold(G4int detID, G4double thr) {
+  thresholds[detID] = thr;
+}
+
+void Trigger::DefineGroup(const G4String &name, const std::vector<G4int> &detIDs) {
+  groups[name] = detIDs;
+}
+
+G4bool Trigger::AddMultiplicity(const G4String &group, G4int min_multiplicity, G4int max_multiplicity) {
+  if (groups.find(group) == groups.end()) {
+    return false;
+  }
+  Trigger_Condition condition;
+  condition.type = MULTIPLICITY;
+  condition.groups.push_back(group);
+  condition.min_multiplicity = min_multiplicity;
+  condition.max_multiplicity = max_multiplicity;
+  conditions.push_back(condition);
+  return true;
+}
+
+G4bool Trigger::AddCoincidence(const std::vector<G4String> &coincidence_groups) {
+  for (auto &group : coincidence_groups) {
+    if (groups.find(group) == groups.end()) {
+      return false;
+    }
+  }
+  Trigger_Condition condition;
+  condition.type = COINCIDENCE;
+  condition.groups = coincidence_groups;
+  conditions.push_back(condition);
+  return true;
+}
+
+G4bool Trigger::AddVeto(const G4String &veto_group, const G4String &group) {
+  if (groups.find(veto_group) == groups.end() || (group != "" && groups.find(group) == groups.end())) {
+    return false;
+  }
+  Trigger_Condition condition;
+  condition.type = VETO;
+  condition.groups.push_back(veto_group);
+  if (group != "") {
+    condition.groups.push_back(group);
+  }
+  conditions.push_back(condition);
+  return true;
+}
+
+void Trigger::Clear() {
+  thresholds.clear();
+  groups.clear();
+  conditions.clear();
+}
+
+void Trigger::AddEnergyDeposition(G4int detID, G4double energy, G4double weight, G4int history) {
+  if (!active) {
+    return;
+  }
+  if (!event_energies) {
+    event_energies = new std::map<G4int, std::map<G4int, G4double>>();
+    event_depositions = new std::vector<Trigger_Deposition>();
+  }
+  (*event_energies)[history][detID] += energy;
+  event_depositions->push_back({detID, energy, weight, history});
+}
+
+G4int Trigger::CountFired(const G4String &group, const std::map<G4int, G4double> &energies) {
+  auto detIDs = groups.find(group);
+  if (detIDs == groups.end()) {
+    return 0;
+  }
+  G4int n_fired = 0;
+  for (auto detID : detIDs->second) {
+    auto energy = energies.find(detID);
+    if (energy == energies.end() || energy->second <= 0.) {
+      continue;
+    }
+    auto threshold = thresholds.find(detID);
+    if (threshold == thresholds.end() || energy->second >= threshold->second) {
+      ++n_fired;
+    }
+  }
+  return n_fired;
+}
+
+G4bool Trigger::Accepts(const std::map<G4int, G4double> &energies) {
+  G4bool any_fired = false;
+  for (auto &energy : energies) {
+    auto threshold = thresholds.find(energy.first);
+    if (energy.second > 0. && (threshold == thresholds.end() || energy.second >= threshold->second)) {
+      any_fired = true;
+      break;
+    }
+  }
+  if (!any_fired) {
+    ++thread_statistics->n_no_hit;
+    return false;
+  }
+
+  G4bool accepted = true;
+  for (size_t i = 0; accepted && i < conditions.size(); ++i) {
+    const Trigger_Condition &condition = conditions[i];
+    if (condition.type == MULTIPLICITY) {
+      const G4int n_fired = CountFired(condition.groups[0], energies);
+      accepted = n_fired >= condition.min_multiplicity && (condition.max_multiplicity < 0 || n_fired <= condition.max_multiplicity);
+    } else if (condition.type == COINCIDENCE) {
+      for (auto &group : condition.groups) {
+        if (CountFired(group, energies) == 0) {
+          accepted = false;
+          break;
+        }
+      }
+    } else if (condition.type == VETO) {
+      accepted = CountFired(condition.groups[0], energies) == 0 || (condition.groups.size() > 1 && CountFired(condition.groups[1], energies) == 0);
+    }
+    if (!accepted) {
+      ++thread_statistics->n_failed[i];
+    }
+  }
+  return accepted;
+}
+
+void Trigger::EndOfEvent() {
+  if (!active) {
+    return;
+  }
+  if (!event_energies) {
+    event_energies = new std::map<G4int, std::map<G4int, G4double>>();
+    event_depositions = new std::vector<Trigger_Deposition>();
+  }
+  if (!accepted_histories) {
+    accepted_histories = new std::set<G4int>();
+  }
+  if (!thread_statistics) {
+    thread_statistics = new Trigger_Statistics();
+  }
+  ++thread_statistics->n_events;
+  thread_statistics->n_failed.resize(conditions.size(), 0);
+
+  // An event without any energy deposition counts as a single rejected history
+  if (event_energies->empty()) {
+    (*event_energies)[0];
+  }
+  accepted_histories->clear();
+  for (auto &history : *event_energies) {
+    ++thread_statistics->n_histories;
+    if (Accepts(history.second)) {
+      accepted_histories->insert(history.first);
+    }
+  }
+
+  // The online histograms are filled here instead of in the sensitive detectors
+  if (!accepted_histories->empty() && Digitizer::IsActive()) {
+    for (auto &deposition : *event_depositions) {
+      if (accepted_histories->count(deposition.history)) {
+        Digitizer::FillHistogram(deposition.detID, deposition.energy, deposition.weight);
+      }
+    }
+  }
+  event_energies->clear();
+  event_depositions->clear();
+}
+
+G4bool Trigger::IsAccepted(G4int history) {
+  return !active || (accepted_histories && accepted_histories->count(history));
+}
+
+void Trigger::BeginOfRun() {
+  if (G4Threading::IsMasterThread()) {
+    G4AutoLock lock(&statisticsMutex);
+    statistics = Trigger_Statistics();
+    if (active) {
+      CheckSensitiveDetectors();
+    }
+  }
+  if (!thread_statistics) {
+    thread_statistics = new Trigger_Statistics();
+  }
+  *thread_statistics = Trigger_Statistics();
+  if (event_energies) {
+    event_energies->clear();
+    event_depositions->clear();
+  }
+  if (accepted_histories) {
+    accepted_histories->clear();
+  }
+}
+
+// The sensitive detectors are constructed for the master thread as well, so they can be found here
+void Trigger::CheckSensitiveDetectors() {
+  G4int n_energy_deposition = 0, n_other = 0;
+  for (auto logicalVolume : *G4LogicalVolumeStore::GetInstance()) {
+    if (!logicalVolume->GetSensitiveDetector()) {
+      continue;
+    }
+    if (dynamic_cast<EnergyDepositionSD *>(logicalVolume->GetSensitiveDetector())) {
+      ++n_energy_deposition;
+    } else {
+      ++n_other;
+    }
+  }
+  if (n_energy_deposition == 0) {
+    G4cout << "Trigger: Warning! The trigger is active, but the geometry contains no EnergyDepositionSD detectors. No event will be accepted and nothing will be written to the output file." << G4endl;
+  } else if (n_other > 0) {
+    G4cout << "Trigger: Warning! The hits of the " << n_other << " ParticleSD or SecondarySD volumes do not fire the trigger. They are only written for events accepted because of the EnergyDepositionSD detectors." << G4endl;
+  }
+}
+
+void Trigger::EndOfWorkerRun() {
+  if (!thread_statistics) {
+    return;
+  }
+  G4AutoLock lock(&statisticsMutex);
+  statistics.n_events += thread_statistics->n_events;
+  statistics.n_histories += thread_statistics->n_histories;
+  statistics.n_no_hit += thread_statistics->n_no_hit;
+  statistics.n_failed.resize(conditions.size(), 0);
+  for (size_t i = 0; i < thread_statistics->n_failed.size() && i < statistics.n_failed.size(); ++i) {
+    statistics.n_failed[i] += thread_statistics->n_failed[i];
+  }
+}
+
+G4String Trigger::GetDescription(const Trigger_Condition &condition) {
+  std::stringstream description;
+  if (condition.type == MULTIPLICITY) {
+    description << "multiplicity(" << condition.groups[0] << ") >= " << condition.min_multiplicity;
+    if (condition.max_multiplicity >= 0) {
+      description << " and <= " << condition.max_multiplicity;
+    }
+  } else if (condition.type == COINCIDENCE) {
+    description << "coincidence(";
+    for (size_t i = 0; i < condition.groups.size(); ++i) {
+      description << (i > 0 ? ", " : "") << condition.groups[i];
+    }
+    description << ")";
+  } else if (condition.type == VETO) {
+    description << "veto(" << condition.groups[0];
+    if (condition.groups.size() > 1) {
+      description << " on " << condition.groups[1];
+    }
+    description << ")";
+  }
+  return description.str();
+}
+
+void Trigger::PrintStatistics() {
+  G4AutoLock lock(&statisticsMutex);
+  if (!active || statistics.n_events == 0) {
+    return;
+  }
+
+  G4long n_accepted = statistics.n_histories - statistics.n_no_hit;
+  for (auto n_failed : statistics.n_failed) {
+    n_accepted -= n_failed;
+  }
+
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  // Without variance reduction, each event consists of a single history
+  const G4String unit = statistics.n_histories == statistics.n_events ? "events" : "histories";
+  G4cout << "Trigger: Accepted " << n_accepted << " of " << statistics.n_histories << " " << unit;
+  if (statistics.n_histories != statistics.n_events) {
+    G4cout << " in " << statistics.n_events << " events";
+  }
+  G4cout << " (" << std::fixed << std::setprecision(3) << 100. * n_accepted / statistics.n_histories << " %)" << G4endl;
+  G4cout << "\trejected " << unit << "\tcondition" << G4endl;
+  G4cout << "\t" << std::setw(15) << statistics.n_no_hit << "\tno detector above threshold" << G4endl;
+  for (size_t i = 0; i < conditions.size() && i < statistics.n_failed.size(); ++i) {
+    G4cout << "\t" << std::setw(15) << statistics.n_failed[i] << "\t" << GetDescription(conditions[i]) << G4endl;
+  }
+  G4cout << std::defaultfloat << std::setprecision(6);
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
+
+void Trigger::PrintInfo() {
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  if (!active) {
+    G4cout << "Trigger: Inactive, all events will be written to the output file" << G4endl;
+  } else {
+    G4cout << "Trigger: Active with the following settings:" << G4endl;
+    for (auto &threshold : thresholds) {
+      G4cout << "\tthreshold of detector " << threshold.first << ": " << threshold.second / keV << " keV" << G4endl;
+    }
+    for (auto &group : groups) {
+      G4cout << "\tgroup " << group.first << ":";
+      for (auto detID : group.second) {
+        G4cout << " " << detID;
+      }
+      G4cout << G4endl;
+    }
+    for (auto &condition : conditions) {
+      G4cout << "\t" << GetDescription(condition) << G4endl;
+    }
+  }
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
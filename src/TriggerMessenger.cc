@@ -0,0 +1,151 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include "G4UIparameter.hh"
+
+#include "Trigger.hh"
+#include "TriggerMessenger.hh"
+
+TriggerMessenger::TriggerMessenger() {
+  triggerDirectory = new G4UIdirectory("/utr/trigger/");
+  triggerDirectory->SetGuidance("Controls for the event-level trigger, which decides whether the output of an event is written.");
+
+  activateCmd = new G4UIcmdWithABool("/utr/trigger/activate", this);
+  activateCmd->SetGuidance("Only write the output of events which pass the trigger conditions (default: false)");
+  activateCmd->SetParameterName("active", true);
+  activateCmd->SetDefaultValue(true);
+  activateCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  thresholdCmd = new G4UIcommand("/utr/trigger/threshold", this);
+  thresholdCmd->SetGuidance("Set the trigger threshold of a detector. Energy depositions below the threshold do not fire the detector.");
+  thresholdCmd->SetGuidance("The energy depositions are still written if the event is accepted, use /utr/digitizer/threshold to discard them.");
+  thresholdCmd->SetParameter(new G4UIparameter("detectorID", 'i', false));
+  thresholdCmd->SetParameter(new G4UIparameter("threshold", 'd', false));
+  G4UIparameter *thresholdUnitParameter = new G4UIparameter("unit", 's', true);
+  thresholdUnitParameter->SetDefaultValue("keV");
+  thresholdCmd->SetParameter(thresholdUnitParameter);
+  thresholdCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  groupCmd = new G4UIcommand("/utr/trigger/group", this);
+  groupCmd->SetGuidance("Define a named group of detectors by their IDs, e.g. '/utr/trigger/group HPGe 1 2 3 4'.");
+  groupCmd->SetParameter(new G4UIparameter("name", 's', false));
+  groupCmd->SetParameter(new G4UIparameter("detectorIDs", 's', false));
+  groupCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  multiplicityCmd = new G4UIcommand("/utr/trigger/multiplicity", this);
+  multiplicityCmd->SetGuidance("Require that the number of fired detectors in a group is between min and max (max < 0: no upper limit).");
+  multiplicityCmd->SetParameter(new G4UIparameter("group", 's', false));
+  multiplicityCmd->SetParameter(new G4UIparameter("min", 'i', false));
+  G4UIparameter *multiplicityMaxParameter = new G4UIparameter("max", 'i', true);
+  multiplicityMaxParameter->SetDefaultValue(-1);
+  multiplicityCmd->SetParameter(multiplicityMaxParameter);
+  multiplicityCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  coincidenceCmd = new G4UIcommand("/utr/trigger/coincidence", this);
+  coincidenceCmd->SetGuidance("Require that at least one detector fired in each of the given groups, e.g. '/utr/trigger/coincidence HPGe LaBr'.");
+  coincidenceCmd->SetParameter(new G4UIparameter("groups", 's', false));
+  coincidenceCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  vetoCmd = new G4UIcommand("/utr/trigger/veto", this);
+  vetoCmd->SetGuidance("Reject events in which a detector of the veto group fired.");
+  vetoCmd->SetGuidance("If a second group is given, the event is only rejected if a detector of this group fired as well, e.g. '/utr/trigger/veto BGO1 HPGe1' for an anti-Compton shield.");
+  vetoCmd->SetParameter(new G4UIparameter("vetoGroup", 's', false));
+  G4UIparameter *vetoGroupParameter = new G4UIparameter("group", 's', true);
+  vetoGroupParameter->SetDefaultValue("");
+  vetoCmd->SetParameter(vetoGroupParameter);
+  vetoCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  clearCmd = new G4UIcommand("/utr/trigger/clear", this);
+  clearCmd->SetGuidance("Remove all trigger thresholds, groups and conditions.");
+  clearCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  printCmd = new G4UIcommand("/utr/trigger/print", this);
+  printCmd->SetGuidance("Print the current trigger settings.");
+}
+
+TriggerMessenger::~TriggerMessenger() {
+  delete activateCmd;
+  delete thresholdCmd;
+  delete groupCmd;
+  delete multiplicityCmd;
+  delete coincidenceCmd;
+  delete vetoCmd;
+  delete clearCmd;
+  delete printCmd;
+  delete triggerDirectory;
+}
+
+void TriggerMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
+  std::istringstream parameters(newValues);
+
+  if (command == activateCmd) {
+    Trigger::SetActive(activateCmd->GetNewBoolValue(newValues));
+  } else if (command == thresholdCmd) {
+    G4int detID;
+    G4double threshold;
+    G4String unit;
+    parameters >> detID >> threshold >> unit;
+    Trigger::SetThreshold(detID, threshold * G4UIcommand::ValueOf(unit));
+  } else if (command == groupCmd) {
+    G4String name;
+    std::vector<G4int> detIDs;
+    parameters >> name;
+    for (G4int detID; parameters >> detID;) {
+      detIDs.push_back(detID);
+    }
+    Trigger::DefineGroup(name, detIDs);
+  } else if (command == multiplicityCmd) {
+    G4String group;
+    G4int min_multiplicity, max_multiplicity;
+    parameters >> group >> min_multiplicity >> max_multiplicity;
+    if (!Trigger::AddMultiplicity(group, min_multiplicity, max_multiplicity)) {
+      G4cerr << "Error! Unknown trigger group '" << group << "'!" << G4endl;
+    }
+  } else if (command == coincidenceCmd) {
+    std::vector<G4String> groups;
+    for (G4String group; parameters >> group;) {
+      groups.push_back(group);
+    }
+    if (!Trigger::AddCoincidence(groups)) {
+      G4cerr << "Error! Unknown trigger group in '" << newValues << "'!" << G4endl;
+    }
+  } else if (command == vetoCmd) {
+    G4String veto_group, group;
+    parameters >> veto_group >> group;
+    if (!Trigger::AddVeto(veto_group, group)) {
+      G4cerr << "Error! Unknown trigger group in '" << newValues << "'!" << G4endl;
+    }
+  } else if (command == clearCmd) {
+    Trigger::Clear();
+  } else if (command == printCmd) {
+    Trigger::PrintInfo();
+  } else {
+    G4cerr << "Error! Unknown command!" << G4endl;
+  }
+}
+
+G4String TriggerMessenger::GetCurrentValue(G4UIcommand *command) {
+  if (command == activateCmd) {
+    return activateCmd->ConvertToString(Trigger::IsActive());
+  }
+  return "";
+}
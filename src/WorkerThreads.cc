@@ -0,0 +1,243 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+
+#include "WorkerThreads.hh"
+
+namespace {
+  G4Mutex statisticsMutex = G4MUTEX_INITIALIZER;
+}
+
+// Statistics of the current run of the calling worker thread
+static G4ThreadLocal long long event_start = 0; // In nanoseconds
+static G4ThreadLocal G4int thread_n_events = 0;
+static G4ThreadLocal long long thread_busy_time = 0; // In nanoseconds
+static G4ThreadLocal G4bool thread_pinned = false;
+
+G4String WorkerThreads::pinning = "none";
+std::chrono::steady_clock::time_point WorkerThreads::run_start = std::chrono::steady_clock::now();
+std::map<G4int, WorkerThread_Statistics> WorkerThreads::statistics = std::map<G4int, WorkerThread_Statistics>();
+
+static long long Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<G4int> WorkerThreads::GetAvailableCores() {
+  std::vector<G4int> available_cores;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    for (G4int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        available_cores.push_back(cpu);
+      }
+    }
+  }
+  return available_cores;
+}
+
+G4int WorkerThreads::GetNumberOfAvailableCores() {
+  const G4int n_cores = (G4int)GetAvailableCores().size();
+  return n_cores > 0 ? n_cores : G4Threading::G4GetNumberOfCores();
+}
+
+// The cores of a NUMA node are listed in /sys/devices/system/node/nodeN/cpulist in the format '0-15,32-47'.
+// Nodes without any available core are omitted.
+std::vector<std::vector<G4int>> WorkerThreads::GetNUMANodes(const std::vector<G4int> &available_cores) {
+  std::vector<G4int> node_ids;
+  DIR *node_directory = opendir("/sys/devices/system/node");
+  if (node_directory) {
+    for (struct dirent *entry = readdir(node_directory); entry != nullptr; entry = readdir(node_directory)) {
+      const G4String name = entry->d_name;
+      if (name.substr(0, 4) == "node" && name.size() > 4 && name.find_first_not_of("0123456789", 4) == std::string::npos) {
+        node_ids.push_back(std::stoi(name.substr(4)));
+      }
+    }
+    closedir(node_directory);
+  }
+  std::sort(node_ids.begin(), node_ids.end());
+
+  std::vector<std::vector<G4int>> nodes;
+  for (auto node_id : node_ids) {
+    std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(node_id) + "/cpulist");
+    std::string cpulist;
+    std::getline(cpulist_file, cpulist);
+
+    std::vector<G4int> node_cores;
+    std::istringstream cpulist_stream(cpulist);
+    for (std::string range; std::getline(cpulist_stream, range, ',');) {
+      if (range.empty()) {
+        continue;
+      }
+      const size_t dash = range.find('-');
+      const G4int first = std::stoi(range.substr(0, dash));
+      const G4int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (G4int cpu = first; cpu <= last; ++cpu) {
+        if (std::find(available_cores.begin(), available_cores.end(), cpu) != available_cores.end()) {
+          node_cores.push_back(cpu);
+        }
+      }
+    }
+    if (node_cores.size() > 0) {
+      nodes.push_back(node_cores);
+    }
+  }
+
+  // Systems without NUMA information are treated as a single node
+  if (nodes.size() == 0) {
+    nodes.push_back(available_cores);
+  }
+  return nodes;
+}
+
+G4bool WorkerThreads::SetPinning(const G4String &mode) {
+  if (mode != "none" && mode != "core" && mode != "numa") {
+    return false;
+  }
+  pinning = mode;
+  return true;
+}
+
+void WorkerThreads::PinWorkerThread() {
+  if (pinning == "none" || thread_pinned) {
+    return;
+  }
+  thread_pinned = true;
+
+  const std::vector<G4int> available_cores = GetAvailableCores();
+  const G4int thread_id = G4Threading::G4GetThreadId();
+  if (available_cores.size() == 0 || thread_id < 0) {
+    return;
+  }
+
+  std::vector<G4int> cores;
+  if (pinning == "core") {
+    cores.push_back(available_cores[thread_id % available_cores.size()]);
+  } else {
+    const std::vector<std::vector<G4int>> nodes = GetNUMANodes(available_cores);
+    cores = nodes[thread_id % nodes.size()];
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto cpu : cores) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+    G4cerr << "WorkerThreads: Warning! Could not pin worker thread " << thread_id << "." << G4endl;
+  }
+}
+
+void WorkerThreads::RestrictToShard(G4int shard, G4int n_shards, G4int first_thread, G4int n_threads) {
+  const std::vector<G4int> available_cores = GetAvailableCores();
+  if (pinning == "none" || available_cores.size() == 0) {
+    return;
+  }
+
+  std::vector<G4int> cores;
+  if (pinning == "core") {
+    for (G4int i = first_thread; i < first_thread + n_threads; ++i) {
+      cores.push_back(available_cores[i % available_cores.size()]);
+    }
+  } else {
+    // The NUMA nodes are distributed evenly over the shards, or the shards over the nodes
+    const std::vector<std::vector<G4int>> nodes = GetNUMANodes(available_cores);
+    for (size_t node = 0; node < nodes.size(); ++node) {
+      if ((G4int)nodes.size() >= n_shards ? (G4int)(node % n_shards) == shard : (G4int)node == shard % (G4int)nodes.size()) {
+        cores.insert(cores.end(), nodes[node].begin(), nodes[node].end());
+      }
+    }
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto cpu : cores) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    G4cerr << "WorkerThreads: Warning! Could not restrict shard " << shard << " to its cores." << G4endl;
+  }
+}
+
+void WorkerThreads::BeginOfEvent() {
+  event_start = Now();
+}
+
+void WorkerThreads::EndOfEvent() {
+  ++thread_n_events;
+  thread_busy_time += Now() - event_start;
+}
+
+void WorkerThreads::BeginOfRun() {
+  if (G4Threading::IsMasterThread()) {
+    G4AutoLock lock(&statisticsMutex);
+    statistics.clear();
+    run_start = std::chrono::steady_clock::now();
+  }
+  thread_n_events = 0;
+  thread_busy_time = 0;
+}
+
+void WorkerThreads::EndOfWorkerRun() {
+  G4AutoLock lock(&statisticsMutex);
+  WorkerThread_Statistics &thread_statistics = statistics[G4Threading::G4GetThreadId()];
+  thread_statistics.n_events += thread_n_events;
+  thread_statistics.busy_time += thread_busy_time * 1e-9;
+}
+
+void WorkerThreads::PrintStatistics() {
+  G4AutoLock lock(&statisticsMutex);
+  if (statistics.size() == 0) {
+    return;
+  }
+
+  const G4double run_time = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - run_start).count();
+  G4double total_busy_time = 0., max_busy_time = 0.;
+  for (auto &thread : statistics) {
+    total_busy_time += thread.second.busy_time;
+    max_busy_time = std::max(max_busy_time, thread.second.busy_time);
+  }
+
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+  G4cout << "WorkerThreads: Run time " << std::fixed << std::setprecision(1) << run_time << " s, pinning: " << pinning << G4endl;
+  G4cout << "\tthread\tevents\t\tbusy time [s]\tbusy fraction" << G4endl;
+  for (auto &thread : statistics) {
+    G4cout << "\t" << thread.first << "\t" << std::setw(12) << thread.second.n_events << "\t" << std::setw(12) << thread.second.busy_time << "\t" << std::setw(8) << (run_time > 0. ? 100. * thread.second.busy_time / run_time : 0.) << " %" << G4endl;
+  }
+  if (max_busy_time > 0.) {
+    G4cout << "WorkerThreads: Load balance (mean / maximum busy time): " << 100. * total_busy_time / statistics.size() / max_busy_time << " %" << G4endl;
+  }
+  G4cout << std::defaultfloat << std::setprecision(6);
+  G4cout << "================================================================"
+            "================"
+         << G4endl;
+}
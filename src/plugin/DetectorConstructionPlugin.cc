@@ -0,0 +1,61 @@
+/*
+utr - Geant4 simulation of the UTR at HIGS
+Copyright (C) 2017 the developing team (see README.md)
+
+This file is part of utr.
+
+utr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+utr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with utr.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Implementation of the DetectorConstructionPlugin interface for an arbitrary DetectorConstruction.
+// This file is compiled together with the sources of a DetectorConstruction/<campaign>/<setup>
+// directory, whose DetectorConstruction.hh is found via the include path.
+
+#include "DetectorConstruction.hh"
+#include "DetectorCache.hh"
+#include "DetectorConstructionPlugin.hh"
+#include "GeometryOptimizer.hh"
+
+// Only a few DetectorConstructions define Max_Sensitive_Detector_ID. The first overload is
+// preferred by the compiler (int vs. long argument), but only exists if the member exists.
+template <typename T>
+static auto GetMaxSensitiveDetectorID(const T *detectorConstruction, int) -> decltype(static_cast<G4int>(detectorConstruction->Max_Sensitive_Detector_ID)) {
+  return static_cast<G4int>(detectorConstruction->Max_Sensitive_Detector_ID);
+}
+
+template <typename T>
+static G4int GetMaxSensitiveDetectorID(const T *, long) {
+  return -1;
+}
+
+// Clears the cache of detector models, which may point to volumes of a previous construction of
+// the geometry (see DetectorCache.hh), and optimizes the navigation in the world after it has been
+// constructed (see GeometryOptimizer.hh)
+class OptimizedDetectorConstruction : public DetectorConstruction {
+  public:
+  G4VPhysicalVolume *Construct() override {
+    DetectorCache::Clear();
+    G4VPhysicalVolume *world = DetectorConstruction::Construct();
+    GeometryOptimizer::Optimize(world);
+    return world;
+  }
+};
+
+G4int utrDetectorConstructionPluginVersion() { return UTR_DETECTOR_CONSTRUCTION_PLUGIN_VERSION; }
+
+G4VUserDetectorConstruction *utrCreateDetectorConstruction() { return new OptimizedDetectorConstruction(); }
+
+G4int utrGetMaxSensitiveDetectorID(const G4VUserDetectorConstruction *detectorConstruction) {
+  return GetMaxSensitiveDetectorID(static_cast<const DetectorConstruction *>(detectorConstruction), 0);
+}
@@ -22,15 +22,33 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4MTRunManager.hh"
 #include "G4RunManager.hh"
 #include "G4UImanager.hh"
+#include "G4Version.hh"
 #include "G4VisExecutive.hh"
 #include "G4VisManager.hh"
+#if G4VERSION_NUMBER >= 1070
+#include "G4TaskRunManager.hh"
+#endif
 
 #include "ActionInitialization.hh"
-#include "DetectorConstruction.hh"
+#include "AdjointSimulation.hh"
+#include "AdjointSimulationMessenger.hh"
+#include "DetectorArrangementMessenger.hh"
+#include "DigitizerMessenger.hh"
+#include "FluxScoringMessenger.hh"
+#include "GeometryLoader.hh"
+#include "GeometryOptimizerMessenger.hh"
+#include "OutputWriterMessenger.hh"
 #include "Physics.hh"
+#include "Sharding.hh"
+#include "SlowEventsMessenger.hh"
+#include "SolidAngleCalculatorMessenger.hh"
+#include "TriggerMessenger.hh"
+#include "WorkerThreads.hh"
 #include "utrFilenameTools.hh"
 #include "utrMessenger.hh"
 
+#include "utrConfig.h"
+
 #ifdef EVENT_EVENTWISE
 #include "EnergyDepositionSD.hh"
 #endif
@@ -39,10 +57,13 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "G4UImanager.hh"
 
 #include <argp.h>
+#include <cstdint>
 #include <dirent.h>
+#include <random>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
+#include <vector>
 
 using namespace std;
 
@@ -52,16 +73,30 @@ static char doc[] = "GEANT4 simulation of the UTR at HIGS";
 static char args_doc[] = "";
 static struct argp_option options[] = {
     {"macrofile", 'm', "MACRO", 0, "Macro file", 0},
-    {"nthreads", 't', "THREAD", 0, "Number of threads", 0},
+    {"nthreads", 't', "THREAD", 0, "Number of threads (0: number of available cores)", 0},
+    {"tasking", 'T', 0, 0, "Use the task-based run manager (requires Geant4 10.7 or later)", 0},
+    {"chunksize", 'c', "EVENTS", 0, "Number of events which a worker thread requests at once (default: chosen by Geant4)", 0},
+    {"pin", 'p', "MODE", 0, "Pin the worker threads to single cores ('core') or to NUMA nodes ('numa')", 0},
+    {"shards", 's', "K", 0, "Split the simulation into K processes, which share the threads and the events of each run. Their output files are merged as if they were written by a single process.", 0},
+    {"adjoint", 'a', 0, 0, "Adjoint (reverse Monte Carlo) simulation, uses the sequential run manager", 0},
     {"outputdir", 'o', "OUTPUTDIR", 0, "Output directory", 0},
     {"filename", 'f', "PREFIX", 0, "Output files' name prefix", 0},
+    {"seed", 'r', "SEED", 0, "Seed of the random number generator (default: current time)", 0},
+    {"geometry", 'g', "GEOMETRY", 0, "Geometry as CAMPAIGN/DETECTOR_CONSTRUCTION or path to a geometry library (requires the GEOMETRY_PLUGINS build option for geometries other than the default)", 0},
     {0, 0, 0, 0, 0, 0}};
 
 struct arguments {
   int nthreads = 1;
+  bool tasking = false;
+  int chunksize = 0;
+  string pin = "none";
+  int shards = 1;
+  bool adjoint = false;
   char *macrofile = 0;
   string outputdir = "output";
   string filenameprefix = "utr";
+  long seed = -1;
+  string geometry = default_geometry;
 };
 
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
@@ -70,6 +105,21 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
     case 't':
       arguments->nthreads = atoi(arg);
       break;
+    case 'T':
+      arguments->tasking = true;
+      break;
+    case 'c':
+      arguments->chunksize = atoi(arg);
+      break;
+    case 'p':
+      arguments->pin = arg;
+      break;
+    case 's':
+      arguments->shards = atoi(arg);
+      break;
+    case 'a':
+      arguments->adjoint = true;
+      break;
     case 'm':
       arguments->macrofile = arg;
       break;
@@ -79,6 +129,12 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
     case 'f':
       arguments->filenameprefix = arg;
       break;
+    case 'r':
+      arguments->seed = atol(arg);
+      break;
+    case 'g':
+      arguments->geometry = arg;
+      break;
     default:
       return ARGP_ERR_UNKNOWN;
   }
@@ -93,30 +149,89 @@ int main(int argc, char *argv[]) {
   argp_parse(&argp, argc, argv, 0, 0, &arguments);
 
   G4Random::setTheEngine(new CLHEP::RanecuEngine);
-  // 'Real' random results
-  time_t timer;
-  G4Random::setTheSeed(time(&timer));
-  // Deterministic results
-  // G4Random::setTheSeed(1);
+  // 'Real' random results, unless a seed is given. The seed is printed, so that every run can be reproduced.
+  if (arguments.seed < 0) {
+    time_t timer;
+    arguments.seed = time(&timer);
+  }
+  // G4Random::setTheSeed() would only select one of the 215 entries of the seed table of the Ranecu engine,
+  // so both of its seeds are derived from the whole value
+  std::seed_seq seed_sequence{(std::uint32_t)((unsigned long)arguments.seed & 0xffffffff), (std::uint32_t)((unsigned long)arguments.seed >> 32)};
+  std::vector<std::uint32_t> seeds(2);
+  seed_sequence.generate(seeds.begin(), seeds.end());
+  const long ranecu_seeds[3] = {(long)(seeds[0] % 2147483562) + 1, (long)(seeds[1] % 2147483398) + 1, 0};
+  G4Random::setTheSeeds(ranecu_seeds);
+  G4cout << "Random number seed: " << arguments.seed << " (seeds of the Ranecu engine: " << ranecu_seeds[0] << " " << ranecu_seeds[1] << ")" << G4endl;
 
   // Pass output directory and filenamePrefix to RunAction via utrFilenameTools, also find next free filename ID
   utrFilenameTools::setOutputDir(arguments.outputdir);
   utrFilenameTools::setFilenamePrefix(arguments.filenameprefix);
+
+  if (arguments.nthreads <= 0) {
+    arguments.nthreads = WorkerThreads::GetNumberOfAvailableCores();
+    G4cout << "Using " << arguments.nthreads << " threads (number of available cores) ..." << G4endl;
+  }
+  if (!WorkerThreads::SetPinning(arguments.pin)) {
+    G4cerr << "ERROR: Unknown pinning mode '" << arguments.pin << "', expected 'none', 'core' or 'numa'. Aborting..." << G4endl;
+    return 1;
+  }
+
+  // Only the child processes return, each with its own output directory, seeds and share of the threads
+  if (arguments.shards > 1) {
+    if (arguments.adjoint) {
+      G4cerr << "ERROR: The adjoint simulation can not be split into several processes. Aborting..." << G4endl;
+      return 1;
+    }
+    Sharding::Fork(arguments.shards, arguments.nthreads);
+    arguments.nthreads = Sharding::GetNumberOfThreads();
+  }
   utrFilenameTools::findNextFreeFilenameID();
 
 #ifdef G4MULTITHREADED
-  G4MTRunManager *runManager = new G4MTRunManager;
-  runManager->SetNumberOfThreads(arguments.nthreads);
+  G4RunManager *runManager = nullptr;
+  if (arguments.adjoint) {
+    // The reverse Monte Carlo of Geant4 only supports the sequential run manager
+    G4cout << "Using the sequential run manager for the adjoint simulation ..." << G4endl;
+    arguments.nthreads = 1;
+    runManager = new G4RunManager;
+  } else {
+    G4MTRunManager *mtRunManager = nullptr;
+    if (arguments.tasking) {
+#if G4VERSION_NUMBER >= 1070
+      G4cout << "Using the task-based run manager ..." << G4endl;
+      mtRunManager = Sharding::IsShard() ? new Sharding_RunManager<G4TaskRunManager> : new G4TaskRunManager;
+#else
+      G4cout << "WARNING: The task-based run manager requires Geant4 10.7 or later, using G4MTRunManager instead ..." << G4endl;
+#endif
+    }
+    if (!mtRunManager) {
+      mtRunManager = Sharding::IsShard() ? new Sharding_RunManager<G4MTRunManager> : new G4MTRunManager;
+    }
+    mtRunManager->SetNumberOfThreads(arguments.nthreads);
+    // Worker threads which request small chunks of events balance the load better, but have to synchronize more often.
+    // The chunk size can also be changed with /run/eventModulo.
+    if (arguments.chunksize > 0) {
+      mtRunManager->SetEventModulo(arguments.chunksize);
+    }
+    runManager = mtRunManager;
+  }
 #else
   G4RunManager *runManager = new G4RunManager;
+  if (arguments.adjoint) {
+    arguments.nthreads = 1;
+  }
 #endif
 
   //G4RunManager *runManager = new G4RunManager;
   G4cout << "Initializing DetectorConstruction..." << G4endl;
-  runManager->SetUserInitialization(new DetectorConstruction);
+  runManager->SetUserInitialization(GeometryLoader::Create(arguments.geometry));
 
   G4cout << "Initializing PhysicsList..." << G4endl;
   Physics *physicsList = new Physics();
+  if (arguments.adjoint) {
+    AdjointSimulation::SetEnabled(true);
+    physicsList->SelectAdjointPhysics(true);
+  }
   runManager->SetUserInitialization(physicsList);
 
   G4cout << "ActionInitialization..." << G4endl;
@@ -138,6 +253,15 @@ int main(int argc, char *argv[]) {
   G4UImanager *UImanager = G4UImanager::GetUIpointer();
 
   new utrMessenger();
+  new DigitizerMessenger();
+  new DetectorArrangementMessenger();
+  new GeometryOptimizerMessenger();
+  new OutputWriterMessenger();
+  new TriggerMessenger();
+  new AdjointSimulationMessenger();
+  new SolidAngleCalculatorMessenger();
+  new SlowEventsMessenger();
+  new FluxScoringMessenger();
   if (arguments.macrofile) {
     G4cout << "Executing macro file " << arguments.macrofile << G4endl;
     G4String command = "/control/execute ";
@@ -24,8 +24,11 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 #include "globals.hh"
 
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sstream>
 #include <sys/stat.h>
+#include <unistd.h>
 
 using std::string;
 using std::stringstream;
@@ -40,30 +43,100 @@ string utrFilenameTools::filenamePrefix = "utr";
 unsigned int utrFilenameTools::filenameID = 0;
 bool utrFilenameTools::useFilenameID = true;
 string utrFilenameTools::masterFilename = "";
+string utrFilenameTools::lockFilename = "";
+
+std::set<unsigned int> utrFilenameTools::getUsedFilenameIDs() {
+  // Files with the names '{filenamePrefix}N.root', '{filenamePrefix}N_tM.root', '{filenamePrefix}N_hist.root' and '{filenamePrefix}N.lock',
+  // collected with a single pass over the directory
+  std::set<unsigned int> used_fids;
+  DIR *directory = opendir(outputDir.c_str());
+  if (!directory) {
+    return used_fids;
+  }
+  for (struct dirent *entry = readdir(directory); entry != nullptr; entry = readdir(directory)) {
+    const string name = entry->d_name;
+    if (name.compare(0, filenamePrefix.size(), filenamePrefix) != 0) {
+      continue;
+    }
+    const size_t id_end = name.find_first_not_of("0123456789", filenamePrefix.size());
+    if (id_end == filenamePrefix.size() || id_end == string::npos || id_end - filenamePrefix.size() > 9) {
+      continue;
+    }
+    const string suffix = name.substr(id_end);
+    const bool thread_file = suffix.size() > 7 && suffix.compare(0, 2, "_t") == 0 && suffix.compare(suffix.size() - 5, 5, ".root") == 0 && suffix.find_first_not_of("0123456789", 2) == suffix.size() - 5;
+    if (suffix == ".root" || suffix == ".lock" || suffix == "_hist.root" || thread_file) {
+      used_fids.insert((unsigned int)std::stoul(name.substr(filenamePrefix.size(), id_end - filenamePrefix.size())));
+    }
+  }
+  closedir(directory);
+  return used_fids;
+}
 
 unsigned int utrFilenameTools::findNextFreeFilenameID() {
   // Determine the next free filename (with ID) by searching for files with the name
   // '{utrFilenameTools::filenamePrefix}N.root' or '{utrFilenameTools::filenamePrefix}N_t0.root' in the requested directory
-  G4FileUtilities fileutil;
-  stringstream filename_single;
-  stringstream filename_multi;
+  const std::set<unsigned int> used_fids = getUsedFilenameIDs();
   unsigned int fid = 0;
-  for (fid = 0; fid < INT_MAX; ++fid) {
-    filename_single << outputDir << "/" << filenamePrefix << fid << ".root";
-    filename_multi << outputDir << "/" << filenamePrefix << fid << "_t0.root";
-
-    if (fileutil.FileExists(filename_single.str()) || fileutil.FileExists(filename_multi.str())) {
-      filename_single.str("");
-      filename_multi.str("");
-      continue;
-    }
-    break;
+  while (used_fids.count(fid)) {
+    ++fid;
   }
   G4cout << "Using file name prefix '" << filenamePrefix << fid << "' ..." << G4endl;
   filenameID = fid - 1;
   return fid;
 }
 
+unsigned int utrFilenameTools::incrementFilenameID() {
+  filenameID = reserveFilenameID(filenameID + 1);
+  return filenameID;
+}
+
+unsigned int utrFilenameTools::reserveFilenameID(unsigned int first_fid) {
+  releaseFilenameID();
+
+  G4FileUtilities fileutil;
+  const std::set<unsigned int> used_fids = getUsedFilenameIDs();
+  unsigned int first_free_fid = first_fid;
+  while (used_fids.count(first_free_fid)) {
+    ++first_free_fid;
+  }
+  for (unsigned int fid = first_free_fid; fid < INT_MAX; ++fid) {
+    if (used_fids.count(fid)) {
+      continue;
+    }
+    stringstream filename;
+    filename << outputDir << "/" << filenamePrefix << fid;
+    // O_EXCL guarantees that only one process can create the lock file
+    const int fd = open((filename.str() + ".lock").c_str(), O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+      if (errno != EEXIST) {
+        G4cerr << "ERROR: Could not create the lock file '" << filename.str() << ".lock' to reserve the file ID " << fid << "! Aborting..." << G4endl;
+        throw std::exception();
+      }
+      continue;
+    }
+    close(fd);
+    // Another process may have written its output files and released the ID after the directory was read
+    if (fileutil.FileExists(filename.str() + ".root") || fileutil.FileExists(filename.str() + "_t0.root")) {
+      unlink((filename.str() + ".lock").c_str());
+      continue;
+    }
+    if (fid != first_free_fid) {
+      G4cout << "File name prefix '" << filenamePrefix << first_free_fid << "' is used by another process, using '" << filenamePrefix << fid << "' ..." << G4endl;
+    }
+    lockFilename = filename.str() + ".lock";
+    return fid;
+  }
+  G4cerr << "ERROR: Could not find a free file ID for the file name prefix '" << filenamePrefix << "'! Aborting..." << G4endl;
+  throw std::exception();
+}
+
+void utrFilenameTools::releaseFilenameID() {
+  if (lockFilename != "") {
+    unlink(lockFilename.c_str());
+    lockFilename = "";
+  }
+}
+
 bool utrFilenameTools::setOutputDir(string odir) {
   // If output directory does not exists try to create it
   if (!opendir(odir.c_str())) {
@@ -81,6 +154,16 @@ bool utrFilenameTools::setOutputDir(string odir) {
   return false;
 }
 
+string utrFilenameTools::getOutputFilename(const string &suffix) {
+  stringstream filename;
+  filename << outputDir << "/" << filenamePrefix;
+  if (useFilenameID) {
+    filename << filenameID;
+  }
+  filename << suffix;
+  return filename.str();
+}
+
 string utrFilenameTools::getMasterFilename() {
   if (masterFilename == "") {
     char tmpfilename[] = "/tmp/utrXXXXXX";  // Template for mkstemp, must end with "XXXXXX"
@@ -104,4 +187,11 @@ string utrFilenameTools::getMasterFilename() {
   return masterFilename;
 }
 
-
+void utrFilenameTools::deleteMasterFilename() {
+  if (masterFilename != "") {
+    unlink(masterFilename.c_str());
+    // The file created by mkstemp, without the .root extension
+    unlink(masterFilename.substr(0, masterFilename.size() - 5).c_str());
+    masterFilename = "";
+  }
+}
@@ -20,7 +20,10 @@ along with utr.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "utrMessenger.hh"
 #include "G4UIcmdWithAnInteger.hh"
+#include "DetectorArrangement.hh"
 #include "G4UImanager.hh"
+#include "G4UIparameter.hh"
+#include "GeometryLoader.hh"
 #include "utrFilenameTools.hh"
 
 utrMessenger::utrMessenger() {
@@ -40,11 +43,25 @@ utrMessenger::utrMessenger() {
   appendZerosToVarCmd = new G4UIcmdWithAString("/utr/appendZerosToVar", this);
   appendZerosToVarCmd->SetGuidance("Set an UI/macro alias (a variable) to the given numerical value appending a decimal dot and the requested number of zeros if necessary");
   appendZerosToVarCmd->SetParameterName("variableName> <variableValue> <numberOfDecimalDigits", false);
+
+  setGeometryCmd = new G4UIcmdWithAString("/utr/setGeometry", this);
+  setGeometryCmd->SetGuidance("Select the geometry as CAMPAIGN/DETECTOR_CONSTRUCTION (e.g. Campaign_2018_2019/64Ni_271_279) or as the path to a geometry library.\nRequires the GEOMETRY_PLUGINS build option for geometries other than the default and has to be used before /run/initialize.");
+  setGeometryCmd->SetParameterName("geometry", false);
+  setGeometryCmd->AvailableForStates(G4State_PreInit);
+
+  setArrangementFileCmd = new G4UIcommand("/utr/setArrangementFile", this);
+  setArrangementFileCmd->SetGuidance("Read the detector arrangement with the given name from another file (see DetectorArrangement.hh for the file format).\nTakes effect when the geometry is constructed.");
+  setArrangementFileCmd->SetParameter(new G4UIparameter("arrangementName", 's', false));
+  setArrangementFileCmd->SetParameter(new G4UIparameter("filename", 's', false));
+  setArrangementFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 }
 
 utrMessenger::~utrMessenger() {
   delete setFilenameCmd;
   delete setUseFilenameIDCmd;
+  delete appendZerosToVarCmd;
+  delete setGeometryCmd;
+  delete setArrangementFileCmd;
   delete utrDirectory;
 }
 
@@ -122,6 +139,13 @@ void utrMessenger::SetNewValue(G4UIcommand *command, G4String newValues) {
       G4UImanager *UImanager = G4UImanager::GetUIpointer();
       UImanager->ApplyCommand(aliasCommand.str());
     }
+  } else if (command == setGeometryCmd) {
+    GeometryLoader::SetGeometry(newValues);
+  } else if (command == setArrangementFileCmd) {
+    std::istringstream parameters(newValues);
+    G4String arrangementName, filename;
+    parameters >> arrangementName >> filename;
+    DetectorArrangement::Set_Filename(arrangementName, filename);
   } else {
     G4cerr << "Error! Unknown command!" << G4endl;
   }
@@ -132,6 +156,8 @@ G4String utrMessenger::GetCurrentValue(G4UIcommand *command) {
     return utrFilenameTools::getFilenamePrefix();
   } else if (command == setUseFilenameIDCmd) {
     return setUseFilenameIDCmd->ConvertToString(utrFilenameTools::getUseFilenameID());
+  } else if (command == setGeometryCmd) {
+    return GeometryLoader::GetGeometryName();
   }
   return "Error! unknown command!";
 }
@@ -0,0 +1,162 @@
+// Cross-check and navigation benchmark for the crystals of the HPGe_Clover:
+//
+//   boolean:  G4Tubs minus the anode hole minus four G4Box (the former implementation)
+//   extruded: G4ExtrudedSolid with the anode hole as a G4Tubs daughter volume (the current
+//             implementation)
+//
+// The volume and surface area of both representations are compared, and the distance of points
+// on the surface of the extruded crystal and the hole from the surface of the boolean solid is
+// evaluated. For random points and directions, the navigation methods of each solid are timed.
+// For the extruded crystal, the timing includes the daughter volume, as it would be evaluated by
+// the G4Navigator (compare G4NormalNavigation).
+
+#include <algorithm>
+#include <iostream>
+
+#include "G4Box.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SubtractionSolid.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Tubs.hh"
+
+#include "HPGe_Clover.hh"
+#include "HPGe_Collection.hh"
+
+#include "SolidBenchmark.hh"
+
+static char doc[] = "HPGe_Clover_Benchmark";
+static char args_doc[] = "Compare the boolean and the extruded representation of a clover crystal";
+
+struct arguments {
+  SolidBenchmark::Arguments common;
+
+  arguments() : common{"HPGe_Clover_Yale", 0.05, 1000000} {};
+};
+
+static struct argp_option options[] = {
+    {0, 'D', "DETECTOR", 0, "Name of the clover detector in HPGe_Collection (default: HPGe_Clover_Yale)"},
+    {0, 'd', "MAXDEV", 0, "Maximum deviation of the extruded crystal from the cylinder in mm (default: 0.05)"},
+    {0, 'n', "NPOINTS", 0, "Number of random points (default: 1000000)"},
+    {0, 0, 0, 0, 0}};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  return SolidBenchmark::ParseCommonOption(key, arg, ((struct arguments *)state->input)->common);
+}
+
+static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
+
+using namespace std;
+
+// Crystal material of the extruded representation: the mother volume without the anode hole.
+// The navigation methods evaluate the daughter volume as the G4Navigator would.
+struct Extruded_Crystal {
+  const G4VSolid *mother;
+  const G4VSolid *anode;
+  G4ThreeVector anode_position;
+
+  EInside Inside(const G4ThreeVector &p) const {
+    const EInside inside = mother->Inside(p);
+    return inside != kOutside && anode->Inside(p - anode_position) != kOutside ? kOutside : inside;
+  }
+  // Points outside the crystal material are either outside the mother volume or inside the hole
+  G4double DistanceToIn(const G4ThreeVector &p, const G4ThreeVector &v) const { return anode->Inside(p - anode_position) == kInside ? anode->DistanceToOut(p - anode_position, v) : mother->DistanceToIn(p, v); }
+  G4double DistanceToIn(const G4ThreeVector &p) const { return anode->Inside(p - anode_position) == kInside ? anode->DistanceToOut(p - anode_position) : mother->DistanceToIn(p); }
+  // Leaving the crystal material: the mother, or entering the daughter
+  G4double DistanceToOut(const G4ThreeVector &p, const G4ThreeVector &v) const { return min(mother->DistanceToOut(p, v), anode->DistanceToIn(p - anode_position, v)); }
+  G4double DistanceToOut(const G4ThreeVector &p) const { return min(mother->DistanceToOut(p), anode->DistanceToIn(p - anode_position)); }
+};
+
+G4VSolid *Boolean_Crystal(const HPGe_Clover_Properties &properties) {
+  G4Tubs *crystal_full_solid = new G4Tubs("crystal_full_solid", 0., properties.crystal_radius, properties.crystal_length * 0.5, 0., twopi);
+  G4Tubs *anode_solid = new G4Tubs("anode_solid", 0., properties.anode_radius, properties.anode_length * 0.5, 0., twopi);
+  G4SubtractionSolid *crystal_original = new G4SubtractionSolid("crystal_original", crystal_full_solid, anode_solid, 0, G4ThreeVector(0., 0., 0.5 * properties.crystal_length - 0.5 * properties.anode_length));
+  G4Box *subtraction_solid = new G4Box("subtraction_solid", properties.crystal_radius, properties.crystal_radius, properties.crystal_length);
+  G4SubtractionSolid *crystal_step1_solid = new G4SubtractionSolid("crystal_step1_solid", crystal_original, subtraction_solid, 0, G4ThreeVector(properties.crystal_radius + 23. * mm, 0., 0.));
+  G4SubtractionSolid *crystal_step2_solid = new G4SubtractionSolid("crystal_step2_solid", crystal_step1_solid, subtraction_solid, 0, G4ThreeVector(-properties.crystal_radius - 22. * mm, 0., 0.));
+  G4SubtractionSolid *crystal_step3_solid = new G4SubtractionSolid("crystal_step3_solid", crystal_step2_solid, subtraction_solid, 0, G4ThreeVector(0., -properties.crystal_radius - 22. * mm, 0.));
+  G4SubtractionSolid *crystal_step4_solid = new G4SubtractionSolid("crystal_step4_solid", crystal_step3_solid, subtraction_solid, 0, G4ThreeVector(0., properties.crystal_radius + 23. * mm, 0.));
+
+  return crystal_step4_solid;
+}
+
+int main(int argc, char *argv[]) {
+
+  struct arguments args;
+  argp_parse(&argp, argc, argv, 0, 0, &args);
+  const unsigned int npoints = args.common.npoints;
+
+  HPGe_Collection hpge_Collection;
+  HPGe_Clover_Properties *properties_pointer = hpge_Collection.Get_Clover_Properties(args.common.detector);
+  if (!properties_pointer) {
+    cout << "Error: Unknown clover detector '" << args.common.detector << "'" << endl;
+    return 1;
+  }
+  HPGe_Clover_Properties &properties = *properties_pointer;
+
+  HPGe_Clover clover(nullptr, "clover");
+  clover.setProperties(properties);
+
+  G4VSolid *boolean = Boolean_Crystal(properties);
+  G4VSolid *extruded = clover.crystal_extruded_solid(args.common.max_deviation * mm);
+  G4VSolid *anode = clover.anode_solid();
+  const G4ThreeVector anode_position(0., 0., 0.5 * properties.crystal_length - 0.5 * properties.anode_length);
+
+  SolidBenchmark::PrintHeader("HPGe_Clover_Benchmark", args.common);
+
+  /************* Volume and surface *************/
+
+  // The surface of the hole consists of its side and bottom, the opening is not part of the surface.
+  // Accordingly, the face of the extruded crystal is reduced by the area of the opening.
+  const G4double anode_opening_area = pi * properties.anode_radius * properties.anode_radius;
+  const G4double boolean_volume = boolean->GetCubicVolume();
+  const G4double extruded_volume = extruded->GetCubicVolume() - anode->GetCubicVolume();
+  const G4double boolean_surface = boolean->GetSurfaceArea();
+  const G4double extruded_surface = extruded->GetSurfaceArea() + anode->GetSurfaceArea() - 2. * anode_opening_area;
+
+  cout << "Volume  [cm3]: boolean " << boolean_volume / cm3 << ", extruded " << extruded_volume / cm3 << " (" << 100. * (extruded_volume / boolean_volume - 1.) << " %)" << endl;
+  cout << "Surface [cm2]: boolean " << boolean_surface / cm2 << ", extruded " << extruded_surface / cm2 << " (" << 100. * (extruded_surface / boolean_surface - 1.) << " %)" << endl;
+  cout << "Note: The volume and surface of the boolean solid are Monte-Carlo estimates by Geant4." << endl;
+
+  // Distance of points on the surface of the extruded representation from the surface of the
+  // boolean solid. The safety distance of boolean solids is only a lower bound of the exact
+  // distance.
+  G4double max_distance = 0., mean_distance = 0., distance;
+  G4ThreeVector point;
+  unsigned int n_surface_points = 0;
+  for (unsigned int i = 0; i < npoints / 10; ++i) {
+    point = extruded->GetPointOnSurface();
+    if (anode->Inside(point - anode_position) != kOutside) {
+      continue;
+    }
+    distance = boolean->Inside(point) == kInside ? boolean->DistanceToOut(point) : boolean->DistanceToIn(point);
+    max_distance = max(max_distance, distance);
+    mean_distance += distance;
+    ++n_surface_points;
+
+    point = anode->GetPointOnSurface() + anode_position;
+    if (point.z() >= 0.5 * properties.crystal_length - 1e-9 * mm) {
+      continue;
+    }
+    distance = boolean->Inside(point) == kInside ? boolean->DistanceToOut(point) : boolean->DistanceToIn(point);
+    max_distance = max(max_distance, distance);
+    mean_distance += distance;
+    ++n_surface_points;
+  }
+  cout << "Distance of the surface from the boolean surface [mm]: mean " << mean_distance / n_surface_points / mm << ", max " << max_distance / mm << endl;
+
+  /************* Navigation *************/
+
+  // Random points in a box which is 10% larger than the crystal
+  const G4ThreeVector box(1.1 * properties.crystal_radius, 1.1 * properties.crystal_radius, 0.55 * properties.crystal_length);
+  vector<G4ThreeVector> points, directions;
+  SolidBenchmark::RandomPoints(-box, box, npoints, points, directions);
+
+  vector<EInside> inside_boolean, inside_extruded;
+  SolidBenchmark::PrintTimingHeader();
+  const SolidBenchmark::Timing boolean_timing = SolidBenchmark::TimeNavigation(*boolean, points, directions, inside_boolean);
+  SolidBenchmark::PrintTiming("boolean", boolean_timing, 0.);
+  const SolidBenchmark::Timing extruded_timing = SolidBenchmark::TimeNavigation(Extruded_Crystal{extruded, anode, anode_position}, points, directions, inside_extruded);
+  SolidBenchmark::PrintTiming("extruded", extruded_timing, SolidBenchmark::MismatchPercentage(inside_extruded, inside_boolean));
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+// Navigation benchmark for the different representations of a coaxial HPGe crystal:
+//
+//   uniform:  profile sampled at equidistant z positions and reduced by OptimizePolycone
+//             (G4Polycone, the former implementation of HPGe_Coaxial)
+//   adaptive: rounded sections approximated with a maximum deviation by PolyconeProfile
+//             (G4GenericPolycone, the current implementation of HPGe_Coaxial)
+//   boolean:  exact shape from G4Tubs, G4Torus and G4Orb primitives
+//
+// Random points in the bounding box of the crystal and random directions are used to measure
+// the time per call of the navigation methods of each solid. The fraction of points which are
+// classified differently than by the exact boolean solid is a measure of the geometrical error.
+
+#include <iostream>
+#include <vector>
+
+#include "G4Orb.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4Polycone.hh"
+#include "G4SubtractionSolid.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Torus.hh"
+#include "G4Tubs.hh"
+#include "G4UnionSolid.hh"
+
+#include "HPGe_Collection.hh"
+#include "OptimizePolycone.hh"
+#include "PolyconeProfile.hh"
+
+#include "SolidBenchmark.hh"
+
+static char doc[] = "PolyconeProfile_Benchmark";
+static char args_doc[] = "Compare the navigation performance of different representations of a coaxial HPGe crystal";
+
+struct arguments {
+  SolidBenchmark::Arguments common;
+  unsigned int nsteps;
+
+  arguments() : common{"HPGe_60_TUNL_40663", 0.05, 1000000}, nsteps(500){};
+};
+
+static struct argp_option options[] = {
+    {0, 'D', "DETECTOR", 0, "Name of the coaxial detector in HPGe_Collection (default: HPGe_60_TUNL_40663)"},
+    {0, 'd', "MAXDEV", 0, "Maximum deviation of the adaptive profile in mm (default: 0.05)"},
+    {0, 's', "NSTEPS", 0, "Number of z steps of the uniform profile (default: 500)"},
+    {0, 'n', "NPOINTS", 0, "Number of random points (default: 1000000)"},
+    {0, 0, 0, 0, 0}};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+
+  struct arguments *args = (struct arguments *)state->input;
+
+  if (key == 's') {
+    args->nsteps = (unsigned int)atoi(arg);
+    return 0;
+  }
+  return SolidBenchmark::ParseCommonOption(key, arg, args->common);
+}
+
+static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
+
+using namespace std;
+
+// Solid whose origin is shifted with respect to the front face of the crystal
+struct Shifted_Solid {
+  const G4VSolid *solid;
+  G4ThreeVector origin;
+
+  EInside Inside(const G4ThreeVector &p) const { return solid->Inside(p - origin); }
+  G4double DistanceToIn(const G4ThreeVector &p, const G4ThreeVector &v) const { return solid->DistanceToIn(p - origin, v); }
+  G4double DistanceToIn(const G4ThreeVector &p) const { return solid->DistanceToIn(p - origin); }
+  G4double DistanceToOut(const G4ThreeVector &p, const G4ThreeVector &v) const { return solid->DistanceToOut(p - origin, v); }
+  G4double DistanceToOut(const G4ThreeVector &p) const { return solid->DistanceToOut(p - origin); }
+};
+
+// Front face of the crystal at z = 0, hole opening at z = detector_length, as in HPGe_Coaxial
+G4VSolid *Uniform_Crystal(const HPGe_Coaxial_Properties &properties, const unsigned int nsteps) {
+  vector<G4double> zPlaneTemp(nsteps), rInnerTemp(nsteps), rOuterTemp(nsteps);
+  vector<G4double> zPlane(nsteps), rInner(nsteps), rOuter(nsteps);
+
+  G4double z;
+  for (unsigned int i = 0; i < nsteps; i++) {
+    z = (1. - (double)i / (nsteps - 1)) * properties.detector_length;
+
+    zPlaneTemp[i] = z;
+
+    if (z >= properties.detector_length - properties.hole_depth) {
+      if (z >= properties.detector_length - properties.hole_depth + properties.hole_radius) {
+        rInnerTemp[i] = properties.hole_radius;
+      } else {
+        rInnerTemp[i] = properties.hole_radius * sqrt(1. - pow((z - (properties.detector_length - properties.hole_depth + properties.hole_radius)) / properties.hole_radius, 2));
+      }
+    } else {
+      rInnerTemp[i] = 0.;
+    }
+
+    if (z >= properties.detector_face_radius) {
+      rOuterTemp[i] = properties.detector_radius;
+    } else {
+      rOuterTemp[i] = properties.detector_face_radius * sqrt(1. - pow((z - properties.detector_face_radius) / properties.detector_face_radius, 2)) + (properties.detector_radius - properties.detector_face_radius);
+    }
+  }
+
+  OptimizePolycone opt;
+  G4int nsteps_optimized = opt.Optimize(zPlaneTemp.data(), rInnerTemp.data(), rOuterTemp.data(), zPlane.data(), rInner.data(), rOuter.data(), (G4int)nsteps, "uniform");
+
+  return new G4Polycone("uniform", 0., twopi, nsteps_optimized, zPlane.data(), rInner.data(), rOuter.data());
+}
+
+G4VSolid *Adaptive_Crystal(const HPGe_Coaxial_Properties &properties, const G4double max_deviation) {
+  PolyconeProfile crystal_profile("adaptive", max_deviation);
+  crystal_profile.Add_Point(0., 0.);
+  crystal_profile.Add_Arc(properties.detector_radius - properties.detector_face_radius, properties.detector_face_radius, properties.detector_face_radius, properties.detector_face_radius, -90. * deg, 0.);
+  crystal_profile.Add_Point(properties.detector_radius, properties.detector_length);
+  crystal_profile.Add_Point(properties.hole_radius, properties.detector_length);
+  crystal_profile.Add_Arc(0., properties.detector_length - properties.hole_depth + properties.hole_radius, properties.hole_radius, properties.hole_radius, 0., -90. * deg);
+
+  return crystal_profile.Construct();
+}
+
+G4VSolid *Boolean_Crystal(const HPGe_Coaxial_Properties &properties) {
+  const G4double R = properties.detector_radius;
+  const G4double L = properties.detector_length;
+  const G4double f = properties.detector_face_radius;
+  const G4double h = properties.hole_radius;
+  const G4double d = properties.hole_depth;
+
+  G4Tubs *body = new G4Tubs("boolean_body", 0., R, 0.5 * (L - f), 0., twopi);
+  G4Tubs *face = new G4Tubs("boolean_face", 0., R - f, 0.5 * f, 0., twopi);
+  G4Torus *edge = new G4Torus("boolean_edge", 0., f, R - f, 0., twopi);
+  G4UnionSolid *outer = new G4UnionSolid("boolean_outer", body, face, 0, G4ThreeVector(0., 0., -0.5 * L));
+  outer = new G4UnionSolid("boolean_outer", outer, edge, 0, G4ThreeVector(0., 0., -0.5 * (L - f)));
+
+  // The hole cylinder protrudes from the back of the crystal to avoid coincident surfaces
+  G4Tubs *hole_side = new G4Tubs("boolean_hole_side", 0., h, 0.5 * (d - h + 1. * mm), 0., twopi);
+  G4Orb *hole_tip = new G4Orb("boolean_hole_tip", h);
+  G4UnionSolid *hole = new G4UnionSolid("boolean_hole", hole_side, hole_tip, 0, G4ThreeVector(0., 0., -0.5 * (d - h + 1. * mm)));
+
+  // The origin of the body is at z = f + 0.5*(L - f)
+  G4SubtractionSolid *crystal = new G4SubtractionSolid("boolean", outer, hole, 0, G4ThreeVector(0., 0., L - d + h + 0.5 * (d - h + 1. * mm) - f - 0.5 * (L - f)));
+
+  return crystal;
+}
+
+int main(int argc, char *argv[]) {
+
+  struct arguments args;
+  argp_parse(&argp, argc, argv, 0, 0, &args);
+
+  HPGe_Collection hpge_Collection;
+  HPGe_Coaxial_Properties *properties_pointer = hpge_Collection.Get_Coaxial_Properties(args.common.detector);
+  if (!properties_pointer) {
+    cout << "Error: Unknown coaxial detector '" << args.common.detector << "'" << endl;
+    return 1;
+  }
+  const HPGe_Coaxial_Properties &properties = *properties_pointer;
+
+  vector<G4String> names = {"uniform", "adaptive", "boolean"};
+  // The origin of the boolean solid is at z = f + 0.5*(L - f)
+  vector<Shifted_Solid> solids = {{Uniform_Crystal(properties, args.nsteps), G4ThreeVector()}, {Adaptive_Crystal(properties, args.common.max_deviation * mm), G4ThreeVector()}, {Boolean_Crystal(properties), G4ThreeVector(0., 0., properties.detector_face_radius + 0.5 * (properties.detector_length - properties.detector_face_radius))}};
+
+  // Random points in a box which is 10% larger than the crystal
+  const G4double box_r = 1.1 * properties.detector_radius;
+  const G4double box_z = 1.1 * properties.detector_length;
+  vector<G4ThreeVector> points, directions;
+  SolidBenchmark::RandomPoints(G4ThreeVector(-box_r, -box_r, -0.05 * box_z), G4ThreeVector(box_r, box_r, 0.95 * box_z), args.common.npoints, points, directions);
+
+  SolidBenchmark::PrintHeader("PolyconeProfile_Benchmark", args.common);
+  SolidBenchmark::PrintTimingHeader();
+
+  // The boolean solid is evaluated first, it is the reference for the classification of the points
+  vector<EInside> reference, inside;
+  const SolidBenchmark::Timing boolean_timing = SolidBenchmark::TimeNavigation(solids[2], points, directions, reference);
+  for (size_t s = 0; s < solids.size() - 1; ++s) {
+    const SolidBenchmark::Timing timing = SolidBenchmark::TimeNavigation(solids[s], points, directions, inside);
+    SolidBenchmark::PrintTiming(names[s], timing, SolidBenchmark::MismatchPercentage(inside, reference));
+  }
+  SolidBenchmark::PrintTiming(names[2], boolean_timing, 0.);
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Timing harness shared by the navigation benchmarks of the detector solids in the subdirectories
+// of unit_test/.
+//
+// A benchmark generates random points in a box around the solid and random isotropic directions
+// with RandomPoints() and passes each representation of the solid to TimeNavigation(). Any class
+// with the navigation methods of G4VSolid can be timed, for example a mother solid with daughter
+// volumes. The time per call of Inside, DistanceToIn(p,v) for points outside, DistanceToOut(p,v)
+// for points inside and of the safety distance for all points is measured.
+//
+// The options -D DETECTOR, -d MAXDEV and -n NPOINTS, which all benchmarks have in common, are
+// parsed by ParseCommonOption().
+
+#pragma once
+
+#include <argp.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "G4PhysicalConstants.hh"
+#include "G4ThreeVector.hh"
+#include "geomdefs.hh"
+
+namespace SolidBenchmark {
+
+struct Arguments {
+  const char *detector;
+  double max_deviation; // In mm
+  unsigned int npoints;
+};
+
+struct Timing {
+  double inside = 0.; // All times in ns per call
+  double distance_to_in = 0.;
+  double distance_to_out = 0.;
+  double safety = 0.;
+};
+
+inline error_t ParseCommonOption(int key, char *arg, Arguments &args) {
+  switch (key) {
+    case ARGP_KEY_ARG:
+    case ARGP_KEY_END:
+      break;
+    case 'D':
+      args.detector = arg;
+      break;
+    case 'd':
+      args.max_deviation = atof(arg);
+      break;
+    case 'n':
+      args.npoints = (unsigned int)atoi(arg);
+      break;
+    default:
+      return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+// Uniformly distributed points in the box between the corners lower and upper, isotropic
+// directions. The random engine has a fixed seed, so all runs use the same points.
+inline void RandomPoints(const G4ThreeVector &lower, const G4ThreeVector &upper, const unsigned int npoints, std::vector<G4ThreeVector> &points, std::vector<G4ThreeVector> &directions) {
+  std::mt19937 random_engine(0);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  const G4ThreeVector size = upper - lower;
+  points.resize(npoints);
+  directions.resize(npoints);
+  G4double cos_theta, phi;
+  for (unsigned int i = 0; i < npoints; ++i) {
+    points[i] = lower + G4ThreeVector(uniform(random_engine) * size.x(), uniform(random_engine) * size.y(), uniform(random_engine) * size.z());
+    cos_theta = 2. * uniform(random_engine) - 1.;
+    phi = twopi * uniform(random_engine);
+    directions[i] = G4ThreeVector(sqrt(1. - cos_theta * cos_theta) * cos(phi), sqrt(1. - cos_theta * cos_theta) * sin(phi), cos_theta);
+  }
+}
+
+inline double NanosecondsPerCall(const std::chrono::steady_clock::time_point &start, const unsigned int ncalls) {
+  return ncalls ? std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ncalls : 0.;
+}
+
+// Returns the time per call of the navigation methods of the solid. The classification of the
+// points by Inside() is returned in inside.
+template <class Solid>
+Timing TimeNavigation(const Solid &solid, const std::vector<G4ThreeVector> &points, const std::vector<G4ThreeVector> &directions, std::vector<EInside> &inside) {
+  const unsigned int npoints = (unsigned int)points.size();
+  Timing timing;
+  G4double sum = 0.;
+
+  inside.resize(npoints);
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < npoints; ++i) {
+    inside[i] = solid.Inside(points[i]);
+  }
+  timing.inside = NanosecondsPerCall(start, npoints);
+
+  unsigned int n_inside = 0, n_outside = 0;
+  for (unsigned int i = 0; i < npoints; ++i) {
+    if (inside[i] == kInside) {
+      ++n_inside;
+    } else if (inside[i] == kOutside) {
+      ++n_outside;
+    }
+  }
+
+  start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < npoints; ++i) {
+    if (inside[i] == kOutside) {
+      sum += solid.DistanceToIn(points[i], directions[i]);
+    }
+  }
+  timing.distance_to_in = NanosecondsPerCall(start, n_outside);
+
+  start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < npoints; ++i) {
+    if (inside[i] == kInside) {
+      sum += solid.DistanceToOut(points[i], directions[i]);
+    }
+  }
+  timing.distance_to_out = NanosecondsPerCall(start, n_inside);
+
+  start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < npoints; ++i) {
+    sum += inside[i] == kInside ? solid.DistanceToOut(points[i]) : solid.DistanceToIn(points[i]);
+  }
+  timing.safety = NanosecondsPerCall(start, npoints);
+
+  // Prevents the compiler from removing the timed calls
+  volatile G4double sink = sum;
+  (void)sink;
+  return timing;
+}
+
+// Percentage of the points which are classified differently
+inline double MismatchPercentage(const std::vector<EInside> &inside, const std::vector<EInside> &reference) {
+  unsigned int n_mismatch = 0;
+  for (size_t i = 0; i < inside.size(); ++i) {
+    if (inside[i] != reference[i]) {
+      ++n_mismatch;
+    }
+  }
+  return inside.size() ? 100. * n_mismatch / (double)inside.size() : 0.;
+}
+
+inline void PrintHeader(const std::string &name, const Arguments &args) {
+  std::cout << "#############################################" << std::endl;
+  std::cout << "> " << name << std::endl;
+  std::cout << "> DETECTOR     : " << args.detector << std::endl;
+  std::cout << "> NPOINTS      : " << args.npoints << std::endl;
+  std::cout << "#############################################" << std::endl;
+}
+
+inline void PrintTimingHeader() {
+  std::cout << std::setw(10) << "solid" << std::setw(14) << "Inside [ns]" << std::setw(18) << "DistToIn(p,v)" << std::setw(18) << "DistToOut(p,v)" << std::setw(14) << "Safety [ns]" << std::setw(14) << "mismatch [%]" << std::endl;
+}
+
+inline void PrintTiming(const std::string &solid_name, const Timing &timing, const double mismatch) {
+  std::cout << std::setw(10) << solid_name << std::setw(14) << timing.inside << std::setw(18) << timing.distance_to_in << std::setw(18) << timing.distance_to_out << std::setw(14) << timing.safety << std::setw(14) << mismatch << std::endl;
+}
+
+} // namespace SolidBenchmark